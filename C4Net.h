@@ -1,34 +1,43 @@
 // C4Net.h
-// VERSION: 1.0.0
+// VERSION: 1.2.0
+// ADDED: events are also published over ESP-NOW when C4_ESPNOW=1
 #pragma once
 #include <Arduino.h>
 #include "Config.h"
+#include "EventJournal.h"
+#include "EspNowRadio.h"
 
 // Declared in Network/State already (no need to include Network.h here)
 void wsSendJson(const String& json);
 
 // ---- Prop -> Scoreboard events ----
 
+// WebSocket (journaled) + ESP-NOW mesh (no-op unless C4_ESPNOW=1)
+inline void c4Publish(const String& j, bool critical) {
+  journalSend(j, critical);
+  espNowPublish(j);
+}
+
 inline void c4SendBombPlanted(uint32_t duration_ms) {
   String j = F("{\"eventType\":\"c4_event\",\"c4_status\":\"bombPlanted\",\"bomb_duration_ms\":");
   j += String(duration_ms);
   j += '}';
-  wsSendJson(j);
+  c4Publish(j, false);
 }
 
 inline void c4SendBombDefused() {
-  wsSendJson(F("{\"eventType\":\"c4_event\",\"c4_status\":\"bombDefused\"}"));
+  c4Publish(F("{\"eventType\":\"c4_event\",\"c4_status\":\"bombDefused\"}"), true);
 }
 
 inline void c4SendBombExploded() {
-  wsSendJson(F("{\"eventType\":\"c4_event\",\"c4_status\":\"bombExploded\"}"));
+  c4Publish(F("{\"eventType\":\"c4_event\",\"c4_status\":\"bombExploded\"}"), true);
 }
 
 inline void c4SendTimePenalty(uint32_t remaining_ms) {
   String j = F("{\"eventType\":\"c4_event\",\"c4_status\":\"timePenalty\",\"remaining_ms\":");
   j += String(remaining_ms);
   j += '}';
-  wsSendJson(j);
+  c4Publish(j, false);
 }
 
 // convenience one-liners for state transitions
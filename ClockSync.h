@@ -0,0 +1,147 @@
+// ClockSync.h
+// VERSION: 1.1.1
+// FIXED: sync_resp is parsed with JsonLite: a missing, truncated or non-numeric t0/t1/t2 is
+//        rejected instead of read as 0
+// ADDED: Tick keyframes carry the countdown rate ("rate", 0 = paused); a rate change forces a keyframe
+// Countdown sync for the scoreboard: RTT/clock-offset estimator + delta-encoded tick encoder.
+// Pure logic (no Arduino calls) so it can be exercised on a host build.
+//
+// RTT samples come from WS pings carrying a 4-byte millis() payload (echoed in the pong).
+// Offset samples come from an NTP-style exchange:
+//   prop  -> {"type":"sync_req","t0":<prop ms>}
+//   board -> {"type":"sync_resp","t0":<echo>,"t1":<board rx ms>,"t2":<board tx ms>}
+// Board clock = prop clock + offset (mod 2^32). The sample with the lowest RTT wins.
+
+#pragma once
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "JsonLite.h"
+
+#ifndef C4_SYNC_HZ
+  #define C4_SYNC_HZ 4                 // countdown ticks per second while the timer runs
+#endif
+#ifndef C4_SYNC_KEYFRAME_MS
+  #define C4_SYNC_KEYFRAME_MS 2000     // full tick at least this often
+#endif
+
+struct ClockSyncEstimator {
+  static const uint8_t WINDOW = 8;
+
+  uint32_t rtt[WINDOW];
+  int32_t  off[WINDOW];
+  uint8_t  hasOff[WINDOW];
+  uint8_t  count;
+  uint8_t  head;
+
+  void reset() { memset(this, 0, sizeof(*this)); }
+
+  void add(uint32_t rttMs, bool withOffset, int32_t offsetMs) {
+    rtt[head] = rttMs;
+    off[head] = offsetMs;
+    hasOff[head] = withOffset ? 1 : 0;
+    head = (head + 1) % WINDOW;
+    if (count < WINDOW) count++;
+  }
+
+  // Ping/pong round trip (no server timestamps)
+  void addRtt(uint32_t rttMs) { add(rttMs, false, 0); }
+
+  // Four-timestamp exchange: t0/t3 on the prop clock, t1/t2 on the board clock
+  void addExchange(uint32_t t0, uint32_t t1, uint32_t t2, uint32_t t3) {
+    int32_t total  = (int32_t)(t3 - t0);
+    int32_t server = (int32_t)(t2 - t1);
+    uint32_t r = (total > server) ? (uint32_t)(total - server) : 0;
+    int32_t o = (int32_t)(((int64_t)(int32_t)(t1 - t0) + (int64_t)(int32_t)(t2 - t3)) / 2);
+    add(r, true, o);
+  }
+
+  // Lowest RTT in the window (least queueing delay); 0 when empty
+  uint32_t rttMs() const {
+    uint32_t best = 0;
+    for (uint8_t i = 0; i < count; i++) if (i == 0 || rtt[i] < best) best = rtt[i];
+    return best;
+  }
+
+  // Spread of the window, a cheap jitter figure
+  uint32_t jitterMs() const {
+    if (!count) return 0;
+    uint32_t lo = rtt[0], hi = rtt[0];
+    for (uint8_t i = 1; i < count; i++) { if (rtt[i] < lo) lo = rtt[i]; if (rtt[i] > hi) hi = rtt[i]; }
+    return hi - lo;
+  }
+
+  // Offset from the lowest-RTT exchange; false until one has completed
+  bool offsetMs(int32_t& out) const {
+    bool found = false;
+    uint32_t best = 0;
+    for (uint8_t i = 0; i < count; i++) {
+      if (!hasOff[i]) continue;
+      if (!found || rtt[i] < best) { best = rtt[i]; out = off[i]; found = true; }
+    }
+    return found;
+  }
+};
+
+// Tick stream while the countdown runs.
+//   keyframe: {"type":"tick","n":N,"ts":T,"rem":R,"dur":D,"rtt":X[,"off":O][,"rate":P]}
+//   delta:    {"type":"tick","n":N,"ts":T[,"d":E]}
+// P is the countdown speed in percent of real time (Countdown.h), omitted at 100, 0 while
+// paused; a change of rate always sends a keyframe. For a delta,
+// rem = prev_rem - (ts - prev_ts) * P / 100 - E (E omitted when 0, i.e. the timer ran as
+// predicted). A gap in n means a tick was missed: wait for the next keyframe.
+struct CountdownTickEncoder {
+  uint32_t n;
+  uint32_t lastTs;
+  uint32_t lastRem;
+  uint32_t lastKeyTs;
+  uint16_t lastRate;
+  bool     primed;
+
+  void reset() { primed = false; }
+
+  size_t encode(uint32_t ts, uint32_t remaining, uint32_t duration, const ClockSyncEstimator& cs,
+                char* out, size_t cap, uint16_t rate = 100) {
+    n++;
+    int len;
+    if (!primed || rate != lastRate || (ts - lastKeyTs) >= C4_SYNC_KEYFRAME_MS) {
+      int32_t o = 0;
+      bool hasO = cs.offsetMs(o);
+      len = snprintf(out, cap, "{\"type\":\"tick\",\"n\":%u,\"ts\":%u,\"rem\":%u,\"dur\":%u,\"rtt\":%u",
+                     (unsigned)n, (unsigned)ts, (unsigned)remaining, (unsigned)duration, (unsigned)cs.rttMs());
+      if (hasO && len > 0 && (size_t)len < cap) len += snprintf(out + len, cap - len, ",\"off\":%d", (int)o);
+      if (rate != 100 && len > 0 && (size_t)len < cap) len += snprintf(out + len, cap - len, ",\"rate\":%u", (unsigned)rate);
+      lastKeyTs = ts;
+      primed = true;
+    } else {
+      uint32_t elapsed = (uint32_t)((uint64_t)(ts - lastTs) * rate / 100);
+      uint32_t predicted = (lastRem > elapsed) ? lastRem - elapsed : 0;
+      int32_t err = (int32_t)(predicted - remaining);
+      len = snprintf(out, cap, "{\"type\":\"tick\",\"n\":%u,\"ts\":%u", (unsigned)n, (unsigned)ts);
+      if (err && len > 0 && (size_t)len < cap) len += snprintf(out + len, cap - len, ",\"d\":%d", (int)err);
+    }
+    if (len > 0 && (size_t)len + 1 < cap) { out[len++] = '}'; out[len] = '\0'; }
+    lastTs = ts;
+    lastRem = remaining;
+    lastRate = rate;
+    return (len > 0 && (size_t)len < cap) ? (size_t)len : 0;
+  }
+};
+
+// Parses {"type":"sync_resp","t0":..,"t1":..,"t2":..}; each t an unsigned 32-bit integer.
+// Returns false for anything else, and leaves t0..t2 alone then.
+inline bool clockSyncParseResp(const char* msg, uint32_t& t0, uint32_t& t1, uint32_t& t2) {
+  if (!msg || !strstr(msg, "sync_resp")) return false;          // cheap filter before tokenizing
+  JsonTok toks[16];
+  int n = jsonTokenize(msg, strlen(msg), toks, 16);
+  if (n < 1 || toks[0].type != JSON_OBJECT) return false;
+  int ti = jsonFind(msg, toks, n, 0, "type");
+  if (ti < 0 || toks[ti].type != JSON_STRING || !jsonEq(msg, toks[ti], "sync_resp")) return false;
+  int a = jsonFind(msg, toks, n, 0, "t0"), b = jsonFind(msg, toks, n, 0, "t1"), c = jsonFind(msg, toks, n, 0, "t2");
+  uint32_t v0, v1, v2;
+  if (a < 0 || b < 0 || c < 0 || !jsonU32(msg, toks[a], v0) || !jsonU32(msg, toks[b], v1) || !jsonU32(msg, toks[c], v2))
+    return false;
+  t0 = v0; t1 = v1; t2 = v2;
+  return true;
+}
@@ -1,11 +1,19 @@
 // Config.h
-// VERSION: 5.0.3
+// VERSION: 5.3.1
 // DATE: 2026-02-07
 // UPDATE: Added Fixed Code, Expanded RFID (30), Arming Cards, Homing Ping
+// UPDATE: Added cmd_token (auth for scoreboard commands, WsCommands.h)
+// CHANGED: Logs go through Log.h
+// CHANGED: Settings struct moved to SettingsLayout.h (host tools lay the config menu out against it)
+// ADDED: PRE_EXPLOSION_BLAST_MS / PRE_EXPLOSION_STROBE_MS (were literals in Game.h and Display.h)
+// FIXED: saveSettings() stored a remote round's values; they are an overlay now (RoundPlan.h)
+// CHANGED: Only declares the two overlay helpers it calls; RoundPlan.h comes in via RoundControl.h
 
 #pragma once
 #include <Arduino.h>
 #include <EEPROM.h>
+#include "Log.h"
+#include "SettingsLayout.h"
 
 // Version
 static const char* FW_VERSION = "5.0.3";
@@ -13,68 +21,14 @@ static const char* FW_VERSION = "5.0.3";
 // EEPROM / Settings
 #define EEPROM_SIZE 512
 // Expanded to 30. Struct size is 12 bytes. 30*12 = 360 bytes.
-// Settings overhead ~60 bytes. Total ~420/512. Safe.
-#define MAX_RFID_UIDS 30
-#define SETTINGS_MAGIC    0xC4C40206 // Bumped magic for structure change
-#define SETTINGS_VERSION  6          
-
-struct Settings {
-  uint32_t magic_number;
-  uint16_t version;
-  uint16_t _pad0;
-
-  // Gameplay
-  uint32_t bomb_duration_ms;
-  uint32_t manual_disarm_time_ms;
-  uint32_t rfid_disarm_time_ms;
-
-  // --- MODES ---
-  uint8_t  sudden_death_mode;  // 0=Off, 1=On
-  uint8_t  dud_enabled;        // 0=Off, 1=On
-  uint8_t  dud_chance;         // 1-100%
-  
-  // --- FIXED CODE ---
-  uint8_t  fixed_code_enabled; // 0=Any 7 digits, 1=Must match fixed_code_val
-  char     fixed_code_val[8];  // The required code
-
-  // --- HARDWARE ---
-  uint8_t  servo_enabled;           // 0=Off, 1=On
-  uint8_t  servo_start_angle;       // e.g., 0
-  uint8_t  servo_end_angle;         // e.g., 90
-  
-  // --- AUDIO ---
-  uint8_t  sound_enabled;           // 0=Off, 1=On
-  uint8_t  sound_volume;            // 0-30
-  
-  // --- SENSORS & EXTRAS ---
-  uint8_t  plant_sensor_enabled;    // 0=Off, 1=On
-  uint8_t  easter_eggs_enabled;     // 0=Off, 1=On
-  uint8_t  explosion_strobe_enabled;// 0=Off, 1=On
-  
-  // --- HOMING PING ---
-  uint8_t  ping_enabled;            // 0=Off, 1=On
-  uint16_t ping_interval_s;         // Seconds between pings
-  uint8_t  ping_light_enabled;      // Flash LED with ping?
-
-  // --- RFID ---
-  int32_t  num_rfid_uids;
-  struct TagUID {
-    uint8_t len;
-    uint8_t bytes[10];
-    uint8_t type; // 0=Disarm (Default), 1=Arming Card
-  } rfid_uids[MAX_RFID_UIDS];
-  
-  // RFID Arming Logic
-  uint8_t  rfid_arming_mode;    // 0=Use Fixed Code, 1=Random Code
-  uint16_t rfid_entry_speed_ms; // Delay between digits (0=Instant)
-
-  // Network
-  uint8_t  wifi_enabled;
-  uint8_t  net_use_mdns;
-  uint32_t scoreboard_ip;
-  uint32_t master_ip;
-  uint16_t scoreboard_port;
-};
+// Settings overhead ~88 bytes. Total ~448/512. Safe.
+// MAX_RFID_UIDS (30) is in SettingsLayout.h
+#define SETTINGS_MAGIC    0xC4C40207 // Bumped magic for structure change
+#define SETTINGS_VERSION  7          
+
+#ifndef WS_CMD_TOKEN
+  #define WS_CMD_TOKEN ""            // factory default; empty = remote commands disabled
+#endif
 
 extern Settings settings;
 
@@ -83,6 +37,8 @@ static constexpr int      CODE_LENGTH              = 7;
 static constexpr uint32_t DOUBLE_TAP_TIMEOUT      = 500;
 static constexpr uint32_t EASTER_EGG_DURATION_MS  = 2000;
 static constexpr uint32_t PRE_EXPLOSION_FADE_MS   = 2500;
+static constexpr uint32_t PRE_EXPLOSION_BLAST_MS  = 4500;   // blast in the detonation track: shell pop + strobe
+static constexpr uint32_t PRE_EXPLOSION_STROBE_MS = 4000;
 static constexpr uint32_t RANDOM_DIGIT_UPDATE_MS  = 150;
 static constexpr uint32_t EASTER_EGG_CYCLE_MS     = 100;
 
@@ -90,7 +46,6 @@ static constexpr uint32_t EASTER_EGG_CYCLE_MS     = 100;
 static constexpr int      BEEP_TONE_FREQ          = 2070; 
 static constexpr uint32_t BEEP_TONE_DURATION_MS   = 225;
 static constexpr int      NEOPIXEL_BRIGHTNESS     = 255;
-static constexpr size_t   CONFIG_INPUT_MAX        = 16;
 
 // ---------------- Helpers ----------------
 inline void factoryResetSettings() {
@@ -140,16 +95,40 @@ inline void factoryResetSettings() {
   settings.scoreboard_ip           = (192u<<24) | (168u<<16) | (0u<<8) | 100u;
   settings.master_ip               = (192u<<24) | (168u<<16) | (0u<<8) |  50u;
   settings.scoreboard_port         = 8080;
+  strncpy(settings.cmd_token, WS_CMD_TOKEN, sizeof(settings.cmd_token) - 1);
 }
 
+// Remote round overlay (RoundControl.h): while a round runs on its own values, the
+// referee's are in settingsBase and saveSettings() writes those
+static Settings settingsBase, settingsApplied;
+static uint8_t  settingsOverlay = 0;   // RoundField bits written over settings
+
+// Defined in RoundPlan.h
+inline void roundOverlaySaveView(Settings& out, Settings& base, Settings& applied, uint8_t fields);
+inline void roundOverlayEnd(Settings& live, Settings& base, Settings& applied, uint8_t fields);
+
 inline bool saveSettings() {
-  EEPROM.put(0, settings);
+  if (settingsOverlay) {
+    Settings out = settings;
+    roundOverlaySaveView(out, settingsBase, settingsApplied, settingsOverlay);
+    EEPROM.put(0, out);
+  } else {
+    EEPROM.put(0, settings);
+  }
   bool ok = EEPROM.commit();
-  if (ok) Serial.println("[CFG] Settings saved to EEPROM.");
-  else    Serial.println("[CFG] EEPROM commit FAILED!");
+  if (ok) LOG_I("[CFG] Settings saved to EEPROM.");
+  else    LOG_E("[CFG] EEPROM commit FAILED!");
   return ok;
 }
 
+// Round over (STANDBY, reset, next round): the referee's values back
+inline void settingsEndRound() {
+  if (!settingsOverlay) return;
+  roundOverlayEnd(settings, settingsBase, settingsApplied, settingsOverlay);
+  settingsOverlay = 0;
+  LOG_I("[CFG] Round settings lifted.");
+}
+
 inline bool settingsStructValid(const Settings& s) {
   if (s.magic_number != SETTINGS_MAGIC) return false;
   if (s.num_rfid_uids < 0 || s.num_rfid_uids > MAX_RFID_UIDS) return false;
@@ -159,18 +138,18 @@ inline bool settingsStructValid(const Settings& s) {
 inline void loadSettings() {
   EEPROM.get(0, settings);
   if (!settingsStructValid(settings)) {
-    Serial.println("[CFG] Invalid settings. Factory reset.");
+    LOG_W("[CFG] Invalid settings. Factory reset.");
     factoryResetSettings();
     saveSettings();
   } else {
-    Serial.println("[CFG] Settings loaded.");
+    LOG_I("[CFG] Settings loaded.");
   }
 }
 
 inline void factoryResetSettingsIfMagicChanged() {
   Settings tmp; EEPROM.get(0, tmp);
   if (tmp.magic_number != SETTINGS_MAGIC) {
-    Serial.println("[CFG] Magic mismatch. Resetting defaults.");
+    LOG_W("[CFG] Magic mismatch. Resetting defaults.");
     factoryResetSettings();
     saveSettings();
   }
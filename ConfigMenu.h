@@ -0,0 +1,162 @@
+// ConfigMenu.h
+// VERSION: 1.0.0
+// The config menu tree (hold '*' on boot), run by MenuTree.h. One row per line on the LCD:
+// the menu it is listed in, what it does and, for settings, the Settings member with its type
+// and range. A new setting is one row here. Pure C++11 so tools/menu_sim.cpp checks and
+// drives this exact table on the host.
+//
+// Actions and custom screens are declared here and defined by the firmware (Game.h) or by the
+// simulator. The static_asserts at the bottom reject rows that point at unknown or unreachable
+// menus, fields whose size does not match their type and labels too wide for the LCD.
+
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include "MenuTree.h"
+#include "SettingsLayout.h"
+
+enum ConfigMenuId : uint8_t {
+  CM_ROOT, CM_FIXED_CODE, CM_DUD, CM_RFID, CM_HARDWARE, CM_AUDIO, CM_SERVO, CM_EFFECTS, CM_PING,
+  CM_NETWORK, CM_COUNT
+};
+
+// --- HOOKS (Game.h) ---
+inline void      menuSaveExit();
+inline void      menuExit();
+inline void      menuApplyVolume();
+inline void      menuApplyNetwork();
+inline void      menuForgetWifi();
+inline void      menuClearTags();
+inline void      tagListEnter();
+inline MenuSound tagListKey(char key, bool& done);
+inline void      tagListRender(MenuLines out);
+inline bool      tagListPoll();
+inline void      portalEnter();
+inline void      portalRender(MenuLines out);
+inline void      portalLeave();
+
+static constexpr MenuScreen TAG_LIST_SCREEN = { tagListEnter, tagListKey, tagListRender, tagListPoll, nullptr };
+static constexpr MenuScreen PORTAL_SCREEN   = { portalEnter, nullptr, portalRender, nullptr, portalLeave };
+
+#define MENU_FIELD(member, type, flags, lo, hi) \
+  { nullptr, type, flags, (uint16_t)offsetof(Settings, member), (uint16_t)sizeof(((Settings*)0)->member), lo, hi }
+
+#define M_MENU(in, label, id)                      { in, MN_MENU,   label, id, 0, {}, nullptr, nullptr, nullptr, nullptr }
+#define M_TOGGLE(in, label, member, off, on)       { in, MN_TOGGLE, label, 0,  0, MENU_FIELD(member, JF_BOOL, 0, 0, 1), off, on, nullptr, nullptr }
+#define M_NUMBER(in, label, member, t, lo, hi, fn) { in, MN_NUMBER, label, 0,  0, MENU_FIELD(member, t, 0, lo, hi), nullptr, nullptr, fn, nullptr }
+#define M_DIGITS(in, label, member, lo, hi)        { in, MN_DIGITS, label, 0,  0, MENU_FIELD(member, JF_STR, JF_DIGITS, lo, hi), nullptr, nullptr, nullptr, nullptr }
+#define M_IP(in, label, member)                    { in, MN_IP,     label, 0,  0, MENU_FIELD(member, JF_IP, JF_NET, 0, 0), nullptr, nullptr, nullptr, nullptr }
+#define M_ACTION(in, label, fn, flags)             { in, MN_ACTION, label, 0,  flags, {}, nullptr, nullptr, fn, nullptr }
+#define M_SCREEN(in, label, screen)                { in, MN_SCREEN, label, 0,  0, {}, nullptr, nullptr, nullptr, &screen }
+
+// Ranges match the REST API's field table (HttpApi.h)
+static constexpr MenuNode CONFIG_MENU[] = {
+  M_NUMBER(CM_ROOT,     "Bomb Time ms",     bomb_duration_ms,      JF_U32, 10000, 3600000, nullptr),
+  M_NUMBER(CM_ROOT,     "Manual Disarm ms", manual_disarm_time_ms, JF_U32, 1, 600000, nullptr),
+  M_NUMBER(CM_ROOT,     "RFID Disarm ms",   rfid_disarm_time_ms,   JF_U32, 1, 600000, nullptr),
+  M_MENU  (CM_ROOT,     "Fixed Code",       CM_FIXED_CODE),
+  M_TOGGLE(CM_ROOT,     "Sudden Death",     sudden_death_mode,     nullptr, nullptr),
+  M_MENU  (CM_ROOT,     "Dud Settings",     CM_DUD),
+  M_MENU  (CM_ROOT,     "RFID Tags",        CM_RFID),
+  M_MENU  (CM_ROOT,     "Hardware & Audio", CM_HARDWARE),
+  M_MENU  (CM_ROOT,     "Network",          CM_NETWORK),
+  M_ACTION(CM_ROOT,     "Save & Exit",      menuSaveExit,          0),
+  M_ACTION(CM_ROOT,     "Exit",             menuExit,              0),
+
+  M_TOGGLE(CM_FIXED_CODE, "Required",       fixed_code_enabled,    nullptr, nullptr),
+  M_DIGITS(CM_FIXED_CODE, "Code",           fixed_code_val,        7, 7),
+
+  M_TOGGLE(CM_DUD,      "Dud Bomb",         dud_enabled,           nullptr, nullptr),
+  M_NUMBER(CM_DUD,      "Chance %",         dud_chance,            JF_U8, 0, 100, nullptr),
+
+  M_SCREEN(CM_RFID,     "Tag List",         TAG_LIST_SCREEN),
+  M_TOGGLE(CM_RFID,     "Arm Code",         rfid_arming_mode,      "FIXED", "RANDOM"),
+  M_NUMBER(CM_RFID,     "Typing ms",        rfid_entry_speed_ms,   JF_U16, 0, 5000, nullptr),
+  M_ACTION(CM_RFID,     "Clear All Tags",   menuClearTags,         MF_CONFIRM),
+
+  M_MENU  (CM_HARDWARE, "Audio",            CM_AUDIO),
+  M_MENU  (CM_HARDWARE, "Servo",            CM_SERVO),
+  M_TOGGLE(CM_HARDWARE, "Plant Sensor",     plant_sensor_enabled,  nullptr, nullptr),
+  M_MENU  (CM_HARDWARE, "FX & Extras",      CM_EFFECTS),
+
+  M_TOGGLE(CM_AUDIO,    "Sound",            sound_enabled,         nullptr, nullptr),
+  M_NUMBER(CM_AUDIO,    "Volume",           sound_volume,          JF_U8, 0, 30, menuApplyVolume),
+
+  M_TOGGLE(CM_SERVO,    "Ejector",          servo_enabled,         nullptr, nullptr),
+  M_NUMBER(CM_SERVO,    "Start Angle",      servo_start_angle,     JF_U8, 0, 180, nullptr),
+  M_NUMBER(CM_SERVO,    "End Angle",        servo_end_angle,       JF_U8, 0, 180, nullptr),
+
+  M_TOGGLE(CM_EFFECTS,  "Strobe",           explosion_strobe_enabled, nullptr, nullptr),
+  M_TOGGLE(CM_EFFECTS,  "Easter Eggs",      easter_eggs_enabled,   nullptr, nullptr),
+  M_MENU  (CM_EFFECTS,  "Homing Ping",      CM_PING),
+
+  M_TOGGLE(CM_PING,     "Ping",             ping_enabled,          nullptr, nullptr),
+  M_NUMBER(CM_PING,     "Interval s",       ping_interval_s,       JF_U16, 5, 3600, nullptr),
+  M_TOGGLE(CM_PING,     "Light",            ping_light_enabled,    nullptr, nullptr),
+
+  M_TOGGLE(CM_NETWORK,  "WiFi",             wifi_enabled,          nullptr, nullptr),
+  M_TOGGLE(CM_NETWORK,  "Server",           net_use_mdns,          "IP", "mDNS"),
+  M_IP    (CM_NETWORK,  "Scoreboard IP",    scoreboard_ip),
+  M_NUMBER(CM_NETWORK,  "Port",             scoreboard_port,       JF_U16, 1, 65535, nullptr),
+  M_IP    (CM_NETWORK,  "Master IP",        master_ip),
+  M_SCREEN(CM_NETWORK,  "WiFi Setup",       PORTAL_SCREEN),
+  M_ACTION(CM_NETWORK,  "Apply Now",        menuApplyNetwork,      0),
+  M_ACTION(CM_NETWORK,  "Forget WiFi",      menuForgetWifi,        MF_CONFIRM),
+};
+static constexpr uint8_t CONFIG_MENU_COUNT = sizeof(CONFIG_MENU) / sizeof(CONFIG_MENU[0]);
+static constexpr MenuTree CONFIG_TREE = { CONFIG_MENU, CONFIG_MENU_COUNT };
+
+static MenuCursor configMenu;
+
+// --- COMPILE-TIME CHECKS ---
+constexpr uint8_t configMenuLen(const char* s) { return *s ? 1 + configMenuLen(s + 1) : 0; }
+
+constexpr uint8_t configMenuOpeners(uint8_t menu, uint8_t i = 0) {
+  return i >= CONFIG_MENU_COUNT ? 0
+       : (CONFIG_MENU[i].kind == MN_MENU && CONFIG_MENU[i].opens == menu) + configMenuOpeners(menu, i + 1);
+}
+constexpr uint8_t configMenuRows(uint8_t menu, uint8_t i = 0) {
+  return i >= CONFIG_MENU_COUNT ? 0 : (CONFIG_MENU[i].parent == menu) + configMenuRows(menu, i + 1);
+}
+constexpr uint8_t configMenuParentOf(uint8_t menu, uint8_t i = 0) {
+  return i >= CONFIG_MENU_COUNT ? (uint8_t)CM_COUNT
+       : (CONFIG_MENU[i].kind == MN_MENU && CONFIG_MENU[i].opens == menu) ? CONFIG_MENU[i].parent
+       : configMenuParentOf(menu, i + 1);
+}
+// Following the openers up from menu ends at the root within CM_COUNT steps
+constexpr bool configMenuReachesRoot(uint8_t menu, uint8_t steps = CM_COUNT) {
+  return menu == CM_ROOT || (steps > 0 && menu < CM_COUNT && configMenuReachesRoot(configMenuParentOf(menu), steps - 1));
+}
+constexpr bool configMenusValid(uint8_t menu = 0) {
+  return menu >= CM_COUNT ||
+         (configMenuRows(menu) > 0 && configMenuOpeners(menu) == (menu == CM_ROOT ? 0 : 1) &&
+          configMenuReachesRoot(menu) && configMenusValid(menu + 1));
+}
+
+constexpr bool configMenuFieldOk(const JsonField& f) {
+  return f.type == JF_U8  ? f.size == 1 && f.max <= 0xFF
+       : f.type == JF_BOOL ? f.size == 1
+       : f.type == JF_U16 ? f.size == 2 && f.max <= 0xFFFF
+       : f.type == JF_U32 ? f.size == 4
+       : f.type == JF_IP  ? f.size == 4
+       : f.type == JF_STR ? (f.flags & JF_DIGITS) && f.max < f.size && f.max < MENU_INPUT_MAX
+       : false;
+}
+constexpr bool configMenuRowOk(const MenuNode& r) {
+  return r.parent < CM_COUNT && configMenuLen(r.label) > 0 && configMenuLen(r.label) <= MENU_COLS - 2 &&
+         (r.kind == MN_MENU    ? r.opens > CM_ROOT && r.opens < CM_COUNT
+        : r.kind == MN_TOGGLE  ? configMenuFieldOk(r.field)
+        : r.kind == MN_NUMBER  ? configMenuFieldOk(r.field) && r.field.type != JF_BOOL && r.field.min <= r.field.max
+        : r.kind == MN_DIGITS  ? configMenuFieldOk(r.field) && r.field.type == JF_STR && r.field.min <= r.field.max
+        : r.kind == MN_IP      ? configMenuFieldOk(r.field) && r.field.type == JF_IP
+        : r.kind == MN_ACTION  ? r.fn != nullptr
+        : r.kind == MN_SCREEN  ? r.screen != nullptr
+        : false);
+}
+constexpr bool configMenuRowsOk(uint8_t i = 0) {
+  return i >= CONFIG_MENU_COUNT || (configMenuRowOk(CONFIG_MENU[i]) && configMenuRowsOk(i + 1));
+}
+
+static_assert(CONFIG_MENU_COUNT < MENU_NONE, "config menu has too many rows");
+static_assert(configMenuRowsOk(), "config menu row: unknown menu, bad field/type/range or label wider than 18");
+static_assert(configMenusValid(), "config menu: every menu needs rows, exactly one opener and a path to the root");
@@ -0,0 +1,193 @@
+// ConnFsm.h
+// VERSION: 1.0.0
+// Scoreboard connection state machine: one explicit phase at a time, capped exponential
+// backoff with jitter, fast-path redial of the last live address, per-phase timing.
+// Pure logic: the caller does the I/O and reports outcomes, so the same machine drives the
+// prop (Network.h) and a host probe against the stand-in server (tools/conn_probe.cpp).
+//
+//   WIFI -> BACKOFF(0) -> RESOLVE -> TCP -> HANDSHAKE -> LIVE
+//   failure in RESOLVE/TCP/HANDSHAKE -> BACKOFF (base << fails, capped, jittered) -> RESOLVE
+//   LIVE dropped -> BACKOFF (short jitter) -> TCP on the last live address (fast path)
+//   WiFi lost in any phase -> WIFI
+
+#pragma once
+#include <stdint.h>
+#include <string.h>
+
+#ifndef CONN_BACKOFF_BASE_MS
+  #define CONN_BACKOFF_BASE_MS 500       // first retry after a failure
+#endif
+#ifndef CONN_BACKOFF_CAP_MS
+  #define CONN_BACKOFF_CAP_MS 30000      // longest wait between attempts
+#endif
+#ifndef CONN_RESOLVE_TIMEOUT_MS
+  #define CONN_RESOLVE_TIMEOUT_MS 3000   // waiting for the resolver to hand out an address
+#endif
+#ifndef CONN_TCP_TIMEOUT_MS
+  #define CONN_TCP_TIMEOUT_MS 3000
+#endif
+#ifndef CONN_HANDSHAKE_TIMEOUT_MS
+  #define CONN_HANDSHAKE_TIMEOUT_MS 3000
+#endif
+
+enum ConnPhase : uint8_t {
+  CONN_WIFI, CONN_RESOLVE, CONN_TCP, CONN_HANDSHAKE, CONN_LIVE, CONN_BACKOFF, CONN_PHASES
+};
+
+inline const char* connPhaseName(uint8_t p) {
+  switch (p) {
+    case CONN_WIFI:      return "wifi";
+    case CONN_RESOLVE:   return "resolve";
+    case CONN_TCP:       return "tcp";
+    case CONN_HANDSHAKE: return "handshake";
+    case CONN_LIVE:      return "live";
+    case CONN_BACKOFF:   return "backoff";
+    default:             return "?";
+  }
+}
+
+struct ConnStats {
+  uint32_t attempts;               // RESOLVE/TCP entries
+  uint32_t lives;                  // successful connects
+  uint32_t drops;                  // LIVE lost
+  uint32_t fastHits;               // connects made on the fast path
+  uint32_t fails[CONN_PHASES];     // failures by the phase they happened in
+  uint32_t lastMs[CONN_PHASES];    // time per phase on the last way back to LIVE
+  uint32_t lastDownMs;             // last outage, drop (or boot) -> LIVE
+  uint32_t maxDownMs;
+  uint32_t lastAttempts;           // attempts the last outage needed
+};
+
+struct ConnFsm {
+  uint8_t   phase;
+  uint32_t  phaseSinceMs;
+  uint32_t  downSinceMs;
+  uint32_t  retryAtMs;
+  uint8_t   failStreak;
+  bool      fastPath;              // next attempt skips RESOLVE
+  bool      fastTry;               // current attempt is on the fast path
+  uint32_t  rng;
+  uint32_t  acc[CONN_PHASES];      // time per phase since going down
+  uint32_t  outageAttempts;
+  ConnStats stats;
+
+  void begin(uint32_t now, uint32_t seed) {
+    memset(this, 0, sizeof(*this));
+    rng = seed;
+    phase = CONN_WIFI;
+    phaseSinceMs = downSinceMs = now;
+  }
+
+  uint32_t random32() {            // xorshift32: only needs to de-correlate props
+    if (!rng) rng = 0x9E3779B9u;
+    rng ^= rng << 13; rng ^= rng >> 17; rng ^= rng << 5;
+    return rng;
+  }
+
+  // Equal jitter: half the capped exponential delay is fixed, the other half random,
+  // so a restarted scoreboard sees its props spread out instead of in lockstep.
+  uint32_t backoffMs(uint8_t fails) {
+    uint32_t d = CONN_BACKOFF_CAP_MS;
+    if (fails < 16) {
+      uint32_t e = (uint32_t)CONN_BACKOFF_BASE_MS << (fails ? fails - 1 : 0);
+      if (e < d) d = e;
+    }
+    return d / 2 + random32() % (d / 2 + 1);
+  }
+
+  void enter(uint8_t p, uint32_t now) {
+    acc[phase] += now - phaseSinceMs;
+    phase = p;
+    phaseSinceMs = now;
+  }
+
+  uint32_t inPhaseMs(uint32_t now) const { return now - phaseSinceMs; }
+
+  // WiFi link state, every loop
+  void wifi(bool up, uint32_t now) {
+    if (!up && phase != CONN_WIFI) {
+      if (phase == CONN_LIVE) lostLive(now);
+      enter(CONN_WIFI, now);
+    } else if (up && phase == CONN_WIFI) {
+      enter(CONN_BACKOFF, now);
+      retryAtMs = now;
+    }
+  }
+
+  // BACKOFF over; the caller may still hold off (gameplay gate)
+  bool due(uint32_t now) const {
+    return phase == CONN_BACKOFF && (int32_t)(now - retryAtMs) >= 0;
+  }
+
+  // Returns the phase entered: CONN_TCP on the fast path (dial the last live address),
+  // CONN_RESOLVE otherwise.
+  uint8_t startAttempt(uint32_t now) {
+    stats.attempts++;
+    outageAttempts++;
+    fastTry = fastPath;
+    fastPath = false;
+    enter(fastTry ? CONN_TCP : CONN_RESOLVE, now);
+    return phase;
+  }
+
+  void resolved(uint32_t now)  { if (phase == CONN_RESOLVE) enter(CONN_TCP, now); }
+  void tcpUp(uint32_t now)     { if (phase == CONN_TCP) enter(CONN_HANDSHAKE, now); }
+
+  void live(uint32_t now) {
+    enter(CONN_LIVE, now);
+    stats.lives++;
+    if (fastTry) stats.fastHits++;
+    memcpy(stats.lastMs, acc, sizeof(acc));
+    stats.lastDownMs = now - downSinceMs;
+    if (stats.lastDownMs > stats.maxDownMs) stats.maxDownMs = stats.lastDownMs;
+    stats.lastAttempts = outageAttempts;
+    failStreak = 0;
+  }
+
+  // The current attempt failed (explicitly or by timeout)
+  void fail(uint32_t now) {
+    if (phase != CONN_RESOLVE && phase != CONN_TCP && phase != CONN_HANDSHAKE) return;
+    stats.fails[phase]++;
+    if (failStreak < 255) failStreak++;
+    enter(CONN_BACKOFF, now);
+    retryAtMs = now + backoffMs(failStreak);
+  }
+
+  // LIVE connection closed (peer, heartbeat or us)
+  void dropped(uint32_t now) {
+    if (phase != CONN_LIVE) { fail(now); return; }
+    lostLive(now);
+    enter(CONN_BACKOFF, now);
+    retryAtMs = now + random32() % (CONN_BACKOFF_BASE_MS + 1);
+  }
+
+  // Deadline for the attempt phases; true once the caller should give up on it
+  bool timedOut(uint32_t now) const {
+    int32_t t = (int32_t)inPhaseMs(now);   // signed: 'now' may predate the last transition
+    switch (phase) {
+      case CONN_RESOLVE:   return t > CONN_RESOLVE_TIMEOUT_MS;
+      case CONN_TCP:       return t > CONN_TCP_TIMEOUT_MS;
+      case CONN_HANDSHAKE: return t > CONN_HANDSHAKE_TIMEOUT_MS;
+      default:             return false;
+    }
+  }
+
+  // Settings changed / new credentials: forget the streak, try as soon as WiFi allows
+  void kick(uint32_t now) {
+    if (phase == CONN_LIVE) lostLive(now);
+    failStreak = 0;
+    fastPath = false;
+    if (phase != CONN_WIFI) enter(CONN_BACKOFF, now);
+    retryAtMs = now;
+  }
+
+  void lostLive(uint32_t now) {
+    stats.drops++;
+    downSinceMs = now;
+    memset(acc, 0, sizeof(acc));
+    outageAttempts = 0;
+    failStreak = 0;
+    fastPath = true;
+    phaseSinceMs = now;            // LIVE time is not outage time
+  }
+};
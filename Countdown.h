@@ -0,0 +1,158 @@
+// Countdown.h
+// VERSION: 1.0.0
+// The bomb countdown as an object: start, pause/resume, a rate multiplier (scenarios that speed
+// the clock up) and add/subtract time (penalties, referee calls). Display, beeps, LEDs, the
+// status APIs and the scoreboard tick stream all read it. Pure C++11 on top of GameClock.h so
+// tools/countdown_sim.cpp runs it on the host.
+//
+// A countdown is "leftUs of countdown time at real time anchorUs, running at ratePct". Every
+// change re-anchors at now, so a pause or a rate change never makes the remaining time jump.
+// deadlineUs is when it reaches 0 in real time, kept up to date by every change, so the
+// per-loop expiry check stays one compare.
+//
+// BeepCadence is the armed beep on countdown time. A pause freezes it mid-cycle and resume
+// continues from there, and at a faster rate it beeps faster.
+
+#pragma once
+#include <stdint.h>
+#include <math.h>
+#include "GameClock.h"
+
+static constexpr uint16_t COUNTDOWN_RATE_1X  = 100;   // percent of real time
+static constexpr uint16_t COUNTDOWN_RATE_MIN = 25;
+static constexpr uint16_t COUNTDOWN_RATE_MAX = 400;
+static constexpr GameUs   COUNTDOWN_NEVER    = ~(GameUs)0;
+
+struct Countdown {
+  uint32_t totalMs;      // length at start; progress = elapsed / total
+  GameUs   anchorUs;     // real time of the last start/pause/resume/rate/add
+  uint64_t leftUs;       // countdown time left at anchorUs
+  uint16_t ratePct;
+  bool     running;
+  bool     paused;
+  GameUs   deadlineUs;   // real time it reaches 0; COUNTDOWN_NEVER while paused or stopped
+
+  void start(uint32_t ms, GameUs now) {
+    totalMs = ms;
+    anchorUs = now;
+    leftUs = gameMsToUs(ms);
+    ratePct = COUNTDOWN_RATE_1X;
+    running = true;
+    paused = false;
+    plan();
+  }
+
+  void stop() { running = false; paused = false; deadlineUs = COUNTDOWN_NEVER; }
+
+  uint64_t leftUsAt(GameUs now) const {
+    if (!running || paused || now <= anchorUs) return leftUs;
+    uint64_t ran = (now - anchorUs) * ratePct / COUNTDOWN_RATE_1X;
+    return ran >= leftUs ? 0 : leftUs - ran;
+  }
+
+  // The per-loop check. Exactly when leftUsAt(now) reaches 0.
+  bool expired(GameUs now) const { return now >= deadlineUs; }
+
+  // Whole ms left, rounded up (0 only once expired)
+  uint32_t leftMs(GameUs now) const {
+    uint64_t us = leftUsAt(now);
+    uint64_t ms = us / GAME_US_PER_MS + (us % GAME_US_PER_MS != 0);
+    return ms > 0xFFFFFFFFull ? 0xFFFFFFFFu : (uint32_t)ms;
+  }
+
+  // 0..totalMs; stays 0 while added time keeps more than totalMs on the clock
+  uint32_t elapsedMs(GameUs now) const {
+    uint32_t left = leftMs(now);
+    return left >= totalMs ? 0 : totalMs - left;
+  }
+
+  // Speed the scoreboard extrapolates with: 0 while paused
+  uint16_t effectiveRate() const { return (!running || paused) ? 0 : ratePct; }
+
+  bool pause(GameUs now) {
+    if (!running || paused) return false;
+    rebase(now);
+    paused = true;
+    plan();
+    return true;
+  }
+
+  bool resume(GameUs now) {
+    if (!running || !paused) return false;
+    anchorUs = now;
+    paused = false;
+    plan();
+    return true;
+  }
+
+  bool setRate(uint16_t pct, GameUs now) {
+    if (!running || pct < COUNTDOWN_RATE_MIN || pct > COUNTDOWN_RATE_MAX) return false;
+    rebase(now);
+    ratePct = pct;
+    plan();
+    return true;
+  }
+
+  // Positive adds countdown time, negative takes it away (not below 0)
+  void addMs(int32_t ms, GameUs now) {
+    if (!running) return;
+    rebase(now);
+    if (ms >= 0) leftUs += gameMsToUs((uint32_t)ms);
+    else {
+      uint64_t cut = gameMsToUs((uint32_t)(-(int64_t)ms));
+      leftUs = cut >= leftUs ? 0 : leftUs - cut;
+    }
+    plan();
+  }
+
+  void rebase(GameUs now) {
+    leftUs = leftUsAt(now);
+    if (now > anchorUs) anchorUs = now;
+  }
+
+  // Rounded up so expired() and leftUsAt() == 0 agree to the µs
+  void plan() {
+    if (!running || paused) { deadlineUs = COUNTDOWN_NEVER; return; }
+    uint64_t scaled = leftUs * COUNTDOWN_RATE_1X;
+    deadlineUs = anchorUs + scaled / ratePct + (scaled % ratePct != 0);
+  }
+};
+
+// The armed beep: 1.05 * 1.039^(45 * progress) beeps per second, at least every 50 ms, with a
+// tone of baseToneMs (shorter once beeps are less than two tones apart, never under 60 ms).
+// The curve is recomputed every 100 ms of countdown time.
+struct BeepCadence {
+  uint32_t baseToneMs;
+  uint32_t intervalMs;
+  uint32_t toneMs;
+  uint32_t curveAtMs;    // countdown ms the curve was last computed at
+  uint32_t beepAtMs;     // countdown ms the current beep started at
+  bool     primed;
+
+  void reset(uint32_t toneMs_) {
+    baseToneMs = toneMs = toneMs_;
+    intervalMs = 1000;
+    curveAtMs = beepAtMs = 0;
+    primed = false;
+  }
+
+  void curve(uint32_t elapsedMs, uint32_t totalMs) {
+    if (elapsedMs > totalMs) elapsedMs = totalMs;
+    float progress = totalMs ? (float)elapsedMs / (float)totalMs : 1.0f;
+    float bps = 1.05f * powf(1.039f, progress * 45.0f);
+    intervalMs = (uint32_t)(1000.0f / bps);
+    if (intervalMs < 50) intervalMs = 50;
+    toneMs = (intervalMs < baseToneMs * 2) ? intervalMs / 2 : baseToneMs;
+    if (toneMs < 60) toneMs = 60;
+    curveAtMs = elapsedMs;
+  }
+
+  // True while the tone should sound at elapsedMs of a totalMs countdown
+  bool update(uint32_t elapsedMs, uint32_t totalMs) {
+    if (!primed) { curve(elapsedMs, totalMs); beepAtMs = elapsedMs; primed = true; }
+    else if (elapsedMs < curveAtMs || elapsedMs - curveAtMs > 100) curve(elapsedMs, totalMs);
+    if (elapsedMs < beepAtMs) beepAtMs = elapsedMs;             // time was added: restart the cycle
+    if (elapsedMs - beepAtMs >= intervalMs) beepAtMs = elapsedMs;
+    return elapsedMs - beepAtMs < toneMs;
+  }
+};
@@ -0,0 +1,275 @@
+// EspNowLink.h
+// VERSION: 1.1.0
+// FIXED: A copy heard with a lower TTL no longer stops the relay from forwarding a later,
+//        higher-TTL copy; the base delivers once per (origin, epoch, seq) from its own
+//        per-origin window, not from the relay cache its acks also filled
+// Reliable broadcast link for C4Net events over a flat ESP-NOW mesh.
+// Props originate events, relays re-broadcast them (TTL + duplicate cache),
+// the base station delivers them and broadcasts an ack back along the same path.
+//   - relay cache: (type, origin, epoch, seq, attempt) and the highest TTL heard. A copy
+//     with more hops left than any before it is forwarded again, so a short-cut copy that
+//     arrived first cannot strand the event on a deep path.
+//   - delivery: per origin, the highest seq delivered in its current epoch and a bitmap of
+//     the ENL_WINDOW seqs below it. Seqs restart at 1 every boot; the epoch (boot counter)
+//     tells a rebooted prop's seq 1 from a late copy of the old one.
+// Pure logic: the radio is a function pointer, so a host program can run many nodes.
+
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#ifndef ENL_MAX_PAYLOAD
+  #define ENL_MAX_PAYLOAD 200     // JSON bytes per packet (ESP-NOW frame limit is 250)
+#endif
+#ifndef ENL_OUTBOX
+  #define ENL_OUTBOX 8            // unacked events a node keeps retrying
+#endif
+#ifndef ENL_SEEN
+  #define ENL_SEEN 64             // duplicate-suppression cache entries
+#endif
+#ifndef ENL_TTL
+  #define ENL_TTL 8               // max hops (a line of props with range r needs n / r)
+#endif
+#ifndef ENL_ORIGINS
+  #define ENL_ORIGINS 32          // props the base keeps delivery windows for
+#endif
+
+static const uint8_t  ENL_MAGIC      = 0xC5;  // 0xC4 frames had no epoch
+static const uint8_t  ENL_WINDOW     = 64;    // seqs below the highest still told apart
+static const uint32_t ENL_RETRY_MS   = 150;   // first retransmit; doubles each try
+static const uint8_t  ENL_MAX_TRIES  = 8;
+
+enum EnlType : uint8_t { ENL_EVENT = 1, ENL_ACK = 2 };
+enum EnlRole : uint8_t { ENL_ROLE_PROP = 0, ENL_ROLE_RELAY = 1, ENL_ROLE_BASE = 2 };
+
+struct __attribute__((packed)) EnlHeader {
+  uint8_t  magic;
+  uint8_t  type;
+  uint16_t origin;      // node id of the prop that created the event
+  uint16_t epoch;       // origin's boot counter
+  uint16_t seq;         // per-origin sequence number, restarts at 1 every boot
+  uint8_t  ttl;         // hops left
+  uint8_t  attempt;     // retransmission number; relays treat each attempt as a new frame
+  uint8_t  len;         // payload bytes (0 for acks)
+};
+
+static const size_t ENL_FRAME_MAX = sizeof(EnlHeader) + ENL_MAX_PAYLOAD;
+
+// Broadcast one frame / hand one delivered event to the application
+typedef void (*EnlTxFn)(void* ctx, const uint8_t* frame, size_t len);
+typedef void (*EnlDeliverFn)(void* ctx, uint16_t origin, uint16_t epoch, uint16_t seq, const char* json, size_t len);
+
+struct EnlPending {
+  bool     used;
+  uint8_t  tries;
+  uint8_t  len;
+  uint16_t seq;
+  uint32_t firstMs;
+  uint32_t nextMs;
+  uint8_t  frame[ENL_FRAME_MAX];
+};
+
+struct EnlSeen {
+  uint16_t origin;
+  uint16_t epoch;
+  uint16_t seq;
+  uint8_t  type;        // 0 = empty
+  uint8_t  attempt;
+  uint8_t  ttl;         // most hops left of any copy heard
+};
+
+// Base only: what has been delivered from one origin
+struct EnlOrigin {
+  bool     used;
+  uint16_t origin;
+  uint16_t epoch;
+  uint16_t high;        // highest seq delivered in this epoch
+  uint64_t window;      // bit i: seq high - i delivered
+  uint32_t lastMs;      // last heard; the stalest entry makes room for a new origin
+};
+
+struct EnlStats {
+  uint32_t sent, retries, acked, failed, relayed, delivered, dupes, bad;
+  uint32_t ackLatencySumMs, ackLatencyMaxMs;
+};
+
+struct EspNowNode {
+  uint16_t     id;
+  uint16_t     epoch;
+  uint8_t      role;
+  EnlTxFn      tx;
+  EnlDeliverFn deliver;
+  void*        ctx;
+  uint16_t     nextSeq;
+  EnlPending   out[ENL_OUTBOX];
+  EnlSeen      seen[ENL_SEEN];
+  uint8_t      seenHead;
+  EnlOrigin    origins[ENL_ORIGINS];
+  EnlStats     stats;
+
+  // bootEpoch: a counter the caller persists and bumps every boot
+  void begin(uint16_t nodeId, uint16_t bootEpoch, uint8_t nodeRole, EnlTxFn txFn, EnlDeliverFn deliverFn, void* userCtx) {
+    memset(this, 0, sizeof(*this));
+    id = nodeId; epoch = bootEpoch; role = nodeRole; tx = txFn; deliver = deliverFn; ctx = userCtx;
+    nextSeq = 1;
+  }
+
+  // Originate an event. False if it does not fit or the outbox is full.
+  bool send(const char* json, size_t len, uint32_t now) {
+    if (len > ENL_MAX_PAYLOAD) return false;
+    EnlPending* p = nullptr;
+    for (uint8_t i = 0; i < ENL_OUTBOX && !p; i++) if (!out[i].used) p = &out[i];
+    if (!p) { stats.failed++; return false; }
+
+    EnlHeader h = { ENL_MAGIC, ENL_EVENT, id, epoch, nextSeq++, ENL_TTL, 0, (uint8_t)len };
+    memcpy(p->frame, &h, sizeof(h));
+    memcpy(p->frame + sizeof(h), json, len);
+    p->used = true;
+    p->len = (uint8_t)(sizeof(h) + len);
+    p->seq = h.seq;
+    p->tries = 1;
+    p->firstMs = now;
+    p->nextMs = now + ENL_RETRY_MS;
+    markSeen(h);                         // ignore our own event when a relay echoes it
+    transmit(p->frame, p->len);
+    stats.sent++;
+    return true;
+  }
+
+  void onReceive(const uint8_t* frame, size_t len, uint32_t now) {
+    EnlHeader h;
+    if (len < sizeof(h)) { stats.bad++; return; }
+    memcpy(&h, frame, sizeof(h));
+    if (h.magic != ENL_MAGIC || sizeof(h) + h.len != len || h.len > ENL_MAX_PAYLOAD) { stats.bad++; return; }
+
+    if (h.type == ENL_ACK && h.origin == id) {
+      if (h.epoch == epoch) retire(h.seq, now);
+      return;
+    }
+
+    // Same frame heard again (another relay path). A copy with more hops left than any
+    // before it goes out again: the first one may have come the long way round.
+    EnlSeen* s = findSeen(h);
+    if (s && (h.ttl <= s->ttl || role != ENL_ROLE_RELAY)) { stats.dupes++; return; }
+    if (s) s->ttl = h.ttl;
+    else markSeen(h);
+
+    if (h.type == ENL_EVENT && role == ENL_ROLE_BASE) {
+      // A retransmission means our ack got lost: ack again, don't deliver again
+      if (!firstDelivery(h, now)) { stats.dupes++; sendAck(h.origin, h.epoch, h.seq, h.attempt); return; }
+      stats.delivered++;
+      if (deliver) deliver(ctx, h.origin, h.epoch, h.seq, (const char*)frame + sizeof(h), h.len);
+      sendAck(h.origin, h.epoch, h.seq, h.attempt);
+      return;
+    }
+
+    // Relay anything else that still has hops left
+    if (role == ENL_ROLE_RELAY && h.ttl > 1) {
+      uint8_t fwd[ENL_FRAME_MAX];
+      memcpy(fwd, frame, len);
+      ((EnlHeader*)fwd)->ttl = h.ttl - 1;
+      transmit(fwd, len);
+      stats.relayed++;
+    }
+  }
+
+  // Retransmit unacked events with exponential backoff; call every loop.
+  void poll(uint32_t now) {
+    for (uint8_t i = 0; i < ENL_OUTBOX; i++) {
+      EnlPending& p = out[i];
+      if (!p.used || (int32_t)(now - p.nextMs) < 0) continue;
+      if (p.tries >= ENL_MAX_TRIES) { p.used = false; stats.failed++; continue; }
+      ((EnlHeader*)p.frame)->attempt = p.tries;
+      markSeen(*(const EnlHeader*)p.frame);
+      transmit(p.frame, p.len);
+      stats.retries++;
+      p.nextMs = now + (ENL_RETRY_MS << p.tries);
+      p.tries++;
+    }
+  }
+
+  uint8_t pending() const {
+    uint8_t n = 0;
+    for (uint8_t i = 0; i < ENL_OUTBOX; i++) if (out[i].used) n++;
+    return n;
+  }
+
+  // ---- internals ----
+  void transmit(const uint8_t* frame, size_t len) { if (tx) tx(ctx, frame, len); }
+
+  void sendAck(uint16_t origin, uint16_t originEpoch, uint16_t seq, uint8_t attempt) {
+    EnlHeader a = { ENL_MAGIC, ENL_ACK, origin, originEpoch, seq, ENL_TTL, attempt, 0 };
+    markSeen(a);
+    transmit((const uint8_t*)&a, sizeof(a));
+  }
+
+  void retire(uint16_t seq, uint32_t now) {
+    for (uint8_t i = 0; i < ENL_OUTBOX; i++) {
+      if (!out[i].used || out[i].seq != seq) continue;
+      uint32_t lat = now - out[i].firstMs;
+      stats.acked++;
+      stats.ackLatencySumMs += lat;
+      if (lat > stats.ackLatencyMaxMs) stats.ackLatencyMaxMs = lat;
+      out[i].used = false;
+    }
+  }
+
+  EnlSeen* findSeen(const EnlHeader& h) {
+    for (uint8_t i = 0; i < ENL_SEEN; i++) {
+      EnlSeen& s = seen[i];
+      if (s.type == h.type && s.origin == h.origin && s.epoch == h.epoch && s.seq == h.seq &&
+          s.attempt == h.attempt) return &s;
+    }
+    return nullptr;
+  }
+
+  void markSeen(const EnlHeader& h) {
+    EnlSeen& s = seen[seenHead];
+    s.origin = h.origin;
+    s.epoch = h.epoch;
+    s.seq = h.seq;
+    s.type = h.type;
+    s.attempt = h.attempt;
+    s.ttl = h.ttl;
+    seenHead = (seenHead + 1) % ENL_SEEN;
+  }
+
+  // Base: true the first time (origin, epoch, seq) arrives. A newer epoch starts the origin
+  // over; frames from an older one (the prop has rebooted since) count as delivered, and so
+  // does a seq more than ENL_WINDOW below the highest, long past its sender's retry budget.
+  bool firstDelivery(const EnlHeader& h, uint32_t now) {
+    EnlOrigin* o = nullptr;
+    EnlOrigin* stalest = &origins[0];
+    for (uint8_t i = 0; i < ENL_ORIGINS && !o; i++) {
+      if (origins[i].used && origins[i].origin == h.origin) o = &origins[i];
+      else if (!origins[i].used) { if (stalest->used) stalest = &origins[i]; }
+      else if (stalest->used && (int32_t)(origins[i].lastMs - stalest->lastMs) < 0) stalest = &origins[i];
+    }
+    if (!o) {
+      o = stalest;
+      o->used = false;
+    }
+    o->lastMs = now;
+    if (!o->used || (int16_t)(h.epoch - o->epoch) > 0) {
+      o->used = true;
+      o->origin = h.origin;
+      o->epoch = h.epoch;
+      o->high = h.seq;
+      o->window = 1;
+      return true;
+    }
+    if (h.epoch != o->epoch) return false;
+    int16_t d = (int16_t)(h.seq - o->high);
+    if (d > 0) {
+      o->window = d >= ENL_WINDOW ? 1 : (o->window << d) | 1;
+      o->high = h.seq;
+      return true;
+    }
+    if (-d >= ENL_WINDOW) return false;
+    uint64_t bit = (uint64_t)1 << -d;
+    if (o->window & bit) return false;
+    o->window |= bit;
+    return true;
+  }
+};
@@ -0,0 +1,128 @@
+// EspNowRadio.h
+// VERSION: 1.1.0
+// FIXED: Frames carry a boot epoch (kept in Preferences) and the base forwards it, so the
+//        scoreboard can tell a rebooted prop's seq 1 from a repeat
+// CHANGED: Logs go through Log.h (callbacks only queue records)
+// Optional ESP-NOW transport (C4_ESPNOW=1) running alongside the WebSocket.
+// Wires EspNowLink.h to the radio: broadcast TX, RX callback -> queue -> loop().
+// All nodes must share a WiFi channel (the AP's channel when STA is connected).
+
+#pragma once
+#include <Arduino.h>
+#include "Log.h"
+
+#ifndef C4_ESPNOW
+  #define C4_ESPNOW 0                   // 1 = also publish C4Net events over ESP-NOW
+#endif
+#ifndef C4_ESPNOW_ROLE
+  #define C4_ESPNOW_ROLE 1              // 0 = prop, 1 = prop that relays for others, 2 = base station
+#endif
+
+#if C4_ESPNOW
+
+#include <WiFi.h>
+#include <esp_now.h>
+#include <Preferences.h>
+#include "EspNowLink.h"
+
+// Declared in Network.h
+void wsSendJson(const String& json);
+
+struct EnlRxItem {
+  uint8_t len;
+  uint8_t frame[ENL_FRAME_MAX];
+};
+
+static EspNowNode    enlNode;
+static QueueHandle_t enlRxQueue = nullptr;
+static bool          enlStarted = false;
+static uint32_t      enlRxOverflow = 0;
+static const uint8_t ENL_BROADCAST[ESP_NOW_ETH_ALEN] = { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+
+// WiFi task context: copy and hand off, never touch enlNode here
+inline void enlRecvCb(const uint8_t* mac, const uint8_t* data, int len) {
+  (void)mac;
+  if (len <= 0 || (size_t)len > ENL_FRAME_MAX) return;
+  EnlRxItem item;
+  item.len = (uint8_t)len;
+  memcpy(item.frame, data, len);
+  if (xQueueSend(enlRxQueue, &item, 0) != pdPASS) enlRxOverflow++;
+}
+
+inline void enlTx(void*, const uint8_t* frame, size_t len) {
+  esp_now_send(ENL_BROADCAST, frame, len);
+}
+
+// Base station: forward mesh events to the scoreboard over the WebSocket
+inline void enlDeliver(void*, uint16_t origin, uint16_t epoch, uint16_t seq, const char* json, size_t len) {
+  String j = F("{\"type\":\"mesh\",\"from\":");
+  j += String(origin);
+  j += F(",\"epoch\":");
+  j += String(epoch);
+  j += F(",\"seq\":");
+  j += String(seq);
+  j += F(",\"msg\":");
+  j.concat(json, len);
+  j += '}';
+  LOG_I("[MESH] Event %u/%u/%u delivered", (unsigned)origin, (unsigned)epoch, (unsigned)seq);
+  wsSendJson(j);
+}
+
+// Call once WiFi is in STA mode. Safe to call repeatedly.
+inline void espNowBegin() {
+  if (enlStarted) return;
+  if (esp_now_init() != 0) { LOG_E("[MESH] esp_now_init failed."); return; }
+
+  esp_now_peer_info_t peer;
+  memset(&peer, 0, sizeof(peer));
+  memcpy(peer.peer_addr, ENL_BROADCAST, ESP_NOW_ETH_ALEN);
+  peer.channel = 0;                     // follow the current STA channel
+  peer.encrypt = false;
+  if (!esp_now_is_peer_exist(ENL_BROADCAST)) esp_now_add_peer(&peer);
+
+  enlRxQueue = xQueueCreate(8, sizeof(EnlRxItem));
+  esp_now_register_recv_cb(enlRecvCb);
+
+  // Boot counter: seqs restart at 1, the epoch says which boot they belong to
+  Preferences p;
+  p.begin("c4mesh", false);
+  uint16_t epoch = p.getUShort("epoch", 0) + 1;
+  p.putUShort("epoch", epoch);
+  p.end();
+
+  uint16_t id = (uint16_t)(ESP.getEfuseMac() >> 32);   // last two bytes of the MAC
+  enlNode.begin(id, epoch, C4_ESPNOW_ROLE, enlTx, enlDeliver, nullptr);
+  enlStarted = true;
+  LOG_I("[MESH] ESP-NOW up: node=%u epoch=%u role=%u", (unsigned)id, (unsigned)epoch, (unsigned)C4_ESPNOW_ROLE);
+}
+
+inline void espNowLoop() {
+  if (!enlStarted) return;
+  EnlRxItem item;
+  uint32_t now = millis();
+  while (xQueueReceive(enlRxQueue, &item, 0) == pdTRUE) enlNode.onReceive(item.frame, item.len, now);
+  enlNode.poll(now);
+}
+
+inline void espNowPublish(const String& json) {
+  if (!enlStarted || C4_ESPNOW_ROLE == ENL_ROLE_BASE) return;
+  if (!enlNode.send(json.c_str(), json.length(), millis())) LOG_W("[MESH] Event not queued (outbox full or too long).");
+}
+
+inline void espNowPrintStatus(Print& out) {
+  const EnlStats& s = enlNode.stats;
+  out.printf("[MESH] node=%u epoch=%u role=%u pending=%u sent=%u retries=%u acked=%u failed=%u relayed=%u delivered=%u dupes=%u bad=%u rx_overflow=%u ack_ms avg=%u max=%u\n",
+             (unsigned)enlNode.id, (unsigned)enlNode.epoch, (unsigned)enlNode.role, (unsigned)enlNode.pending(), (unsigned)s.sent,
+             (unsigned)s.retries, (unsigned)s.acked, (unsigned)s.failed, (unsigned)s.relayed, (unsigned)s.delivered,
+             (unsigned)s.dupes, (unsigned)s.bad, (unsigned)enlRxOverflow,
+             (unsigned)(s.acked ? s.ackLatencySumMs / s.acked : 0), (unsigned)s.ackLatencyMaxMs);
+}
+
+#else  // !C4_ESPNOW
+
+inline void espNowBegin() {}
+inline void espNowLoop() {}
+inline void espNowPublish(const String&) {}
+inline void espNowPrintStatus(Print& out) { out.println("[MESH] Disabled (build with C4_ESPNOW=1)."); }
+
+#endif // C4_ESPNOW
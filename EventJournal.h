@@ -0,0 +1,79 @@
+// EventJournal.h
+// VERSION: 2.0.0
+// CHANGED: Queue logic moved to JournalCore.h behind a storage interface
+// FIXED: unacked events were retired when the first ack took over 3 s (legacy scoreboards are now
+//        -DJOURNAL_SERVER_ACKS=0); duplicate acks held off the retransmit; an ack for a new epoch
+//        retired the old epoch's unacked events
+// Guaranteed-delivery outbox for C4Net events (plant/defuse/explode/penalty).
+// Every event gets (epoch, seq); epoch = boot counter, seq = per-boot counter.
+// Storage: RAM ring for new events, NVS (flash) FIFO for older/persisted ones.
+// Replay order is always flash FIFO first, then the RAM ring.
+// The scoreboard acks cumulatively with {"type":"ack","epoch":E,"seq":S}.
+// This file is the prop's glue: Preferences as the store, the WS batch as the sink.
+
+#pragma once
+#include <Arduino.h>
+#include "Log.h"
+#include <Preferences.h>
+#include "Config.h"
+#include "WsBatch.h"
+#include "JournalCore.h"
+
+// Declared in Network.h
+void wsSendJson(const String& json);
+
+static Journal     jr;
+static Preferences jrPrefs;
+static bool        jrEnabled = false;
+
+inline uint32_t jrPrefsGetU32(void*, const char* key, uint32_t def) { return jrPrefs.getUInt(key, def); }
+inline void     jrPrefsPutU32(void*, const char* key, uint32_t v) { jrPrefs.putUInt(key, v); }
+inline bool jrPrefsGetBytes(void*, const char* key, void* buf, size_t len) { return jrPrefs.getBytes(key, buf, len) == len; }
+inline void jrPrefsPutBytes(void*, const char* key, const void* buf, size_t len) { jrPrefs.putBytes(key, buf, len); }
+
+inline void jrWsSend(void*, const char* json, size_t len, bool critical) { wsBatchPush(json, len, critical); }
+
+inline uint32_t journalPending() { return jr.pending(); }
+
+// ---- Public API ----
+
+// Call when networking comes up. Until then (WiFi off) events bypass the journal.
+inline void journalBegin(bool enabled) {
+  if (jrEnabled || !enabled) return;
+  jrEnabled = true;
+
+  jrPrefs.begin("c4jrnl", false);
+  JournalStore store = { nullptr, jrPrefsGetU32, jrPrefsPutU32, jrPrefsGetBytes, jrPrefsPutBytes };
+  jr.begin(store, jrWsSend, nullptr);
+  LOG_I("[JRNL] epoch=%u, %u undelivered event(s) from flash",
+                (unsigned)jr.epoch, (unsigned)jr.flashCount());
+}
+
+// Queue a c4_event JSON object ("{...}") for delivery. Adds "epoch"/"seq".
+inline void journalSend(const String& body, bool critical) {
+  if (!jrEnabled) { wsSendJson(body); return; }
+  jr.add(body.c_str(), critical);
+}
+
+// Cumulative ack from the scoreboard. Duplicate/old acks are harmless.
+inline void journalAck(uint32_t epoch, uint32_t seq) {
+  jr.ack(epoch, seq, millis());
+}
+
+// Parses {"type":"ack","epoch":E,"seq":S}. Returns true if msg was an ack.
+inline bool journalHandleAckMessage(const char* msg) {
+  return jr.handleAckMessage(msg, millis());
+}
+
+// Call every loop. allowFlash=false during interactive gameplay (NVS writes take ms).
+inline void journalPump(bool connected, bool allowFlash) {
+  if (!jrEnabled) return;
+  jr.pump(connected, allowFlash, millis());
+}
+
+inline void journalPrintStatus(Print& out) {
+  out.printf("[JRNL] epoch=%u next_seq=%u pending=%u (flash=%u ram=%u) in_flight=%u delivered=%u dropped=%u retx=%u acks=%s\n",
+             (unsigned)jr.epoch, (unsigned)jr.nextSeq, (unsigned)jr.pending(), (unsigned)jr.flashCount(),
+             (unsigned)jr.ramCount, (unsigned)jr.sendPos, (unsigned)jr.delivered, (unsigned)jr.dropped,
+             (unsigned)jr.retransmits, !JOURNAL_SERVER_ACKS ? "off" : jr.serverAcks ? "yes" : "no");
+}
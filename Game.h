@@ -1,23 +1,33 @@
 // Game.h
-// VERSION: 6.5.0
-// UPDATE: Added Delete Logic for individual RFID cards
+// VERSION: 6.12.0
+// CHANGED: The shell pop waits (briefly) for room in the power budget (Power.h)
+// CHANGED: Beeps follow the bomb Countdown (BeepCadence): silent while paused, faster at a higher rate
+// CHANGED: Bomb/disarm checks compare against GameClock.h deadlines; time penalty moves the deadline
+// CHANGED: Config menu is the ConfigMenu.h table; only its actions and the tag/portal screens live here
+// CHANGED: Mode bools replaced by GameModes.h hooks; Star Wars lobby keys go through its onKey
+// CHANGED: Special codes are rows in SpecialCodes.h (hashed lookup) instead of a strcmp chain
+// CHANGED: Handlers raise StateTable.h events instead of picking states; serviceGameplay dispatches through STATE_TICK
+// CHANGED: Arm switch ignored while a firmware update holds the gameplay lock (Ota.h)
+// ADDED: RFID read/invalid counters (Metrics.h); logs via Log.h
 // FIXED: Auto-Typing persistence logic is now in State.h
 
 #pragma once
 #include <Arduino.h>
 #include "State.h"
+#include "SpecialCodes.h"
+#include "GameModes.h"
 #include "Hardware.h"
 #include "Display.h"
 #include "Utils.h"
 #include "Network.h"
 #include "C4Net.h"
 #include "PlantSensor.h"
+#include "Profiler.h"
+
+// --- HOOKS (Power.h) ---
+inline bool powerServoMayStart();   // false while the pop's start-up surge does not fit the budget
 
 // Global Flags
-bool doomModeActive = false;
-bool starWarsModeActive = false;
-bool terminatorModeActive = false;
-bool bondModeActive = false;
 bool suddenDeathActive = false;
 bool easterEggActive = false; 
 
@@ -30,75 +40,63 @@ uint32_t lastPingTime = 0; // For homing ping
 // Cache for unsaved RAM settings
 uint32_t stored_duration_ram = 0;
 
-inline bool parseIpFromBuffer(const char* buf, uint32_t& out) {
-  int a,b,c,d;
-  if (sscanf(buf, "%d.%d.%d.%d", &a,&b,&c,&d) == 4) {
-    if (a<0||b<0||c<0||d<0||a>255||b>255||c>255||d>255) return false;
-    out = (uint32_t)( (a<<24) | (b<<16) | (c<<8) | d );
-    return true;
-  }
-  return false;
-}
-
 inline void handleArmSwitch() {
-  if (currentState == STARWARS_PRE_GAME && armSwitch.rose()) {
-     safePlay(SOUND_POWER_LIGHTSABER);
-  }
+  if (gameplayLocked) return;    // firmware update running: stay in STANDBY, no sounds
 
   if (settings.sudden_death_mode) {
     if (armSwitch.rose()) { 
-       if (currentState == STANDBY || currentState == PROP_IDLE) {
+       if (stateAccepts(EV_SD_ARM_ON)) {
           if (!isBombPlanted()) {
              safePlay(SOUND_MENU_CANCEL);
              return;
           }
           suddenDeathActive = true;
-          bombArmedTimestamp = millis();
+          bombClockStart();
           safePlay(SOUND_BOMB_PLANTED);
-          setState(ARMED);
-       }
-    } else if (armSwitch.fell()) { 
-       if (currentState == ARMED && suddenDeathActive) {
-          setState(DISARMED);
-       }
-       if ((currentState == EXPLODED || currentState == DISARMED) && suddenDeathActive) {
-          setState(STANDBY);
+          stateFire(EV_SD_ARM_ON);
        }
+    } else if (armSwitch.fell() && suddenDeathActive) { 
+       // ARMED -> DISARMED -> STANDBY on a single flip
+       if (stateFire(EV_SD_ARM_OFF) && currentState == DISARMED) stateFire(EV_SD_ARM_OFF);
     }
     return; 
   }
 
   if (armSwitch.rose()) {
-    if (currentState == DISARMED || currentState == EXPLODED || currentState == PROP_IDLE || currentState == AWAIT_ARM_TOGGLE || currentState == PROP_DUD) {
+    if (stateAccepts(EV_ARM_ON)) {
       resetSpecialModes(); 
-      setState(STANDBY);
+      stateFire(EV_ARM_ON);
     }
   } else if (armSwitch.fell()) {
-    if (currentState == STANDBY) {
+    if (stateAccepts(EV_ARM_OFF)) {
         lastPingTime = millis(); // Reset ping timer
-        setState(PROP_IDLE);
+        stateFire(EV_ARM_OFF);
     }
   }
 }
 
+// Applies one SpecialCodes.h row, in the order the per-code branches used to
+inline void applySpecialCode(const SpecialCode& sc, const char* code) {
+    if (sc.mode != GM_NONE) gameModeStart(sc.mode);
+    if (sc.line1) centerPrintC(sc.line1, 1);
+    if (sc.line2) centerPrintC(sc.line2, 2);
+    if (sc.flags & SC_ARM_CODE)   strcpy(activeArmCode, code);
+    if (sc.durationMs) { stored_duration_ram = settings.bomb_duration_ms; settings.bomb_duration_ms = sc.durationMs; }
+    if (sc.flags & SC_START_CLOCK) bombClockStart();
+    if (sc.sound) safePlay(sc.sound);
+    if (sc.flags & SC_SERVO_TEST) startShellEjectorSequence();
+    if (sc.holdMs) taggedDelay(sc.holdMs, STALL_TAG_ARMING_DELAY);
+    if (sc.flags & SC_CLEAR_ENTRY) enteredCode[0] = '\0';
+    if (sc.flags & SC_ON_ARMED)   c4OnEnterArmed();
+    if (sc.event != EV_NONE) stateFire((StateEvent)sc.event);
+}
+
 inline void processArmingCode(const char* code) {
-    bool ee = settings.easter_eggs_enabled;
-    // ... check for special codes first ...
-    if (ee && strcmp(code, "501") == 0) { setState(STARWARS_PRE_GAME); enteredCode[0] = '\0'; return; }
-    if (ee && strcmp(code, "1138") == 0) { strcpy(activeArmCode, code); bombArmedTimestamp = millis(); safePlay(SOUND_THX); c4OnEnterArmed(); setState(ARMED); return; }
-    if (ee && strcmp(code, "8675309") == 0) { strcpy(activeArmCode, code); stored_duration_ram = settings.bomb_duration_ms; settings.bomb_duration_ms = 222000; bombArmedTimestamp = millis(); safePlay(SOUND_JENNY); c4OnEnterArmed(); setState(ARMED); return; }
-    if (ee && strcmp(code, "3141592") == 0) { strcpy(activeArmCode, code); bombArmedTimestamp = millis(); safePlay(SOUND_NERD); c4OnEnterArmed(); setState(ARMED); return; }
-    if (ee && strcmp(code, "1984") == 0) { terminatorModeActive = true; strcpy(activeArmCode, code); bombArmedTimestamp = millis(); safePlay(SOUND_HASTA_2); c4OnEnterArmed(); setState(ARMED); return; }
-    if (ee && strcmp(code, "7777777") == 0) { strcpy(activeArmCode, code); bombArmedTimestamp = millis(); safePlay(SOUND_JACKPOT); c4OnEnterArmed(); setState(ARMED); return; }
-    if (ee && strcmp(code, "007") == 0) { bondModeActive = true; strcpy(activeArmCode, code); stored_duration_ram = settings.bomb_duration_ms; settings.bomb_duration_ms = 105000; bombArmedTimestamp = millis(); safePlay(SOUND_BOND_INTRO); c4OnEnterArmed(); setState(ARMED); return; }
-    if (ee && strcmp(code, "12345") == 0) { centerPrintC("IDIOT LUGGAGE?", 1); safePlay(SOUND_SPACEBALLS); delay(2500); enteredCode[0] = '\0'; setState(PROP_IDLE); return; }
-    if (ee && strcmp(code, "0451") == 0) { strcpy(activeArmCode, code); bombArmedTimestamp = millis(); safePlay(SOUND_SOM_BITCH); c4OnEnterArmed(); setState(ARMED); return; }
-    if (ee && strcmp(code, "14085") == 0) { strcpy(activeArmCode, code); bombArmedTimestamp = millis(); safePlay(SOUND_MGS_ALERT); c4OnEnterArmed(); setState(ARMED); return; }
-    if (ee && strcmp(code, "0000000") == 0) { centerPrintC("TOO EASY", 1); safePlay(SOUND_LAME); delay(1500); enteredCode[0] = '\0'; setState(PROP_IDLE); return; }
-    if (ee && strcmp(code, "666666") == 0) { doomModeActive = true; strcpy(activeArmCode, code); bombArmedTimestamp = millis(); safePlay(SOUND_DOOM_SLAYER); setState(ARMED); return; }
-    if (ee && strcmp(code, "5318008") == 0) { strcpy(activeArmCode, code); setState(EASTER_EGG_2); return; }
-    if (strcmp(code, "999") == 0) { centerPrintC("SERVO TEST", 1); centerPrintC("ACTIVATED", 2); startShellEjectorSequence(); enteredCode[0] = '\0'; return; }
-    if (strcmp(code, MASTER_CODE) == 0) { strcpy(activeArmCode, code); setState(EASTER_EGG); return; }
+    const SpecialCode* sc = specialCodeFind(code);
+    if (sc && (!(sc->flags & SC_EASTER_EGG) || settings.easter_eggs_enabled)) {
+        applySpecialCode(*sc, code);
+        return;
+    }
 
     // Standard Arming
     if ((int)strlen(code) == CODE_LENGTH) {
@@ -108,41 +106,29 @@ inline void processArmingCode(const char* code) {
                 // Wrong code
                 centerPrintC("INVALID CODE", 1);
                 safePlay(SOUND_MENU_CANCEL);
-                delay(1000);
+                taggedDelay(1000, STALL_TAG_ARMING_DELAY);
                 enteredCode[0] = '\0';
-                setState(PROP_IDLE);
+                stateFire(EV_CODE_BAD);
                 return;
             }
         }
 
         strcpy(activeArmCode, code);
-        bombArmedTimestamp = millis();
+        bombClockStart();
         safePlay(SOUND_BOMB_PLANTED);
         c4OnEnterArmed();
-        setState(ARMED);
+        stateFire(EV_CODE_OK);
     } else {
-        setState(PROP_IDLE);
+        stateFire(EV_CODE_BAD);
     }
 }
 
 inline void handleKeypadInput(char key) {
   if (!key) return;
 
-  if (currentState == STARWARS_PRE_GAME) {
-     if (isdigit(key)) safePlay(random(SOUND_SWING_START, SOUND_SWING_END + 1));
-     if (key == '#') {
-        if (!isBombPlanted()) { centerPrintC("ERROR: MUST PLANT", 1); safePlay(SOUND_MENU_CANCEL); delay(2000); return; }
-        strcpy(activeArmCode, MASTER_CODE); 
-        stored_duration_ram = settings.bomb_duration_ms; settings.bomb_duration_ms = 350000; 
-        starWarsModeActive = true; bombArmedTimestamp = millis(); safePlay(SOUND_STAR_WARS_THEME); c4OnEnterArmed(); setState(ARMED);
-        return;
-     }
-     if (key == '*') { resetSpecialModes(); setState(PROP_IDLE); return; }
-     return; 
-  }
+  if (modeOnKey(key)) return;   // Star Wars lobby: lightsaber keys, # arms, * leaves
 
-  if (currentState == PROP_IDLE) setState(ARMING);
-  if (currentState == ARMED) setState(DISARMING_KEYPAD);
+  stateFire(EV_KEY);   // PROP_IDLE -> ARMING, ARMED -> DISARMING_KEYPAD
   displayNeedsUpdate = true;
 
   if (isdigit(key)) {
@@ -155,26 +141,23 @@ inline void handleKeypadInput(char key) {
       bool matched = false;
       if (strcmp(enteredCode, activeArmCode) == 0) matched = true;
       else if (strcmp(enteredCode, MASTER_CODE) == 0) matched = true;
-      else if (starWarsModeActive && strcmp(enteredCode, "501") == 0) matched = true;
+      else if (activeMode && activeMode->disarmCode && strcmp(enteredCode, activeMode->disarmCode) == 0) matched = true;
 
-      if (matched) setState(DISARMED);
+      if (matched) stateFire(EV_CODE_OK);
       else if ((int)strlen(enteredCode) >= CODE_LENGTH) {
-        uint32_t elapsed = millis() - bombArmedTimestamp;
-        uint32_t total   = settings.bomb_duration_ms;
-        uint32_t remaining = (total > elapsed) ? (total - elapsed) : 0;
+        uint32_t remaining = bombRemainingMs();
         uint32_t penalty = remaining / 2;
-        if (remaining > 3000) bombArmedTimestamp -= penalty;
+        if (remaining > 3000) bombClock.addMs(-(int32_t)penalty, gameNowUs());
         uint32_t newRemaining = (remaining > penalty) ? (remaining - penalty) : 0;
         c4OnTimeCut(newRemaining);
         menuCancel();
-        setState(ARMED);
+        stateFire(EV_CODE_BAD);
       }
     }
 
   } else if (key == '*') {
     if (millis() - lastStarPressTime < DOUBLE_TAP_TIMEOUT) {
-      if (currentState == ARMING) setState(PROP_IDLE);
-      if (currentState == DISARMING_KEYPAD) setState(ARMED);
+      stateFire(EV_CANCEL);
       lastStarPressTime = 0;
     } else {
       enteredCode[0] = '\0';
@@ -184,7 +167,7 @@ inline void handleKeypadInput(char key) {
     if (currentState == ARMING) {
       if (!isBombPlanted()) {
          centerPrintC("ERROR: MUST PLANT", 1); centerPrintC("ON SITE FIRST!", 2);
-         safePlay(SOUND_MENU_CANCEL); delay(2000); setState(PROP_IDLE);
+         safePlay(SOUND_MENU_CANCEL); taggedDelay(2000, STALL_TAG_ARMING_DELAY); stateFire(EV_CODE_BAD);
          return; 
       }
       processArmingCode(enteredCode);
@@ -193,24 +176,24 @@ inline void handleKeypadInput(char key) {
 }
 
 inline void handleDisarmButton() {
-  if (currentState == ARMED || currentState == DISARMING_KEYPAD) {
-    if (disarmButton.fell()) setState(DISARMING_MANUAL);
-  }
-  if (currentState == DISARMING_MANUAL && disarmButton.rose()) {
+  if (disarmButton.fell()) stateFire(EV_BUTTON_DOWN);
+  if (disarmButton.rose() && stateAccepts(EV_BUTTON_UP)) {
       safeStop(); 
-      setState(ARMED);
+      stateFire(EV_BUTTON_UP);
   }
 }
 
 inline void handleRfid() {
+  PROF_SCOPE(PROF_RFID);
   if (!rfid.PICC_IsNewCardPresent()) return;
   if (!rfid.PICC_ReadCardSerial())   return;
+  metricInc(M_RFID_READS);
 
   uint8_t adminUID[] = {0xDE, 0xAD, 0xBE, 0xEF}; 
   if (UIDUtil::equals_len_bytes(4, adminUID, rfid.uid.uidByte, rfid.uid.size)) {
       safePlay(SOUND_MENU_CONFIRM);
       resetSpecialModes();
-      setState(STANDBY); 
+      stateFire(EV_RESET); 
       rfid.PICC_HaltA(); rfid.PCD_StopCrypto1();
       return;
   }
@@ -230,9 +213,7 @@ inline void handleRfid() {
 
     // CASE 1: DISARMING CARD (Type 0)
     if (type == 0) {
-        if (currentState == ARMED || currentState == DISARMING_KEYPAD) {
-           setState(DISARMING_RFID);
-        }
+        stateFire(EV_CARD_DISARM);
     }
     // CASE 2: ARMING CARD (Type 1)
     else if (type == 1) {
@@ -261,6 +242,7 @@ inline void handleRfid() {
     }
   }
   else {
+    metricInc(M_RFID_INVALID);
     safePlay(SOUND_INVALID_CARD);
   }
 
@@ -269,505 +251,226 @@ inline void handleRfid() {
 }
 
 inline void handleBeepLogic() {
-  static uint32_t lastCurveCalc = 0;
-  static uint32_t cachedInterval = 1000;
-  static uint32_t cachedBeepDuration = BEEP_TONE_DURATION_MS;
-
-  if (millis() - lastCurveCalc > 100) {
-      uint32_t elapsed = millis() - bombArmedTimestamp;
-      if (elapsed > settings.bomb_duration_ms) elapsed = settings.bomb_duration_ms;
-      float progress = (float)elapsed / (float)settings.bomb_duration_ms;
-      float virtual_t = progress * 45.0f; 
-      float bps = 1.05f * powf(1.039f, virtual_t);
-      cachedInterval = (uint32_t)(1000.0f / bps);
-      if (cachedInterval < 50) cachedInterval = 50;
-      if (cachedInterval < (BEEP_TONE_DURATION_MS * 2)) cachedBeepDuration = cachedInterval / 2;
-      else cachedBeepDuration = BEEP_TONE_DURATION_MS;
-      if (cachedBeepDuration < 60) cachedBeepDuration = 60;
-      lastCurveCalc = millis();
-  }
-
-  uint32_t delta = millis() - lastBeepTimestamp;
-  if (delta >= cachedInterval) { lastBeepTimestamp = millis(); delta = 0; }
-
   static bool isBeeping = false;
-  if (delta < cachedBeepDuration) {
+  bool on = !bombClock.paused && bombBeep.update(bombClock.elapsedMs(gameNowUs()), bombClock.totalMs);
+  if (on) {
      if (!isBeeping) { beepStart(BEEP_TONE_FREQ); ledIsOn = true; isBeeping = true; }
   } else {
      if (isBeeping) { beepStop(); ledIsOn = false; isBeeping = false; }
   }
 }
 
-inline void handleConfigMode(char key) {
-  if (key) {
-    displayNeedsUpdate = true;
-    if (currentConfigState != MENU_VOLUME) safePlay(SOUND_KEY_PRESS);
-
-    switch(currentConfigState) {
-      case MENU_MAIN: {
-        const int N = 11;
-        if (key == '2') configMenuIndex = (configMenuIndex - 1 + N) % N;
-        if (key == '8') configMenuIndex = (configMenuIndex + 1) % N;
-        if (key == '#') {
-          safePlay(SOUND_MENU_CONFIRM);
-          configInputBuffer[0] = '\0';
-          switch (configMenuIndex) {
-            case 0: currentConfigState = MENU_SET_BOMB_TIME; break;
-            case 1: currentConfigState = MENU_SET_MANUAL_TIME; break;
-            case 2: currentConfigState = MENU_SET_RFID_TIME; break;
-            case 3: currentConfigState = MENU_FIXED_CODE_SETTINGS; break; // NEW
-            case 4: currentConfigState = MENU_SUDDEN_DEATH_TOGGLE; break;
-            case 5: currentConfigState = MENU_DUD_SETTINGS; break;
-            case 6: rfidViewIndex = 0; currentConfigState = MENU_VIEW_RFIDS; break;
-            case 7: currentConfigState = MENU_HARDWARE_SUBMENU; break; 
-            case 8: currentConfigState = MENU_NETWORK; break;
-            case 9: { // SAVE EXIT
-              Serial.println("[CFG] Save Exit");
-              currentConfigState = MENU_SAVE_EXIT;
-              displayNeedsUpdate = true;
-              saveSettings();
-              safePlay(SOUND_MENU_CONFIRM);
-              delay(100); 
-              requestRestart(600);
-            } break;
-            case 10: { // EXIT
-              currentConfigState = MENU_EXIT_NO_SAVE;
-              displayNeedsUpdate = true;
-              safePlay(SOUND_MENU_CANCEL);
-              delay(500); configInputBuffer[0]='\0'; setState(STANDBY);
-            } break;
-          }
-        }
-      } break;
-
-      case MENU_SET_BOMB_TIME:
-      case MENU_SET_MANUAL_TIME:
-      case MENU_SET_RFID_TIME: {
-        if (isdigit(key)) {
-          size_t len = strlen(configInputBuffer);
-          if (len + 1 < CONFIG_INPUT_MAX) { configInputBuffer[len] = key; configInputBuffer[len+1] = '\0'; }
-        }
-        if (key == '*') {
-          size_t len = strlen(configInputBuffer);
-          if (len) configInputBuffer[len-1] = '\0'; else currentConfigState = MENU_MAIN;
-        }
-        if (key == '#') {
-          unsigned long v = strtoul(configInputBuffer, nullptr, 10);
-          if (v > 0) {
-            if (currentConfigState == MENU_SET_BOMB_TIME)   settings.bomb_duration_ms = v;
-            if (currentConfigState == MENU_SET_MANUAL_TIME) settings.manual_disarm_time_ms = v;
-            if (currentConfigState == MENU_SET_RFID_TIME)   settings.rfid_disarm_time_ms = v;
-            safePlay(SOUND_MENU_CONFIRM);
-          } else safePlay(SOUND_MENU_CANCEL);
-          currentConfigState = MENU_MAIN;
-        }
-      } break;
-
-      // --- FIXED CODE ---
-      case MENU_FIXED_CODE_SETTINGS: {
-        if (key == '1') currentConfigState = MENU_FIXED_CODE_TOGGLE;
-        if (key == '2') { configInputBuffer[0] = '\0'; currentConfigState = MENU_SET_FIXED_CODE; }
-        if (key == '*') currentConfigState = MENU_MAIN;
-      } break;
-      case MENU_FIXED_CODE_TOGGLE: {
-        if (key == '#') { settings.fixed_code_enabled = !settings.fixed_code_enabled; safePlay(SOUND_MENU_CONFIRM); }
-        if (key == '*') currentConfigState = MENU_FIXED_CODE_SETTINGS;
-      } break;
-      case MENU_SET_FIXED_CODE: {
-        if (isdigit(key)) {
-            size_t len = strlen(configInputBuffer);
-            if (len < 7) { configInputBuffer[len] = key; configInputBuffer[len+1] = '\0'; }
-        }
-        if (key == '*') {
-            size_t len = strlen(configInputBuffer);
-            if (len > 0) configInputBuffer[len-1] = '\0';
-            else currentConfigState = MENU_FIXED_CODE_SETTINGS;
-        }
-        if (key == '#') {
-            size_t len = strlen(configInputBuffer);
-            if (len > 0) {
-               strcpy(settings.fixed_code_val, configInputBuffer);
-               safePlay(SOUND_MENU_CONFIRM);
-            } else safePlay(SOUND_MENU_CANCEL);
-            currentConfigState = MENU_FIXED_CODE_SETTINGS;
-        }
-      } break;
-
-      case MENU_SUDDEN_DEATH_TOGGLE: {
-        if (key == '#') { settings.sudden_death_mode = !settings.sudden_death_mode; safePlay(SOUND_MENU_CONFIRM); }
-        if (key == '*') currentConfigState = MENU_MAIN;
-      } break;
-
-      case MENU_DUD_SETTINGS: {
-        if (key == '#') { settings.dud_enabled = !settings.dud_enabled; safePlay(SOUND_MENU_CONFIRM); }
-        if (key == '1') { configInputBuffer[0]='\0'; currentConfigState = MENU_DUD_CHANCE; }
-        if (key == '*') currentConfigState = MENU_MAIN;
-      } break;
-
-      case MENU_DUD_CHANCE: {
-        if (isdigit(key)) {
-          size_t len = strlen(configInputBuffer);
-          if (len + 1 < CONFIG_INPUT_MAX) { configInputBuffer[len] = key; configInputBuffer[len+1] = '\0'; }
-        }
-        if (key == '*') {
-            size_t len = strlen(configInputBuffer);
-            if (len > 0) configInputBuffer[len-1] = '\0'; else currentConfigState = MENU_DUD_SETTINGS;
-        }
-        if (key == '#') {
-          int val = atoi(configInputBuffer);
-          if (val >= 0 && val <= 100) { settings.dud_chance = val; safePlay(SOUND_MENU_CONFIRM); } 
-          else safePlay(SOUND_MENU_CANCEL);
-          currentConfigState = MENU_DUD_SETTINGS;
-        }
-      } break;
-
-      case MENU_HARDWARE_SUBMENU: {
-        if (key == '1') currentConfigState = MENU_AUDIO_SUBMENU;
-        if (key == '2') currentConfigState = MENU_SERVO_SETTINGS;
-        if (key == '3') currentConfigState = MENU_PLANT_SENSOR_TOGGLE;
-        if (key == '4') currentConfigState = MENU_EXTRAS_SUBMENU;
-        if (key == '*') currentConfigState = MENU_MAIN;
-      } break;
-
-      case MENU_AUDIO_SUBMENU: {
-         if (key == '1') currentConfigState = MENU_AUDIO_TOGGLE;
-         if (key == '2') { configInputBuffer[0]='\0'; currentConfigState = MENU_VOLUME; }
-         if (key == '*') currentConfigState = MENU_HARDWARE_SUBMENU;
-      } break;
-
-      case MENU_AUDIO_TOGGLE: {
-         if (key == '#') { settings.sound_enabled = !settings.sound_enabled; safePlay(SOUND_MENU_CONFIRM); }
-         if (key == '*') currentConfigState = MENU_AUDIO_SUBMENU;
-      } break;
-
-      case MENU_VOLUME: {
-         if (isdigit(key)) {
-            size_t len = strlen(configInputBuffer);
-            if (len + 1 < CONFIG_INPUT_MAX) { configInputBuffer[len] = key; configInputBuffer[len+1] = '\0'; }
-         }
-         if (key == '*') {
-            size_t len = strlen(configInputBuffer);
-            if (len > 0) configInputBuffer[len-1] = '\0'; else currentConfigState = MENU_AUDIO_SUBMENU;
-         }
-         if (key == '#') {
-            int val = atoi(configInputBuffer);
-            if (val >= 0 && val <= 30) { settings.sound_volume = val; safeVolume(val); }
-            currentConfigState = MENU_AUDIO_SUBMENU;
-         }
-      } break;
-
-      case MENU_PLANT_SENSOR_TOGGLE: {
-         if (key == '#') { settings.plant_sensor_enabled = !settings.plant_sensor_enabled; safePlay(SOUND_MENU_CONFIRM); }
-         if (key == '*') currentConfigState = MENU_HARDWARE_SUBMENU;
-      } break;
-
-      case MENU_EXTRAS_SUBMENU: {
-        if (key == '1') currentConfigState = MENU_TOGGLE_STROBE;
-        if (key == '2') currentConfigState = MENU_TOGGLE_EASTER_EGGS;
-        if (key == '3') currentConfigState = MENU_PING_SETTINGS;
-        if (key == '*') currentConfigState = MENU_HARDWARE_SUBMENU;
-      } break;
-      
-      // PING SETTINGS
-      case MENU_PING_SETTINGS: {
-        if (key == '1') currentConfigState = MENU_PING_TOGGLE;
-        if (key == '2') { configInputBuffer[0]='\0'; currentConfigState = MENU_PING_INTERVAL; }
-        if (key == '3') currentConfigState = MENU_PING_LIGHT_TOGGLE;
-        if (key == '*') currentConfigState = MENU_EXTRAS_SUBMENU;
-      } break;
-      case MENU_PING_TOGGLE: {
-        if (key == '#') { settings.ping_enabled = !settings.ping_enabled; safePlay(SOUND_MENU_CONFIRM); }
-        if (key == '*') currentConfigState = MENU_PING_SETTINGS;
-      } break;
-      case MENU_PING_INTERVAL: {
-        if (isdigit(key)) {
-            size_t len = strlen(configInputBuffer);
-            if (len + 1 < CONFIG_INPUT_MAX) { configInputBuffer[len] = key; configInputBuffer[len+1] = '\0'; }
-        }
-        if (key == '*') {
-            size_t len = strlen(configInputBuffer);
-            if (len > 0) configInputBuffer[len-1] = '\0'; else currentConfigState = MENU_PING_SETTINGS;
-        }
-        if (key == '#') {
-           int val = atoi(configInputBuffer);
-           if (val >= 5 && val <= 3600) { settings.ping_interval_s = val; safePlay(SOUND_MENU_CONFIRM); }
-           else safePlay(SOUND_MENU_CANCEL);
-           currentConfigState = MENU_PING_SETTINGS;
-        }
-      } break;
-      case MENU_PING_LIGHT_TOGGLE: {
-        if (key == '#') { settings.ping_light_enabled = !settings.ping_light_enabled; safePlay(SOUND_MENU_CONFIRM); }
-        if (key == '*') currentConfigState = MENU_PING_SETTINGS;
-      } break;
-
-      case MENU_SERVO_SETTINGS: {
-        if (key == '1') currentConfigState = MENU_SERVO_TOGGLE;
-        if (key == '2') { configInputBuffer[0]='\0'; currentConfigState = MENU_SERVO_START_ANGLE; }
-        if (key == '3') { configInputBuffer[0]='\0'; currentConfigState = MENU_SERVO_END_ANGLE; }
-        if (key == '*') currentConfigState = MENU_HARDWARE_SUBMENU;
-      } break;
-
-      case MENU_SERVO_TOGGLE: {
-        if (key == '#') { settings.servo_enabled = !settings.servo_enabled; safePlay(SOUND_MENU_CONFIRM); }
-        if (key == '*') currentConfigState = MENU_SERVO_SETTINGS;
-      } break;
-
-      case MENU_SERVO_START_ANGLE: {
-        if (isdigit(key)) {
-            size_t len = strlen(configInputBuffer);
-            if (len + 1 < CONFIG_INPUT_MAX) { configInputBuffer[len] = key; configInputBuffer[len+1] = '\0'; }
-        }
-        if (key == '*') {
-            size_t len = strlen(configInputBuffer);
-            if (len > 0) configInputBuffer[len-1] = '\0'; else currentConfigState = MENU_SERVO_SETTINGS;
-        }
-        if (key == '#') {
-            int val = atoi(configInputBuffer);
-            if (val >= 0 && val <= 180) { settings.servo_start_angle = val; safePlay(SOUND_MENU_CONFIRM); } 
-            else safePlay(SOUND_MENU_CANCEL);
-            currentConfigState = MENU_SERVO_SETTINGS;
-        }
-      } break;
+// --- CONFIG MENU ---
+// The tree is ConfigMenu.h; these are its actions and the two custom screens.
+enum TagView : uint8_t { TAG_LIST, TAG_DELETE, TAG_TYPE, TAG_SCAN };
+static uint8_t tagView = TAG_LIST;
+static int     tagIndex = 0;          // 0..num-1 = a tag, num = "Add New Tag"
+static uint8_t tagNewType = 0;        // 0 = disarm card, 1 = arming card
+static char    tagAdded[MENU_COLS + 1];
+
+inline void configMenuBegin() {
+  menuReset(configMenu);
+  lcdInvalidate();
+  displayNeedsUpdate = true;
+}
 
-      case MENU_SERVO_END_ANGLE: {
-        if (isdigit(key)) {
-            size_t len = strlen(configInputBuffer);
-            if (len + 1 < CONFIG_INPUT_MAX) { configInputBuffer[len] = key; configInputBuffer[len+1] = '\0'; }
-        }
-        if (key == '*') {
-            size_t len = strlen(configInputBuffer);
-            if (len > 0) configInputBuffer[len-1] = '\0'; else currentConfigState = MENU_SERVO_SETTINGS;
-        }
-        if (key == '#') {
-            int val = atoi(configInputBuffer);
-            if (val >= 0 && val <= 180) { settings.servo_end_angle = val; safePlay(SOUND_MENU_CONFIRM); } 
-            else safePlay(SOUND_MENU_CANCEL);
-            currentConfigState = MENU_SERVO_SETTINGS;
-        }
-      } break;
-
-      case MENU_TOGGLE_EASTER_EGGS: {
-         if (key == '#') { settings.easter_eggs_enabled = !settings.easter_eggs_enabled; safePlay(SOUND_MENU_CONFIRM); }
-         if (key == '*') currentConfigState = MENU_EXTRAS_SUBMENU;
-      } break;
-
-      case MENU_TOGGLE_STROBE: {
-         if (key == '#') { settings.explosion_strobe_enabled = !settings.explosion_strobe_enabled; safePlay(SOUND_MENU_CONFIRM); }
-         if (key == '*') currentConfigState = MENU_EXTRAS_SUBMENU;
-      } break;
-
-      case MENU_VIEW_RFIDS: {
-        int total = settings.num_rfid_uids + 3;
-        if (key == '2') rfidViewIndex = (rfidViewIndex - 1 + total) % total;
-        if (key == '8') rfidViewIndex = (rfidViewIndex + 1) % total;
-        if (key == '#') {
-          if (rfidViewIndex < settings.num_rfid_uids) {
-            // EDIT/DELETE EXISTING
-            currentConfigState = MENU_DELETE_RFID_CONFIRM;
-          } else if (rfidViewIndex == settings.num_rfid_uids) {
-            if (settings.num_rfid_uids < MAX_RFID_UIDS) {
-               currentConfigState = MENU_ADD_RFID_SELECT_TYPE; // Ask type first
-            } else safePlay(SOUND_MENU_CANCEL);
-          } else {
-             if (rfidViewIndex == settings.num_rfid_uids + 1) currentConfigState = MENU_RFID_ADV_SETTINGS;
-             else if (rfidViewIndex == settings.num_rfid_uids + 2) currentConfigState = MENU_CLEAR_RFIDS_CONFIRM; 
-          }
-        }
-        if (key == '*') currentConfigState = MENU_MAIN;
-      } break;
-
-      // NEW: DELETE CONFIRMATION LOGIC
-      case MENU_DELETE_RFID_CONFIRM: {
-         if (key == '#') {
-            // Perform Delete
-            if (rfidViewIndex < settings.num_rfid_uids) {
-                // Shift array left
-                for (int i = rfidViewIndex; i < settings.num_rfid_uids - 1; i++) {
-                    settings.rfid_uids[i] = settings.rfid_uids[i+1];
-                }
-                settings.num_rfid_uids--;
-                safePlay(SOUND_MENU_CONFIRM);
-                // Adjust index if we deleted the last item
-                if (rfidViewIndex >= settings.num_rfid_uids && rfidViewIndex > 0) {
-                    rfidViewIndex--;
-                }
-            }
-            currentConfigState = MENU_VIEW_RFIDS;
-         }
-         if (key == '*') currentConfigState = MENU_VIEW_RFIDS;
-      } break;
-
-      case MENU_ADD_RFID_SELECT_TYPE: {
-        if (key == '1') { // Disarm
-           configInputBuffer[0] = '0'; // abuse buffer to store type
-           currentConfigState = MENU_ADD_RFID_WAIT;
-           rfid.PCD_Init(); 
-        }
-        if (key == '2') { // Arm
-           configInputBuffer[0] = '1';
-           currentConfigState = MENU_ADD_RFID_WAIT;
-           rfid.PCD_Init();
-        }
-        if (key == '*') currentConfigState = MENU_VIEW_RFIDS;
-      } break;
-      
-      case MENU_ADD_RFID_WAIT: {
-         if (key == '*') currentConfigState = MENU_VIEW_RFIDS;
-      } break;
-
-      case MENU_RFID_ADV_SETTINGS: {
-        if (key == '1') currentConfigState = MENU_RFID_ARMING_MODE;
-        if (key == '2') { configInputBuffer[0]='\0'; currentConfigState = MENU_RFID_ENTRY_SPEED; }
-        if (key == '*') currentConfigState = MENU_VIEW_RFIDS;
-      } break;
-      case MENU_RFID_ARMING_MODE: {
-         if (key == '#') { settings.rfid_arming_mode = !settings.rfid_arming_mode; safePlay(SOUND_MENU_CONFIRM); }
-         if (key == '*') currentConfigState = MENU_RFID_ADV_SETTINGS;
-      } break;
-      case MENU_RFID_ENTRY_SPEED: {
-         if (isdigit(key)) {
-            size_t len = strlen(configInputBuffer);
-            if (len + 1 < CONFIG_INPUT_MAX) { configInputBuffer[len] = key; configInputBuffer[len+1] = '\0'; }
-         }
-         if (key == '*') {
-            size_t len = strlen(configInputBuffer);
-            if (len > 0) configInputBuffer[len-1] = '\0'; else currentConfigState = MENU_RFID_ADV_SETTINGS;
-         }
-         if (key == '#') {
-            int val = atoi(configInputBuffer);
-            settings.rfid_entry_speed_ms = val; safePlay(SOUND_MENU_CONFIRM); 
-            currentConfigState = MENU_RFID_ADV_SETTINGS;
-         }
-      } break;
-
-      case MENU_CLEAR_RFIDS_CONFIRM: {
-        if (key == '#') { settings.num_rfid_uids = 0; safePlay(SOUND_MENU_CONFIRM); currentConfigState = MENU_VIEW_RFIDS; }
-        if (key == '*') currentConfigState = MENU_VIEW_RFIDS;
-      } break;
-
-      case MENU_NETWORK: {
-        if (key == '1')      currentConfigState = MENU_NET_ENABLE;
-        else if (key == '2') currentConfigState = MENU_NET_SERVER_MODE;
-        else if (key == '3') { currentConfigState = MENU_NET_IP;        configInputBuffer[0]='\0'; }
-        else if (key == '4') { currentConfigState = MENU_NET_PORT;      configInputBuffer[0]='\0'; }
-        else if (key == '9') { currentConfigState = MENU_NETWORK_2; } 
-        else if (key == '*') currentConfigState = MENU_MAIN;
-      } break;
-
-      case MENU_NETWORK_2: {
-        if (key == '5') { currentConfigState = MENU_NET_MASTER_IP; configInputBuffer[0]='\0'; }
-        else if (key == '6') { currentConfigState = MENU_NET_WIFI_SETUP; startWiFiPortal(90); }
-        else if (key == '7') { currentConfigState = MENU_NET_APPLY_NOW;  networkReconfigure(); }
-        else if (key == '8') currentConfigState = MENU_NET_FORGET_CONFIRM; 
-        else if (key == '9') currentConfigState = MENU_NETWORK; 
-        else if (key == '*') currentConfigState = MENU_MAIN;
-      } break;
-
-      case MENU_NET_ENABLE: {
-        if (key == '#') { settings.wifi_enabled = !settings.wifi_enabled; safePlay(SOUND_MENU_CONFIRM); }
-        if (key == '*') currentConfigState = MENU_NETWORK;
-      } break;
-
-      case MENU_NET_SERVER_MODE: {
-        if (key == '#') { settings.net_use_mdns = !settings.net_use_mdns; safePlay(SOUND_MENU_CONFIRM); }
-        if (key == '*') currentConfigState = MENU_NETWORK;
-      } break;
-
-      case MENU_NET_IP:
-      case MENU_NET_MASTER_IP: {
-        if ((key >= '0' && key <= '9') || key == '.') {
-          size_t len = strlen(configInputBuffer);
-          if (len + 1 < CONFIG_INPUT_MAX) { configInputBuffer[len] = key; configInputBuffer[len+1] = '\0'; }
-        }
-        if (key == '*') {
-          size_t len = strlen(configInputBuffer);
-          if (len) configInputBuffer[len-1] = '\0';
-          else currentConfigState = MENU_NETWORK;
-        }
-        if (key == '#') {
-          uint32_t ip;
-          if (parseIpFromBuffer(configInputBuffer, ip)) {
-            if (currentConfigState == MENU_NET_IP) settings.scoreboard_ip = ip;
-            else settings.master_ip = ip;
-            safePlay(SOUND_MENU_CONFIRM);
-            currentConfigState = MENU_NETWORK;
-          } else {
-            safePlay(SOUND_MENU_CANCEL);
-          }
-        }
-      } break;
-
-      case MENU_NET_FORGET_CONFIRM: {
-        if (key == '#') {
-          forgetWifiCredentials(); 
-          safePlay(SOUND_MENU_CONFIRM);
-          currentConfigState = MENU_NETWORK_2; 
-          displayNeedsUpdate = true;
-        }
-        if (key == '*') {
-          currentConfigState = MENU_NETWORK_2; 
-          displayNeedsUpdate = true;
-        }
-      } break;
+inline void menuSaveExit() {
+  LOG_I("[CFG] Save Exit");
+  saveSettings();
+  menuNotice(configMenu, "Saving...", "Device will reboot.");
+  requestRestart(600);
+}
 
-      case MENU_NET_PORT: {
-        if (isdigit(key)) {
-          size_t len = strlen(configInputBuffer);
-          if (len + 1 < CONFIG_INPUT_MAX) { configInputBuffer[len] = key; configInputBuffer[len+1] = '\0'; }
-        }
-        if (key == '*') {
-          size_t len = strlen(configInputBuffer);
-          if (len) configInputBuffer[len-1] = '\0';
-          else currentConfigState = MENU_NETWORK;
-        }
-        if (key == '#') {
-          unsigned long v = strtoul(configInputBuffer, nullptr, 10);
-          if (v > 0 && v <= 65535) { settings.scoreboard_port = (uint16_t)v; safePlay(SOUND_MENU_CONFIRM); currentConfigState = MENU_NETWORK; }
-          else safePlay(SOUND_MENU_CANCEL);
-        }
-      } break;
+inline void menuExit() {
+  LOG_I("[CFG] Exit (changes kept for this session)");
+  stateFire(EV_RESET);
+}
 
-      case MENU_NET_WIFI_SETUP: {
-        if (key == '*') { stopWiFiPortal(); currentConfigState = MENU_NETWORK_2; }
-      } break;
+inline void menuApplyVolume() { safeVolume(settings.sound_volume); }
 
-      case MENU_NET_APPLY_NOW: {
-        currentConfigState = MENU_NETWORK_2;
-      } break;
+inline void menuApplyNetwork() {
+  networkReconfigure();
+  menuNotice(configMenu, "Network settings", "applied");
+}
 
-      case MENU_SAVE_EXIT: { } break;
-      case MENU_EXIT_NO_SAVE: { } break;
+inline void menuForgetWifi() { forgetWifiCredentials(); }
+
+inline void menuClearTags() { settings.num_rfid_uids = 0; }
+
+inline void tagListEnter() { tagView = TAG_LIST; tagIndex = 0; }
+
+inline MenuSound tagListKey(char key, bool& done) {
+  int total = settings.num_rfid_uids + 1;
+  switch (tagView) {
+    case TAG_LIST:
+      if (key == '2') { tagIndex = (tagIndex + total - 1) % total; return MS_CLICK; }
+      if (key == '8') { tagIndex = (tagIndex + 1) % total; return MS_CLICK; }
+      if (key == '*') { done = true; return MS_CLICK; }
+      if (key != '#') return MS_NONE;
+      if (tagIndex < settings.num_rfid_uids) { tagView = TAG_DELETE; return MS_CLICK; }
+      if (settings.num_rfid_uids >= MAX_RFID_UIDS) return MS_ERR;
+      tagView = TAG_TYPE;
+      return MS_CLICK;
+    case TAG_DELETE:
+      if (key == '*') { tagView = TAG_LIST; return MS_CLICK; }
+      if (key != '#') return MS_NONE;
+      for (int i = tagIndex; i < settings.num_rfid_uids - 1; i++) settings.rfid_uids[i] = settings.rfid_uids[i + 1];
+      settings.num_rfid_uids--;
+      if (tagIndex >= settings.num_rfid_uids && tagIndex > 0) tagIndex--;
+      tagView = TAG_LIST;
+      return MS_OK;
+    case TAG_TYPE:
+      if (key == '*') { tagView = TAG_LIST; return MS_CLICK; }
+      if (key != '1' && key != '2') return MS_NONE;
+      tagNewType = (key == '2') ? 1 : 0;
+      rfid.PCD_Init();
+      tagView = TAG_SCAN;
+      return MS_CLICK;
+    case TAG_SCAN:
+      if (key == '*') { tagView = TAG_LIST; return MS_CLICK; }
+      return MS_NONE;
+  }
+  return MS_NONE;
+}
 
-    }
+inline void tagListRender(MenuLines out) {
+  char buf[MENU_COLS + 1];
+  switch (tagView) {
+    case TAG_LIST:
+      menuLine(out[0], "Registered Cards", true);
+      if (tagIndex < settings.num_rfid_uids) {
+        const Settings::TagUID& t = settings.rfid_uids[tagIndex];
+        snprintf(buf, sizeof(buf), "%s %s", t.type == 1 ? "[ARM]" : "[DIS]", UIDUtil::toHex(t.bytes, t.len).c_str());
+        menuLine(out[1], buf, true);
+        snprintf(buf, sizeof(buf), "Tag %d/%d", tagIndex + 1, (int)settings.num_rfid_uids);
+        menuLine(out[2], buf, true);
+      } else {
+        menuLine(out[1], "> Add New Tag <", true);
+      }
+      menuLine(out[3], "(#=Select, *=Back)", true);
+      break;
+    case TAG_DELETE:
+      menuLine(out[0], "DELETE THIS CARD?", true);
+      menuLine(out[1], UIDUtil::toHex(settings.rfid_uids[tagIndex].bytes, settings.rfid_uids[tagIndex].len).c_str(), true);
+      menuLine(out[3], "(#=YES, *=NO)", true);
+      break;
+    case TAG_TYPE:
+      menuLine(out[0], "New Card Function?", true);
+      menuLine(out[1], "1: DISARM KEY", true);
+      menuLine(out[2], "2: ARMING KEY", true);
+      menuLine(out[3], "(*=Cancel)", true);
+      break;
+    case TAG_SCAN:
+      menuLine(out[1], "SCAN TAG NOW...", true);
+      menuLine(out[3], "(*=Cancel)", true);
+      break;
   }
+}
 
-  // Handle Scan logic
-  if (currentConfigState == MENU_ADD_RFID_WAIT) {
-    if (rfid.PICC_IsNewCardPresent() && rfid.PICC_ReadCardSerial()) {
-      if (rfid.uid.size <= 10) {
-        if (settings.num_rfid_uids < MAX_RFID_UIDS) {
-          Settings::TagUID &slot = settings.rfid_uids[settings.num_rfid_uids];
-          slot.len = rfid.uid.size;
-          memcpy(slot.bytes, rfid.uid.uidByte, rfid.uid.size);
-          // Set Type based on previous selection
-          slot.type = (configInputBuffer[0] == '1') ? 1 : 0;
-          
-          settings.num_rfid_uids++;
-          safePlay(SOUND_MENU_CONFIRM);
-          String uid = String("Added: ") + UIDUtil::toHex(slot.bytes, slot.len);
-          centerPrint(uid, 1);
-          centerPrintC(slot.type==1 ? "[ARMING]" : "[DISARM]", 2);
-          delay(1000);
-          currentConfigState = MENU_VIEW_RFIDS;
-        } else safePlay(SOUND_MENU_CANCEL);
-      } else safePlay(SOUND_MENU_CANCEL);
-      rfid.PICC_HaltA(); rfid.PCD_StopCrypto1();
-      displayNeedsUpdate = true;
-    }
+// Reader is only polled while the scan prompt is up
+inline bool tagListPoll() {
+  if (tagView != TAG_SCAN) return false;
+  if (!rfid.PICC_IsNewCardPresent() || !rfid.PICC_ReadCardSerial()) return false;
+  if (rfid.uid.size <= 10 && settings.num_rfid_uids < MAX_RFID_UIDS) {
+    Settings::TagUID& slot = settings.rfid_uids[settings.num_rfid_uids];
+    slot.len = rfid.uid.size;
+    memcpy(slot.bytes, rfid.uid.uidByte, rfid.uid.size);
+    slot.type = tagNewType;
+    tagIndex = settings.num_rfid_uids++;
+    menuConfirm();
+    snprintf(tagAdded, sizeof(tagAdded), "Added: %s", UIDUtil::toHex(slot.bytes, slot.len).c_str());
+    menuNotice(configMenu, tagAdded, slot.type == 1 ? "[ARMING]" : "[DISARM]");
+    tagView = TAG_LIST;
+  } else {
+    menuCancel();
   }
+  rfid.PICC_HaltA(); rfid.PCD_StopCrypto1();
+  return true;
+}
+
+inline void portalEnter() { startWiFiPortal(90); }
+
+inline void portalRender(MenuLines out) {
+  menuLine(out[0], "WiFi Portal: ON", true);
+  menuLine(out[1], "AP: C4Prop-Setup", true);
+  menuLine(out[2], "Join & set creds", true);
+  menuLine(out[3], "(* to stop)", true);
 }
 
+inline void portalLeave() { stopWiFiPortal(); }
+
+inline void handleConfigMode(char key) {
+  MenuSound s = menuKey(CONFIG_TREE, configMenu, &settings, key);
+  if (menuPoll(CONFIG_TREE, configMenu)) displayNeedsUpdate = true;
+  if (s == MS_NONE) return;
+  displayNeedsUpdate = true;
+  if (s == MS_CLICK)   menuClick();
+  else if (s == MS_OK) menuConfirm();
+  else                 menuCancel();
+}
+
+// --- PER-STATE GAMEPLAY ---
+typedef void (*StateTickFn)(char key);
+
+inline void tickIdle(char key) {
+  handleKeypadInput(key);
+  handleRfid(); // Check for Arming cards
+}
+
+inline void tickArmed(char key) {
+  handleKeypadInput(key);
+  handleDisarmButton();
+  handleRfid();
+  handleBeepLogic();
+}
+
+inline void tickManualDisarm(char) {
+  handleDisarmButton();
+  handleBeepLogic();
+  if (disarmClock.expired(gameNowUs()))
+    stateFire(EV_DISARM_DONE);
+}
+
+inline void tickRfidDisarm(char) {
+  handleBeepLogic();
+  if (disarmClock.expired(gameNowUs()))
+    stateFire(EV_DISARM_DONE);
+}
+
+inline void tickPreExplosion(char) {
+  if (settings.servo_enabled && !servoTriggeredThisExplosion) {
+     if (gameMsSince(stateEnteredUs) >= PRE_EXPLOSION_BLAST_MS && powerServoMayStart()) {
+         startShellEjectorSequence();
+         servoTriggeredThisExplosion = true;
+     }
+  }
+}
+
+// One slot per PropState, in enum order. CONFIG_MODE and TOLKIEN_GAME are serviced by loop().
+static const StateTickFn STATE_TICK[] = {
+  /* STANDBY           */ nullptr,
+  /* AWAIT_ARM_TOGGLE  */ nullptr,
+  /* PROP_IDLE         */ tickIdle,
+  /* ARMING            */ tickIdle,
+  /* ARMED             */ tickArmed,
+  /* DISARMING_KEYPAD  */ tickArmed,
+  /* DISARMING_MANUAL  */ tickManualDisarm,
+  /* DISARMING_RFID    */ tickRfidDisarm,
+  /* DISARMED          */ nullptr,
+  /* PRE_EXPLOSION     */ tickPreExplosion,
+  /* EXPLODED          */ nullptr,
+  /* EASTER_EGG        */ nullptr,
+  /* EASTER_EGG_2      */ nullptr,
+  /* CONFIG_MODE       */ nullptr,
+  /* STARWARS_PRE_GAME */ tickIdle,
+  /* PROP_DUD          */ nullptr,
+  /* TOLKIEN_GAME      */ nullptr,
+};
+static_assert(sizeof(STATE_TICK) / sizeof(STATE_TICK[0]) == STATE_COUNT, "STATE_TICK needs one slot per PropState");
+
 inline void serviceGameplay(char key) {
+  modeOnTick();
+
   // PING LOGIC (Only in Idle)
   if (currentState == PROP_IDLE && settings.ping_enabled) {
       if (millis() - lastPingTime > (settings.ping_interval_s * 1000UL)) {
@@ -802,51 +505,6 @@ inline void serviceGameplay(char key) {
       return; // Skip normal key handling while auto-typing
   }
 
-  switch (currentState) {
-    case STARWARS_PRE_GAME:
-    case PROP_IDLE:
-    case ARMING:
-      handleKeypadInput(key);
-      handleRfid(); // Check for Arming cards
-      break;
-
-    case DISARMING_KEYPAD:
-      handleKeypadInput(key);
-      handleDisarmButton();
-      handleRfid();
-      handleBeepLogic();
-      break;
-
-    case ARMED:
-      handleKeypadInput(key);
-      handleDisarmButton();
-      handleRfid();
-      handleBeepLogic();
-      break;
-
-    case DISARMING_MANUAL:
-      handleDisarmButton();
-      handleBeepLogic();
-      if (millis() - disarmStartTimestamp >= settings.manual_disarm_time_ms)
-        setState(DISARMED);
-      break;
-
-    case DISARMING_RFID:
-      handleBeepLogic();
-      if (millis() - disarmStartTimestamp >= settings.rfid_disarm_time_ms)
-        setState(DISARMED);
-      break;
-
-    case PRE_EXPLOSION:
-      if (settings.servo_enabled && !servoTriggeredThisExplosion) {
-         if (millis() - stateEntryTimestamp >= 4500) {
-             startShellEjectorSequence();
-             servoTriggeredThisExplosion = true;
-         }
-      }
-      break;
-
-    default:
-      break;
-  }
+  StateTickFn tick = STATE_TICK[currentState];
+  if (tick) tick(key);
 }
\ No newline at end of file
@@ -0,0 +1,63 @@
+// GameClock.h
+// VERSION: 1.0.1
+// Game time in microseconds since boot as a uint64_t: esp_timer on the prop, steady_clock on
+// the host. It does not wrap in the life of the prop (584,000 years), unlike millis(), whose
+// 32-bit count rolls over after 49.7 days. Pure C++11 so tools/game_clock.cpp can run it on the host.
+//
+// Game timers are absolute deadlines: the bomb and disarm Countdowns (Countdown.h) keep the
+// real time they run out, and each per-loop check is one compare against now. Start+duration arithmetic and wrap-safe
+// subtraction are gone from the game code. A host tool can define GAME_CLOCK_SOURCE (a
+// function returning GameUs) before including this header to put "now" anywhere.
+
+#pragma once
+#include <stdint.h>
+
+typedef uint64_t GameUs;
+
+static constexpr GameUs GAME_US_PER_MS = 1000;
+
+#if defined(ARDUINO)
+#include <esp_timer.h>
+inline GameUs gameClockDefault() { return (GameUs)esp_timer_get_time(); }
+#else
+#include <chrono>
+inline GameUs gameClockDefault() {
+  return (GameUs)std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+#endif
+
+#ifndef GAME_CLOCK_SOURCE
+#define GAME_CLOCK_SOURCE gameClockDefault
+#endif
+
+inline GameUs gameNowUs() { return GAME_CLOCK_SOURCE(); }
+
+inline GameUs gameMsToUs(uint32_t ms) { return (GameUs)ms * GAME_US_PER_MS; }
+
+// Deadline ms from now
+inline GameUs gameDeadlineIn(uint32_t ms) { return gameNowUs() + gameMsToUs(ms); }
+
+// The per-loop check: one compare
+inline bool gameReached(GameUs deadline, GameUs now = gameNowUs()) { return now >= deadline; }
+
+// Whole ms left, rounded up so it reads 0 exactly when gameReached() turns true. Saturates at 2^32-1.
+inline uint32_t gameMsLeft(GameUs deadline, GameUs now = gameNowUs()) {
+  if (now >= deadline) return 0;
+  GameUs us = deadline - now;
+  GameUs ms = us / GAME_US_PER_MS + (us % GAME_US_PER_MS != 0);
+  return ms > 0xFFFFFFFFull ? 0xFFFFFFFFu : (uint32_t)ms;
+}
+
+// Whole ms since an earlier timestamp (a state entry), 0 if it lies in the future. Saturates.
+inline uint32_t gameMsSince(GameUs then, GameUs now = gameNowUs()) {
+  if (now <= then) return 0;
+  GameUs ms = (now - then) / GAME_US_PER_MS;
+  return ms > 0xFFFFFFFFull ? 0xFFFFFFFFu : (uint32_t)ms;
+}
+
+// ms of a totalMs timer that have run, given its deadline. 0..totalMs.
+inline uint32_t gameMsElapsed(GameUs deadline, uint32_t totalMs, GameUs now = gameNowUs()) {
+  uint32_t left = gameMsLeft(deadline, now);
+  return left >= totalMs ? 0 : totalMs - left;
+}
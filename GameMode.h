@@ -0,0 +1,42 @@
+// GameMode.h
+// VERSION: 1.0.0
+// Pop-culture modes (Doom, Star Wars, Terminator, Bond) as hook tables. A special code
+// (SpecialCodes.h) starts one; at most one runs per round and resetSpecialModes() ends it.
+// The game calls the hooks below at fixed points, so a hot path costs one pointer test and
+// one indirect call whatever the number of modes. The modes themselves live in GameModes.h.
+
+#pragma once
+#include <stdint.h>
+#include "StateTable.h"
+
+enum GameModeId : uint8_t { GM_NONE, GM_DOOM, GM_STARWARS, GM_TERMINATOR, GM_BOND, GM_COUNT };
+
+enum : uint8_t {
+  GM_NO_DUD        = 1 << 0,   // the dud roll never fires
+  GM_ENDS_AT_BLAST = 1 << 1    // mode is dropped when PRE_EXPLOSION starts
+};
+
+// Any hook may be nullptr
+struct GameMode {
+  const char* name;
+  uint8_t flags;
+  const char* disarmCode;                 // accepted at DISARMING_KEYPAD besides the arm code
+  void    (*onArm)(PropState from);       // ARMED entered (first arm or disarm aborted)
+  void    (*onTick)();                    // every gameplay loop
+  bool    (*onKey)(char key);             // true = key consumed
+  void    (*onAudioFinished)(int track);  // DFPlayer finished a track
+  bool    (*onDisarm)();                  // DISARMED entered; true = played its own sound
+  uint8_t (*onExplode)();                 // PRE_EXPLOSION entered; detonation track, 0 = default
+  bool    (*ledEffect)(PropState state);  // true = drew the exterior strip
+};
+
+static const GameMode* activeMode = nullptr;
+
+inline bool modeHas(uint8_t flag) { return activeMode && (activeMode->flags & flag); }
+inline void modeOnArm(PropState from) { if (activeMode && activeMode->onArm) activeMode->onArm(from); }
+inline void modeOnTick() { if (activeMode && activeMode->onTick) activeMode->onTick(); }
+inline bool modeOnKey(char key) { return activeMode && activeMode->onKey && activeMode->onKey(key); }
+inline void modeOnAudioFinished(int track) { if (activeMode && activeMode->onAudioFinished) activeMode->onAudioFinished(track); }
+inline bool modeOnDisarm() { return activeMode && activeMode->onDisarm && activeMode->onDisarm(); }
+inline uint8_t modeOnExplode() { return (activeMode && activeMode->onExplode) ? activeMode->onExplode() : 0; }
+inline bool modeLedEffect(PropState state) { return activeMode && activeMode->ledEffect && activeMode->ledEffect(state); }
@@ -0,0 +1,86 @@
+// GameModes.h
+// VERSION: 1.0.1
+// CHANGED: Star Wars arming starts the bomb clock through bombClockStart()
+// The built-in game modes (hook table: GameMode.h). A new mode is a few hook functions, a
+// row in GAME_MODES and an id in GameModeId; a SpecialCodes.h row starts it.
+
+#pragma once
+#include <Arduino.h>
+#include "State.h"
+#include "Hardware.h"
+#include "Display.h"
+#include "C4Net.h"
+#include "PlantSensor.h"
+
+// Background music comes back when a disarm attempt is abandoned
+inline bool modeDisarmAborted(PropState from) {
+  return from == DISARMING_MANUAL || from == DISARMING_RFID || from == DISARMING_KEYPAD;
+}
+
+// --- DOOM (666666) ---
+inline void doomArm(PropState from) { if (modeDisarmAborted(from)) safePlay(SOUND_DOOM_SLAYER); }
+
+inline void doomAudioFinished(int track) { if (track == SOUND_DOOM_SLAYER) safePlay(SOUND_RIP_TEAR); }
+
+inline bool doomLeds(PropState state) {
+  if (state != ARMED) return false;
+  fadeToBlackBy(leds + 1, NUM_LEDS - 1, 100);
+  for(int i=0; i<20; i++) {
+     int pos = random(1, NUM_LEDS);
+     int c = random(10);
+     if (c < 6) leds[pos] = CRGB::Red;
+     else if (c < 9) leds[pos] = CRGB::OrangeRed;
+     else leds[pos] = CRGB::White;
+  }
+  return true;
+}
+
+// --- STAR WARS (501) ---
+// Active from the pre-game lobby on; '#' there arms with the theme and a 5m50s timer.
+inline void starWarsArm(PropState from) { if (modeDisarmAborted(from)) safePlay(SOUND_STAR_WARS_THEME); }
+
+inline void starWarsTick() {
+  if (currentState == STARWARS_PRE_GAME && armSwitch.rose()) safePlay(SOUND_POWER_LIGHTSABER);
+}
+
+inline bool starWarsKey(char key) {
+  if (currentState != STARWARS_PRE_GAME) return false;
+  if (isdigit(key)) safePlay(random(SOUND_SWING_START, SOUND_SWING_END + 1));
+  if (key == '#') {
+    if (!isBombPlanted()) { centerPrintC("ERROR: MUST PLANT", 1); safePlay(SOUND_MENU_CANCEL); taggedDelay(2000, STALL_TAG_ARMING_DELAY); return true; }
+    strcpy(activeArmCode, MASTER_CODE);
+    stored_duration_ram = settings.bomb_duration_ms; settings.bomb_duration_ms = 350000;
+    bombClockStart(); safePlay(SOUND_STAR_WARS_THEME); c4OnEnterArmed(); stateFire(EV_CODE_OK);
+    return true;
+  }
+  if (key == '*') { resetSpecialModes(); stateFire(EV_CANCEL); }
+  return true;
+}
+
+// --- TERMINATOR (1984) ---
+inline bool terminatorDisarm() {
+  safePlay(SOUND_NOT_KILL_ANYONE);
+  return true;
+}
+
+inline uint8_t terminatorExplode() { return SOUND_ILL_BE_BACK; }   // printDetail() chains the detonation
+
+// --- BOND (007) ---
+inline void bondArm(PropState from) { if (modeDisarmAborted(from)) safePlay(SOUND_BOND_THEME); }
+
+inline void bondAudioFinished(int track) { if (track == SOUND_BOND_INTRO) safePlay(SOUND_BOND_THEME); }
+
+// Indexed by GameModeId - 1
+static const GameMode GAME_MODES[] = {
+  //  name          flags             disarm  onArm        onTick        onKey        onAudioFinished    onDisarm          onExplode          ledEffect
+  { "doom",       GM_ENDS_AT_BLAST, nullptr, doomArm,     nullptr,      nullptr,     doomAudioFinished, nullptr,          nullptr,           doomLeds },
+  { "star_wars",  0,                "501",   starWarsArm, starWarsTick, starWarsKey, nullptr,           nullptr,          nullptr,           nullptr },
+  { "terminator", GM_NO_DUD,        nullptr, nullptr,     nullptr,      nullptr,     nullptr,           terminatorDisarm, terminatorExplode, nullptr },
+  { "bond",       0,                nullptr, bondArm,     nullptr,      nullptr,     bondAudioFinished, nullptr,          nullptr,           nullptr },
+};
+static_assert(sizeof(GAME_MODES) / sizeof(GAME_MODES[0]) == GM_COUNT - 1, "GAME_MODES needs one row per GameModeId");
+
+inline void gameModeStart(uint8_t id) {
+  activeMode = (id > GM_NONE && id < GM_COUNT) ? &GAME_MODES[id - 1] : nullptr;
+  if (activeMode) LOG_I("[MODE] %s", activeMode->name);
+}
@@ -1,6 +1,7 @@
 // Hardware.h
-// VERSION: 3.5.1
-// FIXED: Updated DFPlayer Soft Reset logic for better freeze recovery
+// VERSION: 3.6.0
+// ADDED: safePause()/safeResume() for a referee pause (Countdown.h)
+// CHANGED: DFPlayer recovery logs via Log.h
 
 #pragma once
 #include <Wire.h>
@@ -14,6 +15,9 @@
 #include "DFRobotDFPlayerMini.h"
 #include "Pins.h"
 #include "Config.h"
+#include "LoopMonitor.h"
+#include "Metrics.h"
+#include "Log.h"
 
 // --- LED CONFIGURATION ---
 // Index 0 = Status LED (Blinking)
@@ -98,6 +102,19 @@ inline void safeStop() {
   }
 }
 
+// Not rate limited: a dropped pause would leave music running over a paused round
+inline void safePause() {
+  if (!settings.sound_enabled) return;
+  myDFPlayer.pause();
+  lastAudioCmdTime = millis();
+}
+
+inline void safeResume() {
+  if (!settings.sound_enabled) return;
+  myDFPlayer.start();
+  lastAudioCmdTime = millis();
+}
+
 inline void safeVolume(uint8_t vol) {
   if (millis() - lastAudioCmdTime >= AUDIO_COOLDOWN_MS) {
     myDFPlayer.volume(vol);
@@ -111,8 +128,10 @@ inline void dfplayerSoftReset() {
   // Prevent spamming resets if errors are continuous
   if (millis() - lastResetMs < 5000) return; 
   lastResetMs = millis();
+  STALL_TAG_SCOPE(STALL_TAG_DFPLAYER_RESET);
+  metricInc(M_DFPLAYER_RESETS);
 
-  Serial.println(F("[DFPlayer] Error detected. Executing Soft Reset..."));
+  LOG_W("[DFPlayer] Error detected. Executing Soft Reset...");
 
   // 1. Send Reset Command
   myDFPlayer.reset();
@@ -128,7 +147,7 @@ inline void dfplayerSoftReset() {
   // 4. Restore settings
   myDFPlayer.volume(settings.sound_volume);
   
-  Serial.println(F("[DFPlayer] Module Online."));
+  LOG_I("[DFPlayer] Module Online.");
 }
 
 // --- BUZZER CONTROL ---
@@ -0,0 +1,461 @@
+// HttpApi.h
+// VERSION: 1.3.1
+// CHANGED: The settings field table moved to SettingsFields.h (remote rounds validate against it too)
+// ADDED: /api/status reports timer_paused and timer_rate_pct (Countdown.h)
+// CHANGED: remaining_ms comes from the bomb deadline (GameClock.h)
+// ADDED: POST /api/ota (streamed patch/image, Ota.h) + GET /api/ota
+// CHANGED: Logs go through Log.h
+// ADDED: GET /metrics (Prometheus text, Metrics.h); request counters moved to Metrics.h
+// REST API on the prop for setup and tuning without the LCD menu (HttpLite.h does the parsing/JSON):
+//   GET    /api/status                          state, timer, firmware, network
+//   GET    /api/settings                        every tunable (cmd_token only as cmd_token_set)
+//   PATCH  /api/settings[?save=0][&apply=1]     partial update, all-or-nothing; PUT/POST work too
+//   GET    /api/rfid                            tag table
+//   POST   /api/rfid      {"uid":"04:A1:B2:C3","type":0|1}   (0 = disarm, 1 = arming card)
+//   DELETE /api/rfid?uid=04:A1:B2:C3   or   DELETE /api/rfid?all=1
+//   GET    /metrics                             Prometheus text exposition
+//   POST   /api/ota       body = patch from tools/ota_patch (or a plain .bin if unsigned is allowed)
+//   GET    /api/ota                             partitions, trial state, last update + throughput
+// Changes need "Authorization: Bearer <cmd_token>" (same token + lockout as WsCommands.h) and
+// are refused while a round runs or the LCD menu is open. One client at a time, a per-loop read
+// budget and a request rate limit keep it from starving the game loop. Stopped while the
+// WiFiManager portal owns port 80.
+
+#pragma once
+#include <Arduino.h>
+#include <WiFi.h>
+#include <stddef.h>
+#include "Config.h"
+#include "State.h"
+#include "HttpLite.h"
+#include "SettingsFields.h"
+#include "WsCommands.h"
+#include "Network.h"
+#include "Ota.h"
+#include "Log.h"
+
+#ifndef HTTP_API
+  #define HTTP_API 1
+#endif
+#ifndef HTTP_API_PORT
+  #define HTTP_API_PORT 80
+#endif
+#ifndef HTTP_API_RATE_PER_S
+  #define HTTP_API_RATE_PER_S 4          // sustained requests/s
+#endif
+#ifndef HTTP_API_BURST
+  #define HTTP_API_BURST 8
+#endif
+#ifndef HTTP_API_MAX_TOKENS
+  #define HTTP_API_MAX_TOKENS 72         // a full settings PATCH is ~55 tokens
+#endif
+
+static const uint32_t HTTP_API_IDLE_MS     = 1500;   // drop a client that stops sending
+static const size_t   HTTP_API_READ_BUDGET = 512;    // bytes read per loop() pass
+static const uint32_t HTTP_OTA_IDLE_MS     = 8000;   // upload stalled
+static const uint32_t HTTP_OTA_SLICE_MS    = 20;     // time per loop() pass spent on an upload
+
+static WiFiServer  httpServer(HTTP_API_PORT);
+static WiFiClient  httpClient;
+static HttpRequest httpReq;
+static JsonOut     httpOut;
+static JsonTok     httpToks[HTTP_API_MAX_TOKENS];
+static bool        httpRunning = false;
+static uint32_t    httpClientSinceMs = 0;
+static uint32_t    httpBucketMilli = HTTP_API_BURST * 1000UL;   // token bucket, 1/1000 requests
+static uint32_t    httpBucketAtMs = 0;
+static bool        httpOtaActive = false;                  // httpClient is streaming an update
+static uint8_t     httpOtaBuf[HTTP_MAX_REQUEST];             // the request buffer may already hold this much body
+static uint16_t    httpOtaLen = 0, httpOtaOff = 0;
+
+inline void httpSink(void* ctx, const char* data, size_t len) {
+  ((WiFiClient*)ctx)->write((const uint8_t*)data, len);
+}
+
+// Status line + headers, then the body streams through httpOut
+inline void httpBeginResponse(uint16_t code, const char* contentType = "application/json") {
+  char head[192];
+  int n = snprintf(head, sizeof(head),
+                   "HTTP/1.1 %u %s\r\nContent-Type: %s\r\nCache-Control: no-store\r\nConnection: close\r\n\r\n",
+                   (unsigned)code, httpReason(code), contentType);
+  httpClient.write((const uint8_t*)head, (size_t)n);
+  httpOut.begin(httpSink, &httpClient);
+  if (code >= 400) {             // successes only show up in the counters (scrapes would flood the log)
+    metricInc(M_HTTP_ERRORS);
+    LOG_W("[HTTP] %s -> %u", httpReq.path, (unsigned)code);
+  }
+}
+
+inline void httpCloseClient() {
+  httpClient.stop();
+  httpReq.reset();
+}
+
+inline void httpError(uint16_t code, const char* err) {
+  httpBeginResponse(code);
+  httpOut.open('{');
+  httpOut.kvBool("ok", false);
+  httpOut.kvStr("err", err);
+  httpOut.close('}');
+  httpOut.flush();
+}
+
+inline bool httpRateOk(uint32_t now) {
+  uint32_t elapsed = now - httpBucketAtMs;
+  httpBucketAtMs = now;
+  if (elapsed > HTTP_API_BURST * 1000UL) elapsed = HTTP_API_BURST * 1000UL;   // no overflow after long idle
+  httpBucketMilli += elapsed * HTTP_API_RATE_PER_S;
+  if (httpBucketMilli > HTTP_API_BURST * 1000UL) httpBucketMilli = HTTP_API_BURST * 1000UL;
+  if (httpBucketMilli < 1000) return false;
+  httpBucketMilli -= 1000;
+  return true;
+}
+
+// Auth + "not now" checks shared by every mutating route; sends the error itself
+inline bool httpMayChange() {
+  const char* err = cmdAuthorize(cmdTokenMatches(httpReq.token, strlen(httpReq.token)));
+  if (err) { httpError(strcmp(err, "locked") == 0 ? 429 : 401, err); return false; }
+  if (wsCmdInGame() || currentState == CONFIG_MODE) { httpError(409, "busy"); return false; }
+  return true;
+}
+
+inline bool httpQueryFlag(const char* key, bool dflt) {
+  char v[4];
+  if (!httpReq.queryParam(key, v, sizeof(v))) return dflt;
+  return v[0] != '0';
+}
+
+// "04:A1:B2:C3" or "04a1b2c3" -> bytes
+inline bool httpParseUid(const char* s, size_t len, uint8_t* out, uint8_t& outLen) {
+  outLen = 0;
+  int hi = -1;
+  for (size_t i = 0; i < len; i++) {
+    char c = s[i];
+    int v = (c >= '0' && c <= '9') ? c - '0' : (c >= 'a' && c <= 'f') ? c - 'a' + 10 : (c >= 'A' && c <= 'F') ? c - 'A' + 10 : -1;
+    if (v < 0) { if (c == ':' && hi < 0) continue; return false; }
+    if (hi < 0) { hi = v; continue; }
+    if (outLen >= sizeof(Settings::TagUID::bytes)) return false;
+    out[outLen++] = (uint8_t)((hi << 4) | v);
+    hi = -1;
+  }
+  return hi < 0 && outLen >= 4;
+}
+
+inline int httpFindTag(const uint8_t* uid, uint8_t len) {
+  for (int i = 0; i < settings.num_rfid_uids; i++) {
+    if (UIDUtil::equals_len_bytes(settings.rfid_uids[i].len, settings.rfid_uids[i].bytes, uid, len)) return i;
+  }
+  return -1;
+}
+
+// ---- Routes ----
+inline void httpGetStatus() {
+  uint32_t rem = 0;
+  if (wsCmdInGame()) {
+    rem = bombRemainingMs();
+  }
+  httpBeginResponse(200);
+  JsonOut& o = httpOut;
+  o.open('{');
+  o.kvBool("ok", true);
+  o.kvStr("state", getStateName(currentState));
+  o.kv("remaining_ms", rem);
+  o.kv("bomb_duration_ms", settings.bomb_duration_ms);
+  o.kvBool("timer_paused", wsCmdInGame() && bombClock.paused);
+  o.kv("timer_rate_pct", (uint32_t)(bombClock.running ? bombClock.ratePct : COUNTDOWN_RATE_1X));
+  o.kvStr("fw", FW_VERSION);
+  o.kv("uptime_ms", millis());
+  o.kv("heap_free", ESP.getFreeHeap());
+  o.kvInt("rssi", WiFi.RSSI());
+  o.kvStr("ip", WiFi.localIP().toString().c_str());
+  o.kvStr("ws", connPhaseName(conn.phase));
+  o.kv("ws_drops", conn.stats.drops);
+  o.kv("rfid_tags", (uint32_t)settings.num_rfid_uids);
+  o.close('}');
+  o.flush();
+}
+
+inline void httpGetSettings() {
+  httpBeginResponse(200);
+  httpOut.open('{');
+  jsonFieldsWrite(httpOut, &settings, SETTINGS_FIELDS, SETTINGS_FIELD_COUNT);
+  httpOut.close('}');
+  httpOut.flush();
+}
+
+inline bool httpPatchSettings() {
+  if (!httpMayChange()) return false;
+  char* body = httpReq.body();
+  int n = jsonTokenize(body, httpReq.bodyLen(), httpToks, HTTP_API_MAX_TOKENS);
+  if (n < 1) { httpError(400, "bad_json"); return false; }
+
+  const char* bad = nullptr;
+  uint8_t touched = 0;
+  int changed = jsonFieldsApply(body, httpToks, n, 0, &settings, SETTINGS_FIELDS, SETTINGS_FIELD_COUNT, &bad, &touched);
+  if (changed < 0) {
+    char err[48];
+    snprintf(err, sizeof(err), "bad_field:%s", bad);
+    httpError(400, err);
+    return false;
+  }
+  safeVolume(settings.sound_volume);
+  bool save = httpQueryFlag("save", true);
+  bool saved = save && changed > 0 && saveSettings();
+  bool apply = (touched & JF_NET) && httpQueryFlag("apply", false);
+
+  httpBeginResponse(200);
+  httpOut.open('{');
+  httpOut.kvBool("ok", true);
+  httpOut.kv("changed", (uint32_t)changed);
+  httpOut.kvBool("saved", saved);
+  httpOut.kvBool("network_changed", (touched & JF_NET) != 0);
+  httpOut.kvBool("applying", apply);
+  httpOut.close('}');
+  httpOut.flush();
+  return apply;
+}
+
+inline void httpGetRfid() {
+  httpBeginResponse(200);
+  JsonOut& o = httpOut;
+  o.open('{');
+  o.kv("count", (uint32_t)settings.num_rfid_uids);
+  o.kv("max", MAX_RFID_UIDS);
+  o.key("tags");
+  o.open('[');
+  for (int i = 0; i < settings.num_rfid_uids; i++) {
+    const Settings::TagUID& t = settings.rfid_uids[i];
+    char hex[3 * 10 + 1];
+    int k = 0;
+    for (uint8_t b = 0; b < t.len && b < sizeof(t.bytes); b++) k += snprintf(hex + k, sizeof(hex) - k, "%02X%s", t.bytes[b], (b + 1 < t.len) ? ":" : "");
+    o.open('{');
+    o.kvStr("uid", hex);
+    o.kv("type", t.type);
+    o.close('}');
+  }
+  o.close(']');
+  o.close('}');
+  o.flush();
+}
+
+inline void httpPostRfid() {
+  if (!httpMayChange()) return;
+  char* body = httpReq.body();
+  int n = jsonTokenize(body, httpReq.bodyLen(), httpToks, HTTP_API_MAX_TOKENS);
+  if (n < 1 || httpToks[0].type != JSON_OBJECT) { httpError(400, "bad_json"); return; }
+  int ui = jsonFind(body, httpToks, n, 0, "uid");
+  int ti = jsonFind(body, httpToks, n, 0, "type");
+  uint8_t uid[10], len = 0;
+  uint32_t type = 0;
+  if (ui < 0 || httpToks[ui].type != JSON_STRING ||
+      !httpParseUid(body + httpToks[ui].start, jsonLen(httpToks[ui]), uid, len)) { httpError(400, "bad_uid"); return; }
+  if (ti >= 0 && (!jsonU32(body, httpToks[ti], type) || type > 1)) { httpError(400, "bad_type"); return; }
+
+  int idx = httpFindTag(uid, len);
+  if (idx < 0) {
+    if (settings.num_rfid_uids >= MAX_RFID_UIDS) { httpError(409, "full"); return; }
+    idx = settings.num_rfid_uids++;
+    settings.rfid_uids[idx].len = len;
+    memcpy(settings.rfid_uids[idx].bytes, uid, len);
+  }
+  settings.rfid_uids[idx].type = (uint8_t)type;
+  saveSettings();
+  httpGetRfid();
+}
+
+inline void httpDeleteRfid() {
+  if (!httpMayChange()) return;
+  char q[32];
+  if (httpQueryFlag("all", false)) {
+    settings.num_rfid_uids = 0;
+  } else if (httpReq.queryParam("uid", q, sizeof(q))) {
+    uint8_t uid[10], len = 0;
+    if (!httpParseUid(q, strlen(q), uid, len)) { httpError(400, "bad_uid"); return; }
+    int idx = httpFindTag(uid, len);
+    if (idx < 0) { httpError(404, "no_such_tag"); return; }
+    for (int i = idx; i < settings.num_rfid_uids - 1; i++) settings.rfid_uids[i] = settings.rfid_uids[i + 1];
+    settings.num_rfid_uids--;
+  } else {
+    httpError(400, "need_uid_or_all");
+    return;
+  }
+  saveSettings();
+  httpGetRfid();
+}
+
+inline void httpGetMetrics() {
+  httpBeginResponse(200, "text/plain; version=0.0.4");
+  MetricsOut o;
+  o.begin(false, httpSink, &httpClient);
+  metricsWriteAll(o);
+}
+
+inline void httpGetOta() {
+  const esp_partition_t* running = esp_ota_get_running_partition();
+  const esp_partition_t* next = esp_ota_get_next_update_partition(nullptr);
+  const char* pre = otaPreflight();
+  httpBeginResponse(200);
+  JsonOut& o = httpOut;
+  o.open('{');
+  o.kvStr("fw", FW_VERSION);
+  o.kvStr("running", running ? running->label : "");
+  o.kvStr("next", next ? next->label : "");
+  o.kvBool("trial", otaTrialPending);
+  o.kvStr("ready", pre ? pre : "ok");
+  o.kvBool("signed_only", sizeof(OTA_PATCH_KEY) > 1);
+  o.key("last");
+  o.open('{');
+  o.kvStr("result", otaLastResult);
+  o.kv("bytes_in", otaLastWire);
+  o.kv("bytes_written", otaLastImage);
+  o.kv("ms", otaLastMs);
+  o.kv("kbps", otaKBps(otaLastImage, otaLastMs));
+  o.close('}');
+  o.close('}');
+  o.flush();
+}
+
+// Headers are in; the body is pulled by httpOtaPump() over the next loop() passes
+inline void httpPostOta() {
+  if (!httpMayChange()) return;
+  if (!httpReq.bodyTotal) { httpError(400, "need_length"); return; }
+  const char* err = otaBegin(OTA_SRC_HTTP, httpReq.bodyTotal);
+  if (err) { httpError(409, err); return; }
+  memcpy(httpOtaBuf, httpReq.body(), httpReq.bodyLen());   // what came with the headers (< 1 KB)
+  httpOtaLen = (uint16_t)httpReq.bodyLen();
+  httpOtaOff = 0;
+  httpOtaActive = true;
+}
+
+inline void httpOtaFinish(int8_t r) {
+  httpOtaActive = false;
+  if (r != OTA_P_DONE) {
+    const char* err = otaLastResult;
+    httpError(r == OTA_P_IO ? 500 : 400, err);
+    return;
+  }
+  const char* err = otaCommit();
+  if (err) { httpError(500, err); return; }
+  httpBeginResponse(200);
+  JsonOut& o = httpOut;
+  o.open('{');
+  o.kvBool("ok", true);
+  o.kv("bytes_in", otaLastWire);
+  o.kv("bytes_written", otaLastImage);
+  o.kv("ms", otaLastMs);
+  o.kv("kbps", metricOtaKBps);
+  o.kvBool("rebooting", true);
+  o.close('}');
+  o.flush();
+  requestRestart(1000);
+}
+
+// Moves the upload along for up to HTTP_OTA_SLICE_MS, then lets the loop run
+inline void httpOtaPump(uint32_t now) {
+  int8_t r = OTA_P_MORE;
+  while (r == OTA_P_MORE && millis() - now < HTTP_OTA_SLICE_MS) {
+    if (httpOtaOff == httpOtaLen) {
+      httpOtaOff = httpOtaLen = 0;
+      uint32_t left = ota.wireTotal - ota.wireBytes;
+      if (!left) { otaAbort("truncated"); r = OTA_P_FORMAT; break; }   // Content-Length used up, no END
+      int avail = httpClient.available();
+      if (avail <= 0) {
+        if (!httpClient.connected())                        { otaAbort("client_gone"); r = OTA_P_FORMAT; }
+        else if (now - httpClientSinceMs > HTTP_OTA_IDLE_MS) { otaAbort("timeout"); r = OTA_P_FORMAT; }
+        break;
+      }
+      size_t want = left < sizeof(httpOtaBuf) ? left : sizeof(httpOtaBuf);
+      int got = httpClient.read(httpOtaBuf, want);
+      if (got <= 0) break;
+      httpOtaLen = (uint16_t)got;
+      httpClientSinceMs = now;
+    }
+    size_t used = 0;
+    r = otaWrite(httpOtaBuf + httpOtaOff, httpOtaLen - httpOtaOff, used);
+    httpOtaOff += (uint16_t)used;
+  }
+  if (r == OTA_P_MORE) return;
+  httpOtaFinish(r);
+  httpCloseClient();
+}
+
+// Returns true if the network should be reconfigured once the client is closed
+inline bool httpRoute() {
+  const char* p = httpReq.path;
+  uint8_t m = httpReq.method;
+  if (!strcmp(p, "/api/status")) {
+    if (m == HM_GET) httpGetStatus(); else httpError(405, "method");
+  } else if (!strcmp(p, "/api/settings")) {
+    if (m == HM_GET) httpGetSettings();
+    else if (m == HM_PATCH || m == HM_PUT || m == HM_POST) return httpPatchSettings();
+    else httpError(405, "method");
+  } else if (!strcmp(p, "/api/rfid")) {
+    if (m == HM_GET) httpGetRfid();
+    else if (m == HM_POST) httpPostRfid();
+    else if (m == HM_DELETE) httpDeleteRfid();
+    else httpError(405, "method");
+  } else if (!strcmp(p, "/api/ota")) {
+    if (m == HM_GET) httpGetOta();
+    else if (m == HM_POST) httpPostOta();
+    else httpError(405, "method");
+  } else if (!strcmp(p, "/metrics")) {
+    if (m == HM_GET) httpGetMetrics(); else httpError(405, "method");
+  } else {
+    httpError(404, "not_found");
+  }
+  return false;
+}
+
+
+inline void httpApiLoop() {
+#if HTTP_API
+  bool want = !wifiSessionDisabled && WiFi.isConnected() && !g_wm.getConfigPortalActive();
+  if (want != httpRunning) {
+    httpRunning = want;
+    if (want) { httpServer.begin(); httpReq.streamPath = "/api/ota"; LOG_I("[HTTP] API on http://%s:%u/api/status", WiFi.localIP().toString().c_str(), (unsigned)HTTP_API_PORT); }
+    else      { if (httpOtaActive) { httpOtaActive = false; otaAbort("wifi_lost"); }
+                httpCloseClient(); httpServer.end(); LOG_I("[HTTP] API stopped."); }
+  }
+  if (!httpRunning) return;
+
+  uint32_t now = millis();
+  if (httpOtaActive) { httpOtaPump(now); return; }
+  if (!httpClient) {
+    httpClient = httpServer.available();
+    if (!httpClient) return;
+    httpReq.reset();
+    httpClientSinceMs = now;
+  }
+
+  // Bounded read per pass; a slow client just takes more passes
+  int8_t r = HP_NEED_MORE;
+  size_t budget = HTTP_API_READ_BUDGET;
+  uint8_t chunk[128];
+  while (r == HP_NEED_MORE && budget && httpClient.available() > 0) {
+    int got = httpClient.read(chunk, budget < sizeof(chunk) ? budget : sizeof(chunk));
+    if (got <= 0) break;
+    budget -= (size_t)got;
+    r = httpReq.feed((const char*)chunk, (size_t)got);
+  }
+  if (r == HP_NEED_MORE) {
+    if (!httpClient.connected() || now - httpClientSinceMs > HTTP_API_IDLE_MS) httpCloseClient();
+    return;
+  }
+
+  metricInc(M_HTTP_REQUESTS);
+  bool reconfigure = false;
+  if (r == HP_TOO_LARGE)        httpError(413, "too_large");
+  else if (r == HP_BAD)         httpError(400, "bad_request");
+  else if (!httpRateOk(now))    { metricInc(M_HTTP_RATE_LIMITED); httpError(429, "rate_limited"); }
+  else                          reconfigure = httpRoute();
+  if (httpOtaActive) return;             // the client stays open for the upload
+  httpCloseClient();
+  if (reconfigure) networkReconfigure();
+#endif
+}
+
+inline void httpApiPrintStatus(Print& out) {
+  out.printf("[HTTP] %s port=%u requests=%u limited=%u errors=%u rate=%u/s burst=%u\n",
+             httpRunning ? "running" : "stopped", (unsigned)HTTP_API_PORT, (unsigned)metricGet(M_HTTP_REQUESTS),
+             (unsigned)metricGet(M_HTTP_RATE_LIMITED), (unsigned)metricGet(M_HTTP_ERRORS), (unsigned)HTTP_API_RATE_PER_S, (unsigned)HTTP_API_BURST);
+}
@@ -0,0 +1,374 @@
+// HttpLite.h
+// VERSION: 1.1.1
+// ADDED: jsonFieldStore(): one member, so other tables' values can be staged (RoundPlan.h)
+// ADDED: streamPath: a POST to it completes at the end of the headers, the body is read by the route
+// FIXED: the last header's value ran on into the body
+// Building blocks for the prop's REST API (HttpApi.h), kept free of Arduino calls so a host
+// program can serve them over a loopback socket (tools/http_loopback.cpp):
+//   HttpRequest  incremental request parser over one fixed buffer (no heap)
+//   JsonOut      streaming JSON writer: small chunk buffer flushed to a sink callback
+//   JsonField    table that maps JSON keys onto struct members (offset/type/range), used to
+//                stream a struct out and to validate + apply a partial JSON update to it
+
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "JsonLite.h"
+
+#ifndef HTTP_MAX_REQUEST
+  #define HTTP_MAX_REQUEST 1536        // request line + headers + body
+#endif
+#ifndef HTTP_JSON_CHUNK
+  #define HTTP_JSON_CHUNK 256          // bytes buffered before the sink is called
+#endif
+
+// ---------------------------------------------------------------------------
+// Request parser
+// ---------------------------------------------------------------------------
+enum HttpMethod : uint8_t { HM_GET, HM_PUT, HM_POST, HM_PATCH, HM_DELETE, HM_OTHER };
+
+enum HttpParse : int8_t { HP_NEED_MORE = 0, HP_DONE = 1, HP_BAD = -1, HP_TOO_LARGE = -2 };
+
+struct HttpRequest {
+  char     buf[HTTP_MAX_REQUEST + 1];
+  uint16_t len;
+  uint16_t bodyOff;        // 0 until the header block is complete
+  uint16_t contentLen;
+  uint8_t  method;
+  const char* path;        // NUL-terminated, inside buf
+  const char* query;       // after '?', "" if none
+  const char* token;       // "Authorization: Bearer <x>" or "X-C4-Token: <x>", "" if none
+  uint32_t bodyTotal;      // Content-Length as sent
+  bool     streamed;       // POST to streamPath: body() holds only what came with the headers
+  const char* streamPath;  // set once by the owner; kept across reset()
+
+  void reset() {
+    len = 0; bodyOff = 0; contentLen = 0; bodyTotal = 0; streamed = false; method = HM_OTHER;
+    path = query = token = ""; buf[0] = '\0';
+  }
+
+  char*  body()          { return buf + bodyOff; }
+  size_t bodyLen() const { return contentLen; }
+
+  static bool headerIs(const char* line, const char* name) {
+    size_t n = strlen(name);
+    for (size_t i = 0; i < n; i++) {
+      char c = line[i];
+      if (c >= 'A' && c <= 'Z') c += 32;
+      if (c != name[i]) return false;
+    }
+    return line[n] == ':';
+  }
+
+  static const char* headerValue(char* line, size_t nameLen) {
+    char* v = line + nameLen + 1;
+    while (*v == ' ' || *v == '\t') v++;
+    return v;
+  }
+
+  // Parse the request line and headers in place (lines become NUL-terminated)
+  int8_t parseHead(size_t headEnd) {
+    char* p = buf;
+    char* end = buf + headEnd;                 // points at the blank line's "\r\n"
+    for (char* q = p; q < end; q++) if (*q == '\r' || *q == '\n') *q = '\0';
+    *end = '\0';                               // ends the last header line too
+    char* headers = p + strlen(p) + 1;      // before the request line is split up
+
+    char* sp = strchr(p, ' ');
+    if (!sp) return HP_BAD;
+    *sp = '\0';
+    if      (!strcmp(p, "GET"))    method = HM_GET;
+    else if (!strcmp(p, "PUT"))    method = HM_PUT;
+    else if (!strcmp(p, "POST"))   method = HM_POST;
+    else if (!strcmp(p, "PATCH"))  method = HM_PATCH;
+    else if (!strcmp(p, "DELETE")) method = HM_DELETE;
+    else                           method = HM_OTHER;
+    char* target = sp + 1;
+    sp = strchr(target, ' ');
+    if (!sp || target[0] != '/') return HP_BAD;
+    *sp = '\0';
+    char* qm = strchr(target, '?');
+    if (qm) { *qm = '\0'; query = qm + 1; }
+    path = target;
+
+    for (char* line = headers; line < end; line += strlen(line) + 1) {
+      if (!*line) continue;
+      if (headerIs(line, "content-length")) {
+        bodyTotal = (uint32_t)strtoul(headerValue(line, 14), nullptr, 10);
+      } else if (headerIs(line, "authorization")) {
+        const char* v = headerValue(line, 13);
+        if (!strncmp(v, "Bearer ", 7)) token = v + 7;
+      } else if (headerIs(line, "x-c4-token")) {
+        token = headerValue(line, 10);
+      }
+    }
+    streamed = streamPath && method == HM_POST && !strcmp(path, streamPath);
+    if (!streamed) {
+      if (bodyTotal > HTTP_MAX_REQUEST) return HP_TOO_LARGE;
+      contentLen = (uint16_t)bodyTotal;
+    }
+    return HP_DONE;
+  }
+
+  // Feed received bytes. Returns HP_DONE once the head and the whole body are in.
+  int8_t feed(const char* data, size_t n) {
+    if ((size_t)len + n > HTTP_MAX_REQUEST) return HP_TOO_LARGE;
+    memcpy(buf + len, data, n);
+    len += (uint16_t)n;
+    buf[len] = '\0';
+
+    if (!bodyOff) {
+      char* hdrEnd = strstr(buf, "\r\n\r\n");
+      if (!hdrEnd) return HP_NEED_MORE;
+      size_t headEnd = (size_t)(hdrEnd - buf);
+      bodyOff = (uint16_t)(headEnd + 4);
+      int8_t r = parseHead(headEnd);
+      if (r != HP_DONE) return r;
+      if ((size_t)bodyOff + contentLen > HTTP_MAX_REQUEST) return HP_TOO_LARGE;
+    }
+    if (streamed) {
+      uint32_t have = len - bodyOff;
+      contentLen = (uint16_t)(have < bodyTotal ? have : bodyTotal);
+      return HP_DONE;
+    }
+    if (len < bodyOff + contentLen) return HP_NEED_MORE;
+    buf[bodyOff + contentLen] = '\0';
+    return HP_DONE;
+  }
+
+  // Value of a query parameter (copied, NUL-terminated); false if absent
+  bool queryParam(const char* key, char* out, size_t outLen) const {
+    size_t kl = strlen(key);
+    for (const char* q = query; q && *q; ) {
+      const char* amp = strchr(q, '&');
+      size_t seg = amp ? (size_t)(amp - q) : strlen(q);
+      if (seg >= kl && !strncmp(q, key, kl) && (seg == kl || q[kl] == '=')) {
+        size_t vl = (seg > kl) ? seg - kl - 1 : 0;
+        if (vl >= outLen) vl = outLen - 1;
+        memcpy(out, q + kl + (seg > kl ? 1 : 0), vl);
+        out[vl] = '\0';
+        return true;
+      }
+      q = amp ? amp + 1 : nullptr;
+    }
+    return false;
+  }
+};
+
+inline const char* httpReason(uint16_t code) {
+  switch (code) {
+    case 200: return "OK";
+    case 400: return "Bad Request";
+    case 401: return "Unauthorized";
+    case 404: return "Not Found";
+    case 405: return "Method Not Allowed";
+    case 409: return "Conflict";
+    case 413: return "Payload Too Large";
+    case 429: return "Too Many Requests";
+    case 500: return "Internal Server Error";
+    case 503: return "Service Unavailable";
+    default:  return "Error";
+  }
+}
+
+// ---------------------------------------------------------------------------
+// Streaming JSON writer
+// ---------------------------------------------------------------------------
+typedef void (*HttpSinkFn)(void* ctx, const char* data, size_t len);
+
+struct JsonOut {
+  char       buf[HTTP_JSON_CHUNK];
+  uint16_t   n;
+  uint32_t   total;
+  uint32_t   needComma;      // one bit per nesting level
+  uint8_t    depth;
+  HttpSinkFn sink;
+  void*      ctx;
+
+  void begin(HttpSinkFn fn, void* c) { n = 0; total = 0; needComma = 0; depth = 0; sink = fn; ctx = c; }
+
+  void flush() { if (n && sink) sink(ctx, buf, n); total += n; n = 0; }
+
+  void raw(const char* s, size_t len) {
+    while (len) {
+      size_t room = sizeof(buf) - n, k = len < room ? len : room;
+      memcpy(buf + n, s, k);
+      n += (uint16_t)k; s += k; len -= k;
+      if (n == sizeof(buf)) flush();
+    }
+  }
+  void raw(const char* s) { raw(s, strlen(s)); }
+
+  void str(const char* s, size_t len) {
+    raw("\"", 1);
+    for (size_t i = 0; i < len; i++) {
+      char c = s[i];
+      if (c == '"' || c == '\\') { char e[2] = { '\\', c }; raw(e, 2); }
+      else if ((unsigned char)c < 0x20) { char e[8]; snprintf(e, sizeof(e), "\\u%04x", (unsigned)c); raw(e); }
+      else raw(&c, 1);
+    }
+    raw("\"", 1);
+  }
+  void str(const char* s) { str(s, strlen(s)); }
+
+  void sep() {
+    uint32_t bit = 1UL << depth;
+    if (needComma & bit) raw(",", 1);
+    needComma |= bit;
+  }
+  void open(char c)  { sep(); raw(&c, 1); depth++; needComma &= ~(1UL << depth); }
+  void close(char c) { depth--; raw(&c, 1); }
+  void key(const char* k) { sep(); str(k); raw(":", 1); needComma &= ~(1UL << depth); }
+
+  void val(uint32_t v)           { char t[12]; int k = snprintf(t, sizeof(t), "%lu", (unsigned long)v); sep(); raw(t, (size_t)k); }
+  void valInt(int32_t v)         { char t[12]; int k = snprintf(t, sizeof(t), "%ld", (long)v); sep(); raw(t, (size_t)k); }
+  void valBool(bool b)           { sep(); raw(b ? "true" : "false"); }
+  void valStr(const char* s)     { sep(); str(s); }
+
+  void kv(const char* k, uint32_t v)        { key(k); val(v); }
+  void kvInt(const char* k, int32_t v)      { key(k); valInt(v); }
+  void kvBool(const char* k, bool b)        { key(k); valBool(b); }
+  void kvStr(const char* k, const char* s)  { key(k); valStr(s); }
+};
+
+// ---------------------------------------------------------------------------
+// Struct <-> JSON field tables
+// ---------------------------------------------------------------------------
+enum JsonFieldType : uint8_t { JF_U8, JF_U16, JF_U32, JF_BOOL, JF_STR, JF_IP };
+
+enum JsonFieldFlags : uint8_t {
+  JF_SECRET = 1 << 0,       // write-only: GET shows only whether it is set
+  JF_DIGITS = 1 << 1,       // JF_STR: '0'..'9' only
+  JF_NET    = 1 << 2        // takes effect after a network reconfigure
+};
+
+struct JsonField {
+  const char* key;
+  uint8_t     type;
+  uint8_t     flags;
+  uint16_t    offset;       // offsetof(Struct, member)
+  uint16_t    size;         // JF_STR: buffer size incl. NUL
+  uint32_t    min, max;     // numbers: value range; JF_STR: length range
+};
+
+// IPs are stored like Settings::scoreboard_ip: a.b.c.d = (a<<24)|(b<<16)|(c<<8)|d
+inline bool jsonParseIp(const char* s, size_t len, uint32_t& out) {
+  uint32_t ip = 0, part = 0;
+  uint8_t dots = 0, digits = 0;
+  for (size_t i = 0; i <= len; i++) {
+    char c = (i < len) ? s[i] : '.';
+    if (c >= '0' && c <= '9') {
+      part = part * 10 + (uint32_t)(c - '0');
+      if (++digits > 3 || part > 255) return false;
+    } else if (c == '.') {
+      if (!digits) return false;
+      ip = (ip << 8) | part;
+      part = 0; digits = 0;
+      if (++dots > 4) return false;
+    } else {
+      return false;
+    }
+  }
+  if (dots != 4) return false;
+  out = ip;
+  return true;
+}
+
+inline void jsonFieldsWrite(JsonOut& out, const void* base, const JsonField* fields, size_t count) {
+  const uint8_t* b = (const uint8_t*)base;
+  for (size_t i = 0; i < count; i++) {
+    const JsonField& f = fields[i];
+    const uint8_t* p = b + f.offset;
+    if (f.flags & JF_SECRET) {                 // never echoed back: "<key>_set":true|false
+      char k[40];
+      snprintf(k, sizeof(k), "%s_set", f.key);
+      out.kvBool(k, p[0] != 0);
+      continue;
+    }
+    switch (f.type) {
+      case JF_U8:   out.kv(f.key, *p); break;
+      case JF_U16:  { uint16_t v; memcpy(&v, p, 2); out.kv(f.key, v); } break;
+      case JF_U32:  { uint32_t v; memcpy(&v, p, 4); out.kv(f.key, v); } break;
+      case JF_BOOL: out.kvBool(f.key, *p != 0); break;
+      case JF_STR:  out.key(f.key); out.str((const char*)p, strnlen((const char*)p, f.size)); break;
+      case JF_IP: {
+        uint32_t v; memcpy(&v, p, 4);
+        char t[16];
+        snprintf(t, sizeof(t), "%u.%u.%u.%u", (unsigned)(v >> 24), (unsigned)((v >> 16) & 0xFF),
+                 (unsigned)((v >> 8) & 0xFF), (unsigned)(v & 0xFF));
+        out.kvStr(f.key, t);
+      } break;
+    }
+  }
+}
+
+inline bool jsonFieldCheck(const char* js, const JsonTok& t, const JsonField& f, uint32_t& num) {
+  switch (f.type) {
+    case JF_BOOL:
+      if (jsonEq(js, t, "true"))  { num = 1; return true; }
+      if (jsonEq(js, t, "false")) { num = 0; return true; }
+      return jsonU32(js, t, num) && num <= 1;
+    case JF_U8: case JF_U16: case JF_U32:
+      return jsonU32(js, t, num) && num >= f.min && num <= f.max;
+    case JF_IP:
+      return t.type == JSON_STRING && jsonParseIp(js + t.start, jsonLen(t), num);
+    case JF_STR: {
+      size_t l = jsonLen(t);
+      if (t.type != JSON_STRING || l < f.min || l > f.max || l >= f.size) return false;
+      for (int i = t.start; i < t.end; i++) {
+        if (js[i] == '\\') return false;                                  // no escapes in settings strings
+        if ((f.flags & JF_DIGITS) && (js[i] < '0' || js[i] > '9')) return false;
+      }
+      return true;
+    }
+  }
+  return false;
+}
+
+// Writes a value jsonFieldCheck() passed (num is what it parsed) into the member at base
+inline void jsonFieldStore(void* base, const JsonField& f, const char* js, const JsonTok& v, uint32_t num) {
+  uint8_t* p = (uint8_t*)base + f.offset;
+  switch (f.type) {
+    case JF_U8: case JF_BOOL: *p = (uint8_t)num; break;
+    case JF_U16: { uint16_t x = (uint16_t)num; memcpy(p, &x, 2); } break;
+    case JF_U32: case JF_IP: memcpy(p, &num, 4); break;
+    case JF_STR: memset(p, 0, f.size); memcpy(p, js + v.start, jsonLen(v)); break;
+  }
+}
+
+// Apply the members of object obj that name a field. All-or-nothing: every value is
+// validated before anything is written. Unknown keys are an error (typos should not
+// silently do nothing). Returns the number of fields written, or -1 with *badKey set.
+inline int jsonFieldsApply(const char* js, const JsonTok* toks, int n, int obj, void* base,
+                           const JsonField* fields, size_t count, const char** badKey, uint8_t* flagsOut = nullptr) {
+  if (obj < 0 || obj >= n || toks[obj].type != JSON_OBJECT) { *badKey = "body"; return -1; }
+  uint8_t* b = (uint8_t*)base;
+  for (int pass = 0; pass < 2; pass++) {
+    int written = 0;
+    for (int i = obj + 1; i + 1 < n; i++) {
+      if (toks[i].parent != obj || toks[i].type != JSON_STRING || toks[i].size != 1) continue;
+      const JsonField* f = nullptr;
+      for (size_t k = 0; k < count && !f; k++) if (jsonEq(js, toks[i], fields[k].key)) f = &fields[k];
+      if (!f) {
+        static char unknown[24];
+        size_t l = jsonLen(toks[i]) < sizeof(unknown) - 1 ? jsonLen(toks[i]) : sizeof(unknown) - 1;
+        memcpy(unknown, js + toks[i].start, l);
+        unknown[l] = '\0';
+        *badKey = unknown;
+        return -1;
+      }
+      const JsonTok& v = toks[i + 1];
+      uint32_t num = 0;
+      if (!jsonFieldCheck(js, v, *f, num)) { *badKey = f->key; return -1; }
+      if (pass == 0) continue;
+      jsonFieldStore(b, *f, js, v, num);
+      if (flagsOut) *flagsOut |= f->flags;
+      written++;
+    }
+    if (pass == 1) return written;
+  }
+  return 0;
+}
@@ -0,0 +1,226 @@
+// JournalCore.h
+// VERSION: 1.0.0
+// Queue logic of the event journal (EventJournal.h). No Arduino calls: flash goes through a
+// JournalStore (Preferences on the prop) and frames leave through a send callback, so
+// tools/journal_sim.cpp runs the same code against a simulated scoreboard and link.
+//   - every event gets (epoch, seq): epoch counts boots, seq counts events within a boot
+//   - new events sit in a RAM ring; the oldest move to a flash FIFO when the ring is full and
+//     all of them while offline (checkpoint). Replay order is flash first, then RAM.
+//   - the scoreboard acks cumulatively per epoch; an ack retires everything up to it in that
+//     epoch, and a newer epoch is sent only once the older one in front is acked
+//   - go-back-N: unacked events are sent again from the front after a reconnect and when the
+//     oldest one has gone JOURNAL_ACK_TIMEOUT_MS without an ack retiring anything
+// Nothing is retired without an ack, unless the build says the scoreboard never acks
+// (JOURNAL_SERVER_ACKS=0): then an event counts as delivered once it is on the wire.
+
+#pragma once
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef JOURNAL_RAM_SLOTS
+  #define JOURNAL_RAM_SLOTS   16
+#endif
+#ifndef JOURNAL_FLASH_SLOTS
+  #define JOURNAL_FLASH_SLOTS 64
+#endif
+#ifndef JOURNAL_SERVER_ACKS
+  #define JOURNAL_SERVER_ACKS 1       // 0: legacy scoreboard without acks, sent == delivered
+#endif
+
+static const size_t   JOURNAL_MSG_MAX        = 128;
+static const uint32_t JOURNAL_ACK_TIMEOUT_MS = 3000;  // go-back-N retransmit timer
+static const uint8_t  JOURNAL_BURST          = 4;     // entries sent per pump call
+
+struct JournalEntry {
+  uint32_t epoch;
+  uint32_t seq;
+  uint8_t  critical;
+  uint8_t  _pad[3];
+  char     json[JOURNAL_MSG_MAX];
+};
+
+// Key/value flash. getBytes returns false unless exactly len bytes were read.
+struct JournalStore {
+  void*    ctx;
+  uint32_t (*getU32)(void* ctx, const char* key, uint32_t def);
+  void     (*putU32)(void* ctx, const char* key, uint32_t v);
+  bool     (*getBytes)(void* ctx, const char* key, void* buf, size_t len);
+  void     (*putBytes)(void* ctx, const char* key, const void* buf, size_t len);
+};
+
+typedef void (*JournalSendFn)(void* ctx, const char* json, size_t len, bool critical);
+
+inline uint64_t journalKey(uint32_t epoch, uint32_t seq) { return ((uint64_t)epoch << 32) | seq; }
+
+struct Journal {
+  JournalStore  store;
+  JournalSendFn send;
+  void*         sendCtx;
+
+  JournalEntry ram[JOURNAL_RAM_SLOTS];
+  uint8_t  ramHead, ramCount;
+  uint32_t flashHead, flashTail;            // monotonic; slot = n % JOURNAL_FLASH_SLOTS
+  uint64_t flashKeys[JOURNAL_FLASH_SLOTS];  // (epoch<<32 | seq) per flash slot
+  uint32_t epoch, nextSeq;
+  uint32_t sendPos;                         // entries from the front already on the wire
+  uint32_t frontSentMs;                     // when the front entry went out (or last progress)
+  bool     serverAcks;                      // has an ack come in since boot? (status only)
+  bool     wasConnected;
+  uint32_t delivered, dropped, retransmits;
+
+  uint32_t flashCount() const { return flashTail - flashHead; }
+  uint32_t pending() const { return flashCount() + ramCount; }
+
+  // Loads the flash FIFO and starts a new epoch
+  void begin(const JournalStore& s, JournalSendFn fn, void* ctx) {
+    store = s;
+    send = fn;
+    sendCtx = ctx;
+    ramHead = ramCount = 0;
+    nextSeq = 1;
+    sendPos = frontSentMs = 0;
+    serverAcks = wasConnected = false;
+    delivered = dropped = retransmits = 0;
+    epoch = store.getU32(store.ctx, "epoch", 0) + 1;
+    store.putU32(store.ctx, "epoch", epoch);
+    flashHead = store.getU32(store.ctx, "fh", 0);
+    flashTail = store.getU32(store.ctx, "ft", 0);
+    if (flashCount() > JOURNAL_FLASH_SLOTS) flashHead = flashTail - JOURNAL_FLASH_SLOTS;
+    JournalEntry e;
+    for (uint32_t n = flashHead; n != flashTail; n++)
+      flashKeys[n % JOURNAL_FLASH_SLOTS] = readSlot(n, e) ? journalKey(e.epoch, e.seq) : 0;
+  }
+
+  // Queues a JSON object ("{...}"), adding "epoch"/"seq"
+  void add(const char* body, bool critical) {
+    if (ramCount >= JOURNAL_RAM_SLOTS) spillOne();
+    JournalEntry& e = ram[(ramHead + ramCount) % JOURNAL_RAM_SLOTS];
+    e.epoch = epoch;
+    e.seq = nextSeq++;
+    e.critical = critical ? 1 : 0;
+    if (*body == '{') body++;
+    snprintf(e.json, sizeof(e.json), "{\"epoch\":%u,\"seq\":%u,%s", (unsigned)e.epoch, (unsigned)e.seq, body);
+    ramCount++;
+  }
+
+  // Cumulative ack within one epoch: the scoreboard counts seqs per epoch, so an ack for a
+  // newer epoch says nothing about an older one still queued in front. Duplicate and old acks
+  // change nothing, the retransmit timer included.
+  void ack(uint32_t ackEpoch, uint32_t ackSeq, uint32_t now) {
+    serverAcks = true;
+    uint64_t lo = journalKey(ackEpoch, 0), hi = journalKey(ackEpoch, ackSeq);
+    uint32_t total = pending(), k = 0;
+    while (k < total && keyAt(k) <= hi && (keyAt(k) >= lo || keyAt(k) == 0)) k++;
+    if (!k) return;
+    retireFront(k);
+    frontSentMs = now;
+  }
+
+  // {"type":"ack","epoch":E,"seq":S}. Returns true if msg was an ack.
+  bool handleAckMessage(const char* msg, uint32_t now) {
+    if (!msg || !strstr(msg, "\"type\":\"ack\"")) return false;
+    const char* e = strstr(msg, "\"epoch\":");
+    const char* s = strstr(msg, "\"seq\":");
+    if (e && s) ack(strtoul(e + 8, nullptr, 10), strtoul(s + 6, nullptr, 10), now);
+    return true;
+  }
+
+  // Every loop. allowFlash=false during gameplay (flash writes block for ms).
+  void pump(bool connected, bool allowFlash, uint32_t now) {
+    if (connected != wasConnected) {
+      sendPos = 0;                      // replay everything unacked on (re)connect
+      wasConnected = connected;
+    }
+
+    if (!connected) {
+      // Checkpoint: persist the RAM backlog while offline and it is safe to block briefly
+      if (allowFlash) while (ramCount) spillOne();
+      return;
+    }
+
+    if (JOURNAL_SERVER_ACKS && sendPos && now - frontSentMs > JOURNAL_ACK_TIMEOUT_MS) {
+      sendPos = 0;                      // go-back-N
+      retransmits++;
+    }
+
+    // The scoreboard orders seqs within an epoch only: a newer epoch waits until the one in
+    // front is acked, so it cannot overtake a lost frame of the older one
+    uint32_t frontEpoch = pending() ? (uint32_t)(keyAt(0) >> 32) : 0;
+    JournalEntry e;
+    for (uint8_t burst = 0; burst < JOURNAL_BURST && sendPos < pending(); burst++) {
+      if (JOURNAL_SERVER_ACKS && sendPos && frontEpoch && (uint32_t)(keyAt(sendPos) >> 32) != frontEpoch) break;
+      if (sendPos == 0) frontSentMs = now;
+      if (!entryAt(sendPos, e)) { sendPos++; continue; }   // unreadable slot: the next ack retires it
+      send(sendCtx, e.json, strlen(e.json), e.critical != 0);
+      sendPos++;
+    }
+    if (!JOURNAL_SERVER_ACKS && sendPos) retireFront(sendPos);
+  }
+
+  // ---- internals ----
+
+  void slotName(uint32_t n, char* out, size_t len) const {
+    snprintf(out, len, "e%u", (unsigned)(n % JOURNAL_FLASH_SLOTS));
+  }
+
+  bool readSlot(uint32_t n, JournalEntry& out) {
+    char name[8]; slotName(n, name, sizeof(name));
+    return store.getBytes(store.ctx, name, &out, sizeof(out));
+  }
+
+  void saveCursors() {
+    store.putU32(store.ctx, "fh", flashHead);
+    store.putU32(store.ctx, "ft", flashTail);
+  }
+
+  void flashPush(const JournalEntry& e) {
+    if (flashCount() >= JOURNAL_FLASH_SLOTS) {
+      flashHead++;                      // overwrite oldest
+      dropped++;
+      if (sendPos) sendPos--;
+    }
+    char name[8]; slotName(flashTail, name, sizeof(name));
+    store.putBytes(store.ctx, name, &e, sizeof(e));
+    flashKeys[flashTail % JOURNAL_FLASH_SLOTS] = journalKey(e.epoch, e.seq);
+    flashTail++;
+    saveCursors();
+  }
+
+  // Oldest RAM entry -> back of the flash FIFO. Overall order is unchanged.
+  void spillOne() {
+    if (!ramCount) return;
+    flashPush(ram[ramHead]);
+    ramHead = (ramHead + 1) % JOURNAL_RAM_SLOTS;
+    ramCount--;
+  }
+
+  // Entry at position p in replay order (flash first, then RAM)
+  bool entryAt(uint32_t p, JournalEntry& out) {
+    uint32_t fc = flashCount();
+    if (p < fc) return readSlot(flashHead + p, out);
+    p -= fc;
+    if (p >= ramCount) return false;
+    out = ram[(ramHead + p) % JOURNAL_RAM_SLOTS];
+    return true;
+  }
+
+  uint64_t keyAt(uint32_t p) const {
+    uint32_t fc = flashCount();
+    if (p < fc) return flashKeys[(flashHead + p) % JOURNAL_FLASH_SLOTS];
+    const JournalEntry& e = ram[(ramHead + (p - fc)) % JOURNAL_RAM_SLOTS];
+    return journalKey(e.epoch, e.seq);
+  }
+
+  void retireFront(uint32_t k) {
+    uint32_t fromFlash = k < flashCount() ? k : flashCount();
+    if (fromFlash) { flashHead += fromFlash; saveCursors(); }
+    uint32_t fromRam = k - fromFlash < ramCount ? k - fromFlash : ramCount;
+    ramHead = (ramHead + fromRam) % JOURNAL_RAM_SLOTS;
+    ramCount -= fromRam;
+    uint32_t n = fromFlash + fromRam;
+    sendPos = sendPos > n ? sendPos - n : 0;
+    delivered += n;
+  }
+};
@@ -0,0 +1,156 @@
+// JsonLite.h
+// VERSION: 1.0.0
+// In-place JSON tokenizer (jsmn-style): no allocation, no copies.
+// Tokens are offsets into the caller's buffer; jsonTerm() NUL-terminates a
+// value in place once tokenizing is done. Pure C++, host-compilable.
+
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+enum JsonType : uint8_t { JSON_UNDEF, JSON_OBJECT, JSON_ARRAY, JSON_STRING, JSON_PRIMITIVE };
+
+struct JsonTok {
+  uint8_t  type;
+  int16_t  start;     // first char (strings: after the opening quote)
+  int16_t  end;       // one past the last char; -1 while a container is open
+  uint16_t size;      // children (object: keys, array: elements, key: 1)
+  int16_t  parent;
+};
+
+static const size_t JSON_MAX_LEN = 32767;   // offsets are int16_t
+
+inline int jsonAlloc(JsonTok* toks, uint16_t maxToks, uint16_t& next, uint8_t type, int start, int end, int parent) {
+  if (next >= maxToks) return -1;
+  JsonTok& t = toks[next];
+  t.type = type; t.start = (int16_t)start; t.end = (int16_t)end; t.size = 0; t.parent = (int16_t)parent;
+  return next++;
+}
+
+// Returns the number of tokens, or -1 for malformed / oversized input or too many tokens.
+inline int jsonTokenize(const char* js, size_t len, JsonTok* toks, uint16_t maxToks) {
+  if (len > JSON_MAX_LEN) return -1;
+  uint16_t next = 0;
+  int super = -1;
+
+  for (size_t pos = 0; pos < len && js[pos]; pos++) {
+    char c = js[pos];
+    switch (c) {
+      case '{': case '[': {
+        int t = jsonAlloc(toks, maxToks, next, c == '{' ? JSON_OBJECT : JSON_ARRAY, (int)pos, -1, super);
+        if (t < 0) return -1;
+        if (super >= 0) {
+          if (toks[super].type == JSON_OBJECT) return -1;   // a key must be a string
+          toks[super].size++;
+        }
+        super = t;
+      } break;
+
+      case '}': case ']': {
+        uint8_t type = (c == '}') ? JSON_OBJECT : JSON_ARRAY;
+        if (super < 0) return -1;
+        // Close the innermost open container (walking up through a finished key)
+        int t = super;
+        while (t >= 0 && !(toks[t].end < 0 && (toks[t].type == JSON_OBJECT || toks[t].type == JSON_ARRAY))) t = toks[t].parent;
+        if (t < 0 || toks[t].type != type) return -1;
+        toks[t].end = (int16_t)(pos + 1);
+        super = toks[t].parent;
+      } break;
+
+      case '"': {
+        size_t start = ++pos;
+        for (; pos < len && js[pos] != '"'; pos++) {
+          if (js[pos] == '\\') {
+            if (++pos >= len) return -1;
+            if (js[pos] == 'u') {
+              for (uint8_t k = 0; k < 4; k++) {
+                char h = (++pos < len) ? js[pos] : 0;
+                if (!((h >= '0' && h <= '9') || (h >= 'a' && h <= 'f') || (h >= 'A' && h <= 'F'))) return -1;
+              }
+            } else if (!strchr("\"\\/bfnrt", js[pos])) {
+              return -1;
+            }
+          } else if ((unsigned char)js[pos] < 0x20 || !js[pos]) {
+            return -1;
+          }
+        }
+        if (pos >= len) return -1;
+        if (jsonAlloc(toks, maxToks, next, JSON_STRING, (int)start, (int)pos, super) < 0) return -1;
+        if (super >= 0) toks[super].size++;
+      } break;
+
+      case '\t': case '\r': case '\n': case ' ':
+        break;
+
+      case ':':
+        if (next == 0 || toks[next - 1].type != JSON_STRING || toks[next - 1].parent != super ||
+            super < 0 || toks[super].type != JSON_OBJECT) return -1;
+        super = next - 1;                  // the key owns the value that follows
+        break;
+
+      case ',':
+        if (super >= 0 && toks[super].type != JSON_ARRAY && toks[super].type != JSON_OBJECT) super = toks[super].parent;
+        break;
+
+      default: {
+        if (!(c == '-' || (c >= '0' && c <= '9') || c == 't' || c == 'f' || c == 'n')) return -1;
+        if (super >= 0 && toks[super].type == JSON_OBJECT) return -1;   // primitives cannot be keys
+        size_t start = pos;
+        for (; pos < len && js[pos]; pos++) {
+          char p = js[pos];
+          if (p == ',' || p == ']' || p == '}' || p == ' ' || p == '\t' || p == '\r' || p == '\n') break;
+          if ((unsigned char)p < 0x20 || (unsigned char)p >= 0x7F || p == ':' || p == '"') return -1;
+        }
+        if (jsonAlloc(toks, maxToks, next, JSON_PRIMITIVE, (int)start, (int)pos, super) < 0) return -1;
+        if (super >= 0) toks[super].size++;
+        pos--;                             // re-read the delimiter
+      } break;
+    }
+  }
+
+  for (uint16_t i = 0; i < next; i++) {
+    if (toks[i].end < 0) return -1;                                        // unclosed container
+    int p = toks[i].parent;
+    if (p >= 0 && toks[p].type == JSON_OBJECT && toks[i].size != 1) return -1;   // key without value
+  }
+  return next;
+}
+
+inline size_t jsonLen(const JsonTok& t) { return (size_t)(t.end - t.start); }
+
+// String/primitive token equals the literal s (raw compare, no unescaping)
+inline bool jsonEq(const char* js, const JsonTok& t, const char* s) {
+  size_t n = strlen(s);
+  return (t.type == JSON_STRING || t.type == JSON_PRIMITIVE) && jsonLen(t) == n && memcmp(js + t.start, s, n) == 0;
+}
+
+// Index of the value for key in object obj (top level of that object only), or -1
+inline int jsonFind(const char* js, const JsonTok* toks, int count, int obj, const char* key) {
+  if (obj < 0 || obj >= count || toks[obj].type != JSON_OBJECT) return -1;
+  for (int i = obj + 1; i + 1 < count; i++) {
+    if (toks[i].parent == obj && toks[i].type == JSON_STRING && toks[i].size == 1 && jsonEq(js, toks[i], key)) return i + 1;
+  }
+  return -1;
+}
+
+// Unsigned integer primitive; false for anything else (negative, fraction, overflow)
+inline bool jsonU32(const char* js, const JsonTok& t, uint32_t& out) {
+  if (t.type != JSON_PRIMITIVE || jsonLen(t) == 0 || jsonLen(t) > 10) return false;
+  uint64_t v = 0;
+  for (int i = t.start; i < t.end; i++) {
+    if (js[i] < '0' || js[i] > '9') return false;
+    v = v * 10 + (uint64_t)(js[i] - '0');
+  }
+  if (v > 0xFFFFFFFFULL) return false;
+  out = (uint32_t)v;
+  return true;
+}
+
+inline bool jsonBool(const char* js, const JsonTok& t) { return jsonEq(js, t, "true"); }
+
+// NUL-terminate a token in place (overwrites its closing quote / delimiter). Do this last.
+inline const char* jsonTerm(char* js, const JsonTok& t) {
+  js[t.end] = '\0';
+  return js + t.start;
+}
@@ -0,0 +1,126 @@
+// LedLimiter.h
+// VERSION: 1.0.0
+// Per-frame LED current limiter. Each frame's channel values are summed across the whole
+// buffer (status LED and exterior strip), and the brightness is scaled so the estimated
+// current stays under both LED_MAX_MA (what the strip's regulator can give) and the share the
+// power budget leaves (PowerBudget.h). Per-state frame count, average, peak and undimmed peak
+// are kept for the "power" serial command. Pure C++11 so tools/led_limiter.cpp runs and times
+// it on the host.
+//
+// Integer only and no division per frame, so it runs in a few µs on every frame:
+//   - the sum adds 4 bytes at a time in 16-bit lanes
+//   - "fits at full brightness" is one multiply and a compare against the room in sum units
+//   - the dimmed brightness is room * 1/sum, with 1/sum from a 257-entry reciprocal table
+//     of the sum's top 8 bits (rounded up). It never overshoots the room and is at most one
+//     level and ~1 % dimmer than the exact answer.
+
+#pragma once
+#include <stdint.h>
+#include <string.h>
+#include "PowerModel.h"
+
+#ifndef LED_MAX_MA
+  #define LED_MAX_MA  2500   // strip regulator rating, quiescent draw included
+#endif
+
+// Channel current in mA = sum * (brightness + 1) * LED_MA_Q24 >> 24
+static constexpr uint32_t LED_MA_Q24 = (uint32_t)(((uint64_t)POWER_MA_LED_CHANNEL << 24) / (256u * 255u));
+
+// LED_RECIP[m] = 2^24 / m, rounded down (m = 1..256)
+static uint32_t LED_RECIP[257];
+
+inline void ledRecipInit() {
+  LED_RECIP[0] = 0;
+  for (uint32_t m = 1; m <= 256; m++) LED_RECIP[m] = (1u << 24) / m;
+}
+
+// Sum of n channel bytes. Four at a time in two 16-bit lanes; flushed every 64 words, long
+// before a lane (at most 2 * 255 per word) can overflow.
+inline uint32_t ledChannelSum(const uint8_t* p, uint32_t n) {
+  uint32_t total = 0;
+  while (n >= 4) {
+    uint32_t lanes = 0;
+    uint32_t words = n / 4 < 64 ? n / 4 : 64;
+    for (uint32_t i = 0; i < words; i++, p += 4) {
+      uint32_t w;
+      memcpy(&w, p, 4);
+      lanes += (w & 0x00FF00FFu) + ((w >> 8) & 0x00FF00FFu);
+    }
+    total += (lanes & 0xFFFFu) + (lanes >> 16);
+    n -= words * 4;
+  }
+  while (n--) total += *p++;
+  return total;
+}
+
+// Largest brightness (0..b) at which a frame with channel sum 'sum' draws at most the
+// room given as capSum (room in sum units at full scale). Never over; under by at most a
+// level and ~1 %.
+inline uint8_t ledScaleFor(uint32_t sum, uint8_t b, uint32_t capSum) {
+  if (sum * ((uint32_t)b + 1) <= capSum * 256) return b;
+  uint32_t bits = 32 - __builtin_clz(sum);
+  uint32_t shift = bits > 8 ? bits - 8 : 0;
+  uint32_t m = (sum + (1u << shift) - 1) >> shift;   // top 8 bits rounded up: sum <= m << shift
+  uint64_t q = ((uint64_t)capSum * 256 * LED_RECIP[m]) >> (24 + shift);
+  return q == 0 ? 0 : (uint8_t)(q - 1);
+}
+
+struct LedStateStats {
+  uint32_t frames;
+  uint32_t dimmed;
+  uint64_t maSum;
+  uint16_t peakMa;         // as shown
+  uint16_t peakDemandMa;   // what the frame asked for before limiting
+};
+
+struct LedLimiter {
+  uint16_t count;
+  uint32_t idleMa;
+  uint32_t roomMa;         // channel room capSum was computed for
+  uint32_t capSum;
+  uint32_t lastMa;         // estimated draw of the last frame shown
+  uint8_t  lastBrightness;
+  LedStateStats st[STATE_COUNT];
+
+  void begin(uint16_t n) {
+    ledRecipInit();
+    count = n;
+    idleMa = powerLedIdleMa(n);
+    roomMa = capSum = 0xFFFFFFFFu;
+    lastMa = idleMa;
+    lastBrightness = 0;
+    resetStats();
+  }
+
+  void resetStats() { memset(st, 0, sizeof(st)); }
+
+  // Brightness to show rgb (count * 3 bytes) at: 'brightness' scaled down to fit the lower of
+  // LED_MAX_MA and budgetMa (total LED current the power budget allows, quiescent included).
+  uint8_t frame(const uint8_t* rgb, uint8_t brightness, uint32_t budgetMa, uint8_t state) {
+    uint32_t total = budgetMa < LED_MAX_MA ? budgetMa : LED_MAX_MA;
+    uint32_t room = total > idleMa ? total - idleMa : 0;
+    if (room != roomMa) {                         // once per change of room, not per frame
+      roomMa = room;
+      capSum = room * 255 / POWER_MA_LED_CHANNEL;
+    }
+    uint32_t sum = ledChannelSum(rgb, (uint32_t)count * 3);
+    uint8_t b = sum ? ledScaleFor(sum, brightness, capSum) : brightness;
+    lastBrightness = b;
+    lastMa = idleMa + (uint32_t)(((uint64_t)sum * ((uint32_t)b + 1) * LED_MA_Q24) >> 24);
+    if (state < STATE_COUNT) {
+      LedStateStats& s = st[state];
+      uint32_t demand = b < brightness ? idleMa + (uint32_t)(((uint64_t)sum * ((uint32_t)brightness + 1) * LED_MA_Q24) >> 24) : lastMa;
+      s.frames++;
+      s.dimmed += b < brightness;
+      s.maSum += lastMa;
+      if (lastMa > s.peakMa) s.peakMa = lastMa > 0xFFFF ? 0xFFFF : (uint16_t)lastMa;
+      if (demand > s.peakDemandMa) s.peakDemandMa = demand > 0xFFFF ? 0xFFFF : (uint16_t)demand;
+    }
+    return b;
+  }
+
+  uint32_t avgMa(uint8_t state) const {
+    if (state >= STATE_COUNT || st[state].frames == 0) return 0;
+    return (uint32_t)(st[state].maSum / st[state].frames);
+  }
+};
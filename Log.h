@@ -0,0 +1,191 @@
+// Log.h
+// VERSION: 1.0.0
+// Leveled, deferred logging. LOG_E/LOG_W/LOG_I/LOG_D store a binary record (format pointer +
+// raw arguments, LogCodec.h) in a lock-free ring and return; nothing is formatted or written
+// at the call site. logPump() (end of loop) formats and writes only as much as the serial TX
+// buffer takes without blocking, and can stream the raw records to the scoreboard as binary
+// WS frames (tools/log_decode.cpp turns those back into text with the firmware ELF).
+// A full ring drops the new record and counts it; the drain reports the gap.
+
+#pragma once
+#include <Arduino.h>
+#include "LogCodec.h"
+
+#ifndef C4_LOG_LEVEL
+  #define C4_LOG_LEVEL LOG_LEVEL_INFO   // calls above this level compile out
+#endif
+#ifndef LOG_RING_SLOTS
+  #define LOG_RING_SLOTS 64             // power of two; 96 bytes each
+#endif
+#ifndef LOG_SERIAL_BINARY
+  #define LOG_SERIAL_BINARY 0           // 1: serial gets binary frames (capture + log_decode)
+#endif
+#ifndef LOG_PUMP_MAX_RECORDS
+  #define LOG_PUMP_MAX_RECORDS 8        // per logPump() call
+#endif
+
+static_assert((LOG_RING_SLOTS & (LOG_RING_SLOTS - 1)) == 0, "LOG_RING_SLOTS must be a power of two");
+
+// Never called: lets the compiler check the format against the arguments like Serial.printf
+inline void logFormatCheck(const char*, ...) __attribute__((format(printf, 1, 2)));
+inline void logFormatCheck(const char*, ...) {}
+
+#define LOG_AT(lvl, ...) do { \
+    if (0) logFormatCheck(__VA_ARGS__); \
+    if ((lvl) <= C4_LOG_LEVEL) logWrite((lvl), __VA_ARGS__); \
+  } while (0)
+#define LOG_E(...) LOG_AT(LOG_LEVEL_ERROR, __VA_ARGS__)
+#define LOG_W(...) LOG_AT(LOG_LEVEL_WARN, __VA_ARGS__)
+#define LOG_I(...) LOG_AT(LOG_LEVEL_INFO, __VA_ARGS__)
+#define LOG_D(...) LOG_AT(LOG_LEVEL_DEBUG, __VA_ARGS__)
+
+// --- RING ---
+// Bounded MPSC queue (Vyukov): producers claim a slot with a CAS on logHead, the per-slot
+// sequence publishes it. Safe from the loop task and WiFi/ESP-NOW callbacks; not from ISRs.
+// Slot i stores (sequence - i) so the zero-initialized ring is already "all free".
+struct LogSlot {
+  uint32_t  seq;
+  LogRecord rec;
+};
+
+static LogSlot  logRing[LOG_RING_SLOTS];
+static uint32_t logHead = 0;              // next slot to claim (producers)
+static uint32_t logTail = 0;              // next slot to drain (logPump only)
+static uint32_t logDropped = 0;           // records lost to a full ring
+static uint32_t logDroppedReported = 0;
+static uint32_t logRecords = 0;           // records drained
+
+static const uint32_t LOG_MASK = LOG_RING_SLOTS - 1;
+
+inline uint32_t logSlotSeq(uint32_t i)              { return __atomic_load_n(&logRing[i].seq, __ATOMIC_ACQUIRE) + i; }
+inline void     logSlotPublish(uint32_t i, uint32_t s) { __atomic_store_n(&logRing[i].seq, s - i, __ATOMIC_RELEASE); }
+
+template <typename... Args>
+inline void logWrite(uint8_t level, const char* fmt, const Args&... args) {
+  uint32_t pos = __atomic_load_n(&logHead, __ATOMIC_RELAXED);
+  for (;;) {
+    int32_t dif = (int32_t)(logSlotSeq(pos & LOG_MASK) - pos);
+    if (dif == 0) {
+      if (__atomic_compare_exchange_n(&logHead, &pos, pos + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) break;
+    } else if (dif < 0) {
+      __atomic_fetch_add(&logDropped, 1, __ATOMIC_RELAXED);   // full: never wait
+      return;
+    } else {
+      pos = __atomic_load_n(&logHead, __ATOMIC_RELAXED);
+    }
+  }
+  uint32_t i = pos & LOG_MASK;
+  logEncode(logRing[i].rec, level, millis(), fmt, args...);
+  logSlotPublish(i, pos + 1);
+}
+
+inline bool logPop(LogRecord& out) {
+  uint32_t i = logTail & LOG_MASK;
+  if ((int32_t)(logSlotSeq(i) - (logTail + 1)) < 0) return false;
+  out = logRing[i].rec;
+  logSlotPublish(i, logTail + LOG_RING_SLOTS);
+  logTail++;
+  logRecords++;
+  return true;
+}
+
+// --- SINKS ---
+typedef void (*LogFrameSink)(const uint8_t* data, size_t len);
+
+static uint8_t      logSerialLevel = C4_LOG_LEVEL;   // "log <0-4>" on the serial console
+static uint8_t      logWsLevel = LOG_LEVEL_NONE;     // {"type":"log_stream","level":N}
+static LogFrameSink logWsSink = nullptr;             // set by Network.h
+static uint8_t      logWsBuf[512];
+static size_t       logWsLen = 0;
+
+static char     logLine[192];                        // staged serial output (text or frame)
+static uint16_t logLineLen = 0, logLineOff = 0;
+
+inline void logSetWsSink(LogFrameSink sink) { logWsSink = sink; }
+
+// Text form used on serial and by the decoder: "I (12345) [NET] ..."
+inline size_t logRenderText(const LogRecord& r, char* out, size_t cap) {
+  int h = snprintf(out, cap, "%c (%lu) ", logLevelChar(r.level), (unsigned long)r.ms);
+  if (h < 0 || (size_t)h >= cap) return 0;
+  size_t n = (size_t)h + logFormat(r, out + h, cap - (size_t)h);
+  if (n + 2 >= cap) n = cap - 3;
+  out[n++] = '\r'; out[n++] = '\n'; out[n] = '\0';
+  return n;
+}
+
+inline void logStage(const LogRecord& r) {
+#if LOG_SERIAL_BINARY
+  logLineLen = (uint16_t)logFrameWrite(r, (uint8_t*)logLine, sizeof(logLine));
+#else
+  logLineLen = (uint16_t)logRenderText(r, logLine, sizeof(logLine));
+#endif
+  logLineOff = 0;
+}
+
+// Writes what the TX buffer takes right now; true once the staged line is out
+inline bool logSerialDrain() {
+  while (logLineOff < logLineLen) {
+    int room = Serial.availableForWrite();
+    if (room <= 0) return false;
+    size_t n = logLineLen - logLineOff;
+    if ((size_t)room < n) n = (size_t)room;
+    Serial.write((const uint8_t*)logLine + logLineOff, n);
+    logLineOff += (uint16_t)n;
+  }
+  return true;
+}
+
+inline void logWsFlush() {
+  if (logWsLen && logWsSink) logWsSink(logWsBuf, logWsLen);
+  logWsLen = 0;
+}
+
+inline void logWsQueue(const LogRecord& r) {
+  if (!logWsSink || r.level > logWsLevel) return;
+  if (logWsLen + logFrameSize(r) > sizeof(logWsBuf)) logWsFlush();
+  logWsLen += logFrameWrite(r, logWsBuf + logWsLen, sizeof(logWsBuf) - logWsLen);
+}
+
+// The drop notice goes through the ring like any other record (its own slot frees first)
+inline void logReportDrops() {
+  uint32_t d = __atomic_load_n(&logDropped, __ATOMIC_RELAXED);
+  if (d == logDroppedReported) return;
+  uint32_t lost = d - logDroppedReported;
+  logDroppedReported = d;
+  logWrite(LOG_LEVEL_WARN, "[LOG] %u record(s) dropped (ring full)", (unsigned)lost);
+}
+
+// Call every loop, after gameplay. Never blocks: stops when the TX buffer is full.
+inline void logPump() {
+  for (uint8_t k = 0; k < LOG_PUMP_MAX_RECORDS; k++) {
+    if (!logSerialDrain()) break;
+    LogRecord r;
+    if (!logPop(r)) { logReportDrops(); break; }
+    logWsQueue(r);
+    if (r.level <= logSerialLevel) logStage(r);
+  }
+  logSerialDrain();
+  logWsFlush();
+}
+
+// Blocking drain for setup() and right before a restart, where waiting is fine
+inline void logFlush() {
+  logReportDrops();
+  for (;;) {
+    while (!logSerialDrain()) delay(1);
+    LogRecord r;
+    if (!logPop(r)) break;
+    logWsQueue(r);
+    if (r.level <= logSerialLevel) logStage(r);
+  }
+  logWsFlush();
+  Serial.flush();
+}
+
+inline void logPrintStatus(Print& out) {
+  uint32_t used = __atomic_load_n(&logHead, __ATOMIC_RELAXED) - logTail;
+  out.printf("[LOG] level: build=%u serial=%u ws=%u%s | ring %u/%u used, drained=%u dropped=%u\n",
+             (unsigned)C4_LOG_LEVEL, (unsigned)logSerialLevel, (unsigned)logWsLevel,
+             LOG_SERIAL_BINARY ? " (serial binary)" : "", (unsigned)used, (unsigned)LOG_RING_SLOTS,
+             (unsigned)logRecords, (unsigned)logDropped);
+}
@@ -0,0 +1,236 @@
+// LogCodec.h
+// VERSION: 1.0.0
+// Binary log records: the call site stores the format-string pointer and raw argument
+// bytes; formatting happens later (Log.h drain, or tools/log_decode.cpp on a PC).
+// Pure C++11, shared by the firmware and the host decoder.
+//
+// Wire frame (little-endian), one per record:
+//   0  0xC4         magic
+//   1  0x1D         frame type (log record v1)
+//   2  len          payload bytes
+//   3  level        LOG_LEVEL_*
+//   4  types        2 bits per argument (LOG_ARG_*), argument 0 in bits 0..1
+//   6  nargs
+//   7  check        XOR of the payload bytes (resync aid)
+//   8  ms           uint32 millis() at the call site
+//  12  fmt          uint32 address of the format string in the firmware image
+//  16  payload      arguments: I32/F32 = 4 bytes, I64 = 8, STR = length byte + bytes
+
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <type_traits>
+
+enum LogLevel : uint8_t {
+  LOG_LEVEL_NONE = 0, LOG_LEVEL_ERROR = 1, LOG_LEVEL_WARN = 2, LOG_LEVEL_INFO = 3, LOG_LEVEL_DEBUG = 4
+};
+
+enum LogArgType : uint8_t { LOG_ARG_I32 = 0, LOG_ARG_I64 = 1, LOG_ARG_F32 = 2, LOG_ARG_STR = 3 };
+
+static const uint8_t  LOG_FRAME_MAGIC  = 0xC4;
+static const uint8_t  LOG_FRAME_RECORD = 0x1D;
+static const size_t   LOG_FRAME_HEAD   = 16;
+static const uint8_t  LOG_MAX_ARGS     = 8;
+static const size_t   LOG_MAX_PAYLOAD  = 78;   // ring slot = 96 bytes
+static const uint8_t  LOG_STR_MAX      = 31;   // longer %s arguments are cut
+
+inline char logLevelChar(uint8_t l) {
+  switch (l) {
+    case LOG_LEVEL_ERROR: return 'E';
+    case LOG_LEVEL_WARN:  return 'W';
+    case LOG_LEVEL_INFO:  return 'I';
+    default:              return 'D';
+  }
+}
+
+struct LogRecord {
+  uint32_t    ms;
+  const char* fmt;
+  uint8_t     level;
+  uint8_t     nargs;
+  uint16_t    types;
+  uint8_t     len;
+  uint8_t     payload[LOG_MAX_PAYLOAD];
+};
+
+// --- ENCODING (call site) ---
+struct LogEnc {
+  LogRecord& r;
+  bool       full;         // an argument did not fit: later ones are dropped too (print as "?")
+  explicit LogEnc(LogRecord& rec) : r(rec), full(false) {}
+
+  bool room(size_t n, uint8_t type) {
+    if (full || r.nargs >= LOG_MAX_ARGS || r.len + n > LOG_MAX_PAYLOAD) { full = true; return false; }
+    r.types |= (uint16_t)(type << (2 * r.nargs));
+    r.nargs++;
+    return true;
+  }
+  void put(const void* p, size_t n) { memcpy(r.payload + r.len, p, n); r.len += (uint8_t)n; }
+
+  void i32(uint32_t v) { if (room(4, LOG_ARG_I32)) put(&v, 4); }
+  void i64(uint64_t v) { if (room(8, LOG_ARG_I64)) put(&v, 8); }
+  void f32(float v)    { if (room(4, LOG_ARG_F32)) put(&v, 4); }
+  void str(const char* s) {
+    if (!s) s = "(null)";
+    size_t n = strlen(s);
+    if (n > LOG_STR_MAX) n = LOG_STR_MAX;
+    size_t left = LOG_MAX_PAYLOAD - r.len;
+    if (left >= 2 && n > left - 1) n = left - 1;   // cut to what is left
+    if (!room(1 + n, LOG_ARG_STR)) return;
+    uint8_t k = (uint8_t)n;
+    put(&k, 1);
+    put(s, n);
+  }
+};
+
+inline void logArg(LogEnc& e, bool v)               { e.i32(v ? 1 : 0); }
+inline void logArg(LogEnc& e, char v)               { e.i32((uint32_t)(int32_t)v); }
+inline void logArg(LogEnc& e, signed char v)        { e.i32((uint32_t)(int32_t)v); }
+inline void logArg(LogEnc& e, unsigned char v)      { e.i32(v); }
+inline void logArg(LogEnc& e, short v)              { e.i32((uint32_t)(int32_t)v); }
+inline void logArg(LogEnc& e, unsigned short v)     { e.i32(v); }
+inline void logArg(LogEnc& e, int v)                { e.i32((uint32_t)v); }
+inline void logArg(LogEnc& e, unsigned v)           { e.i32(v); }
+inline void logArg(LogEnc& e, long v)               { if (sizeof(long) > 4) e.i64((uint64_t)v); else e.i32((uint32_t)v); }
+inline void logArg(LogEnc& e, unsigned long v)      { if (sizeof(long) > 4) e.i64(v); else e.i32((uint32_t)v); }
+inline void logArg(LogEnc& e, long long v)          { e.i64((uint64_t)v); }
+inline void logArg(LogEnc& e, unsigned long long v) { e.i64(v); }
+inline void logArg(LogEnc& e, float v)              { e.f32(v); }
+inline void logArg(LogEnc& e, double v)             { e.f32((float)v); }
+inline void logArg(LogEnc& e, const char* s)        { e.str(s); }
+inline void logArg(LogEnc& e, const void* p)        { e.i32((uint32_t)(uintptr_t)p); }
+template <typename T>
+inline typename std::enable_if<std::is_enum<T>::value>::type logArg(LogEnc& e, T v) { e.i32((uint32_t)v); }
+
+inline void logArgs(LogEnc&) {}
+template <typename T, typename... Rest>
+inline void logArgs(LogEnc& e, const T& a, const Rest&... rest) { logArg(e, a); logArgs(e, rest...); }
+
+template <typename... Args>
+inline void logEncode(LogRecord& r, uint8_t level, uint32_t ms, const char* fmt, const Args&... args) {
+  r.ms = ms; r.fmt = fmt; r.level = level; r.nargs = 0; r.types = 0; r.len = 0;
+  LogEnc e(r);
+  logArgs(e, args...);
+}
+
+// --- FORMATTING (drain / host) ---
+// printf over the stored arguments. Length modifiers in the format are ignored: the stored
+// type decides how a value is passed, so "%lu" on a 32-bit target and %llu both work.
+// Returns the length written (out is always NUL-terminated).
+inline size_t logFormat(const LogRecord& r, char* out, size_t cap) {
+  if (!cap) return 0;
+  size_t o = 0, at = 0;
+  uint8_t argi = 0;
+  const char* f = r.fmt ? r.fmt : "(no format)";
+  auto emit = [&](const char* s, size_t n) {
+    if (o + 1 >= cap) return;
+    if (n > cap - 1 - o) n = cap - 1 - o;
+    memcpy(out + o, s, n);
+    o += n;
+  };
+  while (*f) {
+    const char* pct = strchr(f, '%');
+    if (!pct) { emit(f, strlen(f)); break; }
+    emit(f, (size_t)(pct - f));
+    f = pct + 1;
+    if (*f == '%') { emit("%", 1); f++; continue; }
+
+    char spec[16];
+    size_t sl = 0;
+    spec[sl++] = '%';
+    while (*f && strchr("-+ #0123456789.", *f)) { if (sl < sizeof(spec) - 4) spec[sl++] = *f; f++; }
+    while (*f && strchr("hlLqjzt", *f)) f++;
+    char conv = *f ? *f++ : 's';
+
+    char tmp[48];
+    int n = -1;
+    uint8_t type = LOG_ARG_I32;
+    bool have = argi < r.nargs && at < r.len;
+    if (have) type = (uint8_t)((r.types >> (2 * argi)) & 3);
+    argi++;
+    if (!have) { emit("?", 1); continue; }
+
+    if (type == LOG_ARG_STR) {
+      uint8_t k = r.payload[at];
+      char s[LOG_STR_MAX + 1];
+      if (at + 1 + k > r.len) k = 0;
+      memcpy(s, r.payload + at + 1, k);
+      s[k] = '\0';
+      at += 1 + (size_t)r.payload[at];
+      if (conv == 's') { spec[sl++] = 's'; spec[sl] = '\0'; n = snprintf(tmp, sizeof(tmp), spec, s); }
+      else             n = snprintf(tmp, sizeof(tmp), "?");
+    } else if (type == LOG_ARG_F32) {
+      float v;
+      memcpy(&v, r.payload + at, 4);
+      at += 4;
+      if (!strchr("fFeEgGaA", conv)) conv = 'g';
+      spec[sl++] = conv; spec[sl] = '\0';
+      n = snprintf(tmp, sizeof(tmp), spec, (double)v);
+    } else if (type == LOG_ARG_I64) {
+      uint64_t v;
+      memcpy(&v, r.payload + at, 8);
+      at += 8;
+      if (!strchr("diouxXc", conv)) conv = 'd';
+      if (conv == 'c') conv = 'd';
+      spec[sl++] = 'l'; spec[sl++] = 'l'; spec[sl++] = conv; spec[sl] = '\0';
+      if (conv == 'd' || conv == 'i') n = snprintf(tmp, sizeof(tmp), spec, (long long)v);
+      else                            n = snprintf(tmp, sizeof(tmp), spec, (unsigned long long)v);
+    } else {
+      uint32_t v;
+      memcpy(&v, r.payload + at, 4);
+      at += 4;
+      if (conv == 'p') { n = snprintf(tmp, sizeof(tmp), "0x%08lx", (unsigned long)v); }
+      else {
+        if (!strchr("diouxXc", conv)) conv = (conv == 's') ? 'u' : 'd';   // mismatched %s prints the number
+        spec[sl++] = conv; spec[sl] = '\0';
+        if (conv == 'd' || conv == 'i' || conv == 'c') n = snprintf(tmp, sizeof(tmp), spec, (int)(int32_t)v);
+        else                                           n = snprintf(tmp, sizeof(tmp), spec, (unsigned)v);
+      }
+    }
+    if (n > 0) emit(tmp, (size_t)n < sizeof(tmp) ? (size_t)n : sizeof(tmp) - 1);
+  }
+  out[o] = '\0';
+  return o;
+}
+
+// --- FRAMING ---
+inline size_t logFrameSize(const LogRecord& r) { return LOG_FRAME_HEAD + r.len; }
+
+// Returns bytes written, 0 if it does not fit
+inline size_t logFrameWrite(const LogRecord& r, uint8_t* out, size_t cap) {
+  size_t n = logFrameSize(r);
+  if (n > cap) return 0;
+  uint8_t check = 0;
+  for (uint8_t i = 0; i < r.len; i++) check ^= r.payload[i];
+  uint32_t fmt = (uint32_t)(uintptr_t)r.fmt;
+  out[0] = LOG_FRAME_MAGIC; out[1] = LOG_FRAME_RECORD; out[2] = r.len; out[3] = r.level;
+  out[4] = (uint8_t)r.types; out[5] = (uint8_t)(r.types >> 8); out[6] = r.nargs; out[7] = check;
+  for (int i = 0; i < 4; i++) { out[8 + i] = (uint8_t)(r.ms >> (8 * i)); out[12 + i] = (uint8_t)(fmt >> (8 * i)); }
+  memcpy(out + LOG_FRAME_HEAD, r.payload, r.len);
+  return n;
+}
+
+// Parses one frame at 'in'. Returns bytes consumed (>0), 0 if more input is needed, or -1 if
+// 'in' does not start a valid frame (caller skips a byte and retries). The format address is
+// returned in fmtAddr; r.fmt is left null for the caller to resolve.
+inline int logFrameRead(const uint8_t* in, size_t avail, LogRecord& r, uint32_t& fmtAddr) {
+  if (avail < 1) return 0;
+  if (in[0] != LOG_FRAME_MAGIC) return -1;
+  if (avail < 2) return 0;
+  if (in[1] != LOG_FRAME_RECORD) return -1;
+  if (avail < LOG_FRAME_HEAD) return 0;
+  uint8_t len = in[2];
+  if (len > LOG_MAX_PAYLOAD || in[6] > LOG_MAX_ARGS || in[3] > LOG_LEVEL_DEBUG) return -1;
+  if (avail < LOG_FRAME_HEAD + len) return 0;
+  uint8_t check = 0;
+  for (uint8_t i = 0; i < len; i++) check ^= in[LOG_FRAME_HEAD + i];
+  if (check != in[7]) return -1;
+  r.len = len; r.level = in[3]; r.types = (uint16_t)(in[4] | (in[5] << 8)); r.nargs = in[6];
+  r.ms = 0; fmtAddr = 0;
+  for (int i = 0; i < 4; i++) { r.ms |= (uint32_t)in[8 + i] << (8 * i); fmtAddr |= (uint32_t)in[12 + i] << (8 * i); }
+  r.fmt = nullptr;
+  memcpy(r.payload, in + LOG_FRAME_HEAD, len);
+  return (int)(LOG_FRAME_HEAD + len);
+}
@@ -0,0 +1,237 @@
+// LoopMonitor.h
+// VERSION: 1.0.1
+// Loop latency histogram + stall detector with subsystem tagging.
+// Always on (micros() only). Survives soft resets in RTC memory.
+
+#pragma once
+#include <Arduino.h>
+#include <esp_system.h>
+
+#ifndef LOOP_STALL_THRESHOLD_MS
+  #define LOOP_STALL_THRESHOLD_MS 50   // iterations longer than this are logged as stalls
+#endif
+
+// --- SUBSYSTEM TAGS ---
+// Order must match STALL_TAG_NAMES below.
+enum StallTag : uint8_t {
+  STALL_TAG_OTHER,          // untagged time in loop()
+  STALL_TAG_KEYPAD,
+  STALL_TAG_DFPLAYER,
+  STALL_TAG_DFPLAYER_RESET, // dfplayerSoftReset() (1.2 s delay)
+  STALL_TAG_GAMEPLAY,
+  STALL_TAG_ARMING_DELAY,   // delay() inside processArmingCode / handleKeypadInput
+  STALL_TAG_CONFIG,
+  STALL_TAG_DISPLAY,
+  STALL_TAG_LEDS,
+  STALL_TAG_NETWORK,
+  STALL_TAG_WS_BEGIN,       // wsClient.begin()
+  STALL_TAG_WS_LOOP,        // wsClient.loop() (TCP connect happens in here)
+  STALL_TAG_COUNT
+};
+
+static const char* const STALL_TAG_NAMES[STALL_TAG_COUNT] = {
+  "other", "keypad", "dfplayer", "dfplayer_reset", "gameplay", "arming_delay",
+  "config", "display", "leds", "network", "ws_begin", "ws_loop"
+};
+
+// Log2 bins in microseconds: bin k = [2^k, 2^(k+1)) us, bin 0 also holds <1us.
+static const uint8_t LM_BINS = 24;
+static const uint8_t LM_RECENT_STALLS = 8;
+static const uint32_t LM_RTC_MAGIC = 0xC4100702;
+
+struct StallRecord {
+  uint32_t uptimeMs;
+  uint32_t durationUs;
+  uint8_t  tag;
+  uint8_t  state;
+};
+
+struct LoopMonData {
+  uint32_t magic;
+  uint32_t iterations;
+  uint32_t stalls;
+  uint32_t maxUs;
+  uint8_t  maxTag;
+  uint8_t  openTag;          // tag of the innermost scope open right now (for WDT/panic resets)
+  uint8_t  recentHead;
+  uint8_t  _pad;
+  uint32_t hist[LM_BINS];
+  StallRecord recent[LM_RECENT_STALLS];
+};
+
+// RTC slow memory is not cleared on soft reset / WDT / panic.
+static RTC_NOINIT_ATTR LoopMonData lmRtc;
+static LoopMonData lmPrev;            // copy of the previous boot (valid if lmPrevValid)
+static bool lmPrevValid = false;
+static esp_reset_reason_t lmResetReason = ESP_RST_UNKNOWN;
+
+// Per-iteration attribution (exclusive time per tag, nested scopes supported)
+static const uint8_t LM_MAX_DEPTH = 4;
+static uint32_t lmChildUs[LM_MAX_DEPTH + 1];
+static uint8_t  lmDepth = 0;
+static uint32_t lmIterStartUs = 0;
+static uint32_t lmIterTopUs = 0;
+static uint8_t  lmIterTopTag = STALL_TAG_OTHER;
+
+static const char* (*lmStateName)(uint8_t) = nullptr;
+
+inline uint8_t lmBinFor(uint32_t us) {
+  uint8_t b = us ? (uint8_t)(31 - __builtin_clz(us)) : 0;
+  return (b < LM_BINS) ? b : (LM_BINS - 1);
+}
+
+inline const char* lmResetReasonName(esp_reset_reason_t r) {
+  switch (r) {
+    case ESP_RST_POWERON:  return "poweron";
+    case ESP_RST_EXT:      return "ext";
+    case ESP_RST_SW:       return "sw";
+    case ESP_RST_PANIC:    return "panic";
+    case ESP_RST_INT_WDT:  return "int_wdt";
+    case ESP_RST_TASK_WDT: return "task_wdt";
+    case ESP_RST_WDT:      return "wdt";
+    case ESP_RST_BROWNOUT: return "brownout";
+    default:               return "unknown";
+  }
+}
+
+// --- TAGGED SCOPE ---
+class StallTagScope {
+ public:
+  explicit StallTagScope(StallTag t) : tag_(t), prevOpen_(lmRtc.openTag), pushed_(lmDepth < LM_MAX_DEPTH), start_(micros()) {
+    if (pushed_) lmChildUs[++lmDepth] = 0;
+    lmRtc.openTag = t;
+  }
+  ~StallTagScope() {
+    uint32_t total = micros() - start_;
+    uint32_t self = total;
+    if (pushed_) {
+      self = (total > lmChildUs[lmDepth]) ? total - lmChildUs[lmDepth] : 0;
+      lmDepth--;
+    }
+    lmChildUs[lmDepth] += total;
+    if (self > lmIterTopUs) { lmIterTopUs = self; lmIterTopTag = tag_; }
+    lmRtc.openTag = prevOpen_;
+  }
+ private:
+  uint8_t  tag_;
+  uint8_t  prevOpen_;
+  bool     pushed_;
+  uint32_t start_;
+};
+
+#define STALL_CAT2(a, b) a##b
+#define STALL_CAT(a, b)  STALL_CAT2(a, b)
+#define STALL_TAG_SCOPE(t) StallTagScope STALL_CAT(_stallScope, __LINE__)(t)
+
+inline void taggedDelay(uint32_t ms, StallTag tag) {
+  STALL_TAG_SCOPE(tag);
+  delay(ms);
+}
+
+// --- LIFECYCLE ---
+// Call once early in setup(). Moves the previous boot's data aside and starts fresh.
+inline void loopMonBegin(const char* (*stateName)(uint8_t)) {
+  lmStateName = stateName;
+  lmResetReason = esp_reset_reason();
+
+  bool rtcValid = (lmRtc.magic == LM_RTC_MAGIC) && (lmResetReason != ESP_RST_POWERON);
+  if (rtcValid) {
+    lmPrev = lmRtc;
+    lmPrevValid = true;
+  }
+  memset(&lmRtc, 0, sizeof(lmRtc));
+  lmRtc.magic = LM_RTC_MAGIC;
+  lmRtc.openTag = STALL_TAG_OTHER;
+  lmIterStartUs = 0;
+}
+
+// Call at the very top of loop(). Closes out the previous iteration.
+inline void loopMonTick(uint8_t state) {
+  uint32_t now = micros();
+  if (lmIterStartUs != 0) {
+    uint32_t dur = now - lmIterStartUs;
+    uint32_t untagged = (dur > lmChildUs[0]) ? dur - lmChildUs[0] : 0;
+    uint8_t tag = (untagged > lmIterTopUs) ? (uint8_t)STALL_TAG_OTHER : lmIterTopTag;
+
+    lmRtc.iterations++;
+    lmRtc.hist[lmBinFor(dur)]++;
+    if (dur > lmRtc.maxUs) { lmRtc.maxUs = dur; lmRtc.maxTag = tag; }
+
+    if (dur >= LOOP_STALL_THRESHOLD_MS * 1000UL) {
+      StallRecord& r = lmRtc.recent[lmRtc.recentHead];
+      r.uptimeMs   = millis();
+      r.durationUs = dur;
+      r.tag        = tag;
+      r.state      = state;
+      lmRtc.recentHead = (lmRtc.recentHead + 1) % LM_RECENT_STALLS;
+      lmRtc.stalls++;
+    }
+  }
+  lmIterStartUs = now;
+  lmChildUs[0] = 0;
+  lmDepth = 0;
+  lmIterTopUs = 0;
+  lmIterTopTag = STALL_TAG_OTHER;
+}
+
+// --- REPORTING ---
+inline const char* lmTagName(uint8_t t) { return (t < STALL_TAG_COUNT) ? STALL_TAG_NAMES[t] : "?"; }
+inline const char* lmStateStr(uint8_t s) { return lmStateName ? lmStateName(s) : "?"; }
+
+inline void loopMonPrintReport(Print& out, const LoopMonData& d, const char* label) {
+  out.printf("[LOOP] %s: iters=%u stalls=%u max=%uus (%s) open=%s\n", label,
+             (unsigned)d.iterations, (unsigned)d.stalls, (unsigned)d.maxUs,
+             lmTagName(d.maxTag), lmTagName(d.openTag));
+  out.print("[LOOP] hist(log2 us):");
+  for (uint8_t b = 0; b < LM_BINS; b++) {
+    if (d.hist[b]) out.printf(" %u:%u", (unsigned)(1UL << b), (unsigned)d.hist[b]);
+  }
+  out.println();
+  for (uint8_t i = 0; i < LM_RECENT_STALLS; i++) {
+    const StallRecord& r = d.recent[(d.recentHead + i) % LM_RECENT_STALLS];
+    if (r.durationUs == 0) continue;
+    out.printf("[LOOP]   t=%ums %uus tag=%s state=%s\n", (unsigned)r.uptimeMs,
+               (unsigned)r.durationUs, lmTagName(r.tag), lmStateStr(r.state));
+  }
+}
+
+inline void loopMonPrintBootReport(Print& out) {
+  out.printf("[LOOP] Reset reason: %s\n", lmResetReasonName(lmResetReason));
+  if (lmPrevValid) loopMonPrintReport(out, lmPrev, "previous boot");
+  else             out.println("[LOOP] No stall data from previous boot.");
+}
+
+inline void lmAppendJson(String& j, const LoopMonData& d) {
+  char buf[160];
+  snprintf(buf, sizeof(buf), "{\"iters\":%u,\"stalls\":%u,\"max_us\":%u,\"max_tag\":\"%s\",\"open_tag\":\"%s\",\"hist\":[",
+           (unsigned)d.iterations, (unsigned)d.stalls, (unsigned)d.maxUs, lmTagName(d.maxTag), lmTagName(d.openTag));
+  j += buf;
+  for (uint8_t b = 0; b < LM_BINS; b++) {
+    if (b) j += ',';
+    j += String((unsigned long)d.hist[b]);
+  }
+  j += F("],\"recent\":[");
+  bool first = true;
+  for (uint8_t i = 0; i < LM_RECENT_STALLS; i++) {
+    const StallRecord& r = d.recent[(d.recentHead + i) % LM_RECENT_STALLS];
+    if (r.durationUs == 0) continue;
+    snprintf(buf, sizeof(buf), "%s{\"t\":%u,\"us\":%u,\"tag\":\"%s\",\"state\":\"%s\"}",
+             first ? "" : ",", (unsigned)r.uptimeMs, (unsigned)r.durationUs, lmTagName(r.tag), lmStateStr(r.state));
+    j += buf;
+    first = false;
+  }
+  j += "]}";
+}
+
+inline String loopMonToJson() {
+  String j = F("{\"type\":\"loop_report\",\"reset_reason\":\"");
+  j += lmResetReasonName(lmResetReason);
+  j += F("\",\"current\":");
+  lmAppendJson(j, lmRtc);
+  if (lmPrevValid) {
+    j += F(",\"previous\":");
+    lmAppendJson(j, lmPrev);
+  }
+  j += '}';
+  return j;
+}
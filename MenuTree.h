@@ -0,0 +1,354 @@
+// MenuTree.h
+// VERSION: 1.0.0
+// Table-driven LCD menu engine for the config menu (ConfigMenu.h holds the tree). Pure C++11
+// (no Arduino) so tools/menu_sim.cpp drives the same code on the host.
+//
+// The tree is one flat const table of rows. Each row names the menu it is listed in, its kind
+// and, for settings, a JsonField descriptor (HttpLite.h: offset/type/range into Settings), so a
+// new setting is one row. menuKey() moves a small cursor through the tree. menuRender() fills
+// a 4x20 text frame; the display only writes the characters that differ from the last frame.
+//
+// Keys, on every list: 2 = up, 8 = down, # = open / toggle / edit / run, * = back.
+// In an edit: digits type, * deletes (or backs out when empty), # stores if in range.
+
+#pragma once
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "HttpLite.h"
+
+static constexpr uint8_t MENU_COLS      = 20;
+static constexpr uint8_t MENU_ROWS      = 4;
+static constexpr uint8_t MENU_LIST_ROWS = MENU_ROWS - 1;   // row 0 is the title
+static constexpr uint8_t MENU_INPUT_MAX = 16;
+static constexpr uint8_t MENU_NONE      = 0xFF;
+
+typedef char MenuLines[MENU_ROWS][MENU_COLS + 1];
+typedef void (*MenuFn)();
+
+enum MenuKind : uint8_t {
+  MN_MENU,     // opens another list
+  MN_TOGGLE,   // JF_BOOL/JF_U8 0/1, flipped in place
+  MN_NUMBER,   // JF_U8/U16/U32 typed in, range-checked
+  MN_DIGITS,   // JF_STR + JF_DIGITS typed in
+  MN_IP,       // JF_IP typed as four octets, # between them
+  MN_ACTION,   // runs fn
+  MN_SCREEN    // hands the keys and the frame to a MenuScreen
+};
+
+enum MenuFlags : uint8_t {
+  MF_CONFIRM = 1 << 0    // MN_ACTION: "#=Yes *=No" first
+};
+
+// What the caller should sound after a key
+enum MenuSound : uint8_t { MS_NONE, MS_CLICK, MS_OK, MS_ERR };
+
+// Custom screen (tag list, WiFi portal). Any hook may be nullptr.
+struct MenuScreen {
+  void      (*enter)();
+  MenuSound (*key)(char key, bool& done);   // done = back to the list
+  void      (*render)(MenuLines out);
+  bool      (*poll)();                      // every loop while open; true = redraw
+  void      (*leave)();
+};
+
+struct MenuNode {
+  uint8_t     parent;     // menu this row is listed in
+  uint8_t     kind;       // MenuKind
+  const char* label;      // list text, and the title of what it opens
+  uint8_t     opens;      // MN_MENU: menu id
+  uint8_t     flags;      // MenuFlags
+  JsonField   field;      // settings rows (key = nullptr)
+  const char* offText;    // MN_TOGGLE value text, nullptr = OFF/ON
+  const char* onText;
+  MenuFn      fn;         // MN_ACTION: run; settings rows: after a store
+  const MenuScreen* screen;
+};
+
+struct MenuTree {
+  const MenuNode* nodes;
+  uint8_t count;
+};
+
+enum MenuView : uint8_t { MV_LIST, MV_EDIT, MV_CONFIRM, MV_SCREEN };
+
+struct MenuCursor {
+  uint8_t menu;           // list being shown (0 = root)
+  uint8_t pos;            // selected line in it
+  uint8_t top;            // first visible line
+  uint8_t view;           // MenuView
+  uint8_t row;            // MENU_NODES index of the selection once opened
+  char input[MENU_INPUT_MAX];
+  const char* notice[2];  // two-line message over everything until the next key
+};
+
+// --- TREE ---
+inline uint8_t menuCount(const MenuTree& t, uint8_t menu) {
+  uint8_t n = 0;
+  for (uint8_t i = 0; i < t.count; i++) if (t.nodes[i].parent == menu) n++;
+  return n;
+}
+
+inline uint8_t menuAt(const MenuTree& t, uint8_t menu, uint8_t pos) {
+  for (uint8_t i = 0; i < t.count; i++) if (t.nodes[i].parent == menu && pos-- == 0) return i;
+  return MENU_NONE;
+}
+
+inline uint8_t menuOpener(const MenuTree& t, uint8_t menu) {
+  for (uint8_t i = 0; i < t.count; i++) if (t.nodes[i].kind == MN_MENU && t.nodes[i].opens == menu) return i;
+  return MENU_NONE;
+}
+
+// --- FIELD ACCESS ---
+inline uint32_t menuRead(const JsonField& f, const void* base) {
+  const uint8_t* p = (const uint8_t*)base + f.offset;
+  switch (f.type) {
+    case JF_U8: case JF_BOOL: return *p;
+    case JF_U16: { uint16_t v; memcpy(&v, p, 2); return v; }
+    case JF_U32: case JF_IP: { uint32_t v; memcpy(&v, p, 4); return v; }
+  }
+  return 0;
+}
+
+inline void menuWrite(const JsonField& f, void* base, uint32_t v) {
+  uint8_t* p = (uint8_t*)base + f.offset;
+  switch (f.type) {
+    case JF_U8: case JF_BOOL: *p = (uint8_t)v; break;
+    case JF_U16: { uint16_t x = (uint16_t)v; memcpy(p, &x, 2); } break;
+    case JF_U32: case JF_IP: memcpy(p, &v, 4); break;
+  }
+}
+
+inline void menuFormatIp(uint32_t v, char* out, size_t n) {
+  snprintf(out, n, "%u.%u.%u.%u", (unsigned)(v >> 24), (unsigned)((v >> 16) & 0xFF),
+           (unsigned)((v >> 8) & 0xFF), (unsigned)(v & 0xFF));
+}
+
+// Current value as list text ("" for rows without one)
+inline void menuFormatValue(const MenuNode& r, const void* base, char* out, size_t n) {
+  out[0] = '\0';
+  switch (r.kind) {
+    case MN_TOGGLE: {
+      bool on = menuRead(r.field, base) != 0;
+      snprintf(out, n, "%s", on ? (r.onText ? r.onText : "ON") : (r.offText ? r.offText : "OFF"));
+    } break;
+    case MN_NUMBER: snprintf(out, n, "%lu", (unsigned long)menuRead(r.field, base)); break;
+    case MN_DIGITS: {
+      const char* s = (const char*)base + r.field.offset;
+      snprintf(out, n, "%.*s", (int)strnlen(s, r.field.size), s);
+    } break;
+    case MN_IP: menuFormatIp(menuRead(r.field, base), out, n); break;
+  }
+}
+
+// Longest input an edit row accepts
+inline uint8_t menuInputMax(const MenuNode& r) {
+  if (r.kind == MN_IP) return 15;
+  if (r.kind == MN_DIGITS) return (uint8_t)r.field.max;
+  uint8_t d = 1;
+  for (uint32_t v = r.field.max; v >= 10; v /= 10) d++;
+  return d;
+}
+
+// --- FRAME ---
+inline void menuLine(char* line, const char* text, bool center) {
+  memset(line, ' ', MENU_COLS);
+  line[MENU_COLS] = '\0';
+  size_t n = strlen(text);
+  if (n > MENU_COLS) n = MENU_COLS;
+  memcpy(line + (center ? (MENU_COLS - n) / 2 : 0), text, n);
+}
+
+// "> Label      value"; the value is dropped when it does not fit (shown in the edit screen)
+inline void menuListLine(char* line, const char* label, const char* value, bool selected) {
+  menuLine(line, "", false);
+  line[0] = selected ? '>' : ' ';
+  size_t l = strlen(label), v = strlen(value);
+  if (l > MENU_COLS - 2) l = MENU_COLS - 2;
+  memcpy(line + 2, label, l);
+  if (v && 2 + l + 1 + v <= MENU_COLS) memcpy(line + MENU_COLS - v, value, v);
+}
+
+inline void menuRender(const MenuTree& t, const MenuCursor& c, const void* base, const char* rootTitle, MenuLines out) {
+  char buf[MENU_COLS + 1], val[MENU_COLS + 1];
+  for (uint8_t r = 0; r < MENU_ROWS; r++) menuLine(out[r], "", false);
+
+  if (c.notice[0]) {
+    menuLine(out[1], c.notice[0], true);
+    if (c.notice[1]) menuLine(out[2], c.notice[1], true);
+    return;
+  }
+  if (c.view == MV_SCREEN) {
+    const MenuScreen* s = t.nodes[c.row].screen;
+    if (s && s->render) s->render(out);
+    return;
+  }
+  if (c.view != MV_LIST) {
+    const MenuNode& r = t.nodes[c.row];
+    if (c.view == MV_CONFIRM) {
+      snprintf(buf, sizeof(buf), "%s?", r.label);
+      menuLine(out[0], buf, true);
+      menuLine(out[2], "#=Yes  *=No", true);
+      return;
+    }
+    menuLine(out[0], r.label, true);
+    menuFormatValue(r, base, val, sizeof(val));
+    snprintf(buf, sizeof(buf), "Now: %s", val);
+    menuLine(out[1], buf, true);
+    char entry[MENU_INPUT_MAX + 8];                 // a full IP is 21 wide with the cursor; drop the "_"
+    snprintf(entry, sizeof(entry), "New: %s_", c.input);
+    menuLine(out[2], entry, true);
+    if (r.kind == MN_IP) snprintf(buf, sizeof(buf), "#=Dot/OK  *=Back");
+    else if (r.kind == MN_DIGITS && r.field.min == r.field.max) snprintf(buf, sizeof(buf), "%u digits #=OK *=Bk", (unsigned)r.field.max);
+    else if (r.kind == MN_DIGITS) snprintf(buf, sizeof(buf), "Max %u  #=OK *=Back", (unsigned)r.field.max);
+    else if (snprintf(buf, sizeof(buf), "%lu-%lu #=OK *=Bk", (unsigned long)r.field.min, (unsigned long)r.field.max) > MENU_COLS)
+      snprintf(buf, sizeof(buf), "#=OK  *=Back");
+    menuLine(out[3], buf, true);
+    return;
+  }
+
+  uint8_t opener = menuOpener(t, c.menu);
+  menuLine(out[0], opener == MENU_NONE ? rootTitle : t.nodes[opener].label, true);
+  uint8_t n = menuCount(t, c.menu);
+  for (uint8_t i = 0; i < MENU_LIST_ROWS && c.top + i < n; i++) {
+    const MenuNode& r = t.nodes[menuAt(t, c.menu, c.top + i)];
+    menuFormatValue(r, base, val, sizeof(val));
+    menuListLine(out[1 + i], r.label, val, c.top + i == c.pos);
+  }
+}
+
+// --- NAVIGATION ---
+inline void menuReset(MenuCursor& c) {
+  memset(&c, 0, sizeof(c));
+}
+
+inline void menuNotice(MenuCursor& c, const char* line1, const char* line2) {
+  c.notice[0] = line1;
+  c.notice[1] = line2;
+}
+
+inline void menuSelect(MenuCursor& c, uint8_t pos) {
+  c.pos = pos;
+  if (c.pos < c.top) c.top = c.pos;
+  if (c.pos >= c.top + MENU_LIST_ROWS) c.top = c.pos - (MENU_LIST_ROWS - 1);
+}
+
+inline MenuSound menuEditKey(const MenuTree& t, MenuCursor& c, void* base, char key) {
+  const MenuNode& r = t.nodes[c.row];
+  size_t len = strlen(c.input);
+  if (key >= '0' && key <= '9') {
+    if (r.kind == MN_IP) {                      // no '.' on the keypad: octets end with '#'
+      const char* dot = strrchr(c.input, '.');
+      const char* octet = dot ? dot + 1 : c.input;
+      if (strlen(octet) >= 3 || atoi(octet) * 10 + (key - '0') > 255) return MS_ERR;
+    } else if (len >= menuInputMax(r)) {
+      return MS_ERR;
+    }
+    c.input[len] = key;
+    c.input[len + 1] = '\0';
+    return MS_CLICK;
+  }
+  if (key == '*') {
+    if (len) c.input[len - 1] = '\0';
+    else c.view = MV_LIST;
+    return MS_CLICK;
+  }
+  if (key != '#') return MS_NONE;
+  if (!len || c.input[len - 1] == '.') return MS_ERR;
+
+  if (r.kind == MN_IP) {
+    uint32_t ip;
+    if (!jsonParseIp(c.input, len, ip)) {
+      if (len + 1 >= MENU_INPUT_MAX) return MS_ERR;
+      c.input[len] = '.';
+      c.input[len + 1] = '\0';
+      return MS_CLICK;
+    }
+    menuWrite(r.field, base, ip);
+  } else if (r.kind == MN_DIGITS) {
+    if (len < r.field.min) return MS_ERR;
+    memset((uint8_t*)base + r.field.offset, 0, r.field.size);
+    memcpy((uint8_t*)base + r.field.offset, c.input, len);
+  } else {
+    unsigned long v = strtoul(c.input, nullptr, 10);
+    if (v < r.field.min || v > r.field.max) { c.input[0] = '\0'; return MS_ERR; }
+    menuWrite(r.field, base, (uint32_t)v);
+  }
+  if (r.fn) r.fn();
+  c.view = MV_LIST;
+  return MS_OK;
+}
+
+inline MenuSound menuKey(const MenuTree& t, MenuCursor& c, void* base, char key) {
+  if (!key) return MS_NONE;
+  if (c.notice[0]) { menuNotice(c, nullptr, nullptr); return MS_CLICK; }
+
+  switch (c.view) {
+    case MV_EDIT: return menuEditKey(t, c, base, key);
+    case MV_CONFIRM:
+      if (key == '*') { c.view = MV_LIST; return MS_CLICK; }
+      if (key != '#') return MS_NONE;
+      c.view = MV_LIST;
+      if (t.nodes[c.row].fn) t.nodes[c.row].fn();
+      return MS_OK;
+    case MV_SCREEN: {
+      const MenuScreen* s = t.nodes[c.row].screen;
+      bool done = false;
+      MenuSound snd = (s && s->key) ? s->key(key, done) : MS_NONE;
+      if (!s || (!s->key && key == '*')) done = true;
+      if (!done) return snd;
+      if (s && s->leave) s->leave();
+      c.view = MV_LIST;
+      return snd == MS_NONE ? MS_CLICK : snd;
+    }
+  }
+
+  uint8_t n = menuCount(t, c.menu);
+  if (key == '2' || key == '8') {
+    if (!n) return MS_NONE;
+    menuSelect(c, key == '2' ? (c.pos + n - 1) % n : (c.pos + 1) % n);
+    return MS_CLICK;
+  }
+  if (key == '*') {
+    uint8_t opener = menuOpener(t, c.menu);
+    if (opener == MENU_NONE) return MS_NONE;              // root: leave with Exit
+    c.menu = t.nodes[opener].parent;
+    c.top = 0;
+    for (uint8_t p = 0; p < menuCount(t, c.menu); p++) if (menuAt(t, c.menu, p) == opener) menuSelect(c, p);
+    return MS_CLICK;
+  }
+  if (key != '#' || c.pos >= n) return MS_NONE;
+
+  c.row = menuAt(t, c.menu, c.pos);
+  const MenuNode& r = t.nodes[c.row];
+  switch (r.kind) {
+    case MN_MENU:
+      c.menu = r.opens; c.pos = 0; c.top = 0;
+      return MS_CLICK;
+    case MN_TOGGLE:
+      menuWrite(r.field, base, menuRead(r.field, base) ? 0 : 1);
+      if (r.fn) r.fn();
+      return MS_OK;
+    case MN_NUMBER: case MN_DIGITS: case MN_IP:
+      c.input[0] = '\0';
+      c.view = MV_EDIT;
+      return MS_CLICK;
+    case MN_ACTION:
+      if (r.flags & MF_CONFIRM) { c.view = MV_CONFIRM; return MS_CLICK; }
+      if (r.fn) r.fn();
+      return MS_OK;
+    case MN_SCREEN:
+      c.view = MV_SCREEN;
+      if (r.screen && r.screen->enter) r.screen->enter();
+      return MS_CLICK;
+  }
+  return MS_NONE;
+}
+
+// Every loop: lets an open screen watch hardware (card reader, portal). true = redraw.
+inline bool menuPoll(const MenuTree& t, const MenuCursor& c) {
+  if (c.view != MV_SCREEN) return false;
+  const MenuScreen* s = t.nodes[c.row].screen;
+  return s && s->poll && s->poll();
+}
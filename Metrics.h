@@ -0,0 +1,221 @@
+// Metrics.h
+// VERSION: 1.3.0
+// ADDED: c4_rail_mv (Power.h, with a sense pin)
+// ADDED: c4_power_estimated_ma (Power.h)
+// ADDED: OTA update/rollback counters + last OTA throughput
+// ADDED: c4_log_dropped_total
+// Counters + gauges for dashboards. Modules bump counters where they used to only log;
+// metricsWrite() renders everything in Prometheus text format (GET /metrics, "metrics"
+// serial command) or as one flat JSON object ({"type":"metrics",...} over the WebSocket).
+// Output goes through a fixed chunk buffer into a sink: no Strings, no heap.
+
+#pragma once
+#include <Arduino.h>
+#include <WiFi.h>
+#include "LoopMonitor.h"
+#include "WsBatch.h"
+#include "Log.h"
+
+#ifndef METRICS_CHUNK
+  #define METRICS_CHUNK 256          // bytes buffered before the sink is called
+#endif
+#ifndef METRICS_PUSH_MS
+  #define METRICS_PUSH_MS 0          // >0: push {"type":"metrics",...} this often while connected
+#endif
+
+// --- COUNTERS ---
+// Order must match METRIC_INFO below.
+enum MetricId : uint8_t {
+  M_WS_CONNECTS,            // WebSocket reached LIVE
+  M_WS_DISCONNECTS,         // DISCONNECTED events (live or during connect)
+  M_WS_ABORTS,              // attempts given up by the connection FSM (timeout/resolve)
+  M_WS_RX_TEXT,
+  M_WS_RX_OTHER,            // binary / unexpected frames
+  M_WS_MSGS_DROPPED,        // outbound messages discarded: not connected, or batch lost on disconnect
+  M_DFPLAYER_ERRORS,
+  M_DFPLAYER_RESETS,
+  M_RFID_READS,
+  M_RFID_INVALID,           // card not in the tag table
+  M_LED_FRAMES,             // FastLED.show() calls from updateLeds()
+  M_HTTP_REQUESTS,
+  M_HTTP_RATE_LIMITED,
+  M_HTTP_ERRORS,            // responses >= 400
+  M_OTA_ERRORS,
+  M_OTA_UPDATES,            // images written and switched to
+  M_OTA_ROLLBACKS,          // boots that found a failed update rolled back
+  M_COUNT
+};
+
+struct MetricInfo {
+  const char* name;
+  const char* help;
+};
+
+static const MetricInfo METRIC_INFO[M_COUNT] = {
+  { "c4_ws_connects_total",        "WebSocket connections established" },
+  { "c4_ws_disconnects_total",     "WebSocket disconnect events" },
+  { "c4_ws_aborts_total",          "Connection attempts abandoned by the FSM" },
+  { "c4_ws_rx_text_total",         "Text frames received" },
+  { "c4_ws_rx_other_total",        "Binary or unexpected frames received" },
+  { "c4_ws_msgs_dropped_total",    "Outbound messages dropped while disconnected" },
+  { "c4_dfplayer_errors_total",    "DFPlayer error reports" },
+  { "c4_dfplayer_resets_total",    "DFPlayer soft resets" },
+  { "c4_rfid_reads_total",         "RFID cards read in gameplay" },
+  { "c4_rfid_invalid_total",       "RFID cards not in the tag table" },
+  { "c4_led_frames_total",         "LED strip frames pushed" },
+  { "c4_http_requests_total",      "HTTP API requests" },
+  { "c4_http_rate_limited_total",  "HTTP API requests refused by the rate limit" },
+  { "c4_http_errors_total",        "HTTP API responses with status >= 400" },
+  { "c4_ota_errors_total",         "OTA update errors" },
+  { "c4_ota_updates_total",        "OTA updates completed" },
+  { "c4_ota_rollbacks_total",      "OTA updates rolled back" },
+};
+
+static uint32_t metricCounters[M_COUNT];
+
+// Sampled once a second by metricsPoll()
+static uint32_t metricLoopsPerSec = 0;
+static uint32_t metricLoopMarkIters = 0, metricLoopMarkMs = 0;
+static uint32_t metricLastPushMs = 0;
+static uint32_t metricOtaKBps = 0;        // set by Ota.h when an update completes
+static uint32_t metricPowerMa = 0;        // set by Power.h every loop
+static uint32_t metricRailMv = 0;         // set by Power.h; 0 = no BATTERY_SENSE_PIN
+
+inline void metricInc(MetricId id, uint32_t n = 1) { metricCounters[id] += n; }
+inline uint32_t metricGet(MetricId id)              { return metricCounters[id]; }
+
+// --- OUTPUT ---
+typedef void (*MetricsSinkFn)(void* ctx, const char* data, size_t len);
+
+struct MetricsOut {
+  char          buf[METRICS_CHUNK];
+  size_t        n;
+  MetricsSinkFn sink;
+  void*         ctx;
+  bool          json;
+  bool          first;
+  const char*   family;            // labelled family being written
+
+  void begin(bool asJson, MetricsSinkFn fn, void* c) {
+    n = 0; sink = fn; ctx = c; json = asJson; first = true; family = nullptr;
+  }
+  void flush() { if (n && sink) sink(ctx, buf, n); n = 0; }
+  void raw(const char* s, size_t len) {
+    while (len) {
+      size_t k = sizeof(buf) - n;
+      if (k > len) k = len;
+      memcpy(buf + n, s, k);
+      n += k; s += k; len -= k;
+      if (n == sizeof(buf)) flush();
+    }
+  }
+  void raw(const char* s) { raw(s, strlen(s)); }
+  void num(int64_t v) { char t[24]; int k = snprintf(t, sizeof(t), "%lld", (long long)v); raw(t, (size_t)k); }
+
+  void header(const char* name, const char* type, const char* help) {
+    if (json) return;
+    char t[160];
+    int k = snprintf(t, sizeof(t), "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+    raw(t, (size_t)k < sizeof(t) ? (size_t)k : sizeof(t) - 1);
+  }
+  void jsonKey(const char* k) {
+    raw(first ? "" : ",");
+    first = false;
+    raw("\""); raw(k); raw("\":");
+  }
+
+  void metric(const char* name, const char* type, const char* help, int64_t v) {
+    header(name, type, help);
+    if (json) jsonKey(name);
+    else      { raw(name); raw(" "); }
+    num(v);
+    if (!json) raw("\n");
+  }
+  void counter(const char* name, const char* help, int64_t v) { metric(name, "counter", help, v); }
+  void gauge(const char* name, const char* help, int64_t v)   { metric(name, "gauge", help, v); }
+
+  // name{label="value"} v per sample; JSON: "name":{"value":v,...} keyed by label value
+  void familyBegin(const char* name, const char* type, const char* help) {
+    header(name, type, help);
+    family = name;
+    if (json) { jsonKey(name); raw("{"); first = true; }
+  }
+  void sample(const char* label, const char* value, int64_t v) {
+    if (json) { jsonKey(value); }
+    else      { raw(family); raw("{"); raw(label); raw("=\""); raw(value); raw("\"} "); }
+    num(v);
+    if (!json) raw("\n");
+  }
+  void familyEnd() {
+    if (json) { raw("}"); first = false; }
+    family = nullptr;
+  }
+};
+
+// Everything the prop exposes. 'connFails' is indexed by ConnPhase (may be null).
+inline void metricsWrite(MetricsOut& o, const uint32_t* connFails, const char* const* phaseNames, uint8_t phases,
+                         uint32_t lastReconnectMs) {
+  if (o.json) o.raw("{\"type\":\"metrics\",");
+  o.gauge("c4_uptime_seconds", "Seconds since boot", millis() / 1000);
+
+  o.counter("c4_loop_iterations_total", "loop() iterations", lmRtc.iterations);
+  o.gauge("c4_loop_per_second", "loop() iterations in the last second", metricLoopsPerSec);
+  o.gauge("c4_loop_max_us", "Longest loop() iteration this boot", lmRtc.maxUs);
+  o.counter("c4_loop_stalls_total", "Iterations over LOOP_STALL_THRESHOLD_MS", lmRtc.stalls);
+
+  o.counter("c4_ws_frames_total", "WebSocket text frames sent", wbFrames);
+  o.counter("c4_ws_msgs_sent_total", "Messages handed to the WebSocket batcher", wbMsgs);
+  o.counter("c4_ws_bytes_total", "WebSocket payload bytes sent", wbBytes);
+  o.gauge("c4_ws_reconnect_ms", "Duration of the last outage until LIVE", lastReconnectMs);
+  if (connFails) {
+    o.familyBegin("c4_conn_failures_total", "counter", "Failed connection attempts by phase");
+    for (uint8_t p = 0; p < phases; p++) {
+      if (phaseNames[p]) o.sample("phase", phaseNames[p], connFails[p]);
+    }
+    o.familyEnd();
+  }
+
+  for (uint8_t i = 0; i < M_COUNT; i++) o.counter(METRIC_INFO[i].name, METRIC_INFO[i].help, metricCounters[i]);
+
+  o.counter("c4_log_dropped_total", "Log records lost to a full ring", logDropped);
+  o.gauge("c4_ota_last_kbytes_per_second", "Flash write throughput of the last OTA update", metricOtaKBps);
+  o.gauge("c4_power_estimated_ma", "Estimated supply current from what each load is doing", metricPowerMa);
+  if (metricRailMv) o.gauge("c4_rail_mv", "Filtered 5 V rail voltage", metricRailMv);
+
+  o.gauge("c4_heap_free_bytes", "Free heap", ESP.getFreeHeap());
+  o.gauge("c4_heap_min_free_bytes", "Lowest free heap since boot", ESP.getMinFreeHeap());
+  o.gauge("c4_heap_largest_block_bytes", "Largest allocatable heap block", ESP.getMaxAllocHeap());
+  o.gauge("c4_wifi_connected", "1 if the station is associated", WiFi.isConnected() ? 1 : 0);
+  if (WiFi.isConnected()) o.gauge("c4_wifi_rssi_dbm", "Station RSSI", WiFi.RSSI());
+  if (o.json) o.raw("}");
+  o.flush();
+}
+
+// Call every loop: keeps the per-second loop rate fresh. Returns true when a push is due.
+inline bool metricsPoll() {
+  uint32_t now = millis();
+  if (now - metricLoopMarkMs >= 1000) {
+    metricLoopsPerSec = (lmRtc.iterations - metricLoopMarkIters) * 1000UL / (now - metricLoopMarkMs);
+    metricLoopMarkIters = lmRtc.iterations;
+    metricLoopMarkMs = now;
+  }
+  if (METRICS_PUSH_MS == 0 || now - metricLastPushMs < METRICS_PUSH_MS) return false;
+  metricLastPushMs = now;
+  return true;
+}
+
+// Sinks
+inline void metricsSinkPrint(void* ctx, const char* data, size_t len) { ((Print*)ctx)->write((const uint8_t*)data, len); }
+
+struct MetricsFixedBuf {
+  char*  p;
+  size_t cap;
+  size_t len;
+  bool   overflow;
+};
+inline void metricsSinkFixed(void* ctx, const char* data, size_t len) {
+  MetricsFixedBuf* b = (MetricsFixedBuf*)ctx;
+  if (b->len + len > b->cap) { b->overflow = true; return; }
+  memcpy(b->p + b->len, data, len);
+  b->len += len;
+}
@@ -1,6 +1,13 @@
 // Network.h
-// VERSION: 2.3.0
-// ADDED: ArduinoOTA support (setupOTA/handleOTA)
+// VERSION: 2.18.2
+// FIXED: The TCP phase ends only once the socket is connected; a failed connect is a TCP failure
+//        (c4_conn_failures_total{phase="tcp"}) instead of sitting out the handshake timeout
+// CHANGED: A new scoreboard connection starts round ids over (roundLinkUp, RoundControl.h)
+// CHANGED: WiFi modem sleep follows the per-state power policy (wifiPowerSave, Power.h) instead of always off
+// CHANGED: Tick stream sends the bomb Countdown's rate (paused = 0) so the scoreboard extrapolates correctly
+// CHANGED: Tick stream reads remaining time from the bomb deadline (GameClock.h)
+// CHANGED: ArduinoOTA setup moved to Ota.h (pre-flight gated, password = cmd_token)
+// CHANGED: Logging goes through Log.h (deferred, leveled); log_stream over binary WS frames
 
 #pragma once
 #include <Arduino.h>
@@ -8,10 +15,22 @@
 #include <ESPmDNS.h>
 #include <WebSocketsClient.h>
 #include <WiFiManager.h>
-#include <ArduinoOTA.h>  // FIX: Added for firmware updates
 #include "Config.h"
 #include "State.h"
 #include "Utils.h"
+#include "Profiler.h"
+#include "LoopMonitor.h"
+#include "ScoreboardResolver.h"
+#include "EventJournal.h"
+#include "WsBatch.h"
+#include "ClockSync.h"
+#include "EspNowRadio.h"
+#include "WsCommands.h"
+#include "RoundControl.h"
+#include "ConnFsm.h"
+#include "Metrics.h"
+#include "Ota.h"
+#include "Log.h"
 
 // ---- WebSocket dials & headers ----
 #ifndef WS_PATH
@@ -26,6 +45,9 @@
 #ifndef WS_CONNECT_BY_IP
   #define WS_CONNECT_BY_IP 1     // 0 = dial hostname; 1 = dial resolved IP (safer/faster fail)
 #endif
+#ifndef METRICS_WS_MAX
+  #define METRICS_WS_MAX 1536    // {"type":"metrics",...} is built here before it is queued
+#endif
 
 // -----------------------------------------------------------------------------
 // External functions implemented elsewhere
@@ -127,20 +149,35 @@ inline void ledTick() {
 // -----------------------------------------------------------------------------
 // Session / module state
 // -----------------------------------------------------------------------------
-static WebSocketsClient wsClient;
+// The library reports neither a failed connect nor the socket's state (isConnected() turns
+// true only after the HTTP upgrade); its client record is protected, so read it from here
+class C4WsClient : public WebSocketsClient {
+ public:
+  bool tcpConnected() { return _client.tcp && _client.tcp->connected(); }
+};
+
+static C4WsClient wsClient;
 static bool wsConnected = false;
-static bool wsConnecting = false;           // prevents repeated begin()
-static unsigned long wsConnectingSinceMs = 0;   // watchdog for stuck connects
-static unsigned long nextWsAttemptMs = 0;       // backoff scheduler
+static ConnFsm conn;                            // WIFI/RESOLVE/TCP/HANDSHAKE/LIVE/BACKOFF
+static uint32_t connLivesPublished = 0;
 
 static bool wifiSessionDisabled = false;
+static bool wifiPowerSave = false;             // modem sleep; Power.h sets it per state
 
 static bool mdnsStarted = false;
-static unsigned long lastResolveAttemptMs = 0;
 static IPAddress cachedScoreboardIP;
-
-static const uint16_t WS_RECONNECT_MS = 7000;
-static const uint16_t WS_INITIAL_DELAY_MS = 500;   // slight delay before 1st try
+static uint16_t  cachedScoreboardPort = 0;     // from SRV record, else settings port
+static uint8_t   cachedScoreboardSource = RES_SRC_NONE;
+static uint32_t  lastResolveSamplePublished = 0;
+
+// Countdown sync (ClockSync.h)
+static ClockSyncEstimator   clockSync;
+static CountdownTickEncoder tickEncoder;
+static uint32_t nextTickMs = 0;
+static uint32_t nextSyncMs = 0;
+static uint8_t  syncBurstLeft = 0;               // quick samples right after connect
+static const uint32_t SYNC_BURST_MS    = 500;
+static const uint32_t SYNC_INTERVAL_MS = 10000;
 
 // track when we tried Wi-Fi connect (to decide when to show "red")
 static unsigned long lastWifiAttemptMs = 0;
@@ -150,11 +187,6 @@ static const unsigned long WIFI_FAIL_GRACE_MS = 15000; // 15s until we deem it "
 static bool g_portalConnectedThisSession = false;
 static WiFiManager g_wm;  // single instance shared across start/loop/stop
 
-// Cooldown after repeated WS failures
-static uint8_t  wsConsecutiveFails = 0;
-static unsigned long wsFirstFailWindowMs = 0;
-static unsigned long wsBackoffUntilMs = 0; // when nonzero, skip attempts
-
 // -----------------------------------------------------------------------------
 // Forwards for local helpers (to avoid order issues)
 // -----------------------------------------------------------------------------
@@ -168,70 +200,47 @@ inline bool resolveScoreboardIP();
 inline void forgetWifiCredentials();
 inline void beginNetwork(bool disableForThisBoot);
 inline void networkLoop();
-inline void setupOTA(); 
 
-// -----------------------------------------------------------------------------
-// OTA Setup (FIX: Added Function)
-// -----------------------------------------------------------------------------
-inline void setupOTA() {
-  ArduinoOTA.setHostname("c4prop");
-  // ArduinoOTA.setPassword("admin"); // Optional: set if needed
-
-  ArduinoOTA.onStart([]() {
-    String type = (ArduinoOTA.getCommand() == U_FLASH) ? "sketch" : "filesystem";
-    Serial.println("[OTA] Start updating " + type);
-  });
-  ArduinoOTA.onEnd([]() {
-    Serial.println("\n[OTA] End");
-  });
-  ArduinoOTA.onProgress([](unsigned int progress, unsigned int total) {
-    // throttle progress logs
-    static unsigned int lastP = 0;
-    unsigned int p = (progress / (total / 100));
-    if (p != lastP && p % 10 == 0) {
-      Serial.printf("[OTA] Progress: %u%%\n", p);
-      lastP = p;
-    }
-  });
-  ArduinoOTA.onError([](ota_error_t error) {
-    Serial.printf("[OTA] Error[%u]: ", error);
-    if (error == OTA_AUTH_ERROR) Serial.println("Auth Failed");
-    else if (error == OTA_BEGIN_ERROR) Serial.println("Begin Failed");
-    else if (error == OTA_CONNECT_ERROR) Serial.println("Connect Failed");
-    else if (error == OTA_RECEIVE_ERROR) Serial.println("Receive Failed");
-    else if (error == OTA_END_ERROR) Serial.println("End Failed");
-  });
-
-  ArduinoOTA.begin();
-  Serial.println("[OTA] Service Ready (Hostname: c4prop)");
+// Log.h stream sink: raw records as binary frames (tools/log_decode.cpp)
+inline void wsWriteLogFrames(const uint8_t* data, size_t len) {
+  if (wsConnected) wsClient.sendBIN(data, len);
 }
 
+// Socket gone: whatever is still batched is lost (journaled events are replayed separately)
+inline void wsDropPending() {
+  metricInc(M_WS_MSGS_DROPPED, wbCount);
+  wsBatchReset();
+}
 
 // -----------------------------------------------------------------------------
 // WebSocket helpers (connect via resolved IP if we have one)
 // -----------------------------------------------------------------------------
 inline void connectWebSocket() {
   if (!WiFi.isConnected()) return;
-  if (wsConnected || wsConnecting) return;
+  if (wsConnected) return;
 
   // Prefer hostname for log/Host:, but dial numeric IP when allowed
   String hostForLog = settings.net_use_mdns ? "scoreboard.local" : ipToString(settings.scoreboard_ip);
   String tcpHost    = hostForLog;
+  uint16_t port     = settings.scoreboard_port;
+  if (settings.net_use_mdns && cachedScoreboardPort) port = cachedScoreboardPort;
   if (settings.net_use_mdns && WS_CONNECT_BY_IP && cachedScoreboardIP != IPAddress(0,0,0,0)) {
     tcpHost = ipToString(cachedScoreboardIP); // TCP target is numeric IP
   }
 
-  wsConnecting = true;
-  wsConnectingSinceMs = millis();
-
-  Serial.printf("[NET] Connecting WebSocket to %s (%s):%u path=%s\n",
-                hostForLog.c_str(), tcpHost.c_str(), settings.scoreboard_port, WS_PATH);
+  LOG_I("[NET] Connecting WebSocket to %s (%s via %s):%u path=%s",
+                hostForLog.c_str(), tcpHost.c_str(),
+                settings.net_use_mdns ? resolveSourceName(cachedScoreboardSource) : "static",
+                port, WS_PATH);
 
+  {
+    STALL_TAG_SCOPE(STALL_TAG_WS_BEGIN);
 #if WS_USE_SSL
-  wsClient.beginSSL(tcpHost.c_str(), settings.scoreboard_port, WS_PATH);
+    wsClient.beginSSL(tcpHost.c_str(), port, WS_PATH);
 #else
-  wsClient.begin(tcpHost.c_str(), settings.scoreboard_port, WS_PATH);
+    wsClient.begin(tcpHost.c_str(), port, WS_PATH);
 #endif
+  }
 
   if (strlen(WS_SUBPROTO)) {
     String hdr = String("Sec-WebSocket-Protocol: ") + WS_SUBPROTO + "\r\n";
@@ -245,54 +254,91 @@ inline void connectWebSocket() {
     switch (type) {
       case WStype_CONNECTED:
         wsConnected = true;
-        wsConnecting = false;
-        wsConnectingSinceMs = 0;
-        wsConsecutiveFails = 0;
-        wsFirstFailWindowMs = 0;
-        wsBackoffUntilMs = 0;
-        Serial.println("[NET] WebSocket connected.");
+        conn.live(millis());
+        metricInc(M_WS_CONNECTS);
+        LOG_I("[NET] WebSocket connected (down %u ms, %u attempt(s)%s).",
+                      (unsigned)conn.stats.lastDownMs, (unsigned)conn.stats.lastAttempts,
+                      conn.fastTry ? ", fast path" : "");
+        if (settings.net_use_mdns) scoreboardResolverReportSuccess(cachedScoreboardIP);
+        clockSync.reset();
+        roundLinkUp();
+        tickEncoder.reset();
+        syncBurstLeft = 4;
+        nextSyncMs = millis();
+        wsSendJson(loopMonToJson()); // stall history (incl. previous boot) for the scoreboard
         break;
 
       case WStype_DISCONNECTED: {
         wsConnected = false;
-        wsConnecting = false;
-        wsConnectingSinceMs = 0;
-        Serial.println("[NET] WebSocket disconnected.");
-
-        unsigned long now = millis();
-        if (wsFirstFailWindowMs == 0 || now - wsFirstFailWindowMs > 60000UL) {
-          wsFirstFailWindowMs = now;
-          wsConsecutiveFails = 1;
-        } else {
-          wsConsecutiveFails++;
-        }
-        if (wsConsecutiveFails >= 3) {
-          wsBackoffUntilMs = now + 5UL * 60UL * 1000UL; // 5 minutes cooldown
-          Serial.println("[NET] Too many WS failures; cooling down for 5 minutes.");
-        }
-
-        nextWsAttemptMs = now + WS_RECONNECT_MS; // schedule retry
+        wsDropPending();
+        metricInc(M_WS_DISCONNECTS);
+        logWsLevel = LOG_LEVEL_NONE;   // a new connection subscribes again
+        // A dropped live link redials the same address first; resolver failure is only
+        // reported if that fast path fails too (connAbort)
+        bool wasLive = (conn.phase == CONN_LIVE);
+        if (!wasLive && settings.net_use_mdns) scoreboardResolverReportFailure();
+        conn.dropped(millis());
+        LOG_I("[NET] WebSocket disconnected%s; retry in %u ms.", wasLive ? "" : " during connect",
+                      (unsigned)(conn.retryAtMs - millis()));
       } break;
 
-      case WStype_TEXT:
+      case WStype_TEXT: {
+        uint32_t t0, t1, t2;
+        metricInc(M_WS_RX_TEXT);
+        if (journalHandleAckMessage((const char*)payload)) break;
+        if (clockSyncParseResp((const char*)payload, t0, t1, t2)) { clockSync.addExchange(t0, t1, t2, millis()); break; }
+        if (wsCommandDispatch((char*)payload, length)) break;
+        {
+          int32_t off = 0;
+          bool hasOff = clockSync.offsetMs(off);
+          if (roundHandleMessage((char*)payload, length, hasOff, off, clockSync.rttMs())) break;
+        }
         handleInboundWsMessage((const char*)payload);
-        break;
+      } break;
 
-      case WStype_BIN:
-        Serial.printf("[NET] WS RX BIN (%u bytes)\n", (unsigned)length);
+      case WStype_PONG:
+        // Our sync pings carry a 4-byte millis() stamp; heartbeat pongs are empty
+        if (length == sizeof(uint32_t)) {
+          uint32_t sent;
+          memcpy(&sent, payload, sizeof(sent));
+          clockSync.addRtt(millis() - sent);
+        }
         break;
 
-      default:
-        Serial.printf("[NET] WS event type=%d len=%u\n", (int)type, (unsigned)length);
+      default:   // binary frames, fragments, errors: counted, not logged per frame
+        metricInc(M_WS_RX_OTHER);
         break;
     }
   });
 
-  wsClient.setReconnectInterval(WS_RECONNECT_MS);
+  // The FSM owns retries: the library must not redial inside one attempt window
+  // (its first loop() after begin() does the TCP connect).
+  wsClient.setReconnectInterval(CONN_TCP_TIMEOUT_MS + CONN_HANDSHAKE_TIMEOUT_MS);
+}
+
+// Give up on the current attempt and back off
+inline void connAbort(const char* why) {
+  uint32_t now = millis();
+  uint8_t phase = conn.phase;
+  uint32_t inPhase = conn.inPhaseMs(now);
+  if (settings.net_use_mdns) scoreboardResolverReportFailure();   // re-query in background
+  conn.fail(now);             // first, so a DISCONNECTED event from disconnect() is a no-op
+  metricInc(M_WS_ABORTS);
+  wsClient.disconnect();
+  wsDropPending();
+  wsConnected = false;
+  LOG_W("[NET] %s failed after %u ms (%s); retry in %u ms", connPhaseName(phase), (unsigned)inPhase, why,
+        (unsigned)(conn.retryAtMs - now));
+}
+
+// Frame sink for WsBatch.h
+inline void wsWriteFrame(const uint8_t* data, size_t len) {
+  if (wsConnected) wsClient.sendTXT(data, len);
 }
 
 inline void wsSend(const String& s) {
-  if (wsConnected) wsClient.sendTXT((const uint8_t*)s.c_str(), s.length());
+  if (wsConnected) wsBatchPush(s.c_str(), s.length(), false);
+  else             metricInc(M_WS_MSGS_DROPPED);
 }
 inline void wsSendJson(const String& json) { wsSend(json); }
 
@@ -306,23 +352,23 @@ inline void startWiFiPortal(uint16_t seconds) {
 
   g_wm.setSaveConfigCallback([]() {
     g_portalConnectedThisSession = true;
-    Serial.println("[NET] WiFiManager save callback fired.");
+    LOG_I("[NET] WiFiManager save callback fired.");
   });
 
   const char* ap = "C4Prop-Setup";
   (void)g_wm.startConfigPortal(ap);  // non-blocking: return means "connected"
-  Serial.println("[NET] WiFi portal launched (non-blocking).");
+  LOG_I("[NET] WiFi portal launched (non-blocking).");
 
   if (g_wm.getConfigPortalActive()) {
-    Serial.printf("[NET] Portal active at http://%s\n", WiFi.softAPIP().toString().c_str());
+    LOG_I("[NET] Portal active at http://%s", WiFi.softAPIP().toString().c_str());
   } else {
-    Serial.println("[NET] Portal not yet active (will tick in loop).");
+    LOG_I("[NET] Portal not yet active (will tick in loop).");
   }
 }
 
 inline void stopWiFiPortal() {
   g_wm.stopConfigPortal();
-  Serial.println("[NET] WiFi portal stopped.");
+  LOG_I("[NET] WiFi portal stopped.");
 }
 
 inline void networkPortalLoop() {
@@ -333,38 +379,36 @@ inline void networkPortalLoop() {
 // Network (re)configuration entry point (invoked from menu "Apply Now")
 // -----------------------------------------------------------------------------
 inline void networkReconfigure() {
-  Serial.println("[NET] Applying network settings…");
+  LOG_I("[NET] Applying network settings…");
 
   // Ensure portal isn't running to avoid SoftAP/STA conflicts
   stopWiFiPortal();
 
-  // Tear down WebSocket so we can reconnect cleanly with new settings
+  // Tear down WebSocket so we can reconnect cleanly with new settings;
+  // clear the backoff so user actions retry immediately
   wsClient.disconnect();
   wsConnected = false;
-  wsConnecting = false;
-  wsConnectingSinceMs = 0;
-  nextWsAttemptMs = millis() + WS_INITIAL_DELAY_MS;
-
-  // Clear cooldown counters so user actions immediately re-try
-  wsBackoffUntilMs = 0;
-  wsConsecutiveFails = 0;
-  wsFirstFailWindowMs = 0;
+  conn.kick(millis());
 
   if (!settings.wifi_enabled) {
     wifiSessionDisabled = true;
     mdnsStarted = false;
     WiFi.disconnect(true, true);   // also clears creds from NVS
     WiFi.mode(WIFI_OFF);
-    Serial.println("[NET] Networking disabled for this boot.");
+    LOG_I("[NET] Networking disabled for this boot.");
     ledSetMode(LEDMODE_PULSE_YELLOW);
     return;
   }
 
   wifiSessionDisabled = false;
+  journalBegin(true);
+  wsBatchBegin(wsWriteFrame);
+  logSetWsSink(wsWriteLogFrames);
   WiFi.mode(WIFI_STA);
   WiFi.persistent(true);
   WiFi.setAutoReconnect(true);
-  WiFi.setSleep(false);
+  WiFi.setSleep(wifiPowerSave);
+  espNowBegin();
 
   // Always attempt autoconnect to whatever creds are in NVS
   WiFi.begin();
@@ -374,26 +418,24 @@ inline void networkReconfigure() {
   if (!mdnsStarted) {
     if (MDNS.begin("c4prop")) {
       mdnsStarted = true;
-      Serial.println("[NET] mDNS responder started (hostname c4prop).");
+      LOG_I("[NET] mDNS responder started (hostname c4prop).");
     } else {
-      Serial.println("[NET] mDNS start failed; will retry later (not in loop).");
+      LOG_W("[NET] mDNS start failed; will retry later (not in loop).");
     }
   }
+  if (mdnsStarted) scoreboardResolverStart();
 
-  // First WS attempt will be scheduled a moment later
-  nextWsAttemptMs = millis() + WS_INITIAL_DELAY_MS;
-
-  Serial.println("[NET] Reconfigure complete.");
+  LOG_I("[NET] Reconfigure complete.");
 }
 
 // -----------------------------------------------------------------------------
 // WiFi credentials management
 // -----------------------------------------------------------------------------
 inline void forgetWifiCredentials() {
-  Serial.println("[NET] Forgetting saved WiFi credentials...");
+  LOG_I("[NET] Forgetting saved WiFi credentials...");
 
   if (g_wm.getConfigPortalActive() || (WiFi.getMode() & WIFI_MODE_AP)) {
-    Serial.println("[NET] Stopping WiFi portal before erasing creds…");
+    LOG_I("[NET] Stopping WiFi portal before erasing creds…");
     stopWiFiPortal();
   }
 
@@ -404,7 +446,7 @@ inline void forgetWifiCredentials() {
   }
 
   delay(100);
-  Serial.println("[NET] Credentials erased. Use Network->WiFi Setup to configure.");
+  LOG_I("[NET] Credentials erased. Use Network->WiFi Setup to configure.");
 }
 
 // -----------------------------------------------------------------------------
@@ -416,20 +458,25 @@ inline void beginNetwork(bool disableForThisBoot) {
   wifiSessionDisabled = disableForThisBoot || !settings.wifi_enabled;
 
   if (wifiSessionDisabled) {
-    Serial.println("[NET] Networking DISABLED for this boot.");
+    LOG_I("[NET] Networking DISABLED for this boot.");
     WiFi.disconnect(true, true);
     WiFi.mode(WIFI_OFF);
     ledSetMode(LEDMODE_PULSE_YELLOW);
     return;
   }
 
+  journalBegin(true);
+  wsBatchBegin(wsWriteFrame);
+  logSetWsSink(wsWriteLogFrames);
+
   WiFi.mode(WIFI_STA);
   WiFi.persistent(true);
   WiFi.setAutoReconnect(true);
-  WiFi.setSleep(false);
+  WiFi.setSleep(wifiPowerSave);
+  espNowBegin();
 
   // IMPORTANT: Always try autoconnect using saved credentials.
-  Serial.println("[NET] Boot: attempting STA autoconnect (saved creds).");
+  LOG_I("[NET] Boot: attempting STA autoconnect (saved creds).");
   WiFi.begin();
   lastWifiAttemptMs = millis();
 
@@ -437,17 +484,16 @@ inline void beginNetwork(bool disableForThisBoot) {
   if (!mdnsStarted) {
     if (MDNS.begin("c4prop")) {
       mdnsStarted = true;
-      Serial.println("[NET] mDNS responder started (hostname c4prop).");
+      LOG_I("[NET] mDNS responder started (hostname c4prop).");
     } else {
-      Serial.println("[NET] mDNS start failed; will retry later (not in loop).");
+      LOG_W("[NET] mDNS start failed; will retry later (not in loop).");
     }
   }
+  if (mdnsStarted) scoreboardResolverStart();
 
-  // First WS attempt will be scheduled a moment later
+  // First WS attempt goes out as soon as WiFi is up
   wsConnected = false;
-  wsConnecting = false;
-  wsConnectingSinceMs = 0;
-  nextWsAttemptMs = millis() + WS_INITIAL_DELAY_MS;
+  conn.begin(millis(), esp_random());
 
   // keep portal responsive if opened later
   networkPortalLoop();
@@ -455,6 +501,7 @@ inline void beginNetwork(bool disableForThisBoot) {
 
 // -----------------------------------------------------------------------------
 // Resolve scoreboard host (mDNS or static IP)
+// Non-blocking: reads the background resolver's cache / fallback list.
 // -----------------------------------------------------------------------------
 inline bool resolveScoreboardIP() {
   if (!settings.net_use_mdns) {
@@ -462,24 +509,127 @@ inline bool resolveScoreboardIP() {
     return true;
   }
 
-  const unsigned long RESOLVE_BACKOFF_MS = 5000;
-  unsigned long now = millis();
-  if (now - lastResolveAttemptMs < RESOLVE_BACKOFF_MS) {
-    return (cachedScoreboardIP != IPAddress(0,0,0,0));
+  IPAddress ip;
+  uint16_t port = 0;
+  uint8_t src = RES_SRC_NONE;
+  if (!scoreboardResolverGet(ip, port, &src)) return false;
+
+  if (ip != cachedScoreboardIP || src != cachedScoreboardSource) {
+    LOG_I("[NET] Scoreboard -> %s:%u (%s)", ipToString(ip).c_str(), port, resolveSourceName(src));
   }
-  lastResolveAttemptMs = now;
-
-  // Query only; mDNS BEGIN happens in beginNetwork()/networkReconfigure()
-  const uint32_t MDNS_QUERY_TIMEOUT_MS = 250;
-  IPAddress ip = MDNS.queryHost("scoreboard", MDNS_QUERY_TIMEOUT_MS);
-  if (ip == IPAddress(0,0,0,0)) ip = MDNS.queryHost("scoreboard.local", MDNS_QUERY_TIMEOUT_MS);
-  if (ip != IPAddress(0,0,0,0)) {
-    cachedScoreboardIP = ip;
-    Serial.printf("[NET] mDNS resolved scoreboard.local -> %s\n", ipToString(ip).c_str());
-    return true;
+  cachedScoreboardIP = ip;
+  cachedScoreboardPort = port;
+  cachedScoreboardSource = src;
+  return true;
+}
+
+// Publish mDNS resolve latency whenever the resolver has a new sample
+inline void publishResolveMetric() {
+  if (!settings.net_use_mdns || !wsConnected) return;
+  ResolverState rs = scoreboardResolverSnapshot();
+  uint32_t n = rs.samples + rs.failures;
+  if (n == lastResolveSamplePublished) return;
+  lastResolveSamplePublished = n;
+
+  char buf[160];
+  snprintf(buf, sizeof(buf),
+           "{\"type\":\"metric\",\"name\":\"mdns_resolve_ms\",\"value\":%u,\"source\":\"%s\",\"ok\":%u,\"fail\":%u}",
+           (unsigned)rs.lastLatencyMs, resolveSourceName(rs.source), (unsigned)rs.samples, (unsigned)rs.failures);
+  wsSendJson(String(buf));
+}
+
+// Publish the per-phase breakdown of each outage once we are back
+inline void publishConnMetric() {
+  if (!wsConnected || conn.stats.lives == connLivesPublished) return;
+  connLivesPublished = conn.stats.lives;
+  const ConnStats& cs = conn.stats;
+
+  char buf[256];
+  snprintf(buf, sizeof(buf),
+           "{\"type\":\"metric\",\"name\":\"reconnect_ms\",\"value\":%u,\"wifi\":%u,\"resolve\":%u,\"tcp\":%u,"
+           "\"handshake\":%u,\"backoff\":%u,\"attempts\":%u,\"fast\":%u,\"drops\":%u,\"max\":%u}",
+           (unsigned)cs.lastDownMs, (unsigned)cs.lastMs[CONN_WIFI], (unsigned)cs.lastMs[CONN_RESOLVE],
+           (unsigned)cs.lastMs[CONN_TCP], (unsigned)cs.lastMs[CONN_HANDSHAKE], (unsigned)cs.lastMs[CONN_BACKOFF],
+           (unsigned)cs.lastAttempts, conn.fastTry ? 1u : 0u, (unsigned)cs.drops, (unsigned)cs.maxDownMs);
+  wsSendJson(String(buf));
+}
+
+inline void connPrintStatus(Print& out) {
+  const ConnStats& cs = conn.stats;
+  uint32_t now = millis();
+  out.printf("[CONN] phase=%s for %ums streak=%u", connPhaseName(conn.phase), (unsigned)conn.inPhaseMs(now),
+             (unsigned)conn.failStreak);
+  if (conn.phase == CONN_BACKOFF) out.printf(" retry in %dms%s", (int)(conn.retryAtMs - now), conn.fastPath ? " (fast path)" : "");
+  out.printf("\n[CONN] attempts=%u lives=%u drops=%u fast=%u fails: resolve=%u tcp=%u handshake=%u\n",
+             (unsigned)cs.attempts, (unsigned)cs.lives, (unsigned)cs.drops, (unsigned)cs.fastHits,
+             (unsigned)cs.fails[CONN_RESOLVE], (unsigned)cs.fails[CONN_TCP], (unsigned)cs.fails[CONN_HANDSHAKE]);
+  out.printf("[CONN] last outage %ums (max %ums, %u attempt(s)): wifi=%u resolve=%u tcp=%u handshake=%u backoff=%u\n",
+             (unsigned)cs.lastDownMs, (unsigned)cs.maxDownMs, (unsigned)cs.lastAttempts,
+             (unsigned)cs.lastMs[CONN_WIFI], (unsigned)cs.lastMs[CONN_RESOLVE], (unsigned)cs.lastMs[CONN_TCP],
+             (unsigned)cs.lastMs[CONN_HANDSHAKE], (unsigned)cs.lastMs[CONN_BACKOFF]);
+}
+
+// Metrics with the connection FSM's per-phase failure counts
+inline void metricsWriteAll(MetricsOut& o) {
+  static const char* const phases[CONN_PHASES] = { nullptr, "resolve", "tcp", "handshake", nullptr, nullptr };
+  metricsWrite(o, conn.stats.fails, phases, CONN_PHASES, conn.stats.lastDownMs);
+}
+
+// Same set as GET /metrics, as one JSON message (METRICS_PUSH_MS or {"type":"metrics"})
+inline void publishMetrics() {
+  if (!wsConnected) return;
+  static char buf[METRICS_WS_MAX];
+  MetricsFixedBuf fb = { buf, sizeof(buf), 0, false };
+  MetricsOut o;
+  o.begin(true, metricsSinkFixed, &fb);
+  metricsWriteAll(o);
+  if (fb.overflow) { LOG_W("[NET] metrics message exceeds METRICS_WS_MAX; not sent."); return; }
+  wsBatchPush(buf, fb.len, false);
+}
+
+// No new connection attempts (blocking TCP connect) during interactive/critical states
+inline bool connGameplayHold() {
+  return (currentState == ARMED) ||
+         (currentState == DISARMING_KEYPAD) ||
+         (currentState == DISARMING_MANUAL) ||
+         (currentState == DISARMING_RFID) ||
+         (currentState == PROP_IDLE) ||
+         (currentState == ARMING) ||
+         (currentState == CONFIG_MODE);
+}
+
+// Clock sync samples + countdown ticks (only while connected)
+inline void countdownSyncPump() {
+  if (!wsConnected) return;
+  uint32_t now = millis();
+
+  if ((int32_t)(now - nextSyncMs) >= 0) {
+    uint32_t stamp = now;
+    wsClient.sendPing((uint8_t*)&stamp, sizeof(stamp));
+    char req[48];
+    int n = snprintf(req, sizeof(req), "{\"type\":\"sync_req\",\"t0\":%u}", (unsigned)now);
+    wsBatchPush(req, (size_t)n, true);
+    nextSyncMs = now + (syncBurstLeft ? SYNC_BURST_MS : SYNC_INTERVAL_MS);
+    if (syncBurstLeft) syncBurstLeft--;
   }
 
-  return (cachedScoreboardIP != IPAddress(0,0,0,0));
+  bool running = (currentState >= ARMED && currentState < DISARMED);
+  if (!running) { tickEncoder.reset(); return; }
+  if ((int32_t)(now - nextTickMs) < 0) return;
+  nextTickMs = now + 1000UL / C4_SYNC_HZ;
+
+  uint32_t remaining = bombRemainingMs();
+  char buf[160];
+  size_t len = tickEncoder.encode(now, remaining, bombClock.totalMs, clockSync, buf, sizeof(buf), bombClock.effectiveRate());
+  if (len) wsBatchPush(buf, len, true);   // ticks are time-critical: don't sit in the batch window
+}
+
+inline void clockSyncPrintStatus(Print& out) {
+  int32_t off = 0;
+  bool hasOff = clockSync.offsetMs(off);
+  out.printf("[SYNC] samples=%u rtt=%ums jitter=%ums offset=%s%d ticks=%u rate=%uHz\n",
+             (unsigned)clockSync.count, (unsigned)clockSync.rttMs(), (unsigned)clockSync.jitterMs(),
+             hasOff ? "" : "(none) ", (int)off, (unsigned)tickEncoder.n, (unsigned)C4_SYNC_HZ);
 }
 
 // -----------------------------------------------------------------------------
@@ -504,18 +654,20 @@ inline void networkLoop() {
 
   if (wifiSessionDisabled) return;
 
+  // Event journal: replay/ack while connected, persist to flash while offline & idle
+  bool quietState = (currentState == STANDBY) || (currentState == AWAIT_ARM_TOGGLE) ||
+                    (currentState == DISARMED) || (currentState == EXPLODED) || (currentState == PROP_DUD);
+  journalPump(wsConnected, quietState);
+  countdownSyncPump();
+  roundPump();
+  espNowLoop();
+  wsBatchPoll();   // close the coalescing window
+
   // Keep portal responsive if it's active
   networkPortalLoop();
 
-  // FIX: Initialize OTA once if we have WiFi
-  static bool otaInitialized = false;
-  if (WiFi.isConnected() && !otaInitialized) {
-      setupOTA();
-      otaInitialized = true;
-  }
-  if (otaInitialized) {
-      ArduinoOTA.handle(); 
-  }
+  // ArduinoOTA: set up once WiFi is up, only answered while an update is allowed
+  otaArduinoPump();
 
   // If we just saved creds via WiFiManager, attempt a STA connect once
   if (g_portalConnectedThisSession) {
@@ -524,7 +676,7 @@ inline void networkLoop() {
     unsigned long now = millis();
     if (now - lastTry > RETRY_MS) {
       lastTry = now;
-      Serial.println("[NET] Attempting STA autoconnect after portal save.");
+      LOG_I("[NET] Attempting STA autoconnect after portal save.");
       WiFi.begin(); // use saved creds from NVS
       lastWifiAttemptMs = millis();
 
@@ -532,89 +684,70 @@ inline void networkLoop() {
       if (g_wm.getConfigPortalActive()) stopWiFiPortal();
 
       g_portalConnectedThisSession = false; // only once
-      nextWsAttemptMs = millis() + WS_INITIAL_DELAY_MS;
+      conn.kick(millis());
     }
   }
 
-  // --- WebSocket connect watchdog: bail out if a connect is stuck >5s ---
-  if (wsConnecting) {
-    const unsigned long WS_CONNECT_STUCK_MS = 1000;
-    if (millis() - wsConnectingSinceMs > WS_CONNECT_STUCK_MS) {
-      Serial.println("[NET] WS connect watchdog: aborting stuck attempt");
-      wsClient.disconnect();
-      wsConnected = false;
-      wsConnecting = false;
-      wsConnectingSinceMs = 0;
-      nextWsAttemptMs = millis() + WS_RECONNECT_MS; // backoff before next try
-    }
+  // --- Connection FSM ---
+  uint32_t now = millis();
+  uint8_t before = conn.phase;
+  conn.wifi(WiFi.isConnected(), now);
+  if (conn.phase == CONN_WIFI && before != CONN_WIFI && before != CONN_BACKOFF) {
+    // WiFi went away under an attempt or a live link: drop the socket now
+    wsClient.disconnect();
+    wsDropPending();
+    wsConnected = false;
   }
 
-  // If connected to Wi-Fi, maybe resolve and maybe schedule WS connect
-  if (WiFi.isConnected()) {
-
-    // --- NEW FIX v3 ---
-    // Gate ALL network activity (mDNS, WS) during critical/interactive states
-    extern PropState currentState;  // from State.h
-    bool inCriticalGameplay =
-      (currentState == ARMED) ||
-      (currentState == DISARMING_KEYPAD) ||
-      (currentState == DISARMING_MANUAL) ||
-      (currentState == DISARMING_RFID) ||
-      // Also include all interactive states to prevent lag
-      (currentState == PROP_IDLE) ||
-      (currentState == ARMING) ||
-      (currentState == CONFIG_MODE);
-
-    unsigned long now = millis();
-    
-    // Respect cooldown after repeated failures
-    if (wsBackoffUntilMs && now < wsBackoffUntilMs) {
-      // Stay quiet until cooldown expires
-      if (now + WS_RECONNECT_MS > nextWsAttemptMs) nextWsAttemptMs = now + WS_RECONNECT_MS;
-      
-    } else if (inCriticalGameplay) {
-      // Defer all network activity until we are in a non-interactive state
-      if (now + 1500 > nextWsAttemptMs) nextWsAttemptMs = now + 1500;
-
-    } else if (!wsConnected && !wsConnecting && now >= nextWsAttemptMs) {
-      // --- THIS IS THE KEY CHANGE ---
-      // We are clear to attempt ONE connection.
-      // Do all blocking network tasks INSIDE this timed block.
-      
-      bool canTry = false;
-      if (settings.net_use_mdns) {
-        // 1. First blocking call: mDNS resolve (0.5s)
-        if (resolveScoreboardIP()) {
-          canTry = (cachedScoreboardIP != IPAddress(0,0,0,0));
-        }
-      } else {
-        canTry = true; // Static IP, always "try"
-      }
-      
-      if (canTry) {
-        // 2. Second blocking call: WebSocket connect (1.0s)
-        connectWebSocket();
-      }
-      
-      // 3. Set the backoff timer REGARDLESS of success.
-      //    The watchdog will handle the fail-and-retry.
-      nextWsAttemptMs = now + WS_RECONNECT_MS;
-    }
-
-  } else {
-    // Not connected to Wi-Fi: gentle reminder and push WS attempts out
+  if (conn.phase == CONN_WIFI) {
+    // Not connected to Wi-Fi: gentle reminder
     static unsigned long lastMsg = 0;
     const unsigned long HINT_MS = 10000;
-    unsigned long now = millis();
     if (now - lastMsg > HINT_MS) {
       lastMsg = now;
-      Serial.println("[NET] Not connected. Use Network->WiFi Setup to configure.");
+      LOG_I("[NET] Not connected. Use Network->WiFi Setup to configure.");
+    }
+  }
+
+  if (conn.due(now) && !connGameplayHold()) {
+    if (conn.startAttempt(now) == CONN_TCP) {
+      LOG_I("[NET] Fast path: redialing %s", ipToString(cachedScoreboardIP).c_str());
+      connectWebSocket();
+    }
+  }
+
+  if (conn.phase == CONN_RESOLVE) {
+    // Cached lookup (background task does the actual mDNS queries)
+    bool haveAddr = resolveScoreboardIP() &&
+                    (!settings.net_use_mdns || cachedScoreboardIP != IPAddress(0,0,0,0));
+    if (haveAddr) {
+      conn.resolved(millis());
+      connectWebSocket();
+    } else if (conn.timedOut(millis())) {
+      connAbort("no address");
     }
-    if (now + WS_RECONNECT_MS > nextWsAttemptMs) nextWsAttemptMs = now + WS_RECONNECT_MS;
   }
 
   // NOTE: mDNS.begin() is intentionally NOT called from the loop anymore.
 
-  // WebSocket maintenance
-  wsClient.loop();
+  publishResolveMetric();
+  publishConnMetric();
+
+  // WebSocket maintenance (only while an attempt or a live link exists, so the
+  // library never redials on its own)
+  if (conn.phase == CONN_TCP || conn.phase == CONN_HANDSHAKE || conn.phase == CONN_LIVE) {
+    bool tcp = (conn.phase == CONN_TCP);
+    {
+      PROF_SCOPE(PROF_WS_LOOP);
+      STALL_TAG_SCOPE(STALL_TAG_WS_LOOP);
+      wsClient.loop();
+    }
+    // The first loop() after begin() is the library's (blocking) TCP connect; what
+    // follows until WStype_CONNECTED is the HTTP upgrade
+    if (tcp && conn.phase == CONN_TCP) {          // (an event inside loop() may have moved on)
+      if (wsClient.tcpConnected()) conn.tcpUp(millis());
+      else { connAbort("connect failed"); return; }
+    }
+    if (conn.timedOut(millis())) connAbort("timeout");
+  }
 }
\ No newline at end of file
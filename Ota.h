@@ -0,0 +1,361 @@
+// Ota.h
+// VERSION: 1.0.1
+// CHANGED: Gameplay lock is enforced in stateFire() (StateTable.h)
+// Firmware updates. Two ways in:
+//   ArduinoOTA (IDE network port / espota.py)  full images; password = cmd_token
+//   POST /api/ota (HttpApi.h)                  OtaPatch.h patches: a delta against the running
+//                                              image or a compressed full image (ota_patch make);
+//                                              a plain .bin only while OTA_PATCH_KEY is empty
+// Pre-flight: an update starts only in STANDBY with no remote round staged, and gameplay is
+// locked (stateFire() stays in STANDBY) until it ends. The image streams into the inactive app
+// partition; nothing is buffered beyond the patcher's 4 KB window.
+// After the switch the new image is on trial: OTA_GOOD_AFTER_MS of uptime marks it good. If it
+// resets OTA_TRIAL_BOOTS times before that, the previous partition is booted again. With a
+// rollback-enabled bootloader (CONFIG_BOOTLOADER_APP_ROLLBACK_ENABLE) the bootloader's own
+// pending-verify state is used instead of the NVS counter.
+
+#pragma once
+#include <Arduino.h>
+#include <WiFi.h>
+#include <ArduinoOTA.h>
+#include <Preferences.h>
+#include <esp_ota_ops.h>
+#include <esp_partition.h>
+#include "Config.h"
+#include "State.h"
+#include "RoundControl.h"
+#include "Metrics.h"
+#include "OtaPatch.h"
+#include "Log.h"
+
+#ifndef OTA_PATCH_KEY
+  #define OTA_PATCH_KEY ""               // non-empty: only patches signed with this key (ota_patch make -k)
+#endif
+#ifndef OTA_TRIAL_BOOTS
+  #define OTA_TRIAL_BOOTS 3              // resets a new image may take before the old one comes back
+#endif
+#ifndef OTA_GOOD_AFTER_MS
+  #define OTA_GOOD_AFTER_MS 60000        // uptime that marks a new image good
+#endif
+#ifndef OTA_STEP_BYTES
+  #define OTA_STEP_BYTES 8192            // image bytes produced per otaWrite() call (flash-bound)
+#endif
+
+#if defined(CONFIG_BOOTLOADER_APP_ROLLBACK_ENABLE)
+  #define OTA_NATIVE_ROLLBACK 1
+  // The core would mark the image valid right after boot; we decide in otaLoop()
+  extern "C" bool verifyRollbackLater() { return true; }
+#else
+  #define OTA_NATIVE_ROLLBACK 0
+#endif
+
+static const uint8_t OTA_RAW_IMAGE_MAGIC = 0xE9;    // first byte of a plain app .bin
+
+enum OtaSource : uint8_t { OTA_SRC_NONE, OTA_SRC_HTTP, OTA_SRC_ARDUINO };
+
+// NVS "c4ota"/"trial" (software rollback)
+enum OtaTrial : uint8_t { OTA_TRIAL_NONE = 0, OTA_TRIAL_RUNNING = 1, OTA_TRIAL_ROLLED_BACK = 2 };
+
+struct OtaSession {
+  uint8_t  source;
+  bool     raw;                 // plain image, no patch container
+  bool     flashing;            // esp_ota_begin() done
+  uint8_t  lastDecile;          // progress log
+  uint32_t startMs;
+  uint32_t wireTotal;           // bytes the sender announced (0 = unknown)
+  uint32_t wireBytes;           // bytes received
+  uint32_t imageBytes;          // bytes written to flash
+  const esp_partition_t* running;
+  const esp_partition_t* target;
+  esp_ota_handle_t handle;
+};
+
+static OtaSession  ota;
+static OtaPatcher  otaPatcher;
+static const char* otaLastResult = "none";
+static uint32_t    otaLastMs = 0, otaLastWire = 0, otaLastImage = 0;
+static bool        otaTrialPending = false;
+
+inline const char* otaSourceName(uint8_t s) {
+  switch (s) {
+    case OTA_SRC_HTTP:    return "http";
+    case OTA_SRC_ARDUINO: return "arduino";
+    default:              return "none";
+  }
+}
+
+inline uint32_t otaKBps(uint32_t bytes, uint32_t ms) { return ms ? (uint32_t)((uint64_t)bytes * 1000 / 1024 / ms) : 0; }
+
+// nullptr when an update may start now, else the reason it may not
+inline const char* otaPreflight() {
+  if (ota.source != OTA_SRC_NONE)                   return "busy";
+  if (currentState != STANDBY)                      return "not_standby";
+  if (roundStaged.pending)                          return "round_pending";
+  if (!esp_ota_get_next_update_partition(nullptr))  return "no_partition";
+  return nullptr;
+}
+
+inline const char* otaBegin(uint8_t source, uint32_t wireTotal) {
+  const char* err = otaPreflight();
+  if (err) { LOG_W("[OTA] %s update refused: %s", otaSourceName(source), err); return err; }
+  memset(&ota, 0, sizeof(ota));
+  ota.source = source;
+  ota.startMs = millis();
+  ota.wireTotal = wireTotal;
+  ota.running = esp_ota_get_running_partition();
+  ota.target = esp_ota_get_next_update_partition(nullptr);
+  gameplayLocked = true;
+  LOG_I("[OTA] %s update started (%u bytes announced), %s -> %s", otaSourceName(source), (unsigned)wireTotal,
+        ota.running ? ota.running->label : "?", ota.target->label);
+  return nullptr;
+}
+
+inline void otaEnd(const char* result) {
+  otaLastResult = result;
+  otaLastMs = millis() - ota.startMs;
+  otaLastWire = ota.wireBytes;
+  otaLastImage = ota.imageBytes;
+  ota.source = OTA_SRC_NONE;
+}
+
+inline void otaAbort(const char* why) {
+  if (ota.source == OTA_SRC_NONE) return;
+  if (ota.flashing) esp_ota_abort(ota.handle);
+  ota.flashing = false;
+  metricInc(M_OTA_ERRORS);
+  LOG_E("[OTA] aborted after %u bytes in / %u written: %s", (unsigned)ota.wireBytes, (unsigned)ota.imageBytes, why);
+  otaEnd(why);
+  gameplayLocked = false;
+}
+
+inline void otaProgress() {
+  if (!ota.wireTotal) return;
+  uint8_t decile = (uint8_t)((uint64_t)ota.wireBytes * 10 / ota.wireTotal);
+  if (decile == ota.lastDecile) return;
+  ota.lastDecile = decile;
+  uint32_t ms = millis() - ota.startMs;
+  LOG_I("[OTA] %u%%: %u KB in, %u KB written, %u KB/s", (unsigned)decile * 10, (unsigned)(ota.wireBytes / 1024),
+        (unsigned)(ota.imageBytes / 1024), (unsigned)otaKBps(ota.imageBytes, ms));
+}
+
+static bool otaReadRunning(void*, uint32_t off, uint8_t* buf, size_t n) {
+  return esp_partition_read(ota.running, off, buf, n) == ESP_OK;
+}
+
+static bool otaWriteTarget(void*, const uint8_t* buf, size_t n) {
+  if (esp_ota_write(ota.handle, buf, n) != ESP_OK) return false;
+  ota.imageBytes += (uint32_t)n;
+  return true;
+}
+
+inline bool otaFlashBegin() {
+  // Sequential writes erase sector by sector instead of the whole partition up front
+  esp_err_t e = esp_ota_begin(ota.target, OTA_WITH_SEQUENTIAL_WRITES, &ota.handle);
+  if (e != ESP_OK) { LOG_E("[OTA] esp_ota_begin failed (0x%x)", (unsigned)e); return false; }
+  ota.flashing = true;
+  return true;
+}
+
+// Patch header is in (and authenticated): sizes, base image, then open the partition
+inline const char* otaAcceptHeader() {
+  const OtaPatchHeader& h = otaPatcher.hdr;
+  if (h.newSize > ota.target->size) return "too_big";
+  if (h.oldSize) {
+    if (!ota.running || h.oldSize > ota.running->size) return "wrong_base";
+    uint32_t t0 = millis();
+    if (!otaPatcher.baseMatches()) return "wrong_base";
+    LOG_I("[OTA] delta base verified (%u bytes, %u ms)", (unsigned)h.oldSize, (unsigned)(millis() - t0));
+  }
+  if (!otaFlashBegin()) return "flash_io";
+  LOG_I("[OTA] %s: %u byte image", h.oldSize ? "delta" : "compressed image", (unsigned)h.newSize);
+  return nullptr;
+}
+
+// Feeds received bytes; 'used' = bytes consumed (call again with the rest). Returns
+// OTA_P_MORE, OTA_P_DONE (call otaCommit()) or an error, in which case the session is over.
+inline int8_t otaWrite(const uint8_t* data, size_t n, size_t& used) {
+  used = 0;
+  if (ota.source == OTA_SRC_NONE) return OTA_P_FORMAT;
+  if (ota.wireBytes == 0 && n) {                 // first bytes decide: patch or plain image
+    ota.raw = (data[0] == OTA_RAW_IMAGE_MAGIC);
+    if (ota.raw) {
+      if (sizeof(OTA_PATCH_KEY) > 1) { otaAbort("unsigned_image"); return OTA_P_AUTH; }
+      if (!ota.wireTotal || ota.wireTotal > ota.target->size) { otaAbort("bad_size"); return OTA_P_SIZE; }
+      if (!otaFlashBegin()) { otaAbort("flash_io"); return OTA_P_IO; }
+    } else {
+      otaPatcher.begin(otaReadRunning, otaWriteTarget, nullptr, (const uint8_t*)OTA_PATCH_KEY, sizeof(OTA_PATCH_KEY) - 1);
+    }
+  }
+
+  int8_t r;
+  if (ota.raw) {
+    // esp_ota_end() validates the image format and its checksum
+    if (n > ota.wireTotal - ota.wireBytes) n = ota.wireTotal - ota.wireBytes;
+    if (!otaWriteTarget(nullptr, data, n)) r = OTA_P_IO;
+    else { used = n; r = (ota.wireBytes + used >= ota.wireTotal) ? OTA_P_DONE : OTA_P_MORE; }
+  } else {
+    r = otaPatcher.feed(data, n, used, OTA_STEP_BYTES);
+    if (r == OTA_P_HEADER) {
+      const char* err = otaAcceptHeader();
+      ota.wireBytes += (uint32_t)used;
+      if (err) { otaAbort(err); return OTA_P_FORMAT; }
+      otaProgress();
+      return OTA_P_MORE;
+    }
+  }
+  ota.wireBytes += (uint32_t)used;
+  if (r < 0) { otaAbort(otaPatchError(r)); return r; }
+  otaProgress();
+  return r;
+}
+
+// --- ROLLBACK ---
+inline void otaArmTrial(const esp_partition_t* previous) {
+#if !OTA_NATIVE_ROLLBACK
+  Preferences p;
+  p.begin("c4ota", false);
+  p.putString("prev", previous ? previous->label : "");
+  p.putUChar("boots", 0);
+  p.putUChar("trial", OTA_TRIAL_RUNNING);
+  p.end();
+#else
+  (void)previous;
+#endif
+}
+
+// Success path shared by both sources; the boot partition is already switched
+inline void otaFinished() {
+  otaArmTrial(ota.running);
+  metricInc(M_OTA_UPDATES);
+  otaEnd("ok");
+  metricOtaKBps = otaKBps(otaLastImage, otaLastMs);
+  LOG_I("[OTA] done: %u bytes in, %u written in %u ms (%u KB/s, %u%% of the image sent); trial boot next",
+        (unsigned)otaLastWire, (unsigned)otaLastImage, (unsigned)otaLastMs, (unsigned)metricOtaKBps,
+        (unsigned)(otaLastImage ? (uint64_t)otaLastWire * 100 / otaLastImage : 0));
+}
+
+// After OTA_P_DONE: closes the partition and makes it the boot partition. nullptr on success.
+// Gameplay stays locked: the caller restarts.
+inline const char* otaCommit() {
+  esp_err_t e = esp_ota_end(ota.handle);
+  ota.flashing = false;
+  if (e != ESP_OK) { otaAbort(e == ESP_ERR_OTA_VALIDATE_FAILED ? "image_invalid" : "end_failed"); return otaLastResult; }
+  if (esp_ota_set_boot_partition(ota.target) != ESP_OK) { otaAbort("set_boot_failed"); return otaLastResult; }
+  otaFinished();
+  return nullptr;
+}
+
+// Early in setup(): count this boot against the trial, or roll back
+inline void otaBootCheck() {
+  const esp_partition_t* running = esp_ota_get_running_partition();
+#if OTA_NATIVE_ROLLBACK
+  esp_ota_img_states_t st;
+  if (running && esp_ota_get_state_partition(running, &st) == ESP_OK && st == ESP_OTA_IMG_PENDING_VERIFY) {
+    otaTrialPending = true;
+    LOG_W("[OTA] %s pending verify (bootloader rolls back if it resets first)", running->label);
+  }
+#else
+  Preferences p;
+  p.begin("c4ota", false);
+  uint8_t trial = p.getUChar("trial", OTA_TRIAL_NONE);
+  char prev[17];
+  p.getString("prev", prev, sizeof(prev));
+  if (trial == OTA_TRIAL_ROLLED_BACK || (trial == OTA_TRIAL_RUNNING && running && !strcmp(running->label, prev))) {
+    // Either we rolled back last boot, or the bootloader never started the new image
+    metricInc(M_OTA_ROLLBACKS);
+    otaLastResult = "rolled_back";
+    LOG_E("[OTA] update rolled back, running %s again", running ? running->label : "?");
+    p.putUChar("trial", OTA_TRIAL_NONE);
+  } else if (trial == OTA_TRIAL_RUNNING) {
+    uint8_t boots = p.getUChar("boots", 0) + 1;
+    p.putUChar("boots", boots);
+    const esp_partition_t* back = esp_partition_find_first(ESP_PARTITION_TYPE_APP, ESP_PARTITION_SUBTYPE_ANY, prev);
+    if (boots > OTA_TRIAL_BOOTS && back && esp_ota_set_boot_partition(back) == ESP_OK) {
+      p.putUChar("trial", OTA_TRIAL_ROLLED_BACK);
+      p.end();
+      LOG_E("[OTA] new image reset %u times before it was marked good: back to %s", (unsigned)(boots - 1), prev);
+      logFlush();
+      ESP.restart();
+    }
+    otaTrialPending = true;
+    LOG_W("[OTA] trial boot %u/%u of %s", (unsigned)boots, (unsigned)OTA_TRIAL_BOOTS, running ? running->label : "?");
+  }
+  p.end();
+#endif
+}
+
+inline void otaMarkGood() {
+  otaTrialPending = false;
+#if OTA_NATIVE_ROLLBACK
+  esp_ota_mark_app_valid_cancel_rollback();
+#else
+  Preferences p;
+  p.begin("c4ota", false);
+  p.putUChar("trial", OTA_TRIAL_NONE);
+  p.end();
+#endif
+  const esp_partition_t* running = esp_ota_get_running_partition();
+  LOG_I("[OTA] %s marked good", running ? running->label : "?");
+}
+
+// Every loop
+inline void otaLoop() {
+  if (otaTrialPending && millis() > OTA_GOOD_AFTER_MS) otaMarkGood();
+}
+
+// --- ARDUINO OTA ---
+inline void otaArduinoSetup() {
+  ArduinoOTA.setHostname("c4prop");
+  if (settings.cmd_token[0]) ArduinoOTA.setPassword(settings.cmd_token);
+  else LOG_W("[OTA] No cmd_token set: network uploads need no password.");
+
+  ArduinoOTA.onStart([]() {
+    // Only reachable through otaArduinoPump(), so the pre-flight has passed
+    otaBegin(OTA_SRC_ARDUINO, 0);
+    ota.flashing = false;                 // Update owns the partition handle
+  });
+  ArduinoOTA.onProgress([](unsigned int progress, unsigned int total) {
+    ota.wireTotal = total;
+    ota.wireBytes = ota.imageBytes = progress;
+    otaProgress();
+  });
+  ArduinoOTA.onEnd([]() {
+    otaFinished();
+    logFlush();                           // ArduinoOTA restarts right after this
+  });
+  ArduinoOTA.onError([](ota_error_t error) {
+    const char* what = "Unknown";
+    if (error == OTA_AUTH_ERROR) what = "Auth Failed";
+    else if (error == OTA_BEGIN_ERROR) what = "Begin Failed";
+    else if (error == OTA_CONNECT_ERROR) what = "Connect Failed";
+    else if (error == OTA_RECEIVE_ERROR) what = "Receive Failed";
+    else if (error == OTA_END_ERROR) what = "End Failed";
+    if (ota.source == OTA_SRC_ARDUINO) otaAbort(what);
+    else { metricInc(M_OTA_ERRORS); LOG_E("[OTA] Error[%u]: %s", (unsigned)error, what); }
+  });
+
+  ArduinoOTA.begin();
+  LOG_I("[OTA] Service Ready (Hostname: c4prop)");
+}
+
+// From networkLoop(). Outside the pre-flight window the invitation is never answered, so the
+// uploader times out without touching flash.
+inline void otaArduinoPump() {
+  static bool started = false;
+  if (!WiFi.isConnected()) return;
+  if (!started) { otaArduinoSetup(); started = true; }
+  if (otaPreflight()) return;
+  ArduinoOTA.handle();
+}
+
+inline void otaPrintStatus(Print& out) {
+  const esp_partition_t* running = esp_ota_get_running_partition();
+  const esp_partition_t* next = esp_ota_get_next_update_partition(nullptr);
+  const char* pre = otaPreflight();
+  out.printf("[OTA] running=%s next=%s trial=%s | %s%s | last: %s, %u B in, %u B written, %u ms, %u KB/s\n",
+             running ? running->label : "?", next ? next->label : "-", otaTrialPending ? "pending" : "no",
+             ota.source != OTA_SRC_NONE ? "receiving via " : pre ? "refusing: " : "ready",
+             ota.source != OTA_SRC_NONE ? otaSourceName(ota.source) : pre ? pre : "",
+             otaLastResult, (unsigned)otaLastWire, (unsigned)otaLastImage, (unsigned)otaLastMs,
+             (unsigned)otaKBps(otaLastImage, otaLastMs));
+}
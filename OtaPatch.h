@@ -0,0 +1,380 @@
+// OtaPatch.h
+// VERSION: 1.0.0
+// Streaming firmware patches for OTA (Ota.h). A patch rebuilds the new image from the image
+// that is running now (COPY_OLD), from the last OTA_PATCH_WINDOW bytes already produced
+// (COPY_OUT, LZ77-style) and from literals. A patch without COPY_OLD ops is simply a
+// compressed full image. The applier needs no buffer for the image: output goes straight to
+// a write callback, old bytes come from a read callback.
+// Pure C++11, shared by the firmware and tools/ota_patch.cpp (make / apply / selftest).
+//
+// Header (little-endian, OTA_PATCH_HEAD bytes):
+//   0  "C4PT"       magic
+//   4  version      1
+//   5  flags        0
+//   6  reserved     uint16
+//   8  newSize      uint32 bytes of the rebuilt image
+//  12  oldSize      uint32 bytes of the base image (0 = not a delta)
+//  16  oldSha       SHA-256 of the base image
+//  48  newSha       SHA-256 of the rebuilt image
+//  80  mac          HMAC-SHA256(key, bytes 0..79); all zero for unsigned patches
+// Ops: tag byte = op | (len << 2), len 1..63 inline, 0 = varint length follows
+//   LIT       len, then len bytes
+//   COPY_OLD  len, zigzag varint (source - base cursor)
+// The base cursor follows the output (every op advances it by len) and jumps to the end of
+// each COPY_OLD, so an edit that keeps the layout costs a zero delta.
+//   COPY_OUT  len, varint distance back into the output (1..OTA_PATCH_WINDOW)
+//   END       rebuilt size and SHA-256 must match the header
+
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#ifndef OTA_PATCH_WINDOW
+  #define OTA_PATCH_WINDOW 4096        // power of two; COPY_OUT reach (RAM on the prop)
+#endif
+
+static_assert((OTA_PATCH_WINDOW & (OTA_PATCH_WINDOW - 1)) == 0, "OTA_PATCH_WINDOW must be a power of two");
+
+static const size_t  OTA_PATCH_HEAD    = 112;
+static const size_t  OTA_PATCH_SIGNED  = 80;     // header bytes covered by the MAC
+static const uint8_t OTA_PATCH_VERSION = 1;
+static const size_t  OTA_PATCH_CHUNK   = 256;    // copy granularity (stack buffer)
+
+enum OtaPatchOp : uint8_t { OTA_OP_LIT = 0, OTA_OP_COPY_OLD = 1, OTA_OP_COPY_OUT = 2, OTA_OP_END = 3 };
+
+enum OtaPatchResult : int8_t {
+  OTA_P_MORE   = 0,     // all input used (or output budget spent): call again
+  OTA_P_HEADER = 1,     // header parsed and authenticated; caller does its pre-flight checks
+  OTA_P_DONE   = 2,     // END reached, size + SHA-256 verified
+  OTA_P_MAGIC  = -1,
+  OTA_P_AUTH   = -2,    // MAC missing or wrong
+  OTA_P_FORMAT = -3,    // bad op, copy outside the base image or window
+  OTA_P_SIZE   = -4,    // output longer/shorter than the header says
+  OTA_P_HASH   = -5,    // rebuilt image does not match newSha
+  OTA_P_IO     = -6     // read/write callback failed
+};
+
+inline const char* otaPatchError(int8_t r) {
+  switch (r) {
+    case OTA_P_MAGIC:  return "bad_magic";
+    case OTA_P_AUTH:   return "bad_signature";
+    case OTA_P_FORMAT: return "bad_patch";
+    case OTA_P_SIZE:   return "bad_size";
+    case OTA_P_HASH:   return "hash_mismatch";
+    case OTA_P_IO:     return "flash_io";
+    default:           return "ok";
+  }
+}
+
+// ---------------------------------------------------------------------------
+// SHA-256 / HMAC-SHA256 (FIPS 180-4, RFC 2104)
+// ---------------------------------------------------------------------------
+struct Sha256 {
+  uint32_t h[8];
+  uint8_t  block[64];
+  uint64_t total;
+  uint8_t  used;
+
+  void begin() {
+    static const uint32_t H0[8] = { 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                                    0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 };
+    memcpy(h, H0, sizeof(h));
+    total = 0; used = 0;
+  }
+
+  static uint32_t ror(uint32_t x, uint8_t n) { return (x >> n) | (x << (32 - n)); }
+
+  void compress(const uint8_t* p) {
+    static const uint32_t K[64] = {
+      0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+      0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+      0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+      0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+      0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+      0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+      0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+      0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2 };
+    uint32_t w[64];
+    for (int i = 0; i < 16; i++) w[i] = (uint32_t)p[4 * i] << 24 | (uint32_t)p[4 * i + 1] << 16 | (uint32_t)p[4 * i + 2] << 8 | p[4 * i + 3];
+    for (int i = 16; i < 64; i++) {
+      uint32_t s0 = ror(w[i - 15], 7) ^ ror(w[i - 15], 18) ^ (w[i - 15] >> 3);
+      uint32_t s1 = ror(w[i - 2], 17) ^ ror(w[i - 2], 19) ^ (w[i - 2] >> 10);
+      w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+    uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4], f = h[5], g = h[6], k = h[7];
+    for (int i = 0; i < 64; i++) {
+      uint32_t t1 = k + (ror(e, 6) ^ ror(e, 11) ^ ror(e, 25)) + ((e & f) ^ (~e & g)) + K[i] + w[i];
+      uint32_t t2 = (ror(a, 2) ^ ror(a, 13) ^ ror(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+      k = g; g = f; f = e; e = d + t1; d = c; c = b; b = a; a = t1 + t2;
+    }
+    h[0] += a; h[1] += b; h[2] += c; h[3] += d; h[4] += e; h[5] += f; h[6] += g; h[7] += k;
+  }
+
+  void update(const uint8_t* p, size_t n) {
+    total += n;
+    while (n) {
+      size_t k = 64 - used;
+      if (k > n) k = n;
+      memcpy(block + used, p, k);
+      used += (uint8_t)k; p += k; n -= k;
+      if (used == 64) { compress(block); used = 0; }
+    }
+  }
+
+  void finish(uint8_t out[32]) {
+    uint64_t bits = total * 8;
+    uint8_t pad = 0x80;
+    update(&pad, 1);
+    pad = 0;
+    while (used != 56) update(&pad, 1);
+    uint8_t len[8];
+    for (int i = 0; i < 8; i++) len[i] = (uint8_t)(bits >> (56 - 8 * i));
+    update(len, 8);
+    for (int i = 0; i < 8; i++) {
+      out[4 * i] = (uint8_t)(h[i] >> 24); out[4 * i + 1] = (uint8_t)(h[i] >> 16);
+      out[4 * i + 2] = (uint8_t)(h[i] >> 8); out[4 * i + 3] = (uint8_t)h[i];
+    }
+  }
+};
+
+inline void hmacSha256(const uint8_t* key, size_t keyLen, const uint8_t* msg, size_t n, uint8_t out[32]) {
+  uint8_t k[64] = { 0 }, pad[64], inner[32];
+  Sha256 s;
+  if (keyLen > 64) { s.begin(); s.update(key, keyLen); s.finish(k); }
+  else if (keyLen) memcpy(k, key, keyLen);
+  for (int i = 0; i < 64; i++) pad[i] = k[i] ^ 0x36;
+  s.begin(); s.update(pad, 64); s.update(msg, n); s.finish(inner);
+  for (int i = 0; i < 64; i++) pad[i] = k[i] ^ 0x5c;
+  s.begin(); s.update(pad, 64); s.update(inner, 32); s.finish(out);
+}
+
+// Constant time: the MAC comparison must not leak how many bytes matched
+inline bool otaDigestEq(const uint8_t* a, const uint8_t* b, size_t n) {
+  uint8_t d = 0;
+  for (size_t i = 0; i < n; i++) d |= a[i] ^ b[i];
+  return d == 0;
+}
+
+// ---------------------------------------------------------------------------
+// Header
+// ---------------------------------------------------------------------------
+struct OtaPatchHeader {
+  uint8_t  version, flags;
+  uint32_t newSize, oldSize;
+  uint8_t  oldSha[32], newSha[32], mac[32];
+};
+
+inline uint32_t otaRd32(const uint8_t* p) { return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24; }
+inline void     otaWr32(uint8_t* p, uint32_t v) { p[0] = (uint8_t)v; p[1] = (uint8_t)(v >> 8); p[2] = (uint8_t)(v >> 16); p[3] = (uint8_t)(v >> 24); }
+
+inline bool otaPatchIsPatch(const uint8_t* p, size_t n) { return n >= 4 && !memcmp(p, "C4PT", 4); }
+
+// Serializes h; signs it when a key is given (the MAC field of h is ignored)
+inline void otaPatchWriteHeader(const OtaPatchHeader& h, const uint8_t* key, size_t keyLen, uint8_t out[OTA_PATCH_HEAD]) {
+  memset(out, 0, OTA_PATCH_HEAD);
+  memcpy(out, "C4PT", 4);
+  out[4] = h.version;
+  out[5] = h.flags;
+  otaWr32(out + 8, h.newSize);
+  otaWr32(out + 12, h.oldSize);
+  memcpy(out + 16, h.oldSha, 32);
+  memcpy(out + 48, h.newSha, 32);
+  if (keyLen) hmacSha256(key, keyLen, out, OTA_PATCH_SIGNED, out + 80);
+}
+
+// ---------------------------------------------------------------------------
+// Streaming applier
+// ---------------------------------------------------------------------------
+typedef bool (*OtaReadFn)(void* ctx, uint32_t off, uint8_t* buf, size_t n);
+typedef bool (*OtaWriteFn)(void* ctx, const uint8_t* buf, size_t n);
+
+struct OtaPatcher {
+  enum Phase : uint8_t { PH_HEAD, PH_TAG, PH_LEN, PH_ARG, PH_LIT, PH_COPY, PH_DONE, PH_FAILED };
+
+  OtaReadFn      readOld;
+  OtaWriteFn     writeNew;
+  void*          ctx;
+  const uint8_t* key;
+  size_t         keyLen;
+
+  OtaPatchHeader hdr;
+  uint8_t  head[OTA_PATCH_HEAD];
+  uint8_t  headLen;
+  uint8_t  phase, op, shift;
+  uint32_t varint;           // argument being decoded
+  uint32_t len;              // bytes left in the current op
+  uint32_t src;              // COPY_OLD: next base offset; COPY_OUT: distance
+  uint32_t oldPos;           // base cursor
+  uint32_t outLen;
+  Sha256   sha;
+  uint8_t  win[OTA_PATCH_WINDOW];
+
+  // key == nullptr / keyLen == 0: unsigned patches accepted (hash still checked)
+  void begin(OtaReadFn rd, OtaWriteFn wr, void* c, const uint8_t* k, size_t kl) {
+    readOld = rd; writeNew = wr; ctx = c; key = k; keyLen = kl;
+    headLen = 0; phase = PH_HEAD; op = 0; shift = 0; varint = 0; len = 0; src = 0; oldPos = 0; outLen = 0;
+    sha.begin();
+  }
+
+  int8_t fail(int8_t r) { phase = PH_FAILED; return r; }
+
+  int8_t parseHeader() {
+    if (!otaPatchIsPatch(head, headLen)) return fail(OTA_P_MAGIC);
+    hdr.version = head[4];
+    hdr.flags = head[5];
+    hdr.newSize = otaRd32(head + 8);
+    hdr.oldSize = otaRd32(head + 12);
+    memcpy(hdr.oldSha, head + 16, 32);
+    memcpy(hdr.newSha, head + 48, 32);
+    memcpy(hdr.mac, head + 80, 32);
+    if (hdr.version != OTA_PATCH_VERSION) return fail(OTA_P_FORMAT);
+    if (keyLen) {
+      uint8_t mac[32];
+      hmacSha256(key, keyLen, head, OTA_PATCH_SIGNED, mac);
+      if (!otaDigestEq(mac, hdr.mac, 32)) return fail(OTA_P_AUTH);
+    }
+    phase = PH_TAG;
+    return OTA_P_HEADER;
+  }
+
+  // Hashes the base image through readOld; blocking, once per update before the first write
+  bool baseMatches() {
+    Sha256 s;
+    s.begin();
+    uint8_t buf[OTA_PATCH_CHUNK];
+    for (uint32_t off = 0; off < hdr.oldSize; ) {
+      size_t n = hdr.oldSize - off < sizeof(buf) ? hdr.oldSize - off : sizeof(buf);
+      if (!readOld(ctx, off, buf, n)) return false;
+      s.update(buf, n);
+      off += (uint32_t)n;
+    }
+    uint8_t d[32];
+    s.finish(d);
+    return memcmp(d, hdr.oldSha, 32) == 0;
+  }
+
+  bool emit(const uint8_t* p, size_t n) {
+    if (outLen + n > hdr.newSize) return false;
+    sha.update(p, n);
+    for (size_t i = 0; i < n; i++) win[(outLen + i) & (OTA_PATCH_WINDOW - 1)] = p[i];
+    outLen += (uint32_t)n;
+    return writeNew(ctx, p, n);
+  }
+
+  // One varint byte; true once complete
+  bool varintByte(uint8_t b) {
+    varint |= (uint32_t)(b & 0x7F) << shift;
+    shift += 7;
+    return !(b & 0x80) || shift > 28;
+  }
+
+  int8_t startOp() {
+    if (op == OTA_OP_COPY_OLD) {
+      int32_t delta = (int32_t)(varint >> 1) ^ -(int32_t)(varint & 1);
+      src = oldPos + (uint32_t)delta;
+      if (src > hdr.oldSize || len > hdr.oldSize - src) return fail(OTA_P_FORMAT);
+      oldPos = src + len;
+    } else {
+      src = varint;
+      if (src == 0 || src > OTA_PATCH_WINDOW || src > outLen) return fail(OTA_P_FORMAT);
+      oldPos += len;
+    }
+    if (outLen + len > hdr.newSize) return fail(OTA_P_SIZE);
+    phase = PH_COPY;
+    return OTA_P_MORE;
+  }
+
+  int8_t finishImage() {
+    if (outLen != hdr.newSize) return fail(OTA_P_SIZE);
+    uint8_t d[32];
+    sha.finish(d);
+    if (memcmp(d, hdr.newSha, 32) != 0) return fail(OTA_P_HASH);
+    phase = PH_DONE;
+    return OTA_P_DONE;
+  }
+
+  // Consumes input until it is used up, the header is complete, or 'budget' output bytes have
+  // been produced by copies (long COPY_OLD runs are flash-bound). 'used' = input consumed.
+  int8_t feed(const uint8_t* in, size_t n, size_t& used, uint32_t budget) {
+    used = 0;
+    if (phase == PH_FAILED) return OTA_P_FORMAT;
+    if (phase == PH_DONE) return OTA_P_DONE;
+    uint32_t produced = 0;
+    for (;;) {
+      if (phase == PH_COPY) {
+        while (len && produced < budget) {
+          uint8_t buf[OTA_PATCH_CHUNK];
+          size_t k = len < sizeof(buf) ? len : sizeof(buf);
+          if (op == OTA_OP_COPY_OLD) {
+            if (!readOld(ctx, src, buf, k)) return fail(OTA_P_IO);
+            src += (uint32_t)k;
+          } else {
+            if (k > src) k = src;                                // overlapping run: one distance at a time
+            for (size_t i = 0; i < k; i++) buf[i] = win[(outLen - src + i) & (OTA_PATCH_WINDOW - 1)];
+          }
+          if (!emit(buf, k)) return fail(outLen + k > hdr.newSize ? OTA_P_SIZE : OTA_P_IO);
+          len -= (uint32_t)k;
+          produced += (uint32_t)k;
+        }
+        if (len) return OTA_P_MORE;
+        phase = PH_TAG;
+      }
+      if (used >= n) return OTA_P_MORE;
+
+      switch (phase) {
+        case PH_HEAD: {
+          size_t k = OTA_PATCH_HEAD - headLen;
+          if (k > n - used) k = n - used;
+          memcpy(head + headLen, in + used, k);
+          headLen += (uint8_t)k;
+          used += k;
+          if (headLen >= 4 && !otaPatchIsPatch(head, headLen)) return fail(OTA_P_MAGIC);
+          if (headLen == OTA_PATCH_HEAD) return parseHeader();
+        } break;
+
+        case PH_TAG: {
+          uint8_t t = in[used++];
+          op = t & 3;
+          if (op == OTA_OP_END) return finishImage();
+          len = t >> 2;
+          varint = 0; shift = 0;
+          if (!len) phase = PH_LEN;
+          else if (op != OTA_OP_LIT) phase = PH_ARG;
+          else { phase = PH_LIT; oldPos += len; }
+        } break;
+
+        case PH_LEN:
+          if (varintByte(in[used++])) {
+            len = varint;
+            if (len == 0) return fail(OTA_P_FORMAT);
+            varint = 0; shift = 0;
+            if (op != OTA_OP_LIT) phase = PH_ARG;
+            else { phase = PH_LIT; oldPos += len; }
+          }
+          break;
+
+        case PH_ARG:
+          if (varintByte(in[used++])) {
+            int8_t r = startOp();
+            if (r < 0) return r;
+          }
+          break;
+
+        case PH_LIT: {
+          size_t k = len < n - used ? len : n - used;
+          if (outLen + k > hdr.newSize) return fail(OTA_P_SIZE);
+          if (!emit(in + used, k)) return fail(OTA_P_IO);
+          used += k;
+          len -= (uint32_t)k;
+          if (!len) phase = PH_TAG;
+        } break;
+
+        default:
+          return fail(OTA_P_FORMAT);
+      }
+    }
+  }
+
+  uint32_t imageBytes() const { return outLen; }
+};
@@ -0,0 +1,340 @@
+// Power.h
+// VERSION: 1.2.1
+// CHANGED: Servo surge window starts with every step of an ejector sequence (ejectorMoves)
+// CHANGED: LED dimming through LedLimiter.h: LED_MAX_MA ceiling, per-state LED current in "power"
+// ADDED: Power budget (PowerBudget.h): rail voltage sampling, LED dimming, staggered shell pop
+// Power-state manager. POWER_POLICY has one row per PropState saying what the prop can do
+// without in that state:
+//   - the RC522 goes into soft power-down wherever no tag is read (tickIdle, tickArmed and the
+//     tag scan screen are the only readers)
+//   - all LEDs go dark in STANDBY / AWAIT_ARM_TOGGLE: one black frame, then no more frames
+//     (and the strip's 5 V is switched off if POWER_STRIP_EN_PIN is fitted)
+//   - WiFi uses modem sleep outside the armed states, where it adds up to a beacon interval
+//     of latency to the tick stream
+//   - in STANDBY / AWAIT_ARM_TOGGLE the CPU light-sleeps between inputs once nothing has
+//     happened for POWER_IDLE_GRACE_MS. A keypad row, the arm switch or the disarm button
+//     wakes it (GPIO level wake-up), and a timer ends each nap after POWER_NAP_MAX_MS.
+// Light sleep needs WiFi off (networking disabled for the session); with a station up the prop
+// uses modem sleep only. It also stays awake while a USB serial monitor is open (light sleep
+// drops the USB link), while a restart is pending and while a firmware update runs.
+//
+// The RC522 has no IRQ line on this board (Pins.h) and its card detect needs the field on, so a
+// tag cannot wake the prop. The reader is powered down only in states that never read tags;
+// every state that does is reached through the keypad or the arm switch, which wake it first.
+//
+// PowerMeter (PowerModel.h) books the estimated draw per state: "power" serial command and
+// the c4_power_estimated_ma gauge.
+//
+// The power budget (PowerBudget.h) caps the estimated peak. Each LED frame is shown at the
+// brightness the other loads and LED_MAX_MA leave (powerLedBrightness, Display.h), and the shell pop waits for
+// its surge to fit (powerServoMayStart, Game.h). With BATTERY_SENSE_PIN on a divider from the 5 V
+// rail the limit comes down as the rail sags. After a brownout reset the whole boot runs at
+// POWER_BUDGET_BROWNOUT_PCT of the limit.
+
+#pragma once
+#include <Arduino.h>
+#include <WiFi.h>
+#include <esp_sleep.h>
+#include <driver/gpio.h>
+#include "Pins.h"
+#include "Config.h"
+#include "State.h"
+#include "Hardware.h"
+#include "ShellEjector.h"
+#include "Utils.h"
+#include "Network.h"
+#include "Metrics.h"
+#include "Log.h"
+#include "LoopMonitor.h"
+#include "PowerBudget.h"
+#include "LedLimiter.h"
+
+// --- DIALS ---
+#ifndef POWER_LIGHT_SLEEP
+  #define POWER_LIGHT_SLEEP    1       // 0 = never light-sleep (the rest of the policy still applies)
+#endif
+#ifndef POWER_IDLE_GRACE_MS
+  #define POWER_IDLE_GRACE_MS  10000   // stay awake this long after a state change or any input
+#endif
+#ifndef POWER_NAP_MAX_MS
+  #define POWER_NAP_MAX_MS     1000    // longest light sleep; loop() runs once between naps
+#endif
+#ifndef POWER_STRIP_EN_PIN
+  #define POWER_STRIP_EN_PIN   -1      // switch on the strip's 5 V, HIGH = on; -1 = not fitted
+#endif
+#ifndef POWER_AUDIO_PLAY_MS
+  #define POWER_AUDIO_PLAY_MS  3000    // DFPlayer counts as playing this long after a command
+#endif
+#ifndef POWER_BLAST_AUDIO_MS
+  #define POWER_BLAST_AUDIO_MS 1500    // loud part of the detonation track from PRE_EXPLOSION_BLAST_MS
+#endif
+#ifndef BATTERY_SENSE_PIN
+  #define BATTERY_SENSE_PIN    -1      // ADC pin on a divider from the 5 V rail; -1 = not fitted
+#endif
+#ifndef BATTERY_DIVIDER_X100
+  #define BATTERY_DIVIDER_X100 200     // rail / pin voltage x100 (two equal resistors = 200)
+#endif
+#ifndef BATTERY_SAMPLE_MS
+  #define BATTERY_SAMPLE_MS    20
+#endif
+
+enum : uint8_t {
+  PW_LIGHT_SLEEP = 1 << 0,   // light-sleep between inputs once idle
+  PW_MODEM_SLEEP = 1 << 1,   // WiFi power save
+  PW_RFID_OFF    = 1 << 2,   // RC522 soft power-down
+  PW_LEDS_OFF    = 1 << 3    // all LEDs dark, no frames pushed
+};
+
+static constexpr uint8_t PW_STANDBY = PW_LIGHT_SLEEP | PW_MODEM_SLEEP | PW_RFID_OFF | PW_LEDS_OFF;
+
+// One row per PropState, in enum order
+static const uint8_t POWER_POLICY[] = {
+  /* STANDBY           */ PW_STANDBY,
+  /* AWAIT_ARM_TOGGLE  */ PW_STANDBY,
+  /* PROP_IDLE         */ PW_MODEM_SLEEP,
+  /* ARMING            */ PW_MODEM_SLEEP,
+  /* ARMED             */ 0,
+  /* DISARMING_KEYPAD  */ 0,
+  /* DISARMING_MANUAL  */ PW_RFID_OFF,
+  /* DISARMING_RFID    */ PW_RFID_OFF,
+  /* DISARMED          */ PW_MODEM_SLEEP | PW_RFID_OFF,
+  /* PRE_EXPLOSION     */ PW_RFID_OFF,
+  /* EXPLODED          */ PW_MODEM_SLEEP | PW_RFID_OFF,
+  /* EASTER_EGG        */ PW_RFID_OFF,
+  /* EASTER_EGG_2      */ PW_RFID_OFF,
+  /* CONFIG_MODE       */ 0,
+  /* STARWARS_PRE_GAME */ PW_MODEM_SLEEP,
+  /* PROP_DUD          */ PW_MODEM_SLEEP | PW_RFID_OFF,
+  /* TOLKIEN_GAME      */ PW_MODEM_SLEEP | PW_RFID_OFF,
+};
+static_assert(sizeof(POWER_POLICY) / sizeof(POWER_POLICY[0]) == STATE_COUNT, "POWER_POLICY needs one row per PropState");
+
+static PowerMeter powerMeter;
+static uint8_t  powerState = 0xFF;      // state the policy was last applied for
+static uint8_t  powerFlags = 0;
+static bool     powerRfidOn = true;     // PCD_Init() leaves it on
+static uint32_t powerActiveMs = 0;      // last input or state change
+static uint16_t powerLedMaNow = 0;      // strip draw of the last frame shown
+static uint32_t powerNaps = 0;
+static uint32_t powerInputWakes = 0;
+
+static BatteryFilter powerRail;
+static uint32_t powerBaseLimitMa = POWER_BUDGET_MA;   // lowered for a boot after a brownout
+static uint32_t powerLimitMa = POWER_BUDGET_MA;       // base, derated for the rail voltage
+static uint32_t powerLastRailMs = 0;
+static uint32_t powerLastMoves = 0;
+static uint32_t powerServoMoveMs = 0;   // start of the current servo move
+static uint32_t powerServoWaitMs = 0;   // pop held back since (0 = not waiting)
+static LedLimiter powerLeds;
+static uint32_t powerStaggers = 0;
+
+inline bool powerLedsDark() { return powerFlags & PW_LEDS_OFF; }
+
+inline void powerBegin() {
+  if (POWER_STRIP_EN_PIN >= 0) { pinMode(POWER_STRIP_EN_PIN, OUTPUT); digitalWrite(POWER_STRIP_EN_PIN, HIGH); }
+  powerMeter.reset(gameNowUs());
+  powerActiveMs = millis();
+  powerRail.reset();
+  powerLeds.begin(NUM_LEDS);
+  if (lmResetReason == ESP_RST_BROWNOUT) {
+    powerBaseLimitMa = POWER_BUDGET_MA * POWER_BUDGET_BROWNOUT_PCT / 100;
+    LOG_W("[PWR] Last reset was a brownout: power budget %u mA for this boot", (unsigned)powerBaseLimitMa);
+  }
+  powerLimitMa = powerBaseLimitMa;
+}
+
+inline void powerLedRecalc() {
+  uint32_t ma = powerLedMa((const uint8_t*)leds, NUM_LEDS, FastLED.getBrightness());
+  powerLedMaNow = ma > 0xFFFF ? 0xFFFF : (uint16_t)ma;
+}
+
+inline void powerApply(uint8_t s) {
+  uint8_t f = POWER_POLICY[s];
+
+  bool rfidOff = f & PW_RFID_OFF;
+  if (rfidOff && powerRfidOn)       { rfid.PCD_SoftPowerDown(); powerRfidOn = false; }
+  else if (!rfidOff && !powerRfidOn) { rfid.PCD_SoftPowerUp();   powerRfidOn = true; }
+
+  bool save = (f & PW_MODEM_SLEEP) && !C4_ESPNOW;   // ESP-NOW frames need the receiver on
+  if (save != wifiPowerSave) {
+    wifiPowerSave = save;
+    if (WiFi.getMode() != WIFI_OFF) WiFi.setSleep(save);
+  }
+
+  bool dark = f & PW_LEDS_OFF;
+  if (dark && !powerLedsDark()) {
+    fill_solid(leds, NUM_LEDS, CRGB::Black);
+    FastLED.show();
+    if (POWER_STRIP_EN_PIN >= 0) digitalWrite(POWER_STRIP_EN_PIN, LOW);
+  } else if (!dark && powerLedsDark() && POWER_STRIP_EN_PIN >= 0) {
+    digitalWrite(POWER_STRIP_EN_PIN, HIGH);
+  }
+  powerLedRecalc();
+
+  powerState = s;
+  powerFlags = f;
+  LOG_D("[PWR] %s: rfid %s, leds %s, modem sleep %s, light sleep %s", getStateName((PropState)s),
+        powerRfidOn ? "on" : "off", dark ? "off" : "on", save ? "on" : "off", (f & PW_LIGHT_SLEEP) ? "allowed" : "no");
+}
+
+// What every load draws now, from what it is doing
+inline PowerDraw powerEstimate(bool asleep) {
+  PowerDraw d;
+  d.ma[PL_CPU] = asleep ? POWER_MA_CPU_LIGHT_SLEEP : POWER_MA_CPU_ACTIVE;
+  int mode = WiFi.getMode();
+  d.ma[PL_WIFI] = mode == WIFI_OFF ? 0 : ((mode & WIFI_MODE_AP) || !wifiPowerSave) ? POWER_MA_WIFI_ON : POWER_MA_WIFI_MODEM_SLEEP;
+  d.ma[PL_LCD] = POWER_MA_LCD;
+  d.ma[PL_RFID] = powerRfidOn ? POWER_MA_RFID_ON : POWER_MA_RFID_SOFT_DOWN;
+  d.ma[PL_LEDS] = (powerLedsDark() && POWER_STRIP_EN_PIN >= 0) ? 0 : powerLedMaNow;
+
+  uint32_t now = millis();
+  uint32_t sinceEntry = gameMsSince(stateEnteredUs);
+  bool blast = currentState == PRE_EXPLOSION && sinceEntry >= PRE_EXPLOSION_BLAST_MS &&
+               sinceEntry < PRE_EXPLOSION_BLAST_MS + POWER_BLAST_AUDIO_MS;
+  d.ma[PL_AUDIO] = !settings.sound_enabled                          ? POWER_MA_AUDIO_IDLE
+                 : blast                                           ? POWER_MA_AUDIO_PEAK
+                 : now - lastAudioCmdTime < POWER_AUDIO_PLAY_MS    ? POWER_MA_AUDIO_PLAY
+                 :                                                   POWER_MA_AUDIO_IDLE;
+
+  // Every move of a sequence starts with a surge
+  if (ejectorMoves != powerLastMoves) {
+    powerServoMoveMs = now;
+    powerLastMoves = ejectorMoves;
+  }
+  d.ma[PL_SERVO] = ejectorState == EJECTOR_IDLE                      ? 0
+                 : now - powerServoMoveMs < POWER_SERVO_START_MS     ? POWER_MA_SERVO_START
+                 :                                                    POWER_MA_SERVO_ACTIVE;
+  d.ma[PL_BUZZER] = ledIsOn ? POWER_MA_BUZZER : 0;
+  return d;
+}
+
+// Display.h shows every frame at this: the configured brightness, dimmed to what LED_MAX_MA
+// and the other loads under the limit leave
+inline uint8_t powerLedBrightness() {
+  uint8_t b = powerLeds.frame((const uint8_t*)leds, FastLED.getBrightness(),
+                              powerLedShareMa(powerEstimate(false), powerLimitMa), currentState);
+  powerLedMaNow = powerLeds.lastMa > 0xFFFF ? 0xFFFF : (uint16_t)powerLeds.lastMa;
+  return b;
+}
+
+// The shell pop starts once its surge fits, or after POWER_STAGGER_MAX_MS regardless: a late
+// pop is better than none
+inline bool powerServoMayStart() {
+  uint32_t now = millis();
+  if (powerBudgetFits(powerEstimate(false), NUM_LEDS, POWER_MA_SERVO_START, powerLimitMa)) { powerServoWaitMs = 0; return true; }
+  if (powerServoWaitMs == 0) {
+    powerServoWaitMs = now | 1;
+    powerStaggers++;
+    LOG_I("[PWR] Shell pop held back: %u mA budget", (unsigned)powerLimitMa);
+  }
+  if (now - powerServoWaitMs < POWER_STAGGER_MAX_MS) return false;
+  powerServoWaitMs = 0;
+  return true;
+}
+
+inline void powerRailSample(uint32_t now) {
+  if (BATTERY_SENSE_PIN < 0 || now - powerLastRailMs < BATTERY_SAMPLE_MS) return;
+  powerLastRailMs = now;
+  powerRail.push((uint16_t)(analogReadMilliVolts(BATTERY_SENSE_PIN) * BATTERY_DIVIDER_X100 / 100));
+  powerLimitMa = powerBudgetDerate(powerBaseLimitMa, powerRail.floorMv);
+  metricRailMv = powerRail.mv;
+}
+
+// Why the prop cannot nap right now; nullptr = it can
+inline const char* powerNapBlocker(uint32_t now) {
+  if (!POWER_LIGHT_SLEEP)                          return "disabled (POWER_LIGHT_SLEEP=0)";
+  if (!(powerFlags & PW_LIGHT_SLEEP))              return "not in this state";
+  if (WiFi.getMode() != WIFI_OFF)                  return "WiFi on (modem sleep only)";
+  if (Serial)                                      return "USB serial monitor open";
+  if (gameplayLocked)                              return "firmware update running";
+  if (g_restartAtMs != 0)                          return "restart pending";
+  if (ejectorState != EJECTOR_IDLE)                return "ejector moving";
+  if (now - powerActiveMs < POWER_IDLE_GRACE_MS)   return "recent input";
+  return nullptr;
+}
+
+// Wake on whichever level the pin is not at now
+inline void powerWakeOnChange(uint8_t pin) {
+  gpio_wakeup_enable((gpio_num_t)digitalPinToGPIONumber(pin), digitalRead(pin) ? GPIO_INTR_LOW_LEVEL : GPIO_INTR_HIGH_LEVEL);
+}
+
+inline void powerNap() {
+  // Keypad: all columns low, so any key pulls its row low
+  for (uint8_t c = 0; c < KEYPAD_COLS; c++) { pinMode(COL_PINS[c], OUTPUT); digitalWrite(COL_PINS[c], LOW); }
+  for (uint8_t r = 0; r < KEYPAD_ROWS; r++) {
+    pinMode(ROW_PINS[r], INPUT_PULLUP);
+    gpio_wakeup_enable((gpio_num_t)digitalPinToGPIONumber(ROW_PINS[r]), GPIO_INTR_LOW_LEVEL);
+  }
+  powerWakeOnChange(ARM_SWITCH_PIN);
+  powerWakeOnChange(DISARM_BUTTON_PIN);
+  esp_sleep_enable_gpio_wakeup();
+  esp_sleep_enable_timer_wakeup((uint64_t)POWER_NAP_MAX_MS * 1000);
+
+  powerMeter.sample(currentState, powerEstimate(true), true, gameNowUs());
+  esp_light_sleep_start();
+  bool byInput = esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_GPIO;
+  powerMeter.sample(currentState, powerEstimate(false), false, gameNowUs());
+
+  esp_sleep_disable_wakeup_source(ESP_SLEEP_WAKEUP_GPIO);
+  esp_sleep_disable_wakeup_source(ESP_SLEEP_WAKEUP_TIMER);
+  for (uint8_t r = 0; r < KEYPAD_ROWS; r++) gpio_wakeup_disable((gpio_num_t)digitalPinToGPIONumber(ROW_PINS[r]));
+  gpio_wakeup_disable((gpio_num_t)digitalPinToGPIONumber(ARM_SWITCH_PIN));
+  gpio_wakeup_disable((gpio_num_t)digitalPinToGPIONumber(DISARM_BUTTON_PIN));
+  for (uint8_t c = 0; c < KEYPAD_COLS; c++) pinMode(COL_PINS[c], INPUT);   // as Keypad leaves them between scans
+
+  powerNaps++;
+  if (byInput) { powerInputWakes++; powerActiveMs = millis(); }   // stay up to handle it
+}
+
+// End of loop(): apply the policy on a state change, book the draw, nap if allowed
+inline void powerLoop(char key) {
+  uint32_t now = millis();
+  if (currentState != powerState) { powerApply(currentState); powerActiveMs = now; }
+  if (key || armSwitch.changed() || disarmButton.changed()) powerActiveMs = now;
+  powerRailSample(now);
+
+  powerMeter.sample(currentState, powerEstimate(false), false, gameNowUs());
+  metricPowerMa = powerMeter.draw.total();
+
+  if (!powerNapBlocker(now)) powerNap();
+}
+
+inline void powerReset() {
+  powerMeter.reset(gameNowUs());
+  powerNaps = powerInputWakes = powerStaggers = 0;
+  powerLeds.resetStats();
+  powerRail.minMv = 0xFFFF;
+}
+
+inline void powerPrintStatus(Print& out) {
+  const PowerDraw& d = powerMeter.draw;
+  const char* blocker = powerNapBlocker(millis());
+  out.printf("[PWR] now ~%u mA in %s:", (unsigned)d.total(), getStateName(currentState));
+  for (uint8_t i = 0; i < PL_COUNT; i++) out.printf(" %s=%u", POWER_LOAD_NAMES[i], (unsigned)d.ma[i]);
+  out.printf("\n[PWR] naps=%u input_wakes=%u light_sleep=%s pack=%u mAh\n", (unsigned)powerNaps,
+             (unsigned)powerInputWakes, blocker ? blocker : "now", (unsigned)POWER_PACK_MAH);
+  out.printf("[PWR] budget=%u mA (base %u) led_max=%u mA staggered_pops=%u\n",
+             (unsigned)powerLimitMa, (unsigned)powerBaseLimitMa, (unsigned)LED_MAX_MA, (unsigned)powerStaggers);
+  if (BATTERY_SENSE_PIN >= 0)
+    out.printf("[PWR] rail=%u mV floor=%u mV min=%u mV\n", (unsigned)powerRail.mv, (unsigned)powerRail.floorMv,
+               (unsigned)(powerRail.minMv == 0xFFFF ? 0 : powerRail.minMv));
+  out.printf("%-17s %8s %6s %6s %6s %6s", "state", "time_s", "avg", "peak", "sleep%", "pack_h");
+  for (uint8_t i = 0; i < PL_COUNT; i++) out.printf(" %6s", POWER_LOAD_NAMES[i]);
+  out.println();
+  for (uint8_t s = 0; s < STATE_COUNT; s++) {
+    if (powerMeter.st[s].us == 0) continue;
+    uint32_t h10 = powerMeter.packHoursX10(s);
+    out.printf("%-17s %8u %6u %6u %6u %4u.%u", STATE_INFO[s].name, (unsigned)(powerMeter.st[s].us / 1000000),
+               (unsigned)powerMeter.avgMa(s), (unsigned)powerMeter.st[s].peakMa, (unsigned)powerMeter.sleepPct(s),
+               (unsigned)(h10 / 10), (unsigned)(h10 % 10));
+    for (uint8_t i = 0; i < PL_COUNT; i++) out.printf(" %6u", (unsigned)powerMeter.avgMa(s, i));
+    out.println();
+  }
+  out.printf("%-17s %8s %6s %6s %6s %7s\n", "leds", "frames", "avg", "peak", "demand", "dimmed%");
+  for (uint8_t s = 0; s < STATE_COUNT; s++) {
+    const LedStateStats& x = powerLeds.st[s];
+    if (x.frames == 0) continue;
+    out.printf("%-17s %8u %6u %6u %6u %7u\n", STATE_INFO[s].name, (unsigned)x.frames, (unsigned)powerLeds.avgMa(s),
+               (unsigned)x.peakMa, (unsigned)x.peakDemandMa, (unsigned)((uint64_t)x.dimmed * 100 / x.frames));
+  }
+}
@@ -0,0 +1,91 @@
+// PowerBudget.h
+// VERSION: 1.1.0
+// CHANGED: powerLedDim() replaced by powerLedShareMa(); LedLimiter.h does the dimming
+// Keeps the estimated supply current (PowerModel.h) under a limit. The strobe, the shell pop
+// and the blast sound all land at the same moment of PRE_EXPLOSION, and on a weak pack the
+// sum pulls the 5 V rail below the ESP32's brownout threshold. Loads are served in order of
+// how little they can give:
+//   1. CPU, WiFi, LCD, RFID, buzzer and audio take what they draw
+//   2. a servo move waits, for up to POWER_STAGGER_MAX_MS, until its start-up surge fits
+//   3. the LEDs get what is left: the frame is dimmed, never recoloured (LedLimiter.h)
+// The limit is derated from the 5 V rail as the ADC sees it (BatteryFilter). It is the full
+// limit at BATTERY_OK_MV and POWER_BUDGET_LOW_PCT of it at BATTERY_LOW_MV and below. Pure
+// C++11 so tools/power_budget.cpp runs it on the host.
+
+#pragma once
+#include <stdint.h>
+#include "PowerModel.h"
+
+// --- DIALS ---
+#ifndef POWER_BUDGET_MA
+  #define POWER_BUDGET_MA            1800   // peak the supply can deliver without sagging
+#endif
+#ifndef POWER_BUDGET_LOW_PCT
+  #define POWER_BUDGET_LOW_PCT       60     // share of the limit left on a weak pack
+#endif
+#ifndef POWER_BUDGET_BROWNOUT_PCT
+  #define POWER_BUDGET_BROWNOUT_PCT  75     // for the rest of a boot that followed a brownout reset
+#endif
+#ifndef POWER_STAGGER_MAX_MS
+  #define POWER_STAGGER_MAX_MS       700    // longest a servo move is held back
+#endif
+#ifndef BATTERY_OK_MV
+  #define BATTERY_OK_MV              4900   // rail voltage with full headroom
+#endif
+#ifndef BATTERY_LOW_MV
+  #define BATTERY_LOW_MV             4500   // rail voltage where the pack is about to brown out
+#endif
+
+// Rail voltage from raw ADC mV readings. A median of 3 drops single-sample spikes. mv is a
+// slow average for display. floorMv drops with a dip at once and recovers slowly, so the
+// budget reacts to a sag in one sample and does not bounce back between strobe flashes.
+struct BatteryFilter {
+  uint16_t last[3];
+  uint8_t  head, count;
+  uint32_t avgX16;     // mv * 16
+  uint16_t mv;
+  uint16_t floorMv;
+  uint16_t minMv;      // lowest median since reset
+
+  void reset() { head = count = 0; avgX16 = 0; mv = floorMv = 0; minMv = 0xFFFF; last[0] = last[1] = last[2] = 0; }
+
+  void push(uint16_t sampleMv) {
+    last[head] = sampleMv;
+    head = (uint8_t)((head + 1) % 3);
+    if (count < 3) count++;
+    uint16_t a = last[0], b = last[1], c = last[2];
+    uint16_t med = count < 3 ? sampleMv
+                 : (a > b) ? ((b > c) ? b : (a > c) ? c : a)
+                           : ((a > c) ? a : (b > c) ? c : b);
+    if (avgX16 == 0) { avgX16 = (uint32_t)med * 16; floorMv = med; }
+    avgX16 = avgX16 - avgX16 / 8 + (uint32_t)med * 2;                 // alpha 1/8
+    mv = (uint16_t)(avgX16 / 16);
+    if (med <= floorMv) floorMv = med;
+    else floorMv = (uint16_t)(floorMv + (med - floorMv + 15) / 16);   // ~1 s to recover at 20 ms
+    if (med < minMv) minMv = med;
+  }
+};
+
+// The limit at a rail voltage (0 = not measured: full limit)
+inline uint32_t powerBudgetDerate(uint32_t limitMa, uint16_t railMv) {
+  if (railMv == 0 || railMv >= BATTERY_OK_MV) return limitMa;
+  uint32_t low = limitMa * POWER_BUDGET_LOW_PCT / 100;
+  if (railMv <= BATTERY_LOW_MV) return low;
+  return low + (limitMa - low) * (railMv - BATTERY_LOW_MV) / (BATTERY_OK_MV - BATTERY_LOW_MV);
+}
+
+// Everything but the LEDs, plus the strip's quiescent draw (dimming cannot save that)
+inline uint32_t powerFixedMa(const PowerDraw& d, uint16_t ledCount) {
+  return d.total() - d.ma[PL_LEDS] + powerLedIdleMa(ledCount);
+}
+
+// A load of extraMa can start now without the LEDs dropping below their quiescent draw
+inline bool powerBudgetFits(const PowerDraw& d, uint16_t ledCount, uint32_t extraMa, uint32_t limitMa) {
+  return powerFixedMa(d, ledCount) + extraMa <= limitMa;
+}
+
+// LED current (quiescent included) the other loads leave under the limit
+inline uint32_t powerLedShareMa(const PowerDraw& d, uint32_t limitMa) {
+  uint32_t others = d.total() - d.ma[PL_LEDS];
+  return others < limitMa ? limitMa - others : 0;
+}
@@ -0,0 +1,162 @@
+// PowerModel.h
+// VERSION: 1.1.0
+// ADDED: servo start surge, audio peak and powerLedIdleMa() for the power budget (PowerBudget.h)
+// Estimated supply current, per load and per game state. The board has no current sense, so
+// each load reports a typical draw for what it is doing right now (the LEDs from the frame
+// content) and PowerMeter integrates the sum over time into the state the prop is in. A change
+// to the power policy (Power.h) shows up as a lower average in that state's row. Pure C++11
+// on top of GameClock.h and StateTable.h so host tools can run it.
+//
+// The figures are datasheet/bench typicals at the 5 V input. Calibrate the dials against a USB
+// meter if the runtime projection matters.
+
+#pragma once
+#include <stdint.h>
+#include "GameClock.h"
+#include "StateTable.h"
+
+// --- DIALS (mA at the 5 V input) ---
+#ifndef POWER_MA_CPU_ACTIVE
+  #define POWER_MA_CPU_ACTIVE       40    // ESP32-S3 at 240 MHz spinning loop()
+#endif
+#ifndef POWER_MA_CPU_LIGHT_SLEEP
+  #define POWER_MA_CPU_LIGHT_SLEEP  2     // light sleep, regulator quiescent included
+#endif
+#ifndef POWER_MA_WIFI_ON
+  #define POWER_MA_WIFI_ON          95    // receiver always on (WiFi.setSleep(false)) or AP portal
+#endif
+#ifndef POWER_MA_WIFI_MODEM_SLEEP
+  #define POWER_MA_WIFI_MODEM_SLEEP 25    // modem sleep, averaged over the DTIM interval
+#endif
+#ifndef POWER_MA_LCD
+  #define POWER_MA_LCD              25    // 20x4 with backlight
+#endif
+#ifndef POWER_MA_RFID_ON
+  #define POWER_MA_RFID_ON          26    // RC522 with the antenna field on
+#endif
+#ifndef POWER_MA_RFID_SOFT_DOWN
+  #define POWER_MA_RFID_SOFT_DOWN   0     // soft power-down, ~10 µA
+#endif
+#ifndef POWER_UA_LED_IDLE
+  #define POWER_UA_LED_IDLE         700   // µA per WS2812B with all channels at 0
+#endif
+#ifndef POWER_MA_LED_CHANNEL
+  #define POWER_MA_LED_CHANNEL      20    // one channel at 255 after brightness
+#endif
+#ifndef POWER_MA_AUDIO_IDLE
+  #define POWER_MA_AUDIO_IDLE       20    // DFPlayer Mini powered, not playing
+#endif
+#ifndef POWER_MA_AUDIO_PLAY
+  #define POWER_MA_AUDIO_PLAY       120   // playing into a small speaker, average
+#endif
+#ifndef POWER_MA_AUDIO_PEAK
+  #define POWER_MA_AUDIO_PEAK       300   // loud passage (the blast) into the speaker
+#endif
+#ifndef POWER_MA_SERVO_ACTIVE
+  #define POWER_MA_SERVO_ACTIVE     150   // attached: moving or holding against the shell
+#endif
+#ifndef POWER_MA_SERVO_START
+  #define POWER_MA_SERVO_START      650   // surge for the first POWER_SERVO_START_MS of a move
+#endif
+#ifndef POWER_SERVO_START_MS
+  #define POWER_SERVO_START_MS      250
+#endif
+#ifndef POWER_MA_BUZZER
+  #define POWER_MA_BUZZER           30
+#endif
+#ifndef POWER_PACK_MAH
+  #define POWER_PACK_MAH            5000  // battery pack, for the runtime column
+#endif
+
+enum PowerLoad : uint8_t { PL_CPU, PL_WIFI, PL_LCD, PL_RFID, PL_LEDS, PL_AUDIO, PL_SERVO, PL_BUZZER, PL_COUNT };
+
+static constexpr const char* POWER_LOAD_NAMES[] = { "cpu", "wifi", "lcd", "rfid", "leds", "audio", "servo", "buzzer" };
+static_assert(sizeof(POWER_LOAD_NAMES) / sizeof(POWER_LOAD_NAMES[0]) == PL_COUNT, "POWER_LOAD_NAMES needs one name per PowerLoad");
+
+// What each load draws right now, mA
+struct PowerDraw {
+  uint16_t ma[PL_COUNT];
+
+  uint32_t total() const {
+    uint32_t t = 0;
+    for (uint8_t i = 0; i < PL_COUNT; i++) t += ma[i];
+    return t;
+  }
+};
+
+inline uint32_t powerLedIdleMa(uint16_t count) { return (uint32_t)count * POWER_UA_LED_IDLE / 1000; }
+
+// Strip current from the frame: every pixel's quiescent draw plus each channel's share of
+// POWER_MA_LED_CHANNEL after the global brightness. rgb is count * 3 bytes (CRGB layout).
+inline uint32_t powerLedMa(const uint8_t* rgb, uint16_t count, uint8_t brightness) {
+  uint32_t sum = 0;
+  for (uint32_t i = 0; i < (uint32_t)count * 3; i++) sum += rgb[i];
+  uint64_t ch = (uint64_t)sum * ((uint32_t)brightness + 1) * POWER_MA_LED_CHANNEL / (256u * 255u);
+  return powerLedIdleMa(count) + (uint32_t)ch;
+}
+
+struct PowerStateStats {
+  uint64_t us;                 // time spent in the state
+  uint64_t sleepUs;            // the part of it in light sleep
+  uint64_t maUs[PL_COUNT];     // charge per load, mA·µs
+  uint16_t peakMa;             // highest total draw seen in the state
+};
+
+// One row per PropState. sample() books the time since the previous call at the previous
+// draw, then takes the new one, so call it whenever the draw or the state changes (and before
+// and after a light sleep).
+struct PowerMeter {
+  PowerStateStats st[STATE_COUNT];
+  PowerDraw draw;
+  uint8_t   state;
+  bool      asleep;
+  GameUs    lastUs;
+
+  void reset(GameUs now) {
+    for (uint8_t s = 0; s < STATE_COUNT; s++) {
+      st[s].us = st[s].sleepUs = 0;
+      for (uint8_t i = 0; i < PL_COUNT; i++) st[s].maUs[i] = 0;
+      st[s].peakMa = 0;
+    }
+    for (uint8_t i = 0; i < PL_COUNT; i++) draw.ma[i] = 0;
+    state = 0;
+    asleep = false;
+    lastUs = now;
+  }
+
+  void sample(uint8_t s, const PowerDraw& d, bool sleeping, GameUs now) {
+    if (now > lastUs && state < STATE_COUNT) {
+      uint64_t dt = now - lastUs;
+      PowerStateStats& x = st[state];
+      x.us += dt;
+      if (asleep) x.sleepUs += dt;
+      for (uint8_t i = 0; i < PL_COUNT; i++) x.maUs[i] += (uint64_t)draw.ma[i] * dt;
+      lastUs = now;
+    }
+    state = s;
+    draw = d;
+    asleep = sleeping;
+    uint32_t t = d.total();
+    if (s < STATE_COUNT && t > st[s].peakMa) st[s].peakMa = t > 0xFFFF ? 0xFFFF : (uint16_t)t;
+  }
+
+  // Average mA of one load in state s, or of all of them with PL_COUNT. 0 if s never ran.
+  uint32_t avgMa(uint8_t s, uint8_t load = PL_COUNT) const {
+    if (s >= STATE_COUNT || st[s].us == 0) return 0;
+    uint64_t q = 0;
+    for (uint8_t i = 0; i < PL_COUNT; i++) if (load == PL_COUNT || load == i) q += st[s].maUs[i];
+    return (uint32_t)((q + st[s].us / 2) / st[s].us);
+  }
+
+  // Percent of the time in state s spent in light sleep
+  uint8_t sleepPct(uint8_t s) const {
+    if (s >= STATE_COUNT || st[s].us == 0) return 0;
+    return (uint8_t)(st[s].sleepUs * 100 / st[s].us);
+  }
+
+  // Hours x10 a pack lasts at state s's average. 0 if the state never ran.
+  uint32_t packHoursX10(uint8_t s, uint32_t mah = POWER_PACK_MAH) const {
+    uint32_t a = avgMa(s);
+    return a ? mah * 10 / a : 0;
+  }
+};
@@ -0,0 +1,161 @@
+// Profiler.h
+// VERSION: 1.0.1
+// FIXED: <Arduino.h> only on the device, so the steady_clock fallback builds on a host
+//        (tools/profiler_host.cpp); the Print/String reporting stays device-only
+// Hot-path cycle counters for loop() subsystems.
+// Probes compile out completely unless C4_PROFILE is set to 1.
+
+#pragma once
+#include <stdint.h>
+#include <string.h>
+#if defined(ARDUINO)
+  #include <Arduino.h>
+#endif
+
+#ifndef C4_PROFILE
+  #define C4_PROFILE 0   // 0 = release (no probes), 1 = debug build with probes
+#endif
+
+#if !defined(ARDUINO)
+  #include <chrono>
+#endif
+
+// --- PROBE IDS ---
+// Order must match PROF_NAMES below.
+enum ProfProbe : uint8_t {
+  PROF_KEYPAD,     // keypad.getKey()
+  PROF_DFPLAYER,   // DFPlayer available()/read()/printDetail()
+  PROF_GAMEPLAY,   // serviceGameplay()
+  PROF_DISPLAY,    // updateDisplay()
+  PROF_LEDS,       // updateLeds() incl. FastLED.show()
+  PROF_NETWORK,    // networkLoop() total
+  PROF_WS_LOOP,    // wsClient.loop() only
+  PROF_RFID,       // handleRfid()
+  PROF_COUNT
+};
+
+static const char* const PROF_NAMES[PROF_COUNT] = {
+  "keypad", "dfplayer", "gameplay", "display", "leds", "network", "ws_loop", "rfid"
+};
+
+// Log2 bins in microseconds: bin 0 = <1us, bin k = [2^(k-1), 2^k) us.
+// The last bin catches everything >= 2^(PROF_BINS-2) us (~262 ms).
+static const uint8_t PROF_BINS = 20;
+
+// --- TIME SOURCE ---
+// Device: CPU cycle counter (CCOUNT). Host: steady_clock nanoseconds.
+inline uint32_t profTicks() {
+#if defined(ARDUINO)
+  return ESP.getCycleCount();
+#else
+  return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+           std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+inline uint32_t profTicksPerUs() {
+#if defined(ARDUINO)
+  return getCpuFrequencyMhz();
+#else
+  return 1000;
+#endif
+}
+
+#if C4_PROFILE
+
+struct ProfStat {
+  uint32_t count;
+  uint32_t minUs;
+  uint32_t maxUs;
+  uint64_t sumUs;
+  uint32_t bins[PROF_BINS];
+};
+
+static ProfStat profStats[PROF_COUNT];
+
+inline uint8_t profBinFor(uint32_t us) {
+  uint8_t b = us ? (uint8_t)(32 - __builtin_clz(us)) : 0;
+  return (b < PROF_BINS) ? b : (PROF_BINS - 1);
+}
+
+inline void profRecord(ProfProbe p, uint32_t ticks) {
+  uint32_t us = ticks / profTicksPerUs();
+  ProfStat& s = profStats[p];
+  if (s.count == 0 || us < s.minUs) s.minUs = us;
+  if (us > s.maxUs) s.maxUs = us;
+  s.count++;
+  s.sumUs += us;
+  s.bins[profBinFor(us)]++;
+}
+
+// Upper edge of the bin holding the 99th percentile sample (clamped to max).
+inline uint32_t profP99(const ProfStat& s) {
+  if (s.count == 0) return 0;
+  uint32_t target = s.count - s.count / 100;
+  uint32_t seen = 0;
+  for (uint8_t b = 0; b < PROF_BINS; b++) {
+    seen += s.bins[b];
+    if (seen >= target) {
+      uint32_t edge = (b == 0) ? 1 : (1UL << b);
+      return (edge < s.maxUs) ? edge : s.maxUs;
+    }
+  }
+  return s.maxUs;
+}
+
+inline void profReset() { memset(profStats, 0, sizeof(profStats)); }
+
+class ProfScope {
+ public:
+  explicit ProfScope(ProfProbe p) : probe_(p), start_(profTicks()) {}
+  ~ProfScope() { profRecord(probe_, profTicks() - start_); }
+ private:
+  ProfProbe probe_;
+  uint32_t start_;
+};
+
+#define PROF_CAT2(a, b) a##b
+#define PROF_CAT(a, b)  PROF_CAT2(a, b)
+#define PROF_SCOPE(p)   ProfScope PROF_CAT(_profScope, __LINE__)(p)
+
+// --- REPORTING ---
+#if defined(ARDUINO)
+inline void profPrintTable(Print& out) {
+  out.printf("%-10s %8s %8s %8s %8s %8s\n", "probe", "count", "min_us", "avg_us", "p99_us", "max_us");
+  for (uint8_t i = 0; i < PROF_COUNT; i++) {
+    const ProfStat& s = profStats[i];
+    uint32_t avg = s.count ? (uint32_t)(s.sumUs / s.count) : 0;
+    out.printf("%-10s %8u %8u %8u %8u %8u\n", PROF_NAMES[i],
+               (unsigned)s.count, (unsigned)s.minUs, (unsigned)avg,
+               (unsigned)profP99(s), (unsigned)s.maxUs);
+  }
+}
+
+inline String profToJson() {
+  String j = F("{\"type\":\"prof\",\"enabled\":true,\"probes\":[");
+  for (uint8_t i = 0; i < PROF_COUNT; i++) {
+    const ProfStat& s = profStats[i];
+    uint32_t avg = s.count ? (uint32_t)(s.sumUs / s.count) : 0;
+    char buf[128];
+    snprintf(buf, sizeof(buf),
+             "%s{\"name\":\"%s\",\"n\":%u,\"min_us\":%u,\"avg_us\":%u,\"p99_us\":%u,\"max_us\":%u}",
+             i ? "," : "", PROF_NAMES[i], (unsigned)s.count, (unsigned)s.minUs,
+             (unsigned)avg, (unsigned)profP99(s), (unsigned)s.maxUs);
+    j += buf;
+  }
+  j += "]}";
+  return j;
+}
+#endif // ARDUINO
+
+#else  // !C4_PROFILE
+
+#define PROF_SCOPE(p) do {} while (0)
+
+inline void profReset() {}
+#if defined(ARDUINO)
+inline void profPrintTable(Print& out) { out.println("[PROF] Disabled (build with C4_PROFILE=1)."); }
+inline String profToJson() { return String(F("{\"type\":\"prof\",\"enabled\":false}")); }
+#endif // ARDUINO
+
+#endif // C4_PROFILE
@@ -0,0 +1,150 @@
+// RoundControl.h
+// VERSION: 1.1.0
+// FIXED: a started round's values were left in settings and saved by the next saveSettings();
+//        they are an overlay now, lifted when the prop enters STANDBY
+// FIXED: manual/rfid disarm times were not range-checked and dud_chance 0 was refused; every
+//        value is checked against SETTINGS_FIELDS (RoundPlan.h)
+// ADDED: a resent config of the staged round is acked again; older round ids are rejected
+// CHANGED: Start states come from the StateTable.h round_start edges
+// CHANGED: No round start while a firmware update holds the gameplay lock
+// CHANGED: Logs go through Log.h
+// Remote round orchestration: the scoreboard pushes a round config + a start instant
+// to many props; each stages it in RAM and goes PROP_IDLE at that instant.
+//
+//   {"type":"round_config","round":12,"token":"...","start_at":<board ms>,   (or "start_in":<ms>)
+//    "bomb_ms":40000,"manual_disarm_ms":10000,"rfid_disarm_ms":5000,
+//    "fixed_code":"7355608" ("" = any code),"sudden_death":0,"dud_enabled":1,"dud_chance":5}
+//   {"type":"round_cancel","round":12,"token":"..."}
+//
+// Acks: {"type":"round_ack","round":12,"phase":"staged"|"started"|"cancelled"|"rejected",...}
+// start_at is on the scoreboard clock and is mapped with the ClockSync offset (board = prop + off).
+// Round ids must grow per scoreboard connection; a lower one is "stale_round".
+// Staged and running values never reach EEPROM (Config.h settingsBase keeps the referee's).
+// The checks themselves are in RoundPlan.h (host-tested by tools/round_plan.cpp).
+
+#pragma once
+#include <Arduino.h>
+#include "Config.h"
+#include "State.h"
+#include "JsonLite.h"
+#include "WsCommands.h"
+#include "RoundPlan.h"
+
+static_assert(SETTINGS_CODE_LEN == CODE_LENGTH, "fixed_code_val must hold CODE_LENGTH digits");
+
+static RoundConfig roundStaged;
+static uint32_t    roundActiveId = 0;
+static uint32_t    roundLastId = 0;    // highest id staged on this scoreboard connection
+
+inline void roundAck(uint32_t id, const char* phase, const char* err, const char* extra = nullptr) {
+  char buf[192];
+  snprintf(buf, sizeof(buf), "{\"type\":\"round_ack\",\"round\":%u,\"phase\":\"%s\"%s%s%s%s}",
+           (unsigned)id, phase, err ? ",\"err\":\"" : "", err ? err : "", err ? "\"" : "", extra ? extra : "");
+  wsSendJson(String(buf));
+  LOG_I("[ROUND] %u %s%s%s", (unsigned)id, phase, err ? ": " : "", err ? err : "");
+}
+
+inline bool roundGetU32(const char* js, const JsonTok* toks, int n, const char* key, uint32_t& out) {
+  int i = jsonFind(js, toks, n, 0, key);
+  return i >= 0 && jsonU32(js, toks[i], out);
+}
+
+inline bool roundCanStart() {
+  if (gameplayLocked) return false;
+  return stateAccepts(EV_ROUND_START);
+}
+
+// Scoreboard connected: its round ids start over
+inline void roundLinkUp() { roundLastId = 0; }
+
+inline void roundAckStaged(const RoundConfig& rc) {
+  char extra[48];
+  snprintf(extra, sizeof(extra), ",\"start_in_ms\":%d", (int)(rc.startLocalMs - millis()));
+  roundAck(rc.id, "staged", nullptr, extra);
+}
+
+// Returns true if msg was a round message. offset/rtt come from the ClockSync estimator.
+inline bool roundHandleMessage(char* msg, size_t len, bool hasOffset, int32_t offsetMs, uint32_t rttMs) {
+  if (!msg || !strstr(msg, "\"round_")) return false;
+
+  JsonTok toks[WS_CMD_MAX_TOKENS];
+  int n = jsonTokenize(msg, len, toks, WS_CMD_MAX_TOKENS);
+  if (n < 1 || toks[0].type != JSON_OBJECT) return false;
+  int t = jsonFind(msg, toks, n, 0, "type");
+  if (t < 0) return false;
+  bool isConfig = jsonEq(msg, toks[t], "round_config");
+  bool isCancel = jsonEq(msg, toks[t], "round_cancel");
+  if (!isConfig && !isCancel) return false;
+
+  uint32_t id = 0;
+  if (!roundGetU32(msg, toks, n, "round", id) || id == 0) { roundAck(0, "rejected", "bad_round"); return true; }
+  int ki = jsonFind(msg, toks, n, 0, "token");
+  if (!wsCmdTokenOk(msg, ki >= 0 ? &toks[ki] : nullptr)) {
+    roundAck(id, "rejected", settings.cmd_token[0] ? "auth" : "no_token_set");
+    return true;
+  }
+
+  if (isCancel) {
+    if (roundStaged.pending && roundStaged.id == id) {
+      roundStaged.pending = false;
+      roundAck(id, "cancelled", nullptr);
+    } else {
+      roundAck(id, "rejected", "not_staged");
+    }
+    return true;
+  }
+
+  switch (roundIdCheck(id, roundLastId, roundStaged)) {
+    case RID_DUPLICATE: roundAckStaged(roundStaged); return true;   // our ack was lost: same start
+    case RID_STALE:     roundAck(id, "rejected", "stale_round"); return true;
+    case RID_NEW:       break;
+  }
+
+  RoundConfig rc;
+  memset(&rc, 0, sizeof(rc));
+  rc.id = id;
+  int32_t lead = 0;
+  const char* err = roundParse(msg, toks, n, hasOffset, offsetMs, rttMs, millis(), rc, lead);
+  if (err) { roundAck(id, "rejected", err); return true; }
+
+  rc.pending = true;
+  roundStaged = rc;
+  roundLastId = id;
+  roundAckStaged(rc);
+  return true;
+}
+
+inline void roundApply(const RoundConfig& rc) {
+  resetSpecialModes();   // undo code-specific overrides (stored_duration_ram) first
+  settingsEndRound();    // back to back rounds: start from the referee's values
+  roundOverlayBegin(settings, settingsBase, settingsApplied, rc);
+  settingsOverlay = rc.fields;
+}
+
+// Call every loop iteration; fires the staged round on time.
+inline void roundPump() {
+  if (!roundStaged.pending) return;
+  uint32_t now = millis();
+  int32_t late = (int32_t)(now - roundStaged.startLocalMs);
+  if (late < 0) return;
+
+  roundStaged.pending = false;
+  if (!roundCanStart()) { roundAck(roundStaged.id, "rejected", "busy"); return; }
+
+  roundApply(roundStaged);
+  roundActiveId = roundStaged.id;
+  stateFire(EV_ROUND_START);
+  displayNeedsUpdate = true;
+  char extra[48];
+  snprintf(extra, sizeof(extra), ",\"late_ms\":%d", (int)late);
+  roundAck(roundStaged.id, "started", nullptr, extra);
+}
+
+inline void roundPrintStatus(Print& out) {
+  if (roundStaged.pending) {
+    out.printf("[ROUND] staged=%u starts in %d ms, active=%u%s\n", (unsigned)roundStaged.id,
+               (int)(roundStaged.startLocalMs - millis()), (unsigned)roundActiveId, settingsOverlay ? ", round settings on" : "");
+  } else {
+    out.printf("[ROUND] nothing staged, active=%u%s\n", (unsigned)roundActiveId, settingsOverlay ? ", round settings on" : "");
+  }
+}
@@ -0,0 +1,143 @@
+// RoundPlan.h
+// VERSION: 1.0.0
+// The checks and bookkeeping behind remote rounds (RoundControl.h), free of Arduino calls so
+// tools/round_plan.cpp can run them with injected clocks and offsets:
+//   - start instant: board clock -> millis(), refused if too far out or already too late
+//   - round ids: a resent config of the staged round is a duplicate (acked again, not
+//     restaged); an id at or below the last one staged on this connection is stale
+//   - settings: each round key maps onto a SETTINGS_FIELDS row and is checked against its
+//     range, exactly like PATCH /api/settings
+//   - overlay: a started round writes its values over settings; the referee's stay in a
+//     snapshot. Saving while the overlay is on writes the snapshot's values (or an edit made
+//     since), and ending the round puts them back.
+
+#pragma once
+#include <stdint.h>
+#include <string.h>
+#include "JsonLite.h"
+#include "SettingsFields.h"
+
+static const uint32_t ROUND_MAX_LEAD_MS = 600000;  // refuse starts further out than 10 min
+static const uint32_t ROUND_MAX_LATE_MS = 2000;    // refuse starts that are already this stale
+
+enum RoundField : uint8_t {
+  RF_BOMB = 1 << 0, RF_MANUAL = 1 << 1, RF_RFID = 1 << 2, RF_CODE = 1 << 3,
+  RF_SUDDEN = 1 << 4, RF_DUD = 1 << 5, RF_DUD_CHANCE = 1 << 6, RF_CODE_ON = 1 << 7
+};
+
+// Round message key -> settings member
+struct RoundKey { const char* key; const char* setting; uint8_t bit; };
+
+static const RoundKey ROUND_KEYS[] = {
+  { "bomb_ms",          "bomb_duration_ms",      RF_BOMB },
+  { "manual_disarm_ms", "manual_disarm_time_ms", RF_MANUAL },
+  { "rfid_disarm_ms",   "rfid_disarm_time_ms",   RF_RFID },
+  { "sudden_death",     "sudden_death_mode",     RF_SUDDEN },
+  { "dud_enabled",      "dud_enabled",           RF_DUD },
+  { "dud_chance",       "dud_chance",            RF_DUD_CHANCE },
+  { "fixed_code",       "fixed_code_val",        RF_CODE },      // "" = any code
+  { nullptr,            "fixed_code_enabled",    RF_CODE_ON },   // set from fixed_code
+};
+static const size_t ROUND_KEY_COUNT = sizeof(ROUND_KEYS) / sizeof(ROUND_KEYS[0]);
+
+struct RoundConfig {
+  uint32_t id;
+  uint32_t startLocalMs;      // on our millis() clock
+  uint8_t  fields;            // RoundField bits present in the message
+  bool     pending;
+  Settings vals;              // the staged values, at their settings offsets
+};
+
+// Board timestamp -> our millis(). Wraps like millis(); offset is board - prop.
+inline uint32_t roundBoardToLocal(uint32_t boardMs, int32_t offsetMs) {
+  return boardMs - (uint32_t)offsetMs;
+}
+
+enum RoundIdCheck : uint8_t { RID_NEW, RID_DUPLICATE, RID_STALE };
+
+// lastId: highest id staged since the scoreboard link came up (0 = none)
+inline RoundIdCheck roundIdCheck(uint32_t id, uint32_t lastId, const RoundConfig& staged) {
+  if (staged.pending && id == staged.id) return RID_DUPLICATE;
+  if (id <= lastId) return RID_STALE;
+  return RID_NEW;
+}
+
+// Start instant and settings of a round_config into rc. now/offset/rtt are millis(), the
+// ClockSync offset (board - prop) and round trip. Returns nullptr, or the reason for "rejected".
+inline const char* roundParse(const char* js, const JsonTok* toks, int n, bool hasOffset, int32_t offsetMs,
+                              uint32_t rttMs, uint32_t now, RoundConfig& rc, int32_t& lead) {
+  uint32_t v = 0;
+  int i = jsonFind(js, toks, n, 0, "start_at");
+  if (i >= 0) {
+    if (!jsonU32(js, toks[i], v)) return "no_start";
+    if (!hasOffset) return "no_clock_sync";
+    rc.startLocalMs = roundBoardToLocal(v, offsetMs);
+  } else if ((i = jsonFind(js, toks, n, 0, "start_in")) >= 0 && jsonU32(js, toks[i], v)) {
+    rc.startLocalMs = now + v - rttMs / 2;       // the message spent ~rtt/2 in flight
+  } else {
+    return "no_start";
+  }
+  lead = (int32_t)(rc.startLocalMs - now);
+  if (lead > (int32_t)ROUND_MAX_LEAD_MS || lead < -(int32_t)ROUND_MAX_LATE_MS) return "bad_start";
+
+  // Settings: each optional, checked against the SETTINGS_FIELDS row it lands in
+  static char err[32];
+  for (size_t k = 0; k < ROUND_KEY_COUNT; k++) {
+    const RoundKey& rk = ROUND_KEYS[k];
+    if (!rk.key) continue;
+    int t = jsonFind(js, toks, n, 0, rk.key);
+    if (t < 0) continue;
+    const JsonField* f = settingsField(rk.setting);
+    if (rk.bit == RF_CODE && toks[t].type == JSON_STRING && jsonLen(toks[t]) == 0) {
+      rc.vals.fixed_code_enabled = 0;            // any code: the referee's code stays
+      rc.fields |= RF_CODE_ON;
+      continue;
+    }
+    uint32_t num = 0;
+    if (!f || !jsonFieldCheck(js, toks[t], *f, num)) {
+      snprintf(err, sizeof(err), "bad_%.24s", rk.key);
+      return err;
+    }
+    jsonFieldStore(&rc.vals, *f, js, toks[t], num);
+    rc.fields |= rk.bit;
+    if (rk.bit == RF_CODE) { rc.vals.fixed_code_enabled = 1; rc.fields |= RF_CODE_ON; }
+  }
+  return nullptr;
+}
+
+// Copies the members named by fields from one Settings to another
+inline void roundCopy(Settings& to, const Settings& from, uint8_t fields) {
+  for (size_t k = 0; k < ROUND_KEY_COUNT; k++) {
+    if (!(fields & ROUND_KEYS[k].bit)) continue;
+    const JsonField* f = settingsField(ROUND_KEYS[k].setting);
+    memcpy((uint8_t*)&to + f->offset, (const uint8_t*)&from + f->offset, f->size);
+  }
+}
+
+// The round's values over the referee's, which are kept in base (applied = what was written)
+inline void roundOverlayBegin(Settings& live, Settings& base, Settings& applied, const RoundConfig& rc) {
+  base = live;
+  roundCopy(live, rc.vals, rc.fields);
+  applied = live;
+}
+
+// What to save while the overlay is on: live, with the referee's value for every member the
+// round wrote. A member edited since (menu, PATCH, serial) keeps the edit, now and after the round.
+inline void roundOverlaySaveView(Settings& out, Settings& base, Settings& applied, uint8_t fields) {
+  for (size_t k = 0; k < ROUND_KEY_COUNT; k++) {
+    if (!(fields & ROUND_KEYS[k].bit)) continue;
+    const JsonField* f = settingsField(ROUND_KEYS[k].setting);
+    uint8_t* o = (uint8_t*)&out + f->offset;
+    uint8_t* b = (uint8_t*)&base + f->offset;
+    uint8_t* a = (uint8_t*)&applied + f->offset;
+    if (memcmp(o, a, f->size)) { memcpy(b, o, f->size); memcpy(a, o, f->size); }
+    memcpy(o, b, f->size);
+  }
+}
+
+// Round over: the referee's values (and edits made during the round) back in live
+inline void roundOverlayEnd(Settings& live, Settings& base, Settings& applied, uint8_t fields) {
+  Settings keep = live;
+  roundOverlaySaveView(keep, base, applied, fields);
+  roundCopy(live, keep, fields);
+}
@@ -0,0 +1,213 @@
+// ScoreboardResolver.h
+// VERSION: 1.0.0
+// Background mDNS discovery of the scoreboard with a TTL-aware cache.
+// Queries run on their own FreeRTOS task (core 0) so loop() never waits on mDNS.
+// Lookup order: _c4scoreboard._tcp service -> "scoreboard" A record -> last-good IPs -> static IP.
+
+#pragma once
+#include <Arduino.h>
+#include <WiFi.h>
+#include <ESPmDNS.h>
+#include <mdns.h>
+#include "Config.h"
+
+#ifndef SCOREBOARD_MDNS_SERVICE
+  #define SCOREBOARD_MDNS_SERVICE "_c4scoreboard"
+#endif
+#ifndef SCOREBOARD_MDNS_PROTO
+  #define SCOREBOARD_MDNS_PROTO "_tcp"
+#endif
+#ifndef SCOREBOARD_MDNS_HOST
+  #define SCOREBOARD_MDNS_HOST "scoreboard"
+#endif
+
+static const uint32_t RES_QUERY_TIMEOUT_MS = 1500;
+static const uint32_t RES_DEFAULT_TTL_S    = 120;   // A-record fallback (RFC 6762 host TTL)
+static const uint32_t RES_MIN_TTL_S        = 30;
+static const uint32_t RES_MAX_TTL_S        = 3600;
+static const uint32_t RES_RETRY_MS         = 5000;  // after a failed query
+static const uint8_t  RES_FALLBACKS        = 3;     // last-good IPs remembered
+
+enum ResolveSource : uint8_t {
+  RES_SRC_NONE, RES_SRC_SERVICE, RES_SRC_HOST, RES_SRC_LAST_GOOD, RES_SRC_STATIC
+};
+
+inline const char* resolveSourceName(uint8_t s) {
+  switch (s) {
+    case RES_SRC_SERVICE:   return "service";
+    case RES_SRC_HOST:      return "host";
+    case RES_SRC_LAST_GOOD: return "last_good";
+    case RES_SRC_STATIC:    return "static";
+    default:                return "none";
+  }
+}
+
+struct ResolverState {
+  uint32_t ip;              // raw IPAddress/lwIP order; 0 = nothing cached
+  uint16_t port;            // 0 = use settings.scoreboard_port
+  uint8_t  source;
+  uint32_t resolvedAtMs;
+  uint32_t ttlMs;
+  uint32_t generation;      // bumps whenever ip/port changes
+  uint32_t lastLatencyMs;
+  uint32_t samples;         // successful queries
+  uint32_t failures;        // failed queries
+  uint32_t lastGood[RES_FALLBACKS];
+  uint8_t  fallbackIdx;     // which fallback to hand out next when the cache is empty
+};
+
+static ResolverState resState;
+static portMUX_TYPE resMux = portMUX_INITIALIZER_UNLOCKED;
+static TaskHandle_t resTask = nullptr;
+static volatile bool resForce = false;
+
+// ---- Task side ----
+inline bool resQueryService(uint32_t& ip, uint16_t& port, uint32_t& ttlS) {
+  mdns_result_t* results = nullptr;
+  if (mdns_query_ptr(SCOREBOARD_MDNS_SERVICE, SCOREBOARD_MDNS_PROTO, RES_QUERY_TIMEOUT_MS, 4, &results) != ESP_OK || !results) {
+    return false;
+  }
+  bool found = false;
+  for (mdns_result_t* r = results; r && !found; r = r->next) {
+    for (mdns_ip_addr_t* a = r->addr; a; a = a->next) {
+      if (a->addr.type == ESP_IPADDR_TYPE_V4 && a->addr.u_addr.ip4.addr) {
+        ip = a->addr.u_addr.ip4.addr; port = r->port; ttlS = r->ttl; found = true;
+        break;
+      }
+    }
+    // SRV answered without an A record: chase the advertised hostname
+    if (!found && r->hostname) {
+      esp_ip4_addr_t addr;
+      if (mdns_query_a(r->hostname, RES_QUERY_TIMEOUT_MS, &addr) == ESP_OK && addr.addr) {
+        ip = addr.addr; port = r->port; ttlS = r->ttl; found = true;
+      }
+    }
+  }
+  mdns_query_results_free(results);
+  return found;
+}
+
+inline bool resQueryHost(uint32_t& ip) {
+  esp_ip4_addr_t addr;
+  if (mdns_query_a(SCOREBOARD_MDNS_HOST, RES_QUERY_TIMEOUT_MS, &addr) == ESP_OK && addr.addr) {
+    ip = addr.addr;
+    return true;
+  }
+  return false;
+}
+
+inline void resolverTask(void*) {
+  uint32_t nextQueryMs = 0;
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(1000));
+    if (!settings.net_use_mdns || !WiFi.isConnected()) continue;
+
+    uint32_t now = millis();
+    if (!resForce && (int32_t)(now - nextQueryMs) < 0) continue;
+    resForce = false;
+
+    uint32_t ip = 0, ttlS = RES_DEFAULT_TTL_S;
+    uint16_t port = 0;
+    uint8_t src = RES_SRC_NONE;
+    uint32_t t0 = millis();
+    if (resQueryService(ip, port, ttlS)) src = RES_SRC_SERVICE;
+    else if (resQueryHost(ip))           src = RES_SRC_HOST;
+    uint32_t latency = millis() - t0;
+
+    if (ttlS < RES_MIN_TTL_S) ttlS = RES_MIN_TTL_S;
+    if (ttlS > RES_MAX_TTL_S) ttlS = RES_MAX_TTL_S;
+
+    portENTER_CRITICAL(&resMux);
+    resState.lastLatencyMs = latency;
+    if (src != RES_SRC_NONE) {
+      if (ip != resState.ip || port != resState.port) resState.generation++;
+      resState.ip = ip;
+      resState.port = port;
+      resState.source = src;
+      resState.resolvedAtMs = millis();
+      resState.ttlMs = ttlS * 1000UL;
+      resState.samples++;
+    } else {
+      resState.failures++;
+    }
+    portEXIT_CRITICAL(&resMux);
+
+    // Refresh at 80% of TTL so a moved scoreboard is noticed before the entry expires
+    nextQueryMs = millis() + ((src != RES_SRC_NONE) ? (ttlS * 800UL) : RES_RETRY_MS);
+  }
+}
+
+// ---- Loop side (all non-blocking) ----
+inline void scoreboardResolverKick() {
+  resForce = true;
+  if (resTask) xTaskNotifyGive(resTask);
+}
+
+// Call once mDNS is up. Safe to call repeatedly.
+inline void scoreboardResolverStart() {
+  if (!resTask) {
+    xTaskCreatePinnedToCore(resolverTask, "c4_mdns", 4096, nullptr, 1, &resTask, 0);
+  }
+  scoreboardResolverKick();
+}
+
+// Current best address. Returns false only when there is nothing at all to try.
+inline bool scoreboardResolverGet(IPAddress& ip, uint16_t& port, uint8_t* source = nullptr) {
+  uint32_t raw = 0, now = millis();
+  uint16_t p = 0;
+  uint8_t src = RES_SRC_NONE;
+
+  portENTER_CRITICAL(&resMux);
+  if (resState.ip && (now - resState.resolvedAtMs) < resState.ttlMs) {
+    raw = resState.ip; p = resState.port; src = resState.source;
+  } else {
+    // Cache empty/expired: rotate through last-good IPs, then the static IP
+    uint8_t n = 0;
+    uint32_t cands[RES_FALLBACKS];
+    for (uint8_t i = 0; i < RES_FALLBACKS; i++) if (resState.lastGood[i]) cands[n++] = resState.lastGood[i];
+    uint8_t idx = resState.fallbackIdx % (n + 1);
+    if (idx < n) { raw = cands[idx]; src = RES_SRC_LAST_GOOD; }
+  }
+  portEXIT_CRITICAL(&resMux);
+
+  if (src == RES_SRC_NONE) {
+    if (!settings.scoreboard_ip) return false;
+    ip = IPAddress((settings.scoreboard_ip >> 24) & 0xFF, (settings.scoreboard_ip >> 16) & 0xFF,
+                   (settings.scoreboard_ip >> 8) & 0xFF, settings.scoreboard_ip & 0xFF);
+    src = RES_SRC_STATIC;
+  } else {
+    ip = IPAddress(raw);
+  }
+  port = p ? p : settings.scoreboard_port;
+  if (source) *source = src;
+  return true;
+}
+
+// Connection to the address we handed out failed: drop it and re-query now.
+inline void scoreboardResolverReportFailure() {
+  portENTER_CRITICAL(&resMux);
+  resState.resolvedAtMs = 0;
+  resState.ttlMs = 0;
+  resState.fallbackIdx++;
+  portEXIT_CRITICAL(&resMux);
+  scoreboardResolverKick();
+}
+
+// Connection succeeded: remember this IP at the front of the fallback list.
+inline void scoreboardResolverReportSuccess(const IPAddress& ip) {
+  uint32_t raw = (uint32_t)ip;
+  portENTER_CRITICAL(&resMux);
+  uint8_t j = RES_FALLBACKS - 1;
+  for (uint8_t i = 0; i < RES_FALLBACKS; i++) if (resState.lastGood[i] == raw) { j = i; break; }
+  for (; j > 0; j--) resState.lastGood[j] = resState.lastGood[j - 1];
+  resState.lastGood[0] = raw;
+  resState.fallbackIdx = 0;
+  portEXIT_CRITICAL(&resMux);
+}
+
+inline ResolverState scoreboardResolverSnapshot() {
+  portENTER_CRITICAL(&resMux);
+  ResolverState s = resState;
+  portEXIT_CRITICAL(&resMux);
+  return s;
+}
@@ -0,0 +1,164 @@
+// ServoMotion.h
+// VERSION: 1.0.0
+// Motion planner for the shell ejector servo. A sequence is a list of steps, each a move to a
+// point between the start and end angle followed by a hold. Each move follows a speed and
+// acceleration limited profile instead of one jump of the pulse width. The servo then never
+// draws the stall current of a full-scale step, and the arm does not slam into the shell or
+// its stop. ShellEjector.h asks for the angle every SERVO_UPDATE_MS from a timer; the
+// trajectory depends only on the time since the sequence began, so late or missed ticks cannot
+// bend it. Pure C++11 so tools/servo_motion.cpp can check the pulse trajectory on the host.
+//
+// Profiles (SERVO_PROFILE):
+//   SP_STEP        jump to the target, as before (the servo moves at its own top speed)
+//   SP_TRAPEZOID   constant acceleration up to SERVO_SPEED_DEG_S, cruise, constant deceleration
+//   SP_SCURVE      the same, with the acceleration ramping up and down (cycloidal velocity
+//                  ramps): no jerk at the ends of each ramp. Peak acceleration is still
+//                  SERVO_ACCEL_DEG_S2, so the ramps take twice as long.
+// Short moves that never reach cruise speed use a triangle, or a smooth bell for SP_SCURVE.
+
+#pragma once
+#include <stdint.h>
+#include <math.h>
+
+enum ServoProfile : uint8_t { SP_STEP, SP_TRAPEZOID, SP_SCURVE };
+
+// --- DIALS ---
+#ifndef SERVO_PROFILE
+  #define SERVO_PROFILE       SP_SCURVE
+#endif
+#ifndef SERVO_SPEED_DEG_S
+  #define SERVO_SPEED_DEG_S   500    // cruise; an SG90/MG90S tops out near 600 °/s at 5 V
+#endif
+#ifndef SERVO_ACCEL_DEG_S2
+  #define SERVO_ACCEL_DEG_S2  8000   // peak
+#endif
+#ifndef SERVO_MIN_US
+  #define SERVO_MIN_US        544    // pulse at 0°, ESP32Servo's default
+#endif
+#ifndef SERVO_MAX_US
+  #define SERVO_MAX_US        2400   // pulse at 180°
+#endif
+#ifndef SERVO_UPDATE_MS
+  #define SERVO_UPDATE_MS     20     // one pulse per 50 Hz frame
+#endif
+#ifndef SERVO_HOLD_MS
+  #define SERVO_HOLD_MS       1000   // at the end angle, pushing the shell out
+#endif
+#ifndef SERVO_SETTLE_MS
+  #define SERVO_SETTLE_MS     150    // after the last move, before the servo is let go
+#endif
+#ifndef SERVO_HOME_MS
+  #define SERVO_HOME_MS       500    // boot: time to reach the start angle from wherever it is
+#endif
+
+// Move to pct % of the way from the start angle to the end angle, then hold
+struct MotionStep {
+  uint8_t  pct;
+  uint16_t holdMs;
+};
+
+static constexpr MotionStep SERVO_SEQ_HOME[]       = { { 0, SERVO_HOME_MS } };
+static constexpr MotionStep SERVO_SEQ_POP[]        = { { 100, SERVO_HOLD_MS }, { 0, SERVO_SETTLE_MS } };
+// A short knock to free a stuck shell, then the pop
+static constexpr MotionStep SERVO_SEQ_DOUBLE_POP[] = { { 100, 120 }, { 40, 80 }, { 100, SERVO_HOLD_MS }, { 0, SERVO_SETTLE_MS } };
+
+#ifndef SERVO_SEQUENCE
+  #define SERVO_SEQUENCE      SERVO_SEQ_POP   // or SERVO_SEQ_DOUBLE_POP
+#endif
+
+// Pulse width for an angle, 0..180°
+inline uint16_t servoPulseUs(float deg) {
+  if (deg < 0) deg = 0;
+  if (deg > 180) deg = 180;
+  return (uint16_t)(SERVO_MIN_US + deg * (SERVO_MAX_US - SERVO_MIN_US) / 180.0f + 0.5f);
+}
+
+// One move. Each ramp covers dRamp degrees in ta seconds; the cruise covers the rest at v.
+struct MotionMove {
+  float    from, to, dir;  // dir +1 / -1
+  float    v, ta, tc, dRamp;
+  uint8_t  profile;
+  uint32_t us;             // duration
+
+  void plan(float fromDeg, float toDeg, uint8_t prof, float speed, float accel) {
+    from = fromDeg;
+    to = toDeg;
+    dir = toDeg >= fromDeg ? 1.0f : -1.0f;
+    float d = (toDeg - fromDeg) * dir;
+    profile = prof;
+    v = ta = tc = dRamp = 0;
+    if (prof == SP_STEP || d <= 0 || speed <= 0 || accel <= 0) { profile = SP_STEP; us = 0; return; }
+    float k = prof == SP_SCURVE ? 2.0f : 1.0f;   // ramp time is k * v / accel for the same peak
+    v = speed;
+    if (k * v * v / accel > d) v = sqrtf(d * accel / k);   // no room to reach cruise
+    ta = k * v / accel;
+    dRamp = v * ta / 2;
+    tc = d > 2 * dRamp ? (d - 2 * dRamp) / v : 0;
+    us = (uint32_t)((2 * ta + tc) * 1e6f + 0.5f);
+  }
+
+  // Share of a ramp's distance covered at u = 0..1 of its time
+  float ramp(float u) const {
+    if (profile == SP_SCURVE) return u * u + (cosf(6.2831853f * u) - 1.0f) / 19.7392088f;   // 2 pi^2
+    return u * u;
+  }
+
+  float at(uint32_t t) const {
+    if (t >= us) return to;
+    float s = t / 1e6f;
+    float p;
+    if (s < ta)           p = dRamp * ramp(s / ta);
+    else if (s < ta + tc) p = dRamp + v * (s - ta);
+    else                  p = 2 * dRamp + v * tc - dRamp * ramp((2 * ta + tc - s) / ta);
+    return from + dir * p;
+  }
+};
+
+// Runs a sequence. at() takes µs since begin() and must not go backwards.
+struct ServoPlanner {
+  const MotionStep* seq;
+  uint8_t  count;
+  uint8_t  step;           // step running now
+  uint8_t  profile;
+  bool     done;
+  float    startDeg, endDeg, speed, accel;
+  float    angle;          // last angle returned
+  uint32_t stepUs;         // when the running step began
+  MotionMove move;
+
+  float target(uint8_t i) const { return startDeg + (endDeg - startDeg) * seq[i].pct / 100.0f; }
+
+  void begin(const MotionStep* s, uint8_t n, float start, float end, float fromDeg, uint8_t prof,
+             float spd = SERVO_SPEED_DEG_S, float acc = SERVO_ACCEL_DEG_S2) {
+    seq = s; count = n; step = 0; profile = prof; done = n == 0;
+    startDeg = start; endDeg = end; speed = spd; accel = acc;
+    angle = fromDeg;
+    stepUs = 0;
+    if (n) move.plan(fromDeg, target(0), prof, spd, acc);
+  }
+
+  float at(uint32_t t) {
+    while (!done && t - stepUs >= move.us + seq[step].holdMs * 1000u) {
+      uint32_t next = stepUs + move.us + seq[step].holdMs * 1000u;
+      if (step + 1 >= count) { done = true; break; }
+      step++;
+      stepUs = next;
+      move.plan(target(step - 1), target(step), profile, speed, accel);
+    }
+    angle = done ? target(count - 1) : move.at(t - stepUs);
+    return angle;
+  }
+
+  // Length of the whole sequence from fromDeg
+  uint32_t totalUs(float fromDeg) const {
+    uint32_t t = 0;
+    float a = fromDeg;
+    for (uint8_t i = 0; i < count; i++) {
+      MotionMove m;
+      m.plan(a, target(i), profile, speed, accel);
+      t += m.us + seq[i].holdMs * 1000u;
+      a = target(i);
+    }
+    return t;
+  }
+};
@@ -0,0 +1,56 @@
+// SettingsFields.h
+// VERSION: 1.0.0
+// The settings as JSON fields (HttpLite.h JsonField): key, type, member and allowed range.
+// One table for everything that changes settings from outside: PATCH /api/settings
+// (HttpApi.h) and remote round configs (RoundControl.h) check values against the same ranges.
+// Pure C++ so host tools can use it too.
+
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "HttpLite.h"
+#include "SettingsLayout.h"
+
+static const uint32_t SETTINGS_MIN_BOMB_MS = 10000;
+static const uint32_t SETTINGS_MAX_BOMB_MS = 3600000;
+static const uint32_t SETTINGS_CODE_LEN    = sizeof(((Settings*)0)->fixed_code_val) - 1;   // = CODE_LENGTH
+
+#define SETTINGS_FIELD(key, type, flags, member, lo, hi) \
+  { key, type, flags, (uint16_t)offsetof(Settings, member), (uint16_t)sizeof(((Settings*)0)->member), lo, hi }
+
+static const JsonField SETTINGS_FIELDS[] = {
+  SETTINGS_FIELD("bomb_duration_ms",         JF_U32,  0,         bomb_duration_ms,         SETTINGS_MIN_BOMB_MS, SETTINGS_MAX_BOMB_MS),
+  SETTINGS_FIELD("manual_disarm_time_ms",    JF_U32,  0,         manual_disarm_time_ms,    1, 600000),
+  SETTINGS_FIELD("rfid_disarm_time_ms",      JF_U32,  0,         rfid_disarm_time_ms,      1, 600000),
+  SETTINGS_FIELD("sudden_death_mode",        JF_BOOL, 0,         sudden_death_mode,        0, 1),
+  SETTINGS_FIELD("dud_enabled",              JF_BOOL, 0,         dud_enabled,              0, 1),
+  SETTINGS_FIELD("dud_chance",               JF_U8,   0,         dud_chance,               0, 100),
+  SETTINGS_FIELD("fixed_code_enabled",       JF_BOOL, 0,         fixed_code_enabled,       0, 1),
+  SETTINGS_FIELD("fixed_code_val",           JF_STR,  JF_DIGITS, fixed_code_val,           SETTINGS_CODE_LEN, SETTINGS_CODE_LEN),
+  SETTINGS_FIELD("servo_enabled",            JF_BOOL, 0,         servo_enabled,            0, 1),
+  SETTINGS_FIELD("servo_start_angle",        JF_U8,   0,         servo_start_angle,        0, 180),
+  SETTINGS_FIELD("servo_end_angle",          JF_U8,   0,         servo_end_angle,          0, 180),
+  SETTINGS_FIELD("sound_enabled",            JF_BOOL, 0,         sound_enabled,            0, 1),
+  SETTINGS_FIELD("sound_volume",             JF_U8,   0,         sound_volume,             0, 30),
+  SETTINGS_FIELD("plant_sensor_enabled",     JF_BOOL, 0,         plant_sensor_enabled,     0, 1),
+  SETTINGS_FIELD("easter_eggs_enabled",      JF_BOOL, 0,         easter_eggs_enabled,      0, 1),
+  SETTINGS_FIELD("explosion_strobe_enabled", JF_BOOL, 0,         explosion_strobe_enabled, 0, 1),
+  SETTINGS_FIELD("ping_enabled",             JF_BOOL, 0,         ping_enabled,             0, 1),
+  SETTINGS_FIELD("ping_interval_s",          JF_U16,  0,         ping_interval_s,          5, 3600),
+  SETTINGS_FIELD("ping_light_enabled",       JF_BOOL, 0,         ping_light_enabled,       0, 1),
+  SETTINGS_FIELD("rfid_arming_mode",         JF_U8,   0,         rfid_arming_mode,         0, 1),
+  SETTINGS_FIELD("rfid_entry_speed_ms",      JF_U16,  0,         rfid_entry_speed_ms,      0, 5000),
+  SETTINGS_FIELD("wifi_enabled",             JF_BOOL, JF_NET,    wifi_enabled,             0, 1),
+  SETTINGS_FIELD("net_use_mdns",             JF_BOOL, JF_NET,    net_use_mdns,             0, 1),
+  SETTINGS_FIELD("scoreboard_ip",            JF_IP,   JF_NET,    scoreboard_ip,            0, 0),
+  SETTINGS_FIELD("master_ip",                JF_IP,   JF_NET,    master_ip,                0, 0),
+  SETTINGS_FIELD("scoreboard_port",          JF_U16,  JF_NET,    scoreboard_port,          1, 65535),
+  SETTINGS_FIELD("cmd_token",                JF_STR,  JF_SECRET, cmd_token,                0, 15),
+};
+static const size_t SETTINGS_FIELD_COUNT = sizeof(SETTINGS_FIELDS) / sizeof(SETTINGS_FIELDS[0]);
+
+inline const JsonField* settingsField(const char* key) {
+  for (size_t i = 0; i < SETTINGS_FIELD_COUNT; i++) if (!strcmp(SETTINGS_FIELDS[i].key, key)) return &SETTINGS_FIELDS[i];
+  return nullptr;
+}
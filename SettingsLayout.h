@@ -0,0 +1,69 @@
+// SettingsLayout.h
+// VERSION: 1.0.0
+// The Settings struct as stored in EEPROM (Config.h loads/saves it). Pure C++ so host tools
+// (tools/menu_sim.cpp) can build field tables against the real layout. Changing a member
+// means bumping SETTINGS_MAGIC in Config.h.
+
+#pragma once
+#include <stdint.h>
+
+#define MAX_RFID_UIDS 30
+
+struct Settings {
+  uint32_t magic_number;
+  uint16_t version;
+  uint16_t _pad0;
+
+  // Gameplay
+  uint32_t bomb_duration_ms;
+  uint32_t manual_disarm_time_ms;
+  uint32_t rfid_disarm_time_ms;
+
+  // --- MODES ---
+  uint8_t  sudden_death_mode;  // 0=Off, 1=On
+  uint8_t  dud_enabled;        // 0=Off, 1=On
+  uint8_t  dud_chance;         // 1-100%
+  
+  // --- FIXED CODE ---
+  uint8_t  fixed_code_enabled; // 0=Any 7 digits, 1=Must match fixed_code_val
+  char     fixed_code_val[8];  // The required code
+
+  // --- HARDWARE ---
+  uint8_t  servo_enabled;           // 0=Off, 1=On
+  uint8_t  servo_start_angle;       // e.g., 0
+  uint8_t  servo_end_angle;         // e.g., 90
+  
+  // --- AUDIO ---
+  uint8_t  sound_enabled;           // 0=Off, 1=On
+  uint8_t  sound_volume;            // 0-30
+  
+  // --- SENSORS & EXTRAS ---
+  uint8_t  plant_sensor_enabled;    // 0=Off, 1=On
+  uint8_t  easter_eggs_enabled;     // 0=Off, 1=On
+  uint8_t  explosion_strobe_enabled;// 0=Off, 1=On
+  
+  // --- HOMING PING ---
+  uint8_t  ping_enabled;            // 0=Off, 1=On
+  uint16_t ping_interval_s;         // Seconds between pings
+  uint8_t  ping_light_enabled;      // Flash LED with ping?
+
+  // --- RFID ---
+  int32_t  num_rfid_uids;
+  struct TagUID {
+    uint8_t len;
+    uint8_t bytes[10];
+    uint8_t type; // 0=Disarm (Default), 1=Arming Card
+  } rfid_uids[MAX_RFID_UIDS];
+  
+  // RFID Arming Logic
+  uint8_t  rfid_arming_mode;    // 0=Use Fixed Code, 1=Random Code
+  uint16_t rfid_entry_speed_ms; // Delay between digits (0=Instant)
+
+  // Network
+  uint8_t  wifi_enabled;
+  uint8_t  net_use_mdns;
+  uint32_t scoreboard_ip;
+  uint32_t master_ip;
+  uint16_t scoreboard_port;
+  char     cmd_token[16];      // shared secret for WS commands ("" = disabled)
+};
@@ -1,29 +1,82 @@
 // ShellEjector.h
-// VERSION: 3.5.0 (Reverted)
+// VERSION: 4.0.0
+// CHANGED: Profiled, timer-driven moves and multi-step sequences (ServoMotion.h); boot homing no longer blocks
 // STATUS: Restored 'detach' logic. Servo goes limp when idle.
 // NOTE: This fixes "no movement", but "wiggle on start" is expected behavior for open-loop servos.
+//
+// A sequence runs on its own: startShellEjectorSequence() plans it and starts a periodic
+// esp_timer, which writes the next pulse width of the trajectory every SERVO_UPDATE_MS.
+// updateShellEjector() (loop) follows the steps for ejectorState and the power estimate, and
+// stops the timer and detaches once the last hold is over. The planner is only replanned with
+// the timer stopped, under ejectorMux in case a tick was already running.
 
 #pragma once
 #include <Arduino.h>
 #include <ESP32Servo.h>
+#include <esp_timer.h>
 #include "Pins.h"
 #include "Config.h"
+#include "Log.h"
+#include "GameClock.h"
+#include "ServoMotion.h"
 
 // --- FALLBACK CONFIGURATION ---
 #ifndef SERVO_PIN
 #define SERVO_PIN A2
 #endif
 
-// --- CONFIGURATION ---
-static const uint32_t SERVO_HOLD_TIME       = 1000; 
-
 // Internal State
 // 'extern' ensures all files share the EXACT SAME variable instance.
-extern Servo myServo; 
+extern Servo myServo;
 enum EjectorState { EJECTOR_IDLE, EJECTOR_EXTENDED, EJECTOR_RETRACTING };
 
 extern EjectorState ejectorState;
-extern uint32_t ejectorTimer;
+extern uint32_t ejectorTimer;         // millis() the running sequence started
+
+static ServoPlanner ejectorPlan;
+static portMUX_TYPE ejectorMux = portMUX_INITIALIZER_UNLOCKED;
+static esp_timer_handle_t ejectorTicker = nullptr;
+static GameUs ejectorStartUs = 0;
+static volatile bool    ejectorDone = true;
+static volatile uint8_t ejectorStep = 0;
+static uint8_t  ejectorLastStep = 0xFF;
+static float    ejectorAngle = -1;    // last angle commanded, -1 = unknown (boot)
+static uint32_t ejectorMoves = 0;     // steps started, for the start-up surge in Power.h
+
+// esp_timer task: the next point of the trajectory
+inline void ejectorTick(void*) {
+  portENTER_CRITICAL(&ejectorMux);
+  float a = ejectorPlan.at((uint32_t)(gameNowUs() - ejectorStartUs));
+  ejectorStep = ejectorPlan.step;
+  ejectorDone = ejectorPlan.done;
+  portEXIT_CRITICAL(&ejectorMux);
+  myServo.writeMicroseconds(servoPulseUs(a));   // a no-op once the loop has detached
+}
+
+inline void ejectorRun(const MotionStep* seq, uint8_t count, uint8_t profile) {
+  esp_timer_stop(ejectorTicker);
+  portENTER_CRITICAL(&ejectorMux);
+  // Restarted mid-sequence: carry on from where the arm is
+  float from = ejectorState != EJECTOR_IDLE ? ejectorPlan.angle
+             : ejectorAngle >= 0            ? ejectorAngle
+             :                                (float)settings.servo_start_angle;
+  ejectorStartUs = gameNowUs();
+  ejectorPlan.begin(seq, count, settings.servo_start_angle, settings.servo_end_angle, from, profile);
+  ejectorStep = 0;
+  ejectorDone = false;
+  portEXIT_CRITICAL(&ejectorMux);
+
+  if (!myServo.attached()) {
+    myServo.setPeriodHertz(50);
+    myServo.attach(SERVO_PIN, SERVO_MIN_US, SERVO_MAX_US);
+  }
+  myServo.writeMicroseconds(servoPulseUs(from));
+  ejectorLastStep = 0xFF;
+  ejectorState = seq[0].pct ? EJECTOR_EXTENDED : EJECTOR_RETRACTING;
+  ejectorTimer = millis();
+  esp_timer_start_periodic(ejectorTicker, SERVO_UPDATE_MS * 1000ull);
+  LOG_D("[SERVO] %u steps, %u ms", (unsigned)count, (unsigned)(ejectorPlan.totalUs(from) / 1000));
+}
 
 inline void initShellEjector() {
 #ifdef SERVO_PIN
@@ -31,23 +84,22 @@ inline void initShellEjector() {
   pinMode(SERVO_PIN, OUTPUT);
   digitalWrite(SERVO_PIN, LOW);
 
-  // --- Force Reset to Start Position on Boot ---
+  esp_timer_create_args_t args = {};
+  args.callback = ejectorTick;
+  args.name = "servo";
+  esp_timer_create(&args, &ejectorTicker);
+
+  // --- Reset to Start Position on Boot ---
+  // Where the arm is after a reset is unknown, so this one is a plain step. It runs in the
+  // background and lets go after SERVO_HOME_MS.
   if (settings.servo_enabled) {
-      Serial.println("[SERVO] Resetting to Start Angle...");
-      myServo.setPeriodHertz(50);
-      
-      // Write target BEFORE attach to minimize jump
-      myServo.write(settings.servo_start_angle); 
-      myServo.attach(SERVO_PIN);
-      
-      delay(500); // Give it time to move home
-      
-      myServo.detach(); // Relax (Go Limp)
+      LOG_I("[SERVO] Resetting to Start Angle...");
+      ejectorRun(SERVO_SEQ_HOME, sizeof(SERVO_SEQ_HOME) / sizeof(SERVO_SEQ_HOME[0]), SP_STEP);
   }
-  
-  Serial.printf("[SERVO] Initialized on Pin %d\n", SERVO_PIN);
+
+  LOG_I("[SERVO] Initialized on Pin %d", SERVO_PIN);
 #else
-  Serial.println("[SERVO] ERROR: SERVO_PIN NOT DEFINED!");
+  LOG_E("[SERVO] ERROR: SERVO_PIN NOT DEFINED!");
 #endif
 }
 
@@ -55,46 +107,27 @@ inline void startShellEjectorSequence() {
   #ifdef SERVO_PIN
     if (!settings.servo_enabled) return;
 
-    Serial.println("[SERVO] POP! (Attaching & Moving)");
-    
-    // 1. Define Pulse Width FIRST
-    myServo.write(settings.servo_end_angle);
-    
-    // 2. Attach (Sends the pulse)
-    if (!myServo.attached()) {
-      myServo.setPeriodHertz(50);
-      myServo.attach(SERVO_PIN);
-    }
-    
-    ejectorState = EJECTOR_EXTENDED;
-    ejectorTimer = millis();
+    LOG_I("[SERVO] POP! (Attaching & Moving)");
+    ejectorRun(SERVO_SEQUENCE, sizeof(SERVO_SEQUENCE) / sizeof(SERVO_SEQUENCE[0]), SERVO_PROFILE);
   #endif
 }
 
 inline void updateShellEjector() {
   if (ejectorState == EJECTOR_IDLE) return;
 
-  uint32_t elapsed = millis() - ejectorTimer;
-
-  // Phase 1: Holding the "Pop" position (End Angle)
-  if (ejectorState == EJECTOR_EXTENDED) {
-    if (elapsed >= SERVO_HOLD_TIME) {
-      Serial.println("[SERVO] Retracting...");
-      
-      // 3. Move back to "Start" (Neutral) Angle
-      myServo.write(settings.servo_start_angle);
-      
-      ejectorState = EJECTOR_RETRACTING;
-      ejectorTimer = millis(); 
-    }
-  }
-  // Phase 2: Wait for return movement, then Detach
-  else if (ejectorState == EJECTOR_RETRACTING) {
-    if (elapsed >= 1000) { 
-      Serial.println("[SERVO] Sequence Complete. Detaching.");
-      // 4. Detach to stop hum/jitter
-      myServo.detach(); 
-      ejectorState = EJECTOR_IDLE;
-    }
+  uint8_t step = ejectorStep;
+  if (step != ejectorLastStep) {
+    ejectorLastStep = step;
+    ejectorMoves++;
+    ejectorState = ejectorPlan.seq[step].pct ? EJECTOR_EXTENDED : EJECTOR_RETRACTING;
+    if (ejectorState == EJECTOR_RETRACTING && step) LOG_I("[SERVO] Retracting...");
   }
-}
\ No newline at end of file
+
+  if (!ejectorDone) return;
+  esp_timer_stop(ejectorTicker);
+  ejectorAngle = ejectorPlan.angle;
+  LOG_I("[SERVO] Sequence Complete (%u ms). Detaching.", (unsigned)(millis() - ejectorTimer));
+  // Detach to stop hum/jitter
+  myServo.detach();
+  ejectorState = EJECTOR_IDLE;
+}
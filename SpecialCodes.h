@@ -0,0 +1,139 @@
+// SpecialCodes.h
+// VERSION: 1.1.1
+// CHANGED: Rows start a GameMode (GameMode.h) instead of setting mode flags
+// Codes that do something other than plain arming when typed at ARMING + '#'. One row per
+// code; processArmingCode() (Game.h) applies the row. Pure C++11 so tools/code_table.cpp
+// can check it on the host.
+//
+// Lookup is one hash and one strcmp: the seed of a small FNV-1a hash is searched at compile
+// time until every code lands in its own slot of a 64-entry index. Adding or removing a
+// code is a table edit; the static_asserts fail the build if no seed works or a row is bad.
+
+#pragma once
+#include <stdint.h>
+#include <string.h>
+#include "Sounds.h"
+#include "StateTable.h"
+#include "GameMode.h"
+
+static constexpr const char* C4_MASTER_CODE = "7355608";
+
+// What a row does, applied in this order by processArmingCode()
+enum : uint16_t {
+  SC_EASTER_EGG  = 1 << 0,   // only while settings.easter_eggs_enabled
+  SC_ARM_CODE    = 1 << 1,   // the code becomes activeArmCode
+  SC_START_CLOCK = 1 << 2,   // bomb deadline = now + bomb time
+  SC_SERVO_TEST  = 1 << 3,   // run the shell ejector
+  SC_CLEAR_ENTRY = 1 << 4,   // clear enteredCode
+  SC_ON_ARMED    = 1 << 5    // c4OnEnterArmed() (scoreboard event)
+};
+
+struct SpecialCode {
+  const char* code;
+  uint16_t flags;
+  uint8_t  mode;         // GameModeId started first, GM_NONE = none
+  uint8_t  sound;        // 0 = none
+  uint32_t durationMs;   // bomb time override for this round, 0 = keep
+  const char* line1;     // LCD rows 1/2, nullptr = leave
+  const char* line2;
+  uint16_t holdMs;       // taggedDelay() after the sound
+  uint8_t  event;        // StateEvent fired last, EV_NONE = stay in ARMING
+};
+
+// Plain easter-egg arming: code, timer, sound, scoreboard event, ARMED
+#define SC_ARM_EGG (SC_EASTER_EGG | SC_ARM_CODE | SC_START_CLOCK | SC_ON_ARMED)
+
+static constexpr SpecialCode SPECIAL_CODES[] = {
+  //  code          flags                           mode           sound              time    line1             line2        hold  event
+  { "501",          SC_EASTER_EGG | SC_CLEAR_ENTRY, GM_STARWARS,   0,                 0,      nullptr,          nullptr,     0,    EV_CODE_STARWARS },
+  { "1138",         SC_ARM_EGG,                     GM_NONE,       SOUND_THX,         0,      nullptr,          nullptr,     0,    EV_CODE_OK },
+  { "8675309",      SC_ARM_EGG,                     GM_NONE,       SOUND_JENNY,       222000, nullptr,          nullptr,     0,    EV_CODE_OK },
+  { "3141592",      SC_ARM_EGG,                     GM_NONE,       SOUND_NERD,        0,      nullptr,          nullptr,     0,    EV_CODE_OK },
+  { "1984",         SC_ARM_EGG,                     GM_TERMINATOR, SOUND_HASTA_2,     0,      nullptr,          nullptr,     0,    EV_CODE_OK },
+  { "7777777",      SC_ARM_EGG,                     GM_NONE,       SOUND_JACKPOT,     0,      nullptr,          nullptr,     0,    EV_CODE_OK },
+  { "007",          SC_ARM_EGG,                     GM_BOND,       SOUND_BOND_INTRO,  105000, nullptr,          nullptr,     0,    EV_CODE_OK },
+  { "12345",        SC_EASTER_EGG | SC_CLEAR_ENTRY, GM_NONE,       SOUND_SPACEBALLS,  0,      "IDIOT LUGGAGE?", nullptr,     2500, EV_CODE_BAD },
+  { "0451",         SC_ARM_EGG,                     GM_NONE,       SOUND_SOM_BITCH,   0,      nullptr,          nullptr,     0,    EV_CODE_OK },
+  { "14085",        SC_ARM_EGG,                     GM_NONE,       SOUND_MGS_ALERT,   0,      nullptr,          nullptr,     0,    EV_CODE_OK },
+  { "0000000",      SC_EASTER_EGG | SC_CLEAR_ENTRY, GM_NONE,       SOUND_LAME,        0,      "TOO EASY",       nullptr,     1500, EV_CODE_BAD },
+  { "666666",       SC_EASTER_EGG | SC_ARM_CODE | SC_START_CLOCK, GM_DOOM, SOUND_DOOM_SLAYER, 0, nullptr,         nullptr,     0,    EV_CODE_OK },
+  { "5318008",      SC_EASTER_EGG | SC_ARM_CODE,    GM_NONE,       0,                 0,      nullptr,          nullptr,     0,    EV_CODE_JUGS },
+  { "999",          SC_SERVO_TEST | SC_CLEAR_ENTRY, GM_NONE,       0,                 0,      "SERVO TEST",     "ACTIVATED", 0,    EV_NONE },
+  { C4_MASTER_CODE, SC_ARM_CODE,                    GM_NONE,       0,                 0,      nullptr,          nullptr,     0,    EV_CODE_MASTER },
+};
+
+static constexpr uint8_t SPECIAL_CODE_COUNT = sizeof(SPECIAL_CODES) / sizeof(SPECIAL_CODES[0]);
+static constexpr uint8_t SPECIAL_CODE_SLOTS = 64;
+static constexpr uint8_t SPECIAL_CODE_NONE = 0xFF;
+
+// --- HASH ---
+constexpr uint32_t specialCodeHash(const char* s, uint32_t h) {
+  return *s ? specialCodeHash(s + 1, (h ^ (uint8_t)*s) * 16777619u) : h;
+}
+constexpr uint8_t specialCodeSlot(const char* s, uint32_t seed) {
+  return (uint8_t)((specialCodeHash(s, seed) >> 26) & (SPECIAL_CODE_SLOTS - 1));
+}
+
+// --- COMPILE-TIME SEED SEARCH ---
+constexpr bool specialCodeClashes(uint32_t seed, uint8_t i, uint8_t j) {
+  return j < SPECIAL_CODE_COUNT &&
+         (specialCodeSlot(SPECIAL_CODES[i].code, seed) == specialCodeSlot(SPECIAL_CODES[j].code, seed) ||
+          specialCodeClashes(seed, i, j + 1));
+}
+constexpr bool specialCodeSeedWorks(uint32_t seed, uint8_t i = 0) {
+  return i >= SPECIAL_CODE_COUNT || (!specialCodeClashes(seed, i, i + 1) && specialCodeSeedWorks(seed, i + 1));
+}
+// Starts at the FNV offset basis; gives up (returns 0) after 256 candidates
+constexpr uint32_t specialCodeFindSeed(uint32_t seed = 2166136261u, uint16_t tries = 256) {
+  return tries == 0 ? 0 : specialCodeSeedWorks(seed) ? seed : specialCodeFindSeed(seed + 1, tries - 1);
+}
+static constexpr uint32_t SPECIAL_CODE_SEED = specialCodeFindSeed();
+
+constexpr uint8_t specialCodeRowForSlot(uint8_t slot, uint8_t i = 0) {
+  return i >= SPECIAL_CODE_COUNT ? SPECIAL_CODE_NONE
+       : specialCodeSlot(SPECIAL_CODES[i].code, SPECIAL_CODE_SEED) == slot ? i
+       : specialCodeRowForSlot(slot, i + 1);
+}
+
+template <typename Seq> struct SpecialCodeIndex;
+template <unsigned... I> struct SpecialCodeIndex<StateSeq<I...> > {
+  static constexpr uint8_t row[sizeof...(I)] = { specialCodeRowForSlot(I)... };
+};
+template <unsigned... I> constexpr uint8_t SpecialCodeIndex<StateSeq<I...> >::row[sizeof...(I)];
+typedef SpecialCodeIndex<StateSeqGen<SPECIAL_CODE_SLOTS>::type> SpecialCodeSlots;
+
+// Row for code, or nullptr. Case-sensitive exact match.
+inline const SpecialCode* specialCodeFind(const char* code) {
+  uint8_t row = SpecialCodeSlots::row[specialCodeSlot(code, SPECIAL_CODE_SEED)];
+  if (row == SPECIAL_CODE_NONE || strcmp(SPECIAL_CODES[row].code, code) != 0) return nullptr;
+  return &SPECIAL_CODES[row];
+}
+
+// --- COMPILE-TIME CHECKS ---
+constexpr bool specialCodeDigits(const char* s, uint8_t n = 0) {
+  return *s ? (*s >= '0' && *s <= '9' && specialCodeDigits(s + 1, n + 1)) : (n > 0 && n <= 7);
+}
+constexpr bool specialCodeSame(const char* a, const char* b) {
+  return *a == *b && (*a == '\0' || specialCodeSame(a + 1, b + 1));
+}
+constexpr bool specialCodeListed(uint8_t i, uint8_t j) {
+  return j < SPECIAL_CODE_COUNT && (specialCodeSame(SPECIAL_CODES[i].code, SPECIAL_CODES[j].code) || specialCodeListed(i, j + 1));
+}
+constexpr bool specialCodesUnique(uint8_t i = 0) {
+  return i >= SPECIAL_CODE_COUNT || (!specialCodeListed(i, i + 1) && specialCodesUnique(i + 1));
+}
+// Codes are typed into enteredCode[CODE_LENGTH + 1], CODE_LENGTH = 7 (Config.h)
+constexpr bool specialCodeRowsValid(uint8_t i = 0) {
+  return i >= SPECIAL_CODE_COUNT ||
+         (specialCodeDigits(SPECIAL_CODES[i].code) &&
+          (SPECIAL_CODES[i].event == EV_NONE || SPECIAL_CODES[i].event == EV_CODE_OK ||
+           SPECIAL_CODES[i].event == EV_CODE_BAD || SPECIAL_CODES[i].event == EV_CODE_STARWARS ||
+           SPECIAL_CODES[i].event == EV_CODE_MASTER || SPECIAL_CODES[i].event == EV_CODE_JUGS) &&
+          SPECIAL_CODES[i].mode < GM_COUNT &&
+          specialCodeRowsValid(i + 1));
+}
+
+static_assert(SPECIAL_CODE_COUNT < SPECIAL_CODE_SLOTS / 2, "too many special codes for the 64-slot index");
+static_assert(specialCodeRowsValid(), "special code must be 1-7 digits and fire an ARMING code event");
+static_assert(specialCodesUnique(), "special code listed twice");
+static_assert(SPECIAL_CODE_SEED != 0, "no collision-free hash seed; change SPECIAL_CODE_SLOTS or the hash");
@@ -1,22 +1,28 @@
 // State.h
-// VERSION: 6.6.0
-// UPDATE: Added TOLKIEN_GAME state
+// VERSION: 7.4.1
+// ADDED: SF_END_ROUND entry action (Config.h settingsEndRound)
+// CHANGED: Bomb and disarm timers are Countdown objects (Countdown.h): pause/resume, rate, add/subtract time
+// CHANGED: Bomb/disarm timers are absolute 64-bit µs deadlines (GameClock.h); state entry time is a GameUs
+// CHANGED: ConfigState enum and menu globals removed; the menu cursor is in ConfigMenu.h
+// CHANGED: Doom/Star Wars/Terminator/Bond flags replaced by one activeMode pointer and its hooks (GameMode.h)
+// CHANGED: Table-driven transitions (StateTable.h): stateFire(event) replaces setState(); entry actions are a per-state table
+// ADDED: gameplayLocked: setState() cannot leave STANDBY while a firmware update runs (Ota.h)
+// ADDED: DFPlayer error counter (Metrics.h); error log via Log.h
 
 #pragma once
 #include "Config.h"
 #include "Sounds.h"
 #include "Hardware.h"
 #include "ShellEjector.h"
+#include "StateTable.h"
+#include "Countdown.h"
+#include "GameMode.h"
 
 // Forward Declaration
 void wsSendJson(const String& json);
 #include "C4Net.h"
 
 // --- GLOBAL FLAGS ---
-extern bool doomModeActive;
-extern bool starWarsModeActive;
-extern bool terminatorModeActive;
-extern bool bondModeActive;
 extern bool suddenDeathActive;
 extern bool easterEggActive;
 
@@ -28,95 +34,49 @@ extern bool autoTypingActive;
 extern char autoTypingTarget[CODE_LENGTH + 1];
 extern uint32_t lastAutoTypeTime;
 
-// Game states
-enum PropState { 
-  STANDBY, AWAIT_ARM_TOGGLE, PROP_IDLE, ARMING, ARMED, DISARMING_KEYPAD, 
-  DISARMING_MANUAL, DISARMING_RFID, DISARMED, PRE_EXPLOSION, EXPLODED, 
-  EASTER_EGG, EASTER_EGG_2,
-  CONFIG_MODE,
-  STARWARS_PRE_GAME,
-  PROP_DUD,
-  TOLKIEN_GAME // <--- NEW STATE
-};
-
-// Config/menu states
-enum ConfigState {
-  MENU_MAIN, 
-  MENU_SET_BOMB_TIME, MENU_SET_MANUAL_TIME, MENU_SET_RFID_TIME,
-  MENU_SUDDEN_DEATH_TOGGLE, MENU_DUD_SETTINGS, MENU_DUD_CHANCE,
-  
-  // FIXED CODE MENUS
-  MENU_FIXED_CODE_SETTINGS, MENU_FIXED_CODE_TOGGLE, MENU_SET_FIXED_CODE,
-
-  MENU_HARDWARE_SUBMENU, 
-  MENU_AUDIO_SUBMENU, MENU_AUDIO_TOGGLE, MENU_VOLUME,
-
-  // Hardware/FX
-  MENU_PLANT_SENSOR_TOGGLE,
-  
-  // FX Submenu (Strobe/Eggs/Ping)
-  MENU_EXTRAS_SUBMENU, 
-  MENU_TOGGLE_EASTER_EGGS, MENU_TOGGLE_STROBE,
-  
-  // PING MENU
-  MENU_PING_SETTINGS, MENU_PING_TOGGLE, MENU_PING_INTERVAL, MENU_PING_LIGHT_TOGGLE,
-  
-  // Servo
-  MENU_SERVO_SETTINGS, MENU_SERVO_TOGGLE, MENU_SERVO_START_ANGLE, MENU_SERVO_END_ANGLE,
-
-  // RFID & Network
-  MENU_VIEW_RFIDS, 
-  MENU_ADD_RFID_SELECT_TYPE, // Ask Arm vs Disarm
-  MENU_ADD_RFID_WAIT,        // Scan card
-  MENU_DELETE_RFID_CONFIRM,  // NEW: Confirm deletion of single card
-  MENU_CLEAR_RFIDS_CONFIRM, 
-  MENU_RFID_ADV_SETTINGS,    // Arming speed/mode
-  MENU_RFID_ARMING_MODE, MENU_RFID_ENTRY_SPEED,
-
-  MENU_NET_FORGET_CONFIRM, MENU_SAVE_EXIT, MENU_EXIT_NO_SAVE,
-  MENU_NETWORK, MENU_NET_ENABLE, MENU_NET_SERVER_MODE, MENU_NET_IP, MENU_NET_PORT, MENU_NET_MASTER_IP,
-  MENU_NET_WIFI_SETUP, MENU_NET_SAVE_BACK, MENU_NETWORK_2, MENU_NET_APPLY_NOW
-};
-
 extern PropState currentState;
-extern ConfigState currentConfigState;
 
-extern uint32_t bombArmedTimestamp;
-extern uint32_t disarmStartTimestamp;
-extern uint32_t lastBeepTimestamp;
-extern uint32_t stateEntryTimestamp;
+extern Countdown bombClock;        // Countdown.h
+extern Countdown disarmClock;      // manual/RFID disarm hold
+extern BeepCadence bombBeep;
+extern GameUs stateEnteredUs;
 extern uint32_t lastStarPressTime;
 extern bool ledIsOn;
 extern bool displayNeedsUpdate;
 extern int nextTrackToPlay;
-extern int configMenuIndex;
-extern char configInputBuffer[CONFIG_INPUT_MAX];
-extern int rfidViewIndex;
 extern char enteredCode[CODE_LENGTH + 1];
 extern char activeArmCode[CODE_LENGTH + 1];
 extern const char* MASTER_CODE;
 
-inline const char* getStateName(PropState state) {
-  switch (state) {
-    case STANDBY: return "STANDBY";
-    case AWAIT_ARM_TOGGLE: return "AWAIT_ARM_TOGGLE";
-    case PROP_IDLE: return "PROP_IDLE";
-    case ARMING: return "ARMING";
-    case ARMED: return "ARMED";
-    case DISARMING_KEYPAD: return "DISARMING_KEYPAD";
-    case DISARMING_MANUAL: return "DISARMING_MANUAL";
-    case DISARMING_RFID: return "DISARMING_RFID";
-    case DISARMED: return "DISARMED";
-    case PRE_EXPLOSION: return "PRE_EXPLOSION";
-    case EXPLODED: return "EXPLODED";
-    case EASTER_EGG: return "EASTER_EGG";
-    case EASTER_EGG_2: return "EASTER_EGG_2";
-    case CONFIG_MODE: return "CONFIG_MODE";
-    case STARWARS_PRE_GAME: return "STARWARS_PRE";
-    case PROP_DUD: return "PROP_DUD";
-    case TOLKIEN_GAME: return "TOLKIEN_GAME"; // <--- NEW NAME
-    default: return "UNKNOWN";
-  }
+inline const char* getStateName(PropState state) { return stateName(state); }
+
+// Started at arm time from the current (possibly overridden) bomb time
+inline void bombClockStart() {
+  bombClock.start(settings.bomb_duration_ms, gameNowUs());
+  bombBeep.reset(BEEP_TONE_DURATION_MS);
+}
+inline uint32_t bombRemainingMs() { return bombClock.leftMs(gameNowUs()); }
+
+// Referee pause: the bomb and a disarm in progress stop together; loop() ignores gameplay input
+// until resume. Only while the bomb clock runs.
+inline bool bombClockPause() {
+  GameUs now = gameNowUs();
+  if (!stateHas(currentState, SF_BOMB_CLOCK) || !bombClock.pause(now)) return false;
+  disarmClock.pause(now);
+  safePause();
+  displayNeedsUpdate = true;
+  LOG_I("[TIMER] paused, %u ms left", (unsigned)bombClock.leftMs(now));
+  return true;
+}
+
+inline bool bombClockResume() {
+  GameUs now = gameNowUs();
+  if (!bombClock.resume(now)) return false;
+  disarmClock.resume(now);
+  safeResume();
+  displayNeedsUpdate = true;
+  LOG_I("[TIMER] resumed, %u ms left", (unsigned)bombClock.leftMs(now));
+  return true;
 }
 
 inline void netNotifyState(const char* s) {
@@ -127,10 +87,7 @@ inline void netNotifyState(const char* s) {
 }
 
 inline void resetSpecialModes() {
-  doomModeActive = false;
-  starWarsModeActive = false;
-  terminatorModeActive = false;
-  bondModeActive = false;
+  activeMode = nullptr;
   suddenDeathActive = false;
   easterEggActive = false; 
   autoTypingActive = false;
@@ -141,142 +98,152 @@ inline void resetSpecialModes() {
   }
 }
 
-inline void setState(PropState newState) {
-  if (currentState == newState) return;
-  PropState oldState = currentState;
-  currentState = newState;
-  stateEntryTimestamp = millis();
-  displayNeedsUpdate = true;
-  netNotifyState(getStateName(newState));
+// --- ENTRY ACTIONS ---
+// Run after the common entry work in stateFire(). A non-EV_NONE return is a completion
+// event, fired from the new state once the action has returned.
+typedef StateEvent (*StateEntryFn)(PropState from);
 
-  // Clear code on state change
-  enteredCode[0] = '\0';
-  
-  // FIX: Protect Auto-Typing during IDLE -> ARMING transition
-  if ( ! (oldState == PROP_IDLE && newState == ARMING) ) {
-      autoTypingActive = false; 
+inline StateEvent enterStandby(PropState from) {
+  if (from != AWAIT_ARM_TOGGLE) safePlay(SOUND_ARM_SWITCH_OFF);
+  return EV_NONE;
+}
+
+inline StateEvent enterPropIdle(PropState) {
+  safePlay(SOUND_ARM_SWITCH_ON);
+  return EV_NONE;
+}
+
+inline StateEvent enterArmed(PropState from) {
+  modeOnArm(from);   // modes resume their music after an aborted disarm
+  return EV_NONE;
+}
+
+inline StateEvent enterDisarming(PropState) {
+  disarmClock.start(currentState == DISARMING_MANUAL ? settings.manual_disarm_time_ms : settings.rfid_disarm_time_ms, gameNowUs());
+  safePlay(SOUND_DISARM_BEGIN); 
+  return EV_NONE;
+}
+
+inline StateEvent enterDisarmed(PropState) {
+  if (!modeOnDisarm()) safePlay(SOUND_DISARM_SUCCESS_1);
+  nextTrackToPlay = SOUND_DISARM_SUCCESS_2; 
+  return EV_NONE;
+}
+
+inline StateEvent enterPreExplosion(PropState) {
+  bool isDud = false;
+  if (settings.dud_enabled && !modeHas(GM_NO_DUD)) {
+    if (random(1, 101) <= settings.dud_chance) isDud = true;
   }
+  if (isDud) return EV_DUD;
+
+  safeStop(); 
+  delay(50); 
   
-  if (newState == STANDBY || newState == PROP_IDLE || newState == AWAIT_ARM_TOGGLE) {
-    resetSpecialModes();
-  }
+  uint8_t track = modeOnExplode();
+  if (modeHas(GM_ENDS_AT_BLAST)) activeMode = nullptr;
+  safePlayForce(track ? track : SOUND_DETONATION_NEW);
+  return EV_NONE;
+}
 
-  // Reset Servo Flag
-  if (newState == STANDBY || newState == ARMED) {
-    servoTriggeredThisExplosion = false;
-  }
+inline StateEvent enterDud(PropState) {
+  safeStop();
+  delay(50);
+  safePlayForce(SOUND_DUD_FAIL);
+  return EV_NONE;
+}
 
-  switch (newState) {
-    case DISARMED:
-    case PRE_EXPLOSION:
-    case EXPLODED:
-    case STANDBY:
-    case AWAIT_ARM_TOGGLE:
-    case PROP_DUD:
-      beepStop();
-      break;
-    default: break;
-  }
+inline StateEvent enterEasterEgg(PropState) {
+  easterEggActive = true; 
+  safePlay(random(SOUND_EASTER_EGG_START, SOUND_EASTER_EGG_END + 1));
+  bombClockStart();
+  c4OnEnterArmed();
+  return EV_EGG_DONE;
+}
 
-  switch (newState) {
-    case ARMED:
-      // FIX: Resume Background Music if we aborted a disarm
-      if (oldState == DISARMING_MANUAL || oldState == DISARMING_RFID || oldState == DISARMING_KEYPAD) {
-         if (doomModeActive) safePlay(SOUND_DOOM_SLAYER);
-         else if (starWarsModeActive) safePlay(SOUND_STAR_WARS_THEME);
-         else if (bondModeActive) safePlay(SOUND_BOND_THEME);
-      }
-      break;
-
-    case PROP_IDLE:
-      safePlay(SOUND_ARM_SWITCH_ON);
-      break;
-
-    case STANDBY:
-      if (oldState != AWAIT_ARM_TOGGLE) {
-        safePlay(SOUND_ARM_SWITCH_OFF);
-      }
-      break;
-      
-    case STARWARS_PRE_GAME:
-      safePlay(SOUND_POWER_LIGHTSABER); 
-      break;
-
-    case DISARMING_MANUAL:
-    case DISARMING_RFID:
-      disarmStartTimestamp = millis();
-      safePlay(SOUND_DISARM_BEGIN); 
-      break;
-
-    case DISARMED:
-      if (terminatorModeActive) {
-         safePlay(SOUND_NOT_KILL_ANYONE); 
-         nextTrackToPlay = SOUND_DISARM_SUCCESS_2; 
-      } 
-      else {
-         safePlay(SOUND_DISARM_SUCCESS_1);
-         nextTrackToPlay = SOUND_DISARM_SUCCESS_2; 
-      }
-      break;
-
-    case PRE_EXPLOSION: {
-      bool isDud = false;
-      if (settings.dud_enabled && !terminatorModeActive) {
-        if (random(1, 101) <= settings.dud_chance) isDud = true;
-      }
-
-      if (isDud) {
-        setState(PROP_DUD); 
-        return; 
-      }
-
-      safeStop(); 
-      delay(50); 
-      
-      doomModeActive = false; 
-      
-      if (terminatorModeActive) {
-         safePlayForce(SOUND_ILL_BE_BACK); 
-      }
-      else {
-         safePlayForce(SOUND_DETONATION_NEW);
-      }
-    } break;
-      
-    case EXPLODED:
-      break;
+inline StateEvent enterEasterEgg2(PropState) {
+  safePlay(SOUND_JUGS); 
+  return EV_NONE;
+}
+
+inline StateEvent enterStarWars(PropState) {
+  safePlay(SOUND_POWER_LIGHTSABER); 
+  return EV_NONE;
+}
+
+// One slot per PropState, in enum order. TOLKIEN_GAME init lives in TolkienGame.h.
+static const StateEntryFn STATE_ENTER[] = {
+  /* STANDBY           */ enterStandby,
+  /* AWAIT_ARM_TOGGLE  */ nullptr,
+  /* PROP_IDLE         */ enterPropIdle,
+  /* ARMING            */ nullptr,
+  /* ARMED             */ enterArmed,
+  /* DISARMING_KEYPAD  */ nullptr,
+  /* DISARMING_MANUAL  */ enterDisarming,
+  /* DISARMING_RFID    */ enterDisarming,
+  /* DISARMED          */ enterDisarmed,
+  /* PRE_EXPLOSION     */ enterPreExplosion,
+  /* EXPLODED          */ nullptr,
+  /* EASTER_EGG        */ enterEasterEgg,
+  /* EASTER_EGG_2      */ enterEasterEgg2,
+  /* CONFIG_MODE       */ nullptr,
+  /* STARWARS_PRE_GAME */ enterStarWars,
+  /* PROP_DUD          */ enterDud,
+  /* TOLKIEN_GAME      */ nullptr,
+};
+static_assert(sizeof(STATE_ENTER) / sizeof(STATE_ENTER[0]) == STATE_COUNT, "STATE_ENTER needs one slot per PropState");
+
+// Set by Ota.h for the length of a firmware update
+static bool gameplayLocked = false;
+
+// True if ev would select a transition from the current state
+inline bool stateAccepts(StateEvent ev) { return stateEdgeFor(currentState, ev) != STATE_NO_EDGE; }
+
+// The only way to change currentState. Returns true if the state changed.
+inline bool stateFire(StateEvent ev) {
+  bool changed = false;
+  while (ev != EV_NONE) {
+    uint8_t e = stateEdgeFor(currentState, ev);
+    if (e == STATE_NO_EDGE) return changed;
+    const StateEdge& edge = STATE_EDGES[e];
+    PropState newState = (PropState)edge.to;
+    if (currentState == newState) return changed;
+    if (gameplayLocked && newState != STANDBY) {
+      LOG_W("[STATE] %s -> %s refused: firmware update in progress", getStateName(currentState), getStateName(newState));
+      return changed;
+    }
+    PropState oldState = currentState;
+    currentState = newState;
+    changed = true;
+    if (edge.flags & EF_SILENT) return changed;
+
+    LOG_D("[STATE] %s -> %s on %s", getStateName(oldState), getStateName(newState), stateEventName(ev));
+    stateEnteredUs = gameNowUs();
+    displayNeedsUpdate = true;
+    netNotifyState(getStateName(newState));
+
+    // Clear code on state change
+    enteredCode[0] = '\0';
     
-    case PROP_DUD:
-      safeStop();
-      delay(50);
-      safePlayForce(SOUND_DUD_FAIL);
-      break;
-
-    case EASTER_EGG:
-      easterEggActive = true; 
-      safePlay(random(SOUND_EASTER_EGG_START, SOUND_EASTER_EGG_END + 1));
-      bombArmedTimestamp = millis();
-      c4OnEnterArmed();
-      setState(ARMED); 
-      break;
-
-    case EASTER_EGG_2:
-      safePlay(SOUND_JUGS); 
-      break;
-      
-    case TOLKIEN_GAME:
-      // No specific init logic here, handled in TolkienGame.h wrapper
-      break;
-      
-    default: break;
+    // FIX: Protect Auto-Typing during IDLE -> ARMING transition
+    if (!(edge.flags & EF_KEEP_AUTOTYPE)) autoTypingActive = false;
+
+    if (stateHas(newState, SF_RESET_MODES)) resetSpecialModes();
+    if (stateHas(newState, SF_END_ROUND))   settingsEndRound();
+    if (stateHas(newState, SF_CLEAR_SERVO)) servoTriggeredThisExplosion = false;
+    if (stateHas(newState, SF_STOP_BEEP))   beepStop();
+
+    ev = STATE_ENTER[newState] ? STATE_ENTER[newState](oldState) : EV_NONE;
   }
+  return changed;
 }
 
 inline void printDetail(uint8_t type, int value) {
 
   // --- ERROR HANDLING & RECOVERY ---
   if (type == DFPlayerError) {
-    Serial.print(F("[DFPlayer] Err Code: ")); Serial.println(value);
+    metricInc(M_DFPLAYER_ERRORS);
+    LOG_W("[DFPlayer] Err Code: %d", value);
     dfplayerSoftReset();
     return;
   }
@@ -285,13 +252,7 @@ inline void printDetail(uint8_t type, int value) {
   if (type == DFPlayerPlayFinished) {
     if (currentState == EXPLODED) return;
 
-    if (doomModeActive && value == SOUND_DOOM_SLAYER) {
-      safePlay(SOUND_RIP_TEAR); 
-    }
-
-    if (bondModeActive && value == SOUND_BOND_INTRO) {
-      safePlay(SOUND_BOND_THEME);
-    }
+    modeOnAudioFinished(value);
 
     if (value == SOUND_DISARM_BEGIN) {
        if (currentState == DISARMING_MANUAL || currentState == DISARMING_RFID) {
@@ -301,7 +262,7 @@ inline void printDetail(uint8_t type, int value) {
     }
 
     if (value == SOUND_DETONATION_NEW) {
-      setState(EXPLODED); 
+      stateFire(EV_TRACK_DETONATION); 
       nextTrackToPlay = 0;
       return; 
     }
@@ -313,16 +274,16 @@ inline void printDetail(uint8_t type, int value) {
     }
 
     if (value == SOUND_DUD_FAIL) {
-       setState(STANDBY); 
+       stateFire(EV_TRACK_DUD); 
        nextTrackToPlay = 0;
        return;
     }
 
-    if (currentState == EASTER_EGG_2 && value == SOUND_JUGS) {
-       bombArmedTimestamp = millis();
+    if (value == SOUND_JUGS && stateAccepts(EV_TRACK_JUGS)) {
+       bombClockStart();
        safePlay(SOUND_BOMB_PLANTED);
        c4OnEnterArmed();
-       setState(ARMED);
+       stateFire(EV_TRACK_JUGS);
        nextTrackToPlay = 0;
        return;
     }
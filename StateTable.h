@@ -0,0 +1,262 @@
+// StateTable.h
+// VERSION: 1.0.1
+// ADDED: SF_END_ROUND: entering STANDBY lifts a remote round's settings
+// Game states, the events that move between them and the transition table. Pure C++11 (no
+// Arduino) so tools/state_trace.cpp builds the same table on the host.
+//
+// Every state change is stateFire(event) (State.h): the (current state, event) pair selects
+// exactly one edge and the edge names the next state. Guards — code matches, bomb planted,
+// sudden death — are evaluated by the input handler that raises the event (Game.h); entry
+// actions are State.h's STATE_ENTER table. An entry action may return a completion event
+// (dud roll, master code), which is fired after it returns instead of from inside it.
+//
+// The static_asserts at the bottom reject, at compile time: a state table out of enum order,
+// edges naming unknown states/events, two edges for the same (state, event), states that
+// cannot be reached from STANDBY, states with no way out and events no edge handles.
+
+#pragma once
+#include <stdint.h>
+
+// Game states
+enum PropState {
+  STANDBY, AWAIT_ARM_TOGGLE, PROP_IDLE, ARMING, ARMED, DISARMING_KEYPAD,
+  DISARMING_MANUAL, DISARMING_RFID, DISARMED, PRE_EXPLOSION, EXPLODED,
+  EASTER_EGG, EASTER_EGG_2,
+  CONFIG_MODE,
+  STARWARS_PRE_GAME,
+  PROP_DUD,
+  TOLKIEN_GAME // <--- NEW STATE
+};
+static const uint8_t STATE_COUNT = TOLKIEN_GAME + 1;
+static const uint8_t STATE_ANY   = 0xFE;   // edge source: every state
+
+enum StateEvent : uint8_t {
+  EV_NONE,
+  EV_BOOT_AWAIT,        // setup(): arm switch already down
+  EV_BOOT_CONFIG,       // setup(): '*' held
+  EV_BOOT_TOLKIEN,      // setup(): '0' held
+  EV_ARM_ON,            // arm switch up
+  EV_ARM_OFF,           // arm switch down
+  EV_SD_ARM_ON,         // sudden death: switch up with the bomb planted
+  EV_SD_ARM_OFF,        // sudden death: switch down
+  EV_KEY,               // any keypad key (starts code entry)
+  EV_CODE_OK,           // arming / disarming code accepted
+  EV_CODE_BAD,          // code rejected (arming: back to idle; disarming: time cut)
+  EV_CODE_STARWARS,     // "501"
+  EV_CODE_MASTER,       // MASTER_CODE
+  EV_CODE_JUGS,         // "5318008"
+  EV_CANCEL,            // '*' double tap
+  EV_BUTTON_DOWN,       // disarm button pressed
+  EV_BUTTON_UP,         // disarm button released
+  EV_CARD_DISARM,       // disarm tag presented
+  EV_DISARM_DONE,       // manual / RFID disarm held long enough
+  EV_TIMEOUT,           // bomb clock ran out; pre-explosion fade guard
+  EV_DUD,               // completion: dud roll on PRE_EXPLOSION entry
+  EV_EGG_DONE,          // completion: EASTER_EGG entry
+  EV_TRACK_DETONATION,  // DFPlayer finished the detonation track
+  EV_TRACK_DUD,         // DFPlayer finished the dud track
+  EV_TRACK_JUGS,        // DFPlayer finished the JUGS track
+  EV_RESET,             // admin tag, WS "reset", config exit, Tolkien game over
+  EV_REMOTE_ARM,        // WS "arm"
+  EV_ROUND_START,       // scoreboard round start (RoundControl.h)
+  EV_COUNT
+};
+
+// Per-state entry behaviour shared by all transitions into the state (State.h)
+enum : uint8_t {
+  SF_RESET_MODES = 1 << 0,   // resetSpecialModes()
+  SF_STOP_BEEP   = 1 << 1,   // silence the countdown beeper
+  SF_CLEAR_SERVO = 1 << 2,   // re-arm the shell ejector
+  SF_BOMB_CLOCK  = 1 << 3,   // bomb timer runs (ARMED .. DISARMING_RFID)
+  SF_END_ROUND   = 1 << 4    // a remote round's settings overlay is lifted (Config.h)
+};
+
+struct StateInfo { uint8_t id; const char* name; uint8_t flags; };
+
+static constexpr StateInfo STATE_INFO[] = {
+  { STANDBY,           "STANDBY",          SF_RESET_MODES | SF_STOP_BEEP | SF_CLEAR_SERVO | SF_END_ROUND },
+  { AWAIT_ARM_TOGGLE,  "AWAIT_ARM_TOGGLE", SF_RESET_MODES | SF_STOP_BEEP },
+  { PROP_IDLE,         "PROP_IDLE",        SF_RESET_MODES },
+  { ARMING,            "ARMING",           0 },
+  { ARMED,             "ARMED",            SF_CLEAR_SERVO | SF_BOMB_CLOCK },
+  { DISARMING_KEYPAD,  "DISARMING_KEYPAD", SF_BOMB_CLOCK },
+  { DISARMING_MANUAL,  "DISARMING_MANUAL", SF_BOMB_CLOCK },
+  { DISARMING_RFID,    "DISARMING_RFID",   SF_BOMB_CLOCK },
+  { DISARMED,          "DISARMED",         SF_STOP_BEEP },
+  { PRE_EXPLOSION,     "PRE_EXPLOSION",    SF_STOP_BEEP },
+  { EXPLODED,          "EXPLODED",         SF_STOP_BEEP },
+  { EASTER_EGG,        "EASTER_EGG",       0 },
+  { EASTER_EGG_2,      "EASTER_EGG_2",     0 },
+  { CONFIG_MODE,       "CONFIG_MODE",      0 },
+  { STARWARS_PRE_GAME, "STARWARS_PRE",     0 },
+  { PROP_DUD,          "PROP_DUD",         SF_STOP_BEEP },
+  { TOLKIEN_GAME,      "TOLKIEN_GAME",     0 },
+};
+
+static constexpr const char* STATE_EVENT_NAMES[] = {
+  "none", "boot_await", "boot_config", "boot_tolkien", "arm_on", "arm_off", "sd_arm_on",
+  "sd_arm_off", "key", "code_ok", "code_bad", "code_starwars", "code_master", "code_jugs",
+  "cancel", "button_down", "button_up", "card_disarm", "disarm_done", "timeout", "dud",
+  "egg_done", "track_detonation", "track_dud", "track_jugs", "reset", "remote_arm", "round_start",
+};
+
+// Per-edge behaviour
+enum : uint8_t {
+  EF_KEEP_AUTOTYPE = 1 << 0,   // RFID auto-typing survives the transition
+  EF_SILENT        = 1 << 1    // boot-time switch: no entry actions, no notify
+};
+
+struct StateEdge { uint8_t from, event, to, flags; };
+
+static constexpr StateEdge STATE_EDGES[] = {
+  // Boot (setup())
+  { STANDBY,           EV_BOOT_AWAIT,       AWAIT_ARM_TOGGLE,  0 },
+  { STANDBY,           EV_BOOT_CONFIG,      CONFIG_MODE,       EF_SILENT },
+  { STANDBY,           EV_BOOT_TOLKIEN,     TOLKIEN_GAME,      0 },
+
+  // Arm switch
+  { STANDBY,           EV_ARM_OFF,          PROP_IDLE,         0 },
+  { PROP_IDLE,         EV_ARM_ON,           STANDBY,           0 },
+  { AWAIT_ARM_TOGGLE,  EV_ARM_ON,           STANDBY,           0 },
+  { DISARMED,          EV_ARM_ON,           STANDBY,           0 },
+  { EXPLODED,          EV_ARM_ON,           STANDBY,           0 },
+  { PROP_DUD,          EV_ARM_ON,           STANDBY,           0 },
+  { STANDBY,           EV_SD_ARM_ON,        ARMED,             0 },
+  { PROP_IDLE,         EV_SD_ARM_ON,        ARMED,             0 },
+  { ARMED,             EV_SD_ARM_OFF,       DISARMED,          0 },
+  { DISARMED,          EV_SD_ARM_OFF,       STANDBY,           0 },
+  { EXPLODED,          EV_SD_ARM_OFF,       STANDBY,           0 },
+
+  // Keypad: arming
+  { PROP_IDLE,         EV_KEY,              ARMING,            EF_KEEP_AUTOTYPE },
+  { ARMING,            EV_CODE_OK,          ARMED,             0 },
+  { ARMING,            EV_CODE_BAD,         PROP_IDLE,         0 },
+  { ARMING,            EV_CODE_STARWARS,    STARWARS_PRE_GAME, 0 },
+  { ARMING,            EV_CODE_MASTER,      EASTER_EGG,        0 },
+  { ARMING,            EV_CODE_JUGS,        EASTER_EGG_2,      0 },
+  { ARMING,            EV_CANCEL,           PROP_IDLE,         0 },
+  { STARWARS_PRE_GAME, EV_CODE_OK,          ARMED,             0 },
+  { STARWARS_PRE_GAME, EV_CANCEL,           PROP_IDLE,         0 },
+
+  // Keypad / button / tag: disarming
+  { ARMED,             EV_KEY,              DISARMING_KEYPAD,  0 },
+  { DISARMING_KEYPAD,  EV_CODE_OK,          DISARMED,          0 },
+  { DISARMING_KEYPAD,  EV_CODE_BAD,         ARMED,             0 },
+  { DISARMING_KEYPAD,  EV_CANCEL,           ARMED,             0 },
+  { ARMED,             EV_BUTTON_DOWN,      DISARMING_MANUAL,  0 },
+  { DISARMING_KEYPAD,  EV_BUTTON_DOWN,      DISARMING_MANUAL,  0 },
+  { DISARMING_MANUAL,  EV_BUTTON_UP,        ARMED,             0 },
+  { ARMED,             EV_CARD_DISARM,      DISARMING_RFID,    0 },
+  { DISARMING_KEYPAD,  EV_CARD_DISARM,      DISARMING_RFID,    0 },
+  { DISARMING_MANUAL,  EV_DISARM_DONE,      DISARMED,          0 },
+  { DISARMING_RFID,    EV_DISARM_DONE,      DISARMED,          0 },
+
+  // Clock
+  { ARMED,             EV_TIMEOUT,          PRE_EXPLOSION,     0 },
+  { DISARMING_KEYPAD,  EV_TIMEOUT,          PRE_EXPLOSION,     0 },
+  { DISARMING_MANUAL,  EV_TIMEOUT,          PRE_EXPLOSION,     0 },
+  { DISARMING_RFID,    EV_TIMEOUT,          PRE_EXPLOSION,     0 },
+  { PRE_EXPLOSION,     EV_TIMEOUT,          EXPLODED,          0 },
+
+  // Completion events from entry actions
+  { PRE_EXPLOSION,     EV_DUD,              PROP_DUD,          0 },
+  { EASTER_EGG,        EV_EGG_DONE,         ARMED,             0 },
+
+  // DFPlayer track finished. Detonation and dud apply in any state, as they always have.
+  { STATE_ANY,         EV_TRACK_DETONATION, EXPLODED,          0 },
+  { STATE_ANY,         EV_TRACK_DUD,        STANDBY,           0 },
+  { EASTER_EGG_2,      EV_TRACK_JUGS,       ARMED,             0 },
+
+  // Operator / scoreboard
+  { STATE_ANY,         EV_RESET,            STANDBY,           0 },
+  { PROP_IDLE,         EV_REMOTE_ARM,       ARMED,             0 },
+  { ARMING,            EV_REMOTE_ARM,       ARMED,             0 },
+  { STANDBY,           EV_ROUND_START,      PROP_IDLE,         0 },
+  { AWAIT_ARM_TOGGLE,  EV_ROUND_START,      PROP_IDLE,         0 },
+  { PROP_IDLE,         EV_ROUND_START,      PROP_IDLE,         0 },
+  { DISARMED,          EV_ROUND_START,      PROP_IDLE,         0 },
+  { EXPLODED,          EV_ROUND_START,      PROP_IDLE,         0 },
+  { PROP_DUD,          EV_ROUND_START,      PROP_IDLE,         0 },
+};
+
+static constexpr uint8_t STATE_EDGE_COUNT = sizeof(STATE_EDGES) / sizeof(STATE_EDGES[0]);
+static constexpr uint8_t STATE_NO_EDGE = 0xFF;
+
+// --- LOOKUP ---
+// Edge for (state, event): an edge from that state wins over a STATE_ANY edge
+constexpr uint8_t stateFindEdge(uint8_t from, uint8_t ev, uint8_t i = 0) {
+  return i >= STATE_EDGE_COUNT ? STATE_NO_EDGE
+       : (STATE_EDGES[i].from == from && STATE_EDGES[i].event == ev) ? i
+       : stateFindEdge(from, ev, i + 1);
+}
+constexpr uint8_t stateResolveEdge(uint8_t s, uint8_t ev) {
+  return stateFindEdge(s, ev) != STATE_NO_EDGE ? stateFindEdge(s, ev) : stateFindEdge(STATE_ANY, ev);
+}
+
+// Dense [state][event] -> edge index, expanded at compile time (one byte per pair)
+template <unsigned... I> struct StateSeq {};
+template <unsigned N, unsigned... I> struct StateSeqGen : StateSeqGen<N - 1, N - 1, I...> {};
+template <unsigned... I> struct StateSeqGen<0, I...> { typedef StateSeq<I...> type; };
+
+template <typename Seq> struct StateDispatch;
+template <unsigned... I> struct StateDispatch<StateSeq<I...> > {
+  static constexpr uint8_t edge[sizeof...(I)] = { stateResolveEdge(I / EV_COUNT, I % EV_COUNT)... };
+};
+template <unsigned... I> constexpr uint8_t StateDispatch<StateSeq<I...> >::edge[sizeof...(I)];
+typedef StateDispatch<StateSeqGen<STATE_COUNT * EV_COUNT>::type> StateEdgeTable;
+
+inline uint8_t stateEdgeFor(uint8_t s, uint8_t ev) {
+  return (s < STATE_COUNT && ev < EV_COUNT) ? StateEdgeTable::edge[s * EV_COUNT + ev] : STATE_NO_EDGE;
+}
+inline const char* stateName(uint8_t s) { return s < STATE_COUNT ? STATE_INFO[s].name : "UNKNOWN"; }
+inline const char* stateEventName(uint8_t ev) { return ev < EV_COUNT ? STATE_EVENT_NAMES[ev] : "?"; }
+inline bool stateHas(uint8_t s, uint8_t flag) { return s < STATE_COUNT && (STATE_INFO[s].flags & flag); }
+
+// --- COMPILE-TIME CHECKS ---
+constexpr bool stateInfoOrdered(uint8_t i = 0) {
+  return i >= STATE_COUNT || (STATE_INFO[i].id == i && stateInfoOrdered(i + 1));
+}
+constexpr bool stateEdgesWellFormed(uint8_t i = 0) {
+  return i >= STATE_EDGE_COUNT ||
+         ((STATE_EDGES[i].from < STATE_COUNT || STATE_EDGES[i].from == STATE_ANY) &&
+          STATE_EDGES[i].to < STATE_COUNT &&
+          STATE_EDGES[i].event > EV_NONE && STATE_EDGES[i].event < EV_COUNT &&
+          stateEdgesWellFormed(i + 1));
+}
+constexpr bool stateEdgesUnique(uint8_t i = 0) {
+  return i >= STATE_EDGE_COUNT ||
+         (stateFindEdge(STATE_EDGES[i].from, STATE_EDGES[i].event) == i && stateEdgesUnique(i + 1));
+}
+// One pass over the edges: add every target whose source is already reachable
+constexpr uint32_t stateReachStep(uint32_t reach, uint8_t i = 0) {
+  return i >= STATE_EDGE_COUNT ? reach
+       : stateReachStep(reach | ((STATE_EDGES[i].from == STATE_ANY || ((reach >> STATE_EDGES[i].from) & 1))
+                                 ? (1UL << STATE_EDGES[i].to) : 0), i + 1);
+}
+constexpr uint32_t stateReachable(uint32_t reach) {
+  return stateReachStep(reach) == reach ? reach : stateReachable(stateReachStep(reach));
+}
+constexpr bool stateHasExit(uint8_t s, uint8_t i = 0) {
+  return i < STATE_EDGE_COUNT &&
+         (((STATE_EDGES[i].from == s || STATE_EDGES[i].from == STATE_ANY) && STATE_EDGES[i].to != s) ||
+          stateHasExit(s, i + 1));
+}
+constexpr bool stateNoDeadEnds(uint8_t s = 0) {
+  return s >= STATE_COUNT || (stateHasExit(s) && stateNoDeadEnds(s + 1));
+}
+constexpr bool stateEventHandled(uint8_t ev, uint8_t i = 0) {
+  return i < STATE_EDGE_COUNT && (STATE_EDGES[i].event == ev || stateEventHandled(ev, i + 1));
+}
+constexpr bool stateEventsHandled(uint8_t ev = EV_NONE + 1) {
+  return ev >= EV_COUNT || (stateEventHandled(ev) && stateEventsHandled(ev + 1));
+}
+
+static_assert(STATE_COUNT <= 32, "reachability mask is 32 bits");
+static_assert(sizeof(STATE_INFO) / sizeof(STATE_INFO[0]) == STATE_COUNT, "STATE_INFO needs one row per PropState");
+static_assert(stateInfoOrdered(), "STATE_INFO rows must follow PropState order");
+static_assert(sizeof(STATE_EVENT_NAMES) / sizeof(STATE_EVENT_NAMES[0]) == EV_COUNT, "one name per StateEvent");
+static_assert(stateEdgesWellFormed(), "transition names an unknown state or event");
+static_assert(stateEdgesUnique(), "two transitions for the same (state, event)");
+static_assert(stateReachable(1UL << STANDBY) == (1UL << STATE_COUNT) - 1, "state unreachable from STANDBY");
+static_assert(stateNoDeadEnds(), "state has no outgoing transition");
+static_assert(stateEventsHandled(), "event not handled by any transition");
@@ -1,5 +1,6 @@
 // TolkienGame.h
-// VERSION: 2.6.1
+// VERSION: 2.6.2
+// CHANGED: Enters/leaves through StateTable.h events
 // Mini-game based on Lord of the Rings trivia.
 // Triggered by holding '0' on boot.
 // UPDATED: Removed all FastLED.show() calls to prevent flickering.
@@ -258,7 +259,7 @@ inline void checkNextRoundLogic() {
 }
 
 inline void startTolkienGame() {
-    setState(TOLKIEN_GAME); 
+    stateFire(EV_BOOT_TOLKIEN); 
     currentTolkienRound = 0; tolkienScore = 0; tolkienInputBuffer[0] = '\0';
     tDisplayNeedsUpdate = true; tState = T_INTRO; tStateTimer = millis();
     safePlayForce(70); 
@@ -289,7 +290,7 @@ inline void serviceTolkienGame(char key) {
             break;
         }
         case T_GAME_OVER:
-            if (key == '#') setState(STANDBY);
+            if (key == '#') stateFire(EV_RESET);
             break;
         case T_QUESTION:
             if (key) {
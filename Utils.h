@@ -1,12 +1,13 @@
 // Utils.h
-//VERSION: 2.1.0
-// FIXED: Updated menu sounds to use safePlay()
+//VERSION: 2.1.1
+// CHANGED: Restart logs via Log.h; the 250 ms countdown log is debug-level
 
 #pragma once
 #include <Arduino.h>
 #include <string.h>
 #include "Sounds.h"
 #include "Hardware.h"
+#include "Log.h"
 
 // ---------- Non-blocking menu audio ----------
 #ifndef MENU_SOUNDS
@@ -79,7 +80,7 @@ extern volatile uint32_t g_restartAtMs;
 inline void requestRestart(uint32_t delayMs = 500) {
   uint32_t when = millis() + delayMs;
   g_restartAtMs = when;
-  Serial.printf("[REBOOT] requestRestart(%u) scheduled for t=%u ms\n", delayMs, when);
+  LOG_I("[REBOOT] requestRestart(%u) scheduled for t=%u ms", (unsigned)delayMs, (unsigned)when);
 }
 
 inline void restartPump() {
@@ -89,12 +90,13 @@ inline void restartPump() {
   int32_t remaining = (int32_t)(g_restartAtMs - millis());
   if ((millis() - lastLog) > 250) {           
     lastLog = millis();
-    Serial.printf("[REBOOT] pending… now=%u target=%u remaining=%ld ms\n",
+    LOG_D("[REBOOT] pending… now=%u target=%u remaining=%ld ms",
                   (unsigned)millis(), (unsigned)g_restartAtMs, (long)remaining);
   }
 
   if (remaining <= 0) {
-    Serial.println("[REBOOT] firing now: stopping audio/LED, restarting ESP");
+    LOG_I("[REBOOT] firing now: stopping audio/LED, restarting ESP");
+    logFlush();
     beepStop(); // Ensure silence
     
     // Stop Servo
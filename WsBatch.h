@@ -0,0 +1,109 @@
+// WsBatch.h
+// VERSION: 1.0.0
+// Outbound WebSocket coalescing. Messages queued within WS_BATCH_WINDOW_MS of the
+// first one go out as a single text frame "[m1,m2,...]" (a lone message is sent bare).
+// Order is preserved; urgent messages flush the whole batch immediately.
+
+#pragma once
+#include <Arduino.h>
+
+#ifndef WS_BATCH_WINDOW_MS
+  #define WS_BATCH_WINDOW_MS 40     // 0 = no coalescing (one frame per message)
+#endif
+#ifndef WS_BATCH_MAX_BYTES
+  #define WS_BATCH_MAX_BYTES 1024   // frame buffer; a full buffer flushes early
+#endif
+
+// Writes one text frame to the socket (set by Network.h)
+typedef void (*WsFrameSink)(const uint8_t* data, size_t len);
+
+static char     wbBuf[WS_BATCH_MAX_BYTES];
+static size_t   wbLen = 0;               // bytes in wbBuf, including the leading '['
+static uint16_t wbCount = 0;             // messages in the pending frame
+static uint32_t wbFirstMs = 0;           // when the pending frame got its first message
+static WsFrameSink wbSink = nullptr;
+
+// Totals + per-second rates (refreshed once a second by wsBatchPoll)
+static uint32_t wbFrames = 0, wbBytes = 0, wbMsgs = 0;
+static uint32_t wbRateFrames = 0, wbRateBytes = 0, wbRateMsgs = 0;
+static uint32_t wbRateMarkFrames = 0, wbRateMarkBytes = 0, wbRateMarkMsgs = 0;
+static uint32_t wbRateMarkMs = 0;
+
+inline void wsBatchBegin(WsFrameSink sink) { wbSink = sink; }
+
+inline void wbWrite(const char* p, size_t n) {
+  if (wbSink) wbSink((const uint8_t*)p, n);
+  wbFrames++;
+  wbBytes += n;
+}
+
+inline void wsBatchFlush() {
+  if (!wbCount) return;
+  if (wbCount == 1) {
+    wbWrite(wbBuf + 1, wbLen - 1);       // single message: no array wrapper
+  } else {
+    wbBuf[wbLen++] = ']';
+    wbWrite(wbBuf, wbLen);
+  }
+  wbLen = 0;
+  wbCount = 0;
+}
+
+// Drop anything pending (socket went away; stale telemetry is not worth replaying).
+inline void wsBatchReset() {
+  wbLen = 0;
+  wbCount = 0;
+}
+
+inline void wsBatchPush(const char* msg, size_t n, bool urgent) {
+  wbMsgs++;
+  // Room for '[' + ',' + msg + ']'
+  if (wbCount && wbLen + 1 + n + 1 > sizeof(wbBuf)) wsBatchFlush();
+  if (n + 2 > sizeof(wbBuf)) {           // too big to ever batch: send on its own
+    wbWrite(msg, n);
+    return;
+  }
+  if (!wbCount) {
+    wbBuf[0] = '[';
+    wbLen = 1;
+    wbFirstMs = millis();
+  } else {
+    wbBuf[wbLen++] = ',';
+  }
+  memcpy(wbBuf + wbLen, msg, n);
+  wbLen += n;
+  wbCount++;
+  if (urgent || WS_BATCH_WINDOW_MS == 0) wsBatchFlush();
+}
+
+// Call every loop: closes the window and keeps the rate counters fresh.
+inline void wsBatchPoll() {
+  uint32_t now = millis();
+  if (wbCount && (now - wbFirstMs) >= WS_BATCH_WINDOW_MS) wsBatchFlush();
+
+  if (now - wbRateMarkMs >= 1000) {
+    uint32_t dt = now - wbRateMarkMs;
+    wbRateFrames = (wbFrames - wbRateMarkFrames) * 1000UL / dt;
+    wbRateBytes  = (wbBytes  - wbRateMarkBytes)  * 1000UL / dt;
+    wbRateMsgs   = (wbMsgs   - wbRateMarkMsgs)   * 1000UL / dt;
+    wbRateMarkFrames = wbFrames; wbRateMarkBytes = wbBytes; wbRateMarkMsgs = wbMsgs;
+    wbRateMarkMs = now;
+  }
+}
+
+// --- REPORTING ---
+inline void wsBatchPrintStats(Print& out) {
+  out.printf("[WS] window=%ums frames=%u msgs=%u bytes=%u | now: %u frames/s %u msgs/s %u B/s\n",
+             (unsigned)WS_BATCH_WINDOW_MS, (unsigned)wbFrames, (unsigned)wbMsgs, (unsigned)wbBytes,
+             (unsigned)wbRateFrames, (unsigned)wbRateMsgs, (unsigned)wbRateBytes);
+}
+
+inline String wsBatchStatsJson() {
+  char buf[192];
+  snprintf(buf, sizeof(buf),
+           "{\"type\":\"ws_stats\",\"window_ms\":%u,\"frames\":%u,\"msgs\":%u,\"bytes\":%u,"
+           "\"frames_per_s\":%u,\"msgs_per_s\":%u,\"bytes_per_s\":%u}",
+           (unsigned)WS_BATCH_WINDOW_MS, (unsigned)wbFrames, (unsigned)wbMsgs, (unsigned)wbBytes,
+           (unsigned)wbRateFrames, (unsigned)wbRateMsgs, (unsigned)wbRateBytes);
+  return String(buf);
+}
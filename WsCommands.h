@@ -0,0 +1,240 @@
+// WsCommands.h
+// VERSION: 1.3.1
+// CHANGED: wsBareRequest() takes a const message (the .ino matches ws_stats with it)
+// CHANGED: {"type":"metrics"} requests are matched here (exact, bare object) and "metrics" is a
+//          read-only command; an echo of the prop's own metrics push no longer triggers another
+// FIXED: "arm" applies the keypad's checks: plant sensor, exactly CODE_LENGTH digits, the fixed
+//        code when one is required, and no special-table code (those are not plain arming)
+// CHANGED: Bomb time range comes from SettingsFields.h
+// ADDED: "timer" command: pause/resume, rate, add/sub time on the bomb Countdown; status reports paused/rate
+// CHANGED: Remaining time and remote arm use the bomb deadline (GameClock.h)
+// CHANGED: reset/arm go through StateTable.h events
+// CHANGED: Logs go through Log.h
+// Scoreboard -> prop command API. Parsed in place in the WebSocket RX buffer (JsonLite.h).
+//
+//   {"type":"cmd","id":7,"token":"<settings.cmd_token>","cmd":"<name>", ...args}
+//   reply: {"type":"cmd_result","id":7,"cmd":"<name>","ok":true|false[,"err":"..."], ...}
+//
+// Commands: status, metrics (no token needed), reset, arm [code], set_time value [save],
+//           volume value [save], play value, stop,
+//           timer op=pause|resume|rate|add|sub [value] (rate in % of real time, add/sub in ms;
+//           only while the bomb clock runs; the reply carries remaining_ms, paused and rate_pct).
+// Mutating commands need a non-empty cmd_token (serial: "token <value>").
+// The older bare request {"type":"metrics"} (no other keys) is accepted too.
+
+#pragma once
+#include <Arduino.h>
+#include "Config.h"
+#include "State.h"
+#include "Hardware.h"
+#include "JsonLite.h"
+#include "SettingsFields.h"
+#include "SpecialCodes.h"
+#include "PlantSensor.h"
+
+#ifndef WS_CMD_MAX_TOKENS
+  #define WS_CMD_MAX_TOKENS 32
+#endif
+
+static const uint8_t  WS_CMD_MAX_BAD_AUTH  = 5;       // wrong tokens before lockout
+static const uint32_t WS_CMD_LOCKOUT_MS    = 30000;
+static const uint32_t WS_CMD_MIN_BOMB_MS   = SETTINGS_MIN_BOMB_MS;
+static const uint32_t WS_CMD_MAX_BOMB_MS   = SETTINGS_MAX_BOMB_MS;
+static const uint32_t WS_CMD_MAX_ADJUST_MS = 3600000; // timer add/sub per command
+
+static uint8_t  wsCmdBadAuth = 0;
+static uint32_t wsCmdLockedUntilMs = 0;
+static uint32_t wsCmdCount = 0, wsCmdRejected = 0;
+
+// Constant-time compare against settings.cmd_token
+inline bool cmdTokenMatches(const char* s, size_t got) {
+  size_t want = strnlen(settings.cmd_token, sizeof(settings.cmd_token));
+  if (!s || want == 0 || got == 0) return false;
+  uint8_t diff = (got != want);
+  for (size_t i = 0; i < want; i++) diff |= (uint8_t)(settings.cmd_token[i] ^ s[i < got ? i : 0]);
+  return diff == 0;
+}
+
+inline bool wsCmdTokenOk(const char* js, const JsonTok* tok) {
+  return tok && tok->type == JSON_STRING && cmdTokenMatches(js + tok->start, jsonLen(*tok));
+}
+
+// Token check with the shared wrong-token lockout. nullptr = authorized, else the error.
+inline const char* cmdAuthorize(bool tokenOk) {
+  if (wsCmdLockedUntilMs && (int32_t)(millis() - wsCmdLockedUntilMs) < 0) return "locked";
+  if (!tokenOk) {
+    if (++wsCmdBadAuth >= WS_CMD_MAX_BAD_AUTH) { wsCmdLockedUntilMs = millis() + WS_CMD_LOCKOUT_MS; wsCmdBadAuth = 0; }
+    return settings.cmd_token[0] ? "auth" : "no_token_set";
+  }
+  wsCmdBadAuth = 0;
+  return nullptr;
+}
+
+inline void wsCmdReply(uint32_t id, const char* cmd, const char* err, const char* extra = nullptr) {
+  char buf[256];
+  snprintf(buf, sizeof(buf), "{\"type\":\"cmd_result\",\"id\":%u,\"cmd\":\"%s\",\"ok\":%s%s%s%s%s}",
+           (unsigned)id, cmd, err ? "false" : "true",
+           err ? ",\"err\":\"" : "", err ? err : "", err ? "\"" : "",
+           extra ? extra : "");
+  wsSendJson(String(buf));
+  if (err) { wsCmdRejected++; LOG_W("[CMD] %s rejected: %s", cmd, err); }
+  else     LOG_I("[CMD] %s ok", cmd);
+}
+
+inline void publishMetrics();   // Network.h
+
+// {"type":"<type>"} and nothing else. The prop's own pushes reuse these types with payload
+// fields, so a scoreboard echoing one back is not taken for a request.
+inline bool wsBareRequest(const char* msg, size_t len, const char* type) {
+  JsonTok toks[3];
+  int n = jsonTokenize(msg, len, toks, 3);
+  if (n != 3 || toks[0].type != JSON_OBJECT || toks[0].size != 1) return false;
+  int t = jsonFind(msg, toks, n, 0, "type");
+  return t >= 0 && toks[t].type == JSON_STRING && jsonEq(msg, toks[t], type);
+}
+
+inline bool wsCmdInGame() { return currentState >= ARMED && currentState < DISARMED; }
+
+// Returns true if msg was a command (handled or rejected); false lets other handlers see it.
+// msg must be writable (the WebSocketsClient RX buffer is).
+inline bool wsCommandDispatch(char* msg, size_t len) {
+  if (msg && strstr(msg, "\"metrics\"") && wsBareRequest(msg, len, "metrics")) { publishMetrics(); return true; }
+  if (!msg || !strstr(msg, "\"cmd\"")) return false;          // cheap pre-filter
+
+  JsonTok toks[WS_CMD_MAX_TOKENS];
+  int n = jsonTokenize(msg, len, toks, WS_CMD_MAX_TOKENS);
+  if (n < 1 || toks[0].type != JSON_OBJECT) return false;
+  int t = jsonFind(msg, toks, n, 0, "type");
+  if (t < 0 || !jsonEq(msg, toks[t], "cmd")) return false;
+
+  wsCmdCount++;
+  uint32_t id = 0, value = 0;
+  int ti = jsonFind(msg, toks, n, 0, "id");
+  if (ti >= 0) jsonU32(msg, toks[ti], id);
+  int ci = jsonFind(msg, toks, n, 0, "cmd");
+  if (ci < 0 || toks[ci].type != JSON_STRING || jsonLen(toks[ci]) > 16) { wsCmdReply(id, "?", "bad_cmd"); return true; }
+  int vi = jsonFind(msg, toks, n, 0, "value");
+  bool hasValue = (vi >= 0) && jsonU32(msg, toks[vi], value);
+  int si = jsonFind(msg, toks, n, 0, "save");
+  bool save = (si >= 0) && jsonBool(msg, toks[si]);
+  int ki = jsonFind(msg, toks, n, 0, "token");
+  int ai = jsonFind(msg, toks, n, 0, "code");
+  int oi = jsonFind(msg, toks, n, 0, "op");
+
+  // Read-only: no token
+  if (jsonEq(msg, toks[ci], "status")) {
+    uint32_t rem = 0;
+    if (wsCmdInGame()) {
+      rem = bombRemainingMs();
+    }
+    char extra[160];
+    snprintf(extra, sizeof(extra), ",\"state\":\"%s\",\"remaining_ms\":%u,\"bomb_duration_ms\":%u,\"paused\":%s,\"volume\":%u,\"fw\":\"%s\"",
+             getStateName(currentState), (unsigned)rem, (unsigned)settings.bomb_duration_ms,
+             (wsCmdInGame() && bombClock.paused) ? "true" : "false", (unsigned)settings.sound_volume, FW_VERSION);
+    wsCmdReply(id, "status", nullptr, extra);
+    return true;
+  }
+  if (jsonEq(msg, toks[ci], "metrics")) {
+    wsCmdReply(id, "metrics", nullptr);
+    publishMetrics();
+    return true;
+  }
+
+  // Everything else is authenticated
+  char cmd[17];
+  memcpy(cmd, msg + toks[ci].start, jsonLen(toks[ci]));
+  cmd[jsonLen(toks[ci])] = '\0';
+
+  const char* authErr = cmdAuthorize(wsCmdTokenOk(msg, ki >= 0 ? &toks[ki] : nullptr));
+  if (authErr) { wsCmdReply(id, cmd, authErr); return true; }
+
+  if (strcmp(cmd, "reset") == 0) {
+    if (currentState == CONFIG_MODE) { wsCmdReply(id, cmd, "busy"); return true; }
+    resetSpecialModes();
+    stateFire(EV_RESET);
+    wsCmdReply(id, cmd, nullptr);
+  }
+  else if (strcmp(cmd, "arm") == 0) {
+    if (!stateAccepts(EV_REMOTE_ARM)) { wsCmdReply(id, cmd, "bad_state"); return true; }
+    if (!isBombPlanted()) { wsCmdReply(id, cmd, "not_planted"); return true; }
+    // Same rules as ARMING + '#' (processArmingCode): CODE_LENGTH digits, the fixed code if
+    // one is required, and nothing the special-code table would treat as something else
+    char code[CODE_LENGTH + 1];
+    if (ai >= 0) {
+      if (toks[ai].type != JSON_STRING || jsonLen(toks[ai]) != CODE_LENGTH) { wsCmdReply(id, cmd, "bad_code"); return true; }
+      for (int i = toks[ai].start; i < toks[ai].end; i++) {
+        if (msg[i] < '0' || msg[i] > '9') { wsCmdReply(id, cmd, "bad_code"); return true; }
+      }
+      memcpy(code, msg + toks[ai].start, CODE_LENGTH);
+      code[CODE_LENGTH] = '\0';
+      const SpecialCode* sc = specialCodeFind(code);
+      if (sc && (!(sc->flags & SC_EASTER_EGG) || settings.easter_eggs_enabled)) { wsCmdReply(id, cmd, "special_code"); return true; }
+      if (settings.fixed_code_enabled && strcmp(code, settings.fixed_code_val) != 0) { wsCmdReply(id, cmd, "wrong_code"); return true; }
+    } else if (settings.fixed_code_enabled) {
+      strncpy(code, settings.fixed_code_val, CODE_LENGTH);
+      code[CODE_LENGTH] = '\0';
+    } else {
+      do {
+        for (uint8_t i = 0; i < CODE_LENGTH; i++) code[i] = (char)('0' + random(10));
+        code[CODE_LENGTH] = '\0';
+      } while (specialCodeFind(code));
+    }
+    strcpy(activeArmCode, code);
+    bombClockStart();
+    safePlay(SOUND_BOMB_PLANTED);
+    c4OnEnterArmed();
+    stateFire(EV_REMOTE_ARM);
+    char extra[32];
+    snprintf(extra, sizeof(extra), ",\"code\":\"%s\"", activeArmCode);
+    wsCmdReply(id, cmd, nullptr, extra);
+  }
+  else if (strcmp(cmd, "set_time") == 0) {
+    if (!hasValue || value < WS_CMD_MIN_BOMB_MS || value > WS_CMD_MAX_BOMB_MS) { wsCmdReply(id, cmd, "bad_value"); return true; }
+    if (wsCmdInGame()) { wsCmdReply(id, cmd, "bad_state"); return true; }
+    settings.bomb_duration_ms = value;
+    if (save) saveSettings();
+    displayNeedsUpdate = true;
+    wsCmdReply(id, cmd, nullptr);
+  }
+  else if (strcmp(cmd, "volume") == 0) {
+    if (!hasValue || value > 30) { wsCmdReply(id, cmd, "bad_value"); return true; }
+    settings.sound_volume = (uint8_t)value;
+    safeVolume(settings.sound_volume);
+    if (save && !wsCmdInGame()) saveSettings();
+    wsCmdReply(id, cmd, nullptr);
+  }
+  else if (strcmp(cmd, "play") == 0) {
+    if (!hasValue || value == 0 || value > 255) { wsCmdReply(id, cmd, "bad_value"); return true; }
+    safePlay((int)value);
+    wsCmdReply(id, cmd, nullptr);
+  }
+  else if (strcmp(cmd, "stop") == 0) {
+    safeStop();
+    wsCmdReply(id, cmd, nullptr);
+  }
+  else if (strcmp(cmd, "timer") == 0) {
+    if (!wsCmdInGame()) { wsCmdReply(id, cmd, "bad_state"); return true; }
+    if (oi < 0 || toks[oi].type != JSON_STRING) { wsCmdReply(id, cmd, "bad_op"); return true; }
+    GameUs now = gameNowUs();
+    const char* err = nullptr;
+    if (jsonEq(msg, toks[oi], "pause"))       { if (!bombClockPause()) err = "bad_state"; }
+    else if (jsonEq(msg, toks[oi], "resume")) { if (!bombClockResume()) err = "bad_state"; }
+    else if (jsonEq(msg, toks[oi], "rate")) {
+      if (!hasValue || value > 0xFFFF || !bombClock.setRate((uint16_t)value, now)) err = "bad_value";
+    }
+    else if (jsonEq(msg, toks[oi], "add") || jsonEq(msg, toks[oi], "sub")) {
+      if (!hasValue || value == 0 || value > WS_CMD_MAX_ADJUST_MS) err = "bad_value";
+      else bombClock.addMs(jsonEq(msg, toks[oi], "add") ? (int32_t)value : -(int32_t)value, now);
+    }
+    else err = "bad_op";
+    if (!err) displayNeedsUpdate = true;
+    char extra[80];
+    snprintf(extra, sizeof(extra), ",\"remaining_ms\":%u,\"paused\":%s,\"rate_pct\":%u",
+             (unsigned)bombClock.leftMs(now), bombClock.paused ? "true" : "false", (unsigned)bombClock.ratePct);
+    wsCmdReply(id, cmd, err, extra);
+  }
+  else {
+    wsCmdReply(id, cmd, "unknown_cmd");
+  }
+  return true;
+}
@@ -4,11 +4,32 @@
   AUTHOR: Andrew Florio
 
   airsoft_CSGO_C4_V3_0_WEB.ino
-  VERSION: 4.1.0
+  VERSION: 4.20.2
 
   Header-only modular structure for Arduino IDE, with Wi-Fi + mDNS + WebSocket.
   OPTIMIZATION: Throttled LED updates to improve Keypad responsiveness.
   ADDED: Tolkien Mini-Game (Hold '0' on boot)
+  ADDED: Hot-path profiler probes (C4_PROFILE=1) + "prof" serial command
+  ADDED: Loop stall monitor (histogram + tagged stalls kept in RTC memory)
+  ADDED: WebSocket frame coalescing + "ws" serial command
+  FIXED: Only a bare {"type":"ws_stats"} asks for WS stats; an echoed stats push no longer loops
+  ADDED: Countdown tick stream with RTT/clock-offset estimate ("sync" serial command)
+  ADDED: Optional ESP-NOW mesh transport (C4_ESPNOW=1) + "mesh" serial command
+  ADDED: Authenticated scoreboard commands (WsCommands.h) + "token" serial command
+  ADDED: Remote round orchestration (RoundControl.h) + "round" serial command
+  CHANGED: Scoreboard connection FSM with jittered backoff (ConnFsm.h) + "conn" serial command
+  ADDED: HTTP REST API for status, settings and the RFID table (HttpApi.h) + "http" serial command
+  ADDED: Counters/gauges in Prometheus format (Metrics.h): GET /metrics, WS "metrics", "metrics" serial command
+  FIXED: WS metrics requests go through WsCommands.h; an echoed metrics push no longer loops
+  CHANGED: Deferred, leveled logging (Log.h) drained at the end of loop() + "log" serial command
+  ADDED: Patch/compressed OTA over POST /api/ota, STANDBY-only, trial boot with rollback (Ota.h) + "ota" serial command
+  CHANGED: Table-driven game state machine with compile-time checked transitions (StateTable.h)
+  CHANGED: Doom/Star Wars/Terminator/Bond are GameMode hook tables (GameModes.h)
+  CHANGED: Config menu is a table (ConfigMenu.h) drawn by MenuTree.h with partial LCD updates
+  CHANGED: Game timers are 64-bit µs deadlines (GameClock.h), immune to the 49.7-day millis() wrap
+  ADDED: Countdown object with pause/resume, rate and add/subtract time (Countdown.h) + WS "timer" command
+  ADDED: Per-state power policy: RFID power-down, dark LEDs, modem/light sleep (Power.h) + "power" serial command
+  ADDED: Power budget: rail voltage sensing, LED dimming and a staggered shell pop under a mA limit (PowerBudget.h)
 */
 
 #include <Arduino.h>
@@ -17,6 +38,8 @@
 #include "Pins.h"
 #include "Config.h"
 #include "Sounds.h"
+#include "Profiler.h"
+#include "LoopMonitor.h"
 
 // 2. New Modules
 #include "ShellEjector.h"  
@@ -30,10 +53,81 @@
 #include "Network.h"
 #include "Game.h"
 #include "TolkienGame.h" // <--- Added
+#include "HttpApi.h"
+#include "Power.h"
 
 // ---- Default (weak) WS inbound handler ----
 __attribute__((weak)) void handleInboundWsMessage(const char* msg) {
-  Serial.printf("[WS] RX: %s\n", msg ? msg : "(null)");
+  if (msg && strstr(msg, "\"prof_dump\"")) {
+    wsSendJson(profToJson());
+    return;
+  }
+  if (msg && strstr(msg, "\"ws_stats\"") && wsBareRequest(msg, strlen(msg), "ws_stats")) {
+    wsSendJson(wsBatchStatsJson());
+    return;
+  }
+  if (msg && strstr(msg, "\"log_stream\"")) {
+    const char* lv = strstr(msg, "\"level\":");
+    int level = lv ? atoi(lv + 8) : 0;
+    logWsLevel = (uint8_t)(level < 0 ? 0 : level > LOG_LEVEL_DEBUG ? LOG_LEVEL_DEBUG : level);
+    LOG_I("[LOG] WS stream level %u", (unsigned)logWsLevel);
+    return;
+  }
+  LOG_W("[WS] Unhandled: %s", msg ? msg : "(null)");
+}
+
+// ---- Serial console (line based, non-blocking) ----
+// Commands: "prof" = dump probe table, "prof reset" = clear stats,
+//           "loop" = loop latency histogram + recent stalls, "journal" = event outbox status,
+//           "ws" = outbound frame/byte rates, "sync" = RTT/offset estimate, "mesh" = ESP-NOW link,
+//           "token <secret>" / "token -" = set / clear the WS command token, "round" = staged round,
+//           "conn" = connection phase, backoff and per-phase reconnect timing, "http" = REST API counters,
+//           "metrics" = all counters/gauges in Prometheus text format,
+//           "log" = logger status, "log <0-4>" = serial log level (0 off .. 4 debug),
+//           "ota" = partitions, trial state, last update,
+//           "power" = estimated current per state, "power reset" = clear it
+inline void serialConsolePump() {
+  static char line[32];
+  static uint8_t len = 0;
+  while (Serial.available()) {
+    char c = (char)Serial.read();
+    if (c == '\r') continue;
+    if (c != '\n') {
+      if ((size_t)len + 1 < sizeof(line)) line[len++] = c;
+      continue;
+    }
+    line[len] = '\0';
+    len = 0;
+
+    if (strcmp(line, "prof") == 0)            profPrintTable(Serial);
+    else if (strcmp(line, "prof reset") == 0) { profReset(); Serial.println("[PROF] Stats cleared."); }
+    else if (strcmp(line, "journal") == 0)    journalPrintStatus(Serial);
+    else if (strcmp(line, "ws") == 0)         wsBatchPrintStats(Serial);
+    else if (strcmp(line, "sync") == 0)       clockSyncPrintStatus(Serial);
+    else if (strcmp(line, "mesh") == 0)       espNowPrintStatus(Serial);
+    else if (strcmp(line, "round") == 0)      roundPrintStatus(Serial);
+    else if (strcmp(line, "conn") == 0)       connPrintStatus(Serial);
+    else if (strcmp(line, "http") == 0)       httpApiPrintStatus(Serial);
+    else if (strcmp(line, "log") == 0)        logPrintStatus(Serial);
+    else if (strcmp(line, "ota") == 0)        otaPrintStatus(Serial);
+    else if (strcmp(line, "power") == 0)      powerPrintStatus(Serial);
+    else if (strcmp(line, "power reset") == 0) { powerReset(); Serial.println("[PWR] Stats cleared."); }
+    else if (strncmp(line, "log ", 4) == 0 && line[4] >= '0' && line[4] <= '4') {
+      logSerialLevel = (uint8_t)(line[4] - '0');
+      logPrintStatus(Serial);
+    }
+    else if (strcmp(line, "metrics") == 0)    { MetricsOut o; o.begin(false, metricsSinkPrint, &Serial); metricsWriteAll(o); }
+    else if (strncmp(line, "token ", 6) == 0) {
+      const char* tok = line + 6;
+      if (strcmp(tok, "-") == 0) tok = "";
+      memset(settings.cmd_token, 0, sizeof(settings.cmd_token));
+      strncpy(settings.cmd_token, tok, sizeof(settings.cmd_token) - 1);
+      saveSettings();
+      Serial.printf("[CMD] Command token %s.\n", settings.cmd_token[0] ? "set" : "cleared (remote commands disabled)");
+    }
+    else if (strcmp(line, "loop") == 0)       { loopMonPrintReport(Serial, lmRtc, "this boot"); loopMonPrintBootReport(Serial); }
+    else if (line[0])                         Serial.printf("[CON] Unknown command: %s\n", line);
+  }
 }
 
 // ---- Define globals declared in headers ----
@@ -55,19 +149,15 @@ Keypad keypad = Keypad(makeKeymap(KEYS), ROW_PINS, COL_PINS, KEYPAD_ROWS, KEYPAD
 
 // State and config globals
 PropState currentState = STANDBY;
-ConfigState currentConfigState = MENU_MAIN;
 
-uint32_t bombArmedTimestamp = 0;
-uint32_t disarmStartTimestamp = 0;
-uint32_t lastBeepTimestamp = 0;
-uint32_t stateEntryTimestamp = 0;
+Countdown bombClock;
+Countdown disarmClock;
+BeepCadence bombBeep;
+GameUs stateEnteredUs = 0;
 uint32_t lastStarPressTime = 0;
 bool ledIsOn = false;
 bool displayNeedsUpdate = true;
 int nextTrackToPlay = 0;
-int configMenuIndex = 0;
-char configInputBuffer[CONFIG_INPUT_MAX] = "";
-int rfidViewIndex = 0;
 volatile uint32_t g_restartAtMs = 0;   // for Utils.h deferred restart
 
 bool servoTriggeredThisExplosion = false; 
@@ -75,7 +165,7 @@ bool servoTriggeredThisExplosion = false;
 // Codes
 char enteredCode[CODE_LENGTH + 1] = "";
 char activeArmCode[CODE_LENGTH + 1] = "";
-const char* MASTER_CODE = "7355608";
+const char* MASTER_CODE = C4_MASTER_CODE;   // SpecialCodes.h
 
 // Settings storage
 Settings settings;
@@ -85,9 +175,16 @@ bool wifiOverrideDisabledThisBoot = false;
 
 void setup() {
   Serial.begin(115200);
-  Serial.println("C4 Prop Booting Up...");
+  LOG_I("C4 Prop Booting Up...");
   Serial.flush();
 
+  // Stall data from the previous boot survives soft resets in RTC memory
+  loopMonBegin([](uint8_t s) { return getStateName((PropState)s); });
+  loopMonPrintBootReport(Serial);
+
+  // Before anything that could crash a bad update: count this boot or roll back
+  otaBootCheck();
+
   EEPROM.begin(EEPROM_SIZE);
   factoryResetSettingsIfMagicChanged(); // handle struct changes
   loadSettings();
@@ -116,13 +213,12 @@ void setup() {
   }
   
   if (starHeld) {
-    currentState = CONFIG_MODE;
-    currentConfigState = MENU_MAIN;
-    displayNeedsUpdate = true;
+    stateFire(EV_BOOT_CONFIG);
   }
   
   // NOTE: Zero held logic is handled at end of setup to allow hardware init first
 
+  powerBegin();
   initHardware(); 
   initShellEjector();
   initPlantSensor();
@@ -145,27 +241,36 @@ void setup() {
   beginNetwork(wifiOverrideDisabledThisBoot);
 
   // Final check for Game Mode
-  if (currentState != CONFIG_MODE) {
+  if (currentState == CONFIG_MODE) {
+    configMenuBegin();   // after the boot screens: the menu owns the LCD from here
+  }
+  else {
     if (zeroHeld) {
         startTolkienGame();
     }
     else if (armSwitch.read() == LOW) {
-        setState(AWAIT_ARM_TOGGLE);
-    } 
-    else {
-        setState(STANDBY);
+        stateFire(EV_BOOT_AWAIT);
     }
+    // otherwise stay in STANDBY
   }
 
-  Serial.println("Setup complete.");
+  LOG_I("Setup complete.");
+  logFlush();   // boot logs out before the game loop starts (blocking is fine here)
 }
 
 void loop() {
-  char key = keypad.getKey();
+  loopMonTick((uint8_t)currentState);
+
+  char key;
+  { PROF_SCOPE(PROF_KEYPAD); STALL_TAG_SCOPE(STALL_TAG_KEYPAD); key = keypad.getKey(); }
 
   // 1. Service Audio Events
-  if (myDFPlayer.available()) {
-    printDetail(myDFPlayer.readType(), myDFPlayer.read());
+  {
+    PROF_SCOPE(PROF_DFPLAYER);
+    STALL_TAG_SCOPE(STALL_TAG_DFPLAYER);
+    if (myDFPlayer.available()) {
+      printDetail(myDFPlayer.readType(), myDFPlayer.read());
+    }
   }
 
   // 2. State Logic
@@ -175,40 +280,50 @@ void loop() {
       // We do NOT call updateDisplay() here, as TolkienGame handles its own LCD
   } 
   else if (currentState == CONFIG_MODE) {
-      handleConfigMode(key);
-      updateDisplay();
+      { STALL_TAG_SCOPE(STALL_TAG_CONFIG); handleConfigMode(key); }
+      { PROF_SCOPE(PROF_DISPLAY); STALL_TAG_SCOPE(STALL_TAG_DISPLAY); updateDisplay(); }
   } 
+  else if (bombClock.paused && stateHas(currentState, SF_BOMB_CLOCK)) {
+      // Referee pause (WS "timer"): input is dropped, the clock and beeps hold
+      disarmButton.update();
+      armSwitch.update();
+      handleBeepLogic();
+      { PROF_SCOPE(PROF_DISPLAY); STALL_TAG_SCOPE(STALL_TAG_DISPLAY); updateDisplay(); }
+  }
   else {
       disarmButton.update();
       armSwitch.update();
       handleArmSwitch();
 
       // Timer Logic
-      if (currentState >= ARMED && currentState < DISARMED) {
-        if (millis() - bombArmedTimestamp >= settings.bomb_duration_ms) setState(PRE_EXPLOSION);
+      if (stateHas(currentState, SF_BOMB_CLOCK)) {
+        if (bombClock.expired(gameNowUs())) stateFire(EV_TIMEOUT);
       }
 
       // Explosion safety guard 
       if (currentState == PRE_EXPLOSION) {
-        uint32_t since = millis() - stateEntryTimestamp;
-        if (since > (PRE_EXPLOSION_FADE_MS + 10000)) setState(EXPLODED); 
+        if (gameMsSince(stateEnteredUs) > (PRE_EXPLOSION_FADE_MS + 10000)) stateFire(EV_TIMEOUT); 
       }
 
-      serviceGameplay(key);
-      updateDisplay();
+      { PROF_SCOPE(PROF_GAMEPLAY); STALL_TAG_SCOPE(STALL_TAG_GAMEPLAY); serviceGameplay(key); }
+      { PROF_SCOPE(PROF_DISPLAY); STALL_TAG_SCOPE(STALL_TAG_DISPLAY); updateDisplay(); }
   }
   
   // OPTIMIZATION: Throttle LEDs
   static uint32_t lastLedUpdate = 0;
-  if (millis() - lastLedUpdate > 30) {
-      updateLeds();
+  if (!powerLedsDark() && millis() - lastLedUpdate > 30) {
+      { PROF_SCOPE(PROF_LEDS); STALL_TAG_SCOPE(STALL_TAG_LEDS); updateLeds(); }
       lastLedUpdate = millis();
   }
   
   menuBeepPump();   
   restartPump();    
+  otaLoop();        // marks a freshly updated image good after OTA_GOOD_AFTER_MS
   updateShellEjector();
-  networkLoop();
+  { PROF_SCOPE(PROF_NETWORK); STALL_TAG_SCOPE(STALL_TAG_NETWORK); networkLoop(); httpApiLoop(); if (metricsPoll()) publishMetrics(); }
+  serialConsolePump();
+  powerLoop(key);   // may light-sleep in STANDBY (Power.h)
+  logPump();        // last: formatting + serial writes happen here, bounded by TX space
 
   delay(1);
 }
\ No newline at end of file
@@ -0,0 +1,204 @@
+// clock_sync.cpp
+// Host-side checks of the scoreboard clock estimator (ClockSync.h): RTT, jitter and the
+// board - prop offset from sync_req/sync_resp exchanges, and the sync_resp parser.
+//
+//   trace [offset_ms] [jitter_ms] [asym_ms] [seed]
+//                  20 exchanges over a jittery link: per exchange the delays, the sample's
+//                  RTT/offset and the estimate (default offset 123456, jitter 40, asym 0)
+//   selftest       symmetric delays give the exact offset and RTT; asymmetric ones are off
+//                  by half the difference; with jitter the offset is the lowest-RTT sample's,
+//                  within its RTT/2 of the truth; rttMs/jitterMs are min/max-min of the last
+//                  WINDOW samples (pings included); prop and board millis() wrapping mid-exchange
+//                  change nothing; clockSyncParseResp rejects truncated, non-numeric,
+//                  negative, oversized and missing fields
+//
+// Build: g++ -std=c++11 -O2 -I.. clock_sync.cpp -o clock_sync
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdint.h>
+#include "ClockSync.h"
+
+static int fails = 0;
+static void check(bool ok, const char* what, const char* detail) {
+  if (ok) return;
+  if (fails++ < 12) printf("FAIL  %s (%s)\n", what, detail);
+}
+
+static uint32_t rng = 1;
+static uint32_t rnd(uint32_t n) { rng = rng * 1103515245u + 12345u; return (rng >> 8) % n; }
+
+// One exchange: prop sends at t0 (prop clock), up takes a ms, the board holds it hold ms,
+// down takes b ms. Board clock = prop clock + offset (mod 2^32).
+struct Exchange { uint32_t t0, t1, t2, t3; };
+static Exchange exchange(uint32_t t0, int32_t offset, uint32_t a, uint32_t hold, uint32_t b) {
+  Exchange e;
+  e.t0 = t0;
+  e.t1 = t0 + a + (uint32_t)offset;
+  e.t2 = e.t1 + hold;
+  e.t3 = t0 + a + hold + b;
+  return e;
+}
+
+static void add(ClockSyncEstimator& cs, const Exchange& e) { cs.addExchange(e.t0, e.t1, e.t2, e.t3); }
+
+static int32_t iabs(int32_t v) { return v < 0 ? -v : v; }
+
+static int trace(int argc, char** argv) {
+  int32_t offset = argc > 2 ? atoi(argv[2]) : 123456;
+  uint32_t jitter = argc > 3 ? (uint32_t)atoi(argv[3]) : 40;
+  uint32_t asym = argc > 4 ? (uint32_t)atoi(argv[4]) : 0;
+  rng = argc > 5 ? (uint32_t)atoi(argv[5]) : 1;
+  ClockSyncEstimator cs;
+  cs.reset();
+  printf("%4s %5s %5s %5s %7s %9s %7s %9s %9s\n", "n", "up", "hold", "down", "rtt", "sample", "est_rtt", "est_off", "error");
+  uint32_t t = 0xFFFFF000u;   // wraps a few exchanges in
+  for (int i = 0; i < 20; i++) {
+    uint32_t a = 10 + asym + rnd(jitter + 1), hold = rnd(3), b = 10 + rnd(jitter + 1);
+    add(cs, exchange(t, offset, a, hold, b));
+    int32_t o = 0;
+    cs.offsetMs(o);
+    uint8_t last = (uint8_t)((cs.head + ClockSyncEstimator::WINDOW - 1) % ClockSyncEstimator::WINDOW);
+    printf("%4d %5u %5u %5u %7u %9d %7u %9d %9d\n", i, a, hold, b, cs.rtt[last], cs.off[last], cs.rttMs(), o, o - offset);
+    t += 250;
+  }
+  printf("jitter %u ms\n", cs.jitterMs());
+  return 0;
+}
+
+static void selftestEstimator() {
+  char d[96];
+  const int32_t OFFSETS[] = { 0, 123456, -123456, 2000000000, -2000000000 };
+  const uint32_t STARTS[] = { 1000, 0x7FFFFF00u, 0xFFFFFFF0u };   // 0xFFFFFFF0: prop millis() wraps mid-exchange
+
+  // Empty / pings only: no offset yet
+  ClockSyncEstimator cs;
+  cs.reset();
+  int32_t o = 42;
+  check(!cs.offsetMs(o) && o == 42 && cs.rttMs() == 0 && cs.jitterMs() == 0, "empty estimator", "");
+  cs.addRtt(30);
+  cs.addRtt(50);
+  check(!cs.offsetMs(o) && cs.rttMs() == 30 && cs.jitterMs() == 20, "pings: RTT only", "");
+
+  for (int32_t off : OFFSETS) {
+    for (uint32_t t0 : STARTS) {
+      snprintf(d, sizeof(d), "offset %d, t0 0x%08X", off, t0);
+
+      // Symmetric: exact, whatever the board's hold time
+      cs.reset();
+      add(cs, exchange(t0, off, 20, 7, 20));
+      check(cs.offsetMs(o) && o == off, "symmetric offset", d);
+      check(cs.rttMs() == 40 && cs.jitterMs() == 0, "symmetric RTT", d);
+
+      // Asymmetric: off by half the difference (rounded toward zero), RTT still exact
+      cs.reset();
+      add(cs, exchange(t0, off, 50, 3, 10));
+      check(cs.offsetMs(o) && o == off + 20, "asymmetric offset = +(up - down)/2", d);
+      check(cs.rttMs() == 60, "asymmetric RTT", d);
+      cs.reset();
+      add(cs, exchange(t0, off, 10, 3, 51));
+      check(cs.offsetMs(o) && iabs(o - (off - 20)) <= 1, "asymmetric offset = -(down - up)/2", d);
+
+      // Jitter: the estimate is the lowest-RTT sample's offset, within its RTT/2 of the truth
+      cs.reset();
+      rng = t0 ^ (uint32_t)off;
+      uint32_t t = t0, rtts[ClockSyncEstimator::WINDOW];
+      int32_t offs[ClockSyncEstimator::WINDOW];
+      for (int i = 0; i < 40; i++) {
+        uint32_t a = 5 + rnd(80), b = 5 + rnd(80);
+        add(cs, exchange(t, off, a, rnd(4), b));
+        rtts[i % ClockSyncEstimator::WINDOW] = a + b;
+        offs[i % ClockSyncEstimator::WINDOW] = off + ((int32_t)a - (int32_t)b) / 2;
+        t += 250;
+
+        uint32_t lo = 0xFFFFFFFFu, hi = 0;
+        uint8_t k = (uint8_t)(i + 1 < ClockSyncEstimator::WINDOW ? i + 1 : ClockSyncEstimator::WINDOW);
+        for (uint8_t j = 0; j < k; j++) {
+          if (rtts[j] < lo) lo = rtts[j];
+          if (rtts[j] > hi) hi = rtts[j];
+        }
+        bool has = cs.offsetMs(o), isBest = false;
+        for (uint8_t j = 0; j < k; j++) isBest |= rtts[j] == lo && iabs(o - offs[j]) <= 1;   // ties: any of them
+        check(has && iabs(o - off) <= (int32_t)(lo / 2) + 1, "offset within RTT/2 of the truth", d);
+        check(isBest, "offset is not the lowest-RTT sample's", d);
+        check(cs.rttMs() == lo, "rttMs = lowest RTT in the window", d);
+        check(cs.jitterMs() == hi - lo, "jitterMs = spread of the window", d);
+      }
+    }
+  }
+
+  // A low-RTT sample wins until it leaves the window, then the next best takes over
+  cs.reset();
+  add(cs, exchange(5000, 1000, 2, 0, 2));                    // rtt 4, exact
+  for (int i = 0; i < ClockSyncEstimator::WINDOW - 1; i++) add(cs, exchange(5250 + 250 * i, 1000, 90, 0, 10));   // rtt 100, +40
+  check(cs.offsetMs(o) && o == 1000 && cs.rttMs() == 4 && cs.jitterMs() == 96, "best sample in the window", "");
+  add(cs, exchange(9000, 1000, 90, 0, 10));
+  check(cs.offsetMs(o) && o == 1040 && cs.rttMs() == 100 && cs.jitterMs() == 0, "best sample aged out", "");
+
+  // Pings lower rttMs but never replace the offset; a bogus hold longer than the round trip
+  // clamps the RTT to 0 instead of wrapping
+  cs.reset();
+  add(cs, exchange(100, -500, 30, 0, 30));
+  cs.addRtt(10);
+  check(cs.offsetMs(o) && o == -500 && cs.rttMs() == 10 && cs.jitterMs() == 50, "pings and exchanges", "");
+  cs.reset();
+  cs.addExchange(100, 200, 400, 150);
+  check(cs.rttMs() == 0, "hold > round trip clamps RTT to 0", "");
+}
+
+static void selftestParser() {
+  struct Case { const char* msg; bool ok; uint32_t t0, t1, t2; };
+  const Case cases[] = {
+    { "{\"type\":\"sync_resp\",\"t0\":1,\"t1\":2,\"t2\":3}",                          true,  1, 2, 3 },
+    { "{\"t2\":4294967295,\"t1\":0,\"type\":\"sync_resp\",\"t0\":77}",               true,  77, 0, 4294967295u },
+    { "{ \"type\" : \"sync_resp\" , \"t0\" : 5 , \"t1\" : 6 , \"t2\" : 7 , \"x\":[1] }", true,  5, 6, 7 },
+    { "{\"type\":\"sync_resp\",\"t0\":1,\"t1\":2,\"t2\":",                            false, 0, 0, 0 },   // truncated
+    { "{\"type\":\"sync_resp\",\"t0\":1,\"t1\":2,\"t2\":3",                           false, 0, 0, 0 },   // no closing brace
+    { "{\"type\":\"sync_resp\",\"t0\":1,\"t1\":2}",                                   false, 0, 0, 0 },   // t2 missing
+    { "{\"type\":\"sync_resp\",\"t1\":2,\"t2\":3}",                                   false, 0, 0, 0 },   // t0 missing
+    { "{\"type\":\"sync_resp\",\"t0\":1,\"t1\":\"2\",\"t2\":3}",                      false, 0, 0, 0 },   // string
+    { "{\"type\":\"sync_resp\",\"t0\":1,\"t1\":abc,\"t2\":3}",                        false, 0, 0, 0 },   // not a number
+    { "{\"type\":\"sync_resp\",\"t0\":1,\"t1\":2.5,\"t2\":3}",                        false, 0, 0, 0 },   // fraction
+    { "{\"type\":\"sync_resp\",\"t0\":-1,\"t1\":2,\"t2\":3}",                         false, 0, 0, 0 },   // negative
+    { "{\"type\":\"sync_resp\",\"t0\":4294967296,\"t1\":2,\"t2\":3}",                 false, 0, 0, 0 },   // > 32 bits
+    { "{\"type\":\"sync_resp\",\"t0\":null,\"t1\":2,\"t2\":3}",                       false, 0, 0, 0 },
+    { "{\"type\":\"sync_req\",\"t0\":1,\"t1\":2,\"t2\":3}",                           false, 0, 0, 0 },   // other type
+    { "{\"type\":\"tick\",\"note\":\"sync_resp\",\"t0\":1,\"t1\":2,\"t2\":3}",        false, 0, 0, 0 },
+    { "{\"type\":\"sync_resp\",\"x\":{\"t0\":1,\"t1\":2,\"t2\":3}}",                  false, 0, 0, 0 },   // nested only
+    { "[\"sync_resp\",1,2,3]",                                                         false, 0, 0, 0 },
+    { "",                                                                              false, 0, 0, 0 },
+  };
+  for (const Case& c : cases) {
+    uint32_t t0 = 0xAAAA, t1 = 0xBBBB, t2 = 0xCCCC;
+    bool ok = clockSyncParseResp(c.msg, t0, t1, t2);
+    check(ok == c.ok, c.ok ? "sync_resp rejected" : "bad sync_resp accepted", c.msg);
+    if (ok && c.ok) check(t0 == c.t0 && t1 == c.t1 && t2 == c.t2, "sync_resp values", c.msg);
+    if (!ok) check(t0 == 0xAAAA && t1 == 0xBBBB && t2 == 0xCCCC, "rejected sync_resp wrote values", c.msg);
+  }
+  uint32_t t0, t1, t2;
+  check(!clockSyncParseResp(nullptr, t0, t1, t2), "null message", "");
+
+  // Every prefix of a good response is rejected
+  const char* good = "{\"type\":\"sync_resp\",\"t0\":123,\"t1\":456,\"t2\":789}";
+  char buf[64];
+  for (size_t l = 0; l < strlen(good); l++) {
+    memcpy(buf, good, l);
+    buf[l] = '\0';
+    check(!clockSyncParseResp(buf, t0, t1, t2), "truncated sync_resp accepted", buf);
+  }
+}
+
+static int selftest() {
+  selftestEstimator();
+  selftestParser();
+  printf("%d failure(s)\n", fails);
+  return fails ? 1 : 0;
+}
+
+int main(int argc, char** argv) {
+  if (argc > 1 && !strcmp(argv[1], "trace")) return trace(argc, argv);
+  if (argc > 1 && !strcmp(argv[1], "selftest")) return selftest();
+  fprintf(stderr, "usage: %s trace [offset_ms] [jitter_ms] [asym_ms] [seed] | selftest\n", argv[0]);
+  return 2;
+}
@@ -0,0 +1,117 @@
+// code_table.cpp
+// Host-side checks for the special-code table (SpecialCodes.h).
+//
+//   table      print the rows with their hash slots
+//   selftest   every row against the behaviour of the old strcmp chain in processArmingCode(),
+//              then every digit string of 1..7 characters (11.1M) through specialCodeFind()
+//              against a linear scan, so no ordinary code can hit a special row
+//
+// Build: g++ -std=c++11 -O2 -I.. code_table.cpp -o code_table
+
+#include <cstdio>
+#include <cstring>
+#include "SpecialCodes.h"
+
+static const char* flagNames(uint16_t f, char* buf, size_t len) {
+  static const char* NAMES[] = { "egg", "arm_code", "clock", "servo", "clear", "on_armed" };
+  buf[0] = '\0';
+  for (unsigned b = 0; b < sizeof(NAMES) / sizeof(NAMES[0]); b++) {
+    if (!(f & (1u << b))) continue;
+    if (buf[0]) strncat(buf, ",", len - strlen(buf) - 1);
+    strncat(buf, NAMES[b], len - strlen(buf) - 1);
+  }
+  return buf;
+}
+
+static int printTable() {
+  printf("seed %u, %u rows in %u slots\n", (unsigned)SPECIAL_CODE_SEED, (unsigned)SPECIAL_CODE_COUNT, (unsigned)SPECIAL_CODE_SLOTS);
+  for (uint8_t i = 0; i < SPECIAL_CODE_COUNT; i++) {
+    const SpecialCode& c = SPECIAL_CODES[i];
+    char flags[96];
+    printf("%-8s slot %2u  %-13s mode %u  sound %2u  time %6u  hold %4u  %s\n", c.code,
+           specialCodeSlot(c.code, SPECIAL_CODE_SEED), stateEventName(c.event), c.mode, c.sound,
+           (unsigned)c.durationMs, c.holdMs, flagNames(c.flags, flags, sizeof(flags)));
+  }
+  return 0;
+}
+
+// What each code did before the table (Game.h 6.6.0 processArmingCode())
+struct Expect {
+  const char* code; bool eggOnly; uint8_t sound; uint32_t durationMs; uint8_t event;
+  bool armCode, clock, onArmed, clear; uint16_t holdMs;
+};
+static const Expect OLD_CHAIN[] = {
+  { "501",     true,  0,                 0,      EV_CODE_STARWARS, false, false, false, true,  0 },
+  { "1138",    true,  SOUND_THX,         0,      EV_CODE_OK,       true,  true,  true,  false, 0 },
+  { "8675309", true,  SOUND_JENNY,       222000, EV_CODE_OK,       true,  true,  true,  false, 0 },
+  { "3141592", true,  SOUND_NERD,        0,      EV_CODE_OK,       true,  true,  true,  false, 0 },
+  { "1984",    true,  SOUND_HASTA_2,     0,      EV_CODE_OK,       true,  true,  true,  false, 0 },
+  { "7777777", true,  SOUND_JACKPOT,     0,      EV_CODE_OK,       true,  true,  true,  false, 0 },
+  { "007",     true,  SOUND_BOND_INTRO,  105000, EV_CODE_OK,       true,  true,  true,  false, 0 },
+  { "12345",   true,  SOUND_SPACEBALLS,  0,      EV_CODE_BAD,      false, false, false, true,  2500 },
+  { "0451",    true,  SOUND_SOM_BITCH,   0,      EV_CODE_OK,       true,  true,  true,  false, 0 },
+  { "14085",   true,  SOUND_MGS_ALERT,   0,      EV_CODE_OK,       true,  true,  true,  false, 0 },
+  { "0000000", true,  SOUND_LAME,        0,      EV_CODE_BAD,      false, false, false, true,  1500 },
+  { "666666",  true,  SOUND_DOOM_SLAYER, 0,      EV_CODE_OK,       true,  true,  false, false, 0 },
+  { "5318008", true,  0,                 0,      EV_CODE_JUGS,     true,  false, false, false, 0 },
+  { "999",     false, 0,                 0,      EV_NONE,          false, false, false, true,  0 },
+  { "7355608", false, 0,                 0,      EV_CODE_MASTER,   true,  false, false, false, 0 },
+};
+
+static const SpecialCode* linearFind(const char* code) {
+  for (uint8_t i = 0; i < SPECIAL_CODE_COUNT; i++) if (!strcmp(SPECIAL_CODES[i].code, code)) return &SPECIAL_CODES[i];
+  return nullptr;
+}
+
+static int selftest() {
+  int fails = 0;
+  const unsigned N = sizeof(OLD_CHAIN) / sizeof(OLD_CHAIN[0]);
+  if (N != SPECIAL_CODE_COUNT) { printf("FAIL  %u rows, old chain had %u codes\n", (unsigned)SPECIAL_CODE_COUNT, N); fails++; }
+  for (unsigned i = 0; i < N; i++) {
+    const Expect& e = OLD_CHAIN[i];
+    const SpecialCode* c = specialCodeFind(e.code);
+    bool ok = c && c->sound == e.sound && c->durationMs == e.durationMs && c->event == e.event &&
+              !!(c->flags & SC_EASTER_EGG) == e.eggOnly && !!(c->flags & SC_ARM_CODE) == e.armCode &&
+              !!(c->flags & SC_START_CLOCK) == e.clock && !!(c->flags & SC_ON_ARMED) == e.onArmed &&
+              !!(c->flags & SC_CLEAR_ENTRY) == e.clear && c->holdMs == e.holdMs;
+    if (!ok) fails++;
+    printf("%s  %s\n", ok ? "PASS" : "FAIL", e.code);
+  }
+  for (uint8_t i = 0; i < SPECIAL_CODE_COUNT; i++) {
+    const char* code = SPECIAL_CODES[i].code;
+    uint8_t want = !strcmp(code, "1984") ? GM_TERMINATOR : !strcmp(code, "007") ? GM_BOND
+                 : !strcmp(code, "666666") ? GM_DOOM : !strcmp(code, "501") ? GM_STARWARS : GM_NONE;
+    if (SPECIAL_CODES[i].mode != want) { printf("FAIL  %s starts mode %u, want %u\n", code, SPECIAL_CODES[i].mode, want); fails++; }
+  }
+  if (!(specialCodeFind("999")->flags & SC_SERVO_TEST)) { printf("FAIL  999 servo test\n"); fails++; }
+
+  // Every digit string a player can type
+  unsigned long checked = 0, hits = 0, wrong = 0;
+  char buf[8];
+  for (int len = 1; len <= 7; len++) {
+    unsigned long limit = 1;
+    for (int k = 0; k < len; k++) limit *= 10;
+    for (unsigned long v = 0; v < limit; v++) {
+      unsigned long x = v;
+      for (int k = len - 1; k >= 0; k--) { buf[k] = (char)('0' + x % 10); x /= 10; }
+      buf[len] = '\0';
+      const SpecialCode* a = specialCodeFind(buf);
+      if (a != linearFind(buf)) { if (wrong++ < 5) printf("FAIL  lookup %s\n", buf); }
+      if (a) hits++;
+      checked++;
+    }
+  }
+  if (wrong) fails++;
+  if (hits != SPECIAL_CODE_COUNT) { printf("FAIL  %lu hits over all digit strings\n", hits); fails++; }
+  if (specialCodeFind("") || specialCodeFind("73556080") || specialCodeFind("abc")) { printf("FAIL  non-digit / long input\n"); fails++; }
+  printf("%lu digit strings, %lu special, %lu lookup mismatch(es)\n", checked, hits, wrong);
+  printf("%d failure(s)\n", fails);
+  return fails ? 1 : 0;
+}
+
+int main(int argc, char** argv) {
+  if (argc > 1 && !strcmp(argv[1], "table")) return printTable();
+  if (argc > 1 && !strcmp(argv[1], "selftest")) return selftest();
+  fprintf(stderr, "usage: %s table | selftest\n", argv[0]);
+  return 2;
+}
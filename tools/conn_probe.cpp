@@ -0,0 +1,216 @@
+// conn_probe.cpp
+// Host run of the prop's connection FSM (ConnFsm.h) against the stand-in scoreboard.
+// Each virtual prop does what Network.h does: resolve, TCP connect, WS upgrade, then
+// heartbeat pings; any failure goes through the same backoff/fast-path logic. Start the
+// server with faults to see how fast (and how spread out) the props come back:
+//
+//   ./scoreboard_standin.py serve --kill-every 20 --refuse-for 5
+//   ./conn_probe 127.0.0.1 8080 20 120
+//
+// Build: g++ -std=c++11 -O2 -I.. conn_probe.cpp -o conn_probe
+// Run:   ./conn_probe [host=127.0.0.1] [port=8080] [props=8] [seconds=60]
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include "ConnFsm.h"
+
+static const uint32_t PING_MS = 1000;
+static const uint32_t PONG_TIMEOUT_MS = 3000;   // heartbeat: no traffic for this long = dead
+
+static uint32_t nowMs() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint32_t)(ts.tv_sec * 1000u + ts.tv_nsec / 1000000u);
+}
+
+struct Prop {
+  int         idx;
+  ConnFsm     fsm;
+  int         fd;
+  sockaddr_storage addr;
+  socklen_t   addrLen;
+  bool        haveAddr;
+  std::string rx;
+  uint32_t    lastRxMs, nextPingMs;
+  std::vector<uint32_t> outages;
+};
+
+static const char* host = "127.0.0.1";
+static const char* port = "8080";
+
+static void closeFd(Prop& p) {
+  if (p.fd >= 0) close(p.fd);
+  p.fd = -1;
+  p.rx.clear();
+}
+
+// Client frames are masked (RFC 6455); a zero mask keeps the payload readable in captures
+static void sendFrame(Prop& p, uint8_t op, const std::string& payload) {
+  std::string f;
+  f += (char)(0x80 | op);
+  if (payload.size() < 126) {
+    f += (char)(0x80 | payload.size());
+  } else {
+    f += (char)(0x80 | 126);
+    f += (char)(payload.size() >> 8);
+    f += (char)(payload.size() & 0xFF);
+  }
+  f.append(4, '\0');
+  f += payload;
+  if (send(p.fd, f.data(), f.size(), MSG_NOSIGNAL) < 0) { /* surfaces as a read error */ }
+}
+
+static void fail(Prop& p, const char* why) {
+  uint32_t t = nowMs();
+  uint8_t ph = p.fsm.phase;
+  closeFd(p);
+  if (ph == CONN_LIVE) p.fsm.dropped(t);
+  else { p.fsm.fail(t); p.haveAddr = false; }
+  printf("[%3d] %-9s %s, retry in %u ms%s\n", p.idx, connPhaseName(ph), why,
+         (unsigned)(p.fsm.retryAtMs - t), p.fsm.fastPath ? " (fast path)" : "");
+}
+
+static void resolve(Prop& p) {
+  addrinfo hints, *res = nullptr;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  if (getaddrinfo(host, port, &hints, &res) != 0 || !res) { fail(p, "resolve failed"); return; }
+  memcpy(&p.addr, res->ai_addr, res->ai_addrlen);
+  p.addrLen = res->ai_addrlen;
+  p.haveAddr = true;
+  freeaddrinfo(res);
+  p.fsm.resolved(nowMs());
+}
+
+static void dial(Prop& p) {
+  p.fd = socket(p.addr.ss_family, SOCK_STREAM, 0);
+  fcntl(p.fd, F_SETFL, O_NONBLOCK);
+  if (connect(p.fd, (sockaddr*)&p.addr, p.addrLen) < 0 && errno != EINPROGRESS) fail(p, strerror(errno));
+}
+
+static void onWritable(Prop& p) {
+  int err = 0;
+  socklen_t len = sizeof(err);
+  getsockopt(p.fd, SOL_SOCKET, SO_ERROR, &err, &len);
+  if (err) { fail(p, strerror(err)); return; }
+  p.fsm.tcpUp(nowMs());
+  char req[256];
+  snprintf(req, sizeof(req),
+           "GET / HTTP/1.1\r\nHost: %s:%s\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+           "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\nSec-WebSocket-Version: 13\r\n\r\n", host, port);
+  send(p.fd, req, strlen(req), MSG_NOSIGNAL);
+}
+
+static void goLive(Prop& p) {
+  uint32_t t = nowMs();
+  p.fsm.live(t);
+  p.lastRxMs = t;
+  p.nextPingMs = t + PING_MS;
+  const ConnStats& s = p.fsm.stats;
+  p.outages.push_back(s.lastDownMs);
+  printf("[%3d] live      down %u ms (%u attempt(s)%s): resolve=%u tcp=%u handshake=%u backoff=%u\n",
+         p.idx, (unsigned)s.lastDownMs, (unsigned)s.lastAttempts, p.fsm.fastTry ? ", fast path" : "",
+         (unsigned)s.lastMs[CONN_RESOLVE], (unsigned)s.lastMs[CONN_TCP],
+         (unsigned)s.lastMs[CONN_HANDSHAKE], (unsigned)s.lastMs[CONN_BACKOFF]);
+  char buf[256];
+  snprintf(buf, sizeof(buf),
+           "{\"type\":\"metric\",\"name\":\"reconnect_ms\",\"value\":%u,\"resolve\":%u,\"tcp\":%u,"
+           "\"handshake\":%u,\"backoff\":%u,\"attempts\":%u,\"fast\":%u,\"prop\":%d}",
+           (unsigned)s.lastDownMs, (unsigned)s.lastMs[CONN_RESOLVE], (unsigned)s.lastMs[CONN_TCP],
+           (unsigned)s.lastMs[CONN_HANDSHAKE], (unsigned)s.lastMs[CONN_BACKOFF], (unsigned)s.lastAttempts,
+           p.fsm.fastTry ? 1u : 0u, p.idx);
+  sendFrame(p, 0x1, buf);
+}
+
+static void onReadable(Prop& p) {
+  char buf[2048];
+  ssize_t n = recv(p.fd, buf, sizeof(buf), 0);
+  if (n <= 0) { fail(p, n == 0 ? "closed by peer" : strerror(errno)); return; }
+  p.lastRxMs = nowMs();
+  if (p.fsm.phase != CONN_HANDSHAKE) return;       // LIVE: any frame counts as a heartbeat
+  p.rx.append(buf, (size_t)n);
+  size_t end = p.rx.find("\r\n\r\n");
+  if (end == std::string::npos) return;
+  if (p.rx.compare(0, 12, "HTTP/1.1 101") != 0) {
+    std::string status = p.rx.substr(0, p.rx.find("\r\n"));
+    fail(p, status.c_str());
+    return;
+  }
+  p.rx.clear();
+  goLive(p);
+}
+
+int main(int argc, char** argv) {
+  if (argc > 1) host = argv[1];
+  if (argc > 2) port = argv[2];
+  int props = argc > 3 ? atoi(argv[3]) : 8;
+  uint32_t seconds = argc > 4 ? (uint32_t)atoi(argv[4]) : 60;
+
+  std::vector<Prop> ps(props);
+  uint32_t start = nowMs();
+  for (int i = 0; i < props; i++) {
+    ps[i].idx = i;
+    ps[i].fd = -1;
+    ps[i].haveAddr = false;
+    ps[i].fsm.begin(start, 0x1234567u * (uint32_t)(i + 1));
+    ps[i].fsm.wifi(true, start);
+  }
+
+  while (nowMs() - start < seconds * 1000u) {
+    std::vector<pollfd> pfds;
+    std::vector<int> who;
+    uint32_t t = nowMs();
+    for (size_t i = 0; i < ps.size(); i++) {
+      Prop& p = ps[i];
+      if (p.fsm.due(t)) {
+        if (p.fsm.startAttempt(t) == CONN_RESOLVE || !p.haveAddr) resolve(p);
+        if (p.fsm.phase == CONN_TCP) dial(p);
+      }
+      if (p.fsm.timedOut(nowMs())) fail(p, "timeout");
+      if (p.fsm.phase == CONN_LIVE) {
+        if (t - p.lastRxMs > PONG_TIMEOUT_MS) { fail(p, "heartbeat timeout"); continue; }
+        if ((int32_t)(t - p.nextPingMs) >= 0) { sendFrame(p, 0x9, ""); p.nextPingMs = t + PING_MS; }
+      }
+      if (p.fd < 0) continue;
+      pollfd pf = { p.fd, (short)(p.fsm.phase == CONN_TCP ? POLLOUT : POLLIN), 0 };
+      pfds.push_back(pf);
+      who.push_back((int)i);
+    }
+    poll(pfds.data(), pfds.size(), 20);
+    for (size_t k = 0; k < pfds.size(); k++) {
+      Prop& p = ps[who[k]];
+      if (!pfds[k].revents || p.fd != pfds[k].fd) continue;
+      if (p.fsm.phase == CONN_TCP) onWritable(p);
+      else onReadable(p);
+    }
+  }
+
+  std::vector<uint32_t> all;
+  printf("\nprop attempts lives drops fast  fails(res/tcp/hs)  max_down_ms\n");
+  for (size_t i = 0; i < ps.size(); i++) {
+    const ConnStats& s = ps[i].fsm.stats;
+    printf("%4d %8u %5u %5u %4u  %5u/%u/%u %17u\n", ps[i].idx, (unsigned)s.attempts, (unsigned)s.lives,
+           (unsigned)s.drops, (unsigned)s.fastHits, (unsigned)s.fails[CONN_RESOLVE], (unsigned)s.fails[CONN_TCP],
+           (unsigned)s.fails[CONN_HANDSHAKE], (unsigned)s.maxDownMs);
+    // skip the initial connect, keep the recoveries
+    if (ps[i].outages.size() > 1) all.insert(all.end(), ps[i].outages.begin() + 1, ps[i].outages.end());
+  }
+  if (!all.empty()) {
+    std::sort(all.begin(), all.end());
+    printf("recoveries=%u  p50=%u ms  p90=%u ms  max=%u ms\n", (unsigned)all.size(),
+           (unsigned)all[all.size() / 2], (unsigned)all[all.size() * 9 / 10], (unsigned)all.back());
+  }
+  return 0;
+}
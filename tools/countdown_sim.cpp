@@ -0,0 +1,225 @@
+// countdown_sim.cpp
+// Host-side checks for the bomb countdown and beep cadence (Countdown.h) on a simulated clock.
+//
+//   trace [rate]   a 20 s round with a 2.5 s pause: the tone on/off edges in countdown ms and
+//                  the real time it expired (rate in %, default 100)
+//   selftest       beeps across pauses land on the same countdown ms as an uninterrupted
+//                  round; rate changes and add/sub never make the
+//                  remaining time jump; expiry matches 0 ms left to the µs under random
+//                  operations; the tick stream (ClockSync.h) decodes to the true remaining
+//                  time through pauses and rate changes
+//
+// Build: g++ -std=c++11 -O2 -I.. countdown_sim.cpp -o countdown_sim
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <stdint.h>
+
+static uint64_t fakeNowUs = 0;
+static uint64_t fakeClock() { return fakeNowUs; }
+#define GAME_CLOCK_SOURCE fakeClock
+#include "Countdown.h"
+#include "ClockSync.h"
+
+static const uint32_t TONE_MS = 225;   // BEEP_TONE_DURATION_MS (Config.h)
+
+static int fails = 0;
+static void check(bool ok, const char* what, uint64_t at) {
+  if (ok) return;
+  if (fails++ < 12) printf("FAIL  %s (at %llu us)\n", what, (unsigned long long)at);
+}
+
+
+struct Pause { uint32_t atMs, forMs; };
+struct Edge  { uint32_t countdownMs; bool on; };
+
+// A round stepped in 1 ms of real time, with optional pauses and a rate switch. Returns the
+// cadence's tone edges in countdown ms (a pause cuts the audible tone but must not move them);
+// realEndMs gets the real ms the round expired at.
+static std::vector<Edge> runRound(uint32_t totalMs, const Pause* pauses, int nPauses, uint16_t rate,
+                                  uint32_t rateAtMs, uint32_t& realEndMs) {
+  std::vector<Edge> edges;
+  fakeNowUs = 1000000;
+  const uint64_t t0 = fakeNowUs;
+  Countdown c;
+  BeepCadence b;
+  c.start(totalMs, fakeNowUs);
+  b.reset(TONE_MS);
+  bool was = false;
+  int p = 0;
+  uint32_t lastLeft = c.leftMs(fakeNowUs);
+  bool wasPaused = false;
+  for (uint32_t ms = 0;; ms++) {
+    fakeNowUs = t0 + gameMsToUs(ms);
+    if (ms == rateAtMs) check(c.setRate(rate, fakeNowUs), "setRate", fakeNowUs);
+    if (p < nPauses && ms == pauses[p].atMs) c.pause(fakeNowUs);
+    if (p < nPauses && c.paused && ms == pauses[p].atMs + pauses[p].forMs) { c.resume(fakeNowUs); p++; }
+    if (c.expired(fakeNowUs)) { realEndMs = ms; break; }
+    uint32_t left = c.leftMs(fakeNowUs);
+    uint32_t step = (c.ratePct + 99) / 100;
+    check(left <= lastLeft && lastLeft - left <= step, "remaining time jumped", fakeNowUs);
+    if (c.paused && wasPaused) check(left == lastLeft, "time ran while paused", fakeNowUs);
+    lastLeft = left;
+    wasPaused = c.paused;
+    if (c.paused) continue;    // handleBeepLogic(): silent, cadence not advanced
+    bool on = b.update(c.elapsedMs(gameNowUs()), c.totalMs);
+    if (on != was) { edges.push_back({ c.elapsedMs(fakeNowUs), on }); was = on; }
+  }
+  return edges;
+}
+
+static bool sameEdges(const std::vector<Edge>& a, const std::vector<Edge>& b) {
+  if (a.size() != b.size()) return false;
+  for (size_t i = 0; i < a.size(); i++) if (a[i].countdownMs != b[i].countdownMs || a[i].on != b[i].on) return false;
+  return true;
+}
+
+// Same round fed countdown ms directly in steps of stepMs (no Countdown object)
+static std::vector<Edge> directEdges(uint32_t totalMs, uint32_t stepMs) {
+  std::vector<Edge> edges;
+  BeepCadence b;
+  b.reset(TONE_MS);
+  bool was = false;
+  for (uint32_t el = 0; el < totalMs; el += stepMs) {
+    bool on = b.update(el, totalMs);
+    if (on != was) { edges.push_back({ el, on }); was = on; }
+  }
+  return edges;
+}
+
+static int trace(uint16_t rate) {
+  const Pause pauses[] = { { 7100, 2500 } };
+  uint32_t end = 0;
+  std::vector<Edge> e = runRound(20000, pauses, 1, rate, 0, end);
+  printf("20000 ms round at %u%%, paused at real 7100 ms for 2500 ms; expired at real %u ms\n", rate, end);
+  for (const Edge& x : e) printf("  countdown %6u ms  tone %s\n", x.countdownMs, x.on ? "on" : "off");
+  return 0;
+}
+
+// Parses the few tick fields the scoreboard needs; -1 when absent
+static long field(const char* js, const char* key) {
+  char k[16];
+  snprintf(k, sizeof(k), "\"%s\":", key);
+  const char* p = strstr(js, k);
+  return p ? strtol(p + strlen(k), nullptr, 10) : -1;
+}
+
+static int selftest() {
+  const uint32_t totals[] = { 10000, 45000, 120000 };
+  for (uint32_t total : totals) {
+    uint32_t end = 0, endRef = 0;
+    std::vector<Edge> ref = runRound(total, nullptr, 0, 100, ~0u, endRef);
+    check(endRef == total, "uninterrupted round length", total);
+    check(sameEdges(ref, directEdges(total, 1)), "Countdown edges match the direct curve", total);
+
+    // Pauses: in the middle of a tone, between tones, 1 ms long, and in the last second
+    // (real ms; each starts after the previous one ended)
+    const uint32_t p2 = 4010 + total / 4, p3 = p2 + 17 + total / 8;
+    const Pause pauses[] = { { 1010, 3000 }, { p2, 17 }, { p3, 1 }, { total - 600 + 3018, 60000 } };
+    std::vector<Edge> paused = runRound(total, pauses, 4, 100, ~0u, end);
+    check(sameEdges(ref, paused), "beeps across pauses differ from the uninterrupted round", total);
+    check(end == total + 3000 + 17 + 1 + 60000, "paused round length", total);
+
+    // 2x from the start: the same curve sampled every 2 countdown ms, in half the real time
+    std::vector<Edge> fast = runRound(total, nullptr, 0, 200, 0, end);
+    check(sameEdges(fast, directEdges(total, 2)), "2x edges match the curve at 2 ms steps", total);
+    check(end == total / 2, "2x round length", total);
+
+    // Rate switch mid-round plus a pause
+    const Pause late[] = { { total / 4 + 500, 1500 } };
+    runRound(total, late, 1, 150, total / 4, end);
+    uint32_t expect = total / 4 + 1500 + (uint32_t)((gameMsToUs(total - total / 4) * 100 / 150 + 999) / 1000);
+    check(end == expect, "round length after a rate switch", total);
+    printf("%6u ms round: %u beep edges, pauses and rate switches consistent\n", total, (unsigned)ref.size());
+  }
+
+  // add / sub
+  fakeNowUs = 5000000;
+  Countdown c;
+  c.start(45000, fakeNowUs);
+  fakeNowUs += 10000ull * 1000;
+  c.addMs(-5000, fakeNowUs);
+  check(c.leftMs(fakeNowUs) == 30000, "sub 5 s", fakeNowUs);
+  c.addMs(20000, fakeNowUs);
+  check(c.leftMs(fakeNowUs) == 50000 && c.elapsedMs(fakeNowUs) == 0, "add beyond the total", fakeNowUs);
+  c.pause(fakeNowUs);
+  c.addMs(1000, fakeNowUs);
+  check(c.paused && c.leftMs(fakeNowUs) == 51000 && c.deadlineUs == COUNTDOWN_NEVER, "add while paused", fakeNowUs);
+  check(!c.pause(fakeNowUs) && c.resume(fakeNowUs) && !c.resume(fakeNowUs), "pause/resume twice", fakeNowUs);
+  c.addMs(-60000, fakeNowUs);
+  check(c.expired(fakeNowUs) && c.leftMs(fakeNowUs) == 0, "sub past zero expires", fakeNowUs);
+  check(!c.setRate(10, fakeNowUs) && !c.setRate(401, fakeNowUs) && c.ratePct == COUNTDOWN_RATE_1X, "rate range", fakeNowUs);
+
+  // Random operations: expiry == 0 us left, to the us
+  uint32_t rng = 12345;
+  unsigned ops = 0;
+  for (int round = 0; round < 2000; round++) {
+    fakeNowUs = 1000000 + (uint64_t)round * 7;
+    c.start(10000 + (rng % 120000), fakeNowUs);
+    for (int k = 0; k < 12 && !c.expired(fakeNowUs); k++) {
+      rng = rng * 1103515245u + 12345u;
+      fakeNowUs += (rng >> 8) % 9000000;
+      switch ((rng >> 4) % 5) {
+        case 0: c.pause(fakeNowUs); break;
+        case 1: c.resume(fakeNowUs); break;
+        case 2: c.setRate((uint16_t)(COUNTDOWN_RATE_MIN + (rng >> 12) % (COUNTDOWN_RATE_MAX - COUNTDOWN_RATE_MIN + 1)), fakeNowUs); break;
+        case 3: c.addMs((int32_t)((rng >> 10) % 20000) - 10000, fakeNowUs); break;
+        default: break;
+      }
+      ops++;
+      if (c.deadlineUs != COUNTDOWN_NEVER) {
+        GameUs d = c.deadlineUs;
+        check(c.leftUsAt(d) == 0 && c.expired(d), "0 left at the deadline", d);
+        if (d > fakeNowUs) check(c.leftUsAt(d - 1) > 0 && !c.expired(d - 1), "time left 1 us before", d);
+      } else {
+        check(c.paused && !c.expired(fakeNowUs + 1000000000ull), "paused never expires", fakeNowUs);
+      }
+    }
+  }
+  printf("%u random operations checked against the deadline\n", ops);
+
+  // Tick stream through a pause and a rate change, decoded as the scoreboard does
+  ClockSyncEstimator cs;
+  cs.reset();
+  CountdownTickEncoder enc;
+  memset(&enc, 0, sizeof(enc));
+  fakeNowUs = 3000000;
+  c.start(60000, fakeNowUs);
+  long rem = -1, ts = 0, rate = 100;
+  unsigned ticks = 0, keys = 0, bad = 0;
+  for (uint32_t ms = 0; ms < 40000; ms += 250) {
+    fakeNowUs = 3000000 + gameMsToUs(ms);
+    if (ms == 5000) c.pause(fakeNowUs);
+    if (ms == 9000) c.resume(fakeNowUs);
+    if (ms == 15000) c.setRate(300, fakeNowUs);
+    if (ms == 20000) c.addMs(-4000, fakeNowUs);
+    char buf[160];
+    uint32_t now32 = (uint32_t)(fakeNowUs / 1000);
+    uint32_t left = c.leftMs(fakeNowUs);
+    if (!enc.encode(now32, left, c.totalMs, cs, buf, sizeof(buf), c.effectiveRate())) { bad++; continue; }
+    ticks++;
+    if (field(buf, "rem") >= 0) { rem = field(buf, "rem"); ts = field(buf, "ts"); rate = field(buf, "rate"); if (rate < 0) rate = 100; keys++; }
+    else {
+      long t = field(buf, "ts");
+      long d = strstr(buf, "\"d\":") ? field(buf, "d") : 0;
+      rem = rem - (long)((uint64_t)(uint32_t)(t - ts) * rate / 100) - d;
+      if (rem < 0) rem = 0;
+      ts = t;
+    }
+    if (rem != (long)left) bad++;
+  }
+  check(bad == 0, "decoded tick stream != remaining time", bad);
+  printf("%u ticks (%u keyframes), %u decode mismatch(es)\n", ticks, keys, bad);
+
+  printf("%d failure(s)\n", fails);
+  return fails ? 1 : 0;
+}
+
+int main(int argc, char** argv) {
+  if (argc > 1 && !strcmp(argv[1], "trace")) return trace(argc > 2 ? (uint16_t)atoi(argv[2]) : 100);
+  if (argc > 1 && !strcmp(argv[1], "selftest")) return selftest();
+  fprintf(stderr, "usage: %s trace [rate] | selftest\n", argv[0]);
+  return 2;
+}
@@ -0,0 +1,225 @@
+// espnow_sim.cpp
+// Host simulation of the ESP-NOW mesh link (EspNowLink.h) with many virtual props.
+// Nodes sit on a line, each hears only neighbours within RANGE slots. Every
+// frame is lost with probability LOSS and arrives after a random air delay.
+//
+//   [props=12] [loss=0.2] [range=2] [events=50] [seed=1]
+//                  one run: per prop sent / delivered / acked / failed and latency
+//   selftest       lossless line at full depth: every event delivered once and acked, within
+//                  a per-hop latency bound; 20 % loss over several seeds: every event delivered
+//                  once and acked within the retry budget; the base delivers a late
+//                  retransmission once even after other traffic flushed its relay cache, and
+//                  a rebooted prop's seq 1 (new epoch) is delivered, an old-epoch copy is not
+//
+// Build: g++ -std=c++11 -O2 -I.. espnow_sim.cpp -o espnow_sim
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <queue>
+#include <vector>
+#include "EspNowLink.h"
+
+struct Frame {
+  uint32_t at;
+  int to;
+  std::vector<uint8_t> data;
+  bool operator>(const Frame& o) const { return at > o.at; }
+};
+
+static std::priority_queue<Frame, std::vector<Frame>, std::greater<Frame> > air;
+static std::vector<EspNowNode> nodes;
+static uint32_t simNow = 0;
+static int range = 2;
+static double loss = 0.2;
+static uint64_t framesOnAir = 0;
+
+struct Delivery { bool sent; unsigned got; uint32_t sentMs; uint32_t gotMs; };
+static std::vector<std::vector<Delivery> > deliveries;   // [origin][seq]
+
+static double frand() { return rand() / (RAND_MAX + 1.0); }
+
+static void simTx(void* ctx, const uint8_t* frame, size_t len) {
+  int from = (int)(intptr_t)ctx;
+  framesOnAir++;
+  for (int to = 0; to < (int)nodes.size(); to++) {
+    if (to == from || abs(to - from) > range) continue;
+    if (frand() < loss) continue;
+    Frame f;
+    f.at = simNow + 2 + rand() % 6;      // 2..7 ms air + queueing
+    f.to = to;
+    f.data.assign(frame, frame + len);
+    air.push(f);
+  }
+}
+
+static void simDeliver(void*, uint16_t origin, uint16_t, uint16_t seq, const char*, size_t) {
+  Delivery& d = deliveries[origin][seq];
+  if (!d.got++) d.gotMs = simNow;
+}
+
+struct PropResult { unsigned sent, got, twice, acked, failed, avgMs, maxMs; };
+
+// One run; results per prop (index 0 unused)
+static std::vector<PropResult> simulate(int props, double lossRate, int hearRange, int events, unsigned seed) {
+  loss = lossRate;
+  range = hearRange;
+  srand(seed);
+  framesOnAir = 0;
+  while (!air.empty()) air.pop();
+
+  // Node 0 is the base station, the rest are relaying props
+  nodes.assign(props + 1, EspNowNode());
+  deliveries.assign(props + 1, std::vector<Delivery>(events + 2, Delivery()));
+  for (int i = 0; i <= props; i++) {
+    nodes[i].begin((uint16_t)i, 1, i == 0 ? ENL_ROLE_BASE : ENL_ROLE_RELAY, simTx, simDeliver, (void*)(intptr_t)i);
+  }
+
+  // Each prop raises one event every ~1 s (staggered), then we let retries drain
+  const char* msg = "{\"eventType\":\"c4_event\",\"c4_status\":\"bombPlanted\"}";
+  uint32_t endMs = events * 1000 + 60000;
+  for (simNow = 0; simNow < endMs; simNow++) {
+    for (int i = 1; i <= props; i++) {
+      if (simNow % 1000 == (uint32_t)(i * 37 % 1000) && simNow / 1000 < (uint32_t)events) {
+        uint16_t seq = nodes[i].nextSeq;
+        if (nodes[i].send(msg, strlen(msg), simNow)) {
+          deliveries[i][seq].sent = true;
+          deliveries[i][seq].sentMs = simNow;
+        }
+      }
+    }
+    while (!air.empty() && air.top().at <= simNow) {
+      Frame f = air.top();
+      air.pop();
+      nodes[f.to].onReceive(f.data.data(), f.data.size(), simNow);
+    }
+    for (int i = 0; i <= props; i++) nodes[i].poll(simNow);
+  }
+
+  std::vector<PropResult> res(props + 1, PropResult());
+  for (int i = 1; i <= props; i++) {
+    PropResult& r = res[i];
+    unsigned sum = 0;
+    for (size_t s = 0; s < deliveries[i].size(); s++) {
+      const Delivery& d = deliveries[i][s];
+      if (!d.sent) continue;
+      r.sent++;
+      if (!d.got) continue;
+      if (d.got > 1) r.twice++;
+      unsigned lat = d.gotMs - d.sentMs;
+      r.got++; sum += lat; if (lat > r.maxMs) r.maxMs = lat;
+    }
+    r.avgMs = r.got ? sum / r.got : 0;
+    r.acked = nodes[i].stats.acked;
+    r.failed = nodes[i].stats.failed;
+  }
+  return res;
+}
+
+static int run(int argc, char** argv) {
+  int props  = argc > 1 ? atoi(argv[1]) : 12;
+  double l   = argc > 2 ? atof(argv[2]) : 0.2;
+  int r      = argc > 3 ? atoi(argv[3]) : 2;
+  int events = argc > 4 ? atoi(argv[4]) : 50;
+  unsigned seed = argc > 5 ? atoi(argv[5]) : 1;
+  std::vector<PropResult> res = simulate(props, l, r, events, seed);
+
+  printf("props=%d loss=%.2f range=%d events/prop=%d frames_on_air=%llu\n",
+         props, loss, range, events, (unsigned long long)framesOnAir);
+  printf("%5s %4s %8s %8s %8s %8s %7s %7s\n", "prop", "hops", "sent", "deliv", "acked", "failed", "avg_ms", "max_ms");
+  for (int i = 1; i <= props; i++) {
+    const PropResult& p = res[i];
+    printf("%5d %4d %8u %8u %8u %8u %7u %7u\n", i, (i + range - 1) / range, p.sent, p.got,
+           p.acked, p.failed, p.avgMs, p.maxMs);
+  }
+  return 0;
+}
+
+static int fails = 0;
+static void check(bool ok, const char* what, const char* detail) {
+  if (ok) return;
+  if (fails++ < 12) printf("FAIL  %s (%s)\n", what, detail);
+}
+
+// Every prop: all events delivered exactly once and acked, none failed, latency under maxMs
+static unsigned checkRun(int props, double l, int r, int events, unsigned seed, unsigned maxMs) {
+  std::vector<PropResult> res = simulate(props, l, r, events, seed);
+  unsigned worst = 0;
+  char d[96];
+  for (int i = 1; i <= props; i++) {
+    const PropResult& p = res[i];
+    snprintf(d, sizeof(d), "loss %.2f seed %u prop %d: sent %u deliv %u twice %u acked %u failed %u max %u ms",
+             l, seed, i, p.sent, p.got, p.twice, p.acked, p.failed, p.maxMs);
+    check(p.sent == (unsigned)events, "event not queued", d);
+    check(p.got == p.sent && p.twice == 0, "event not delivered exactly once", d);
+    check(p.acked == p.sent && p.failed == 0, "event not acked", d);
+    check(p.maxMs <= maxMs, "delivery too slow", d);
+    if (p.maxMs > worst) worst = p.maxMs;
+  }
+  return worst;
+}
+
+// Feeds frames straight into one base node
+static unsigned baseDelivered = 0;
+static void countDeliver(void*, uint16_t, uint16_t, uint16_t, const char*, size_t) { baseDelivered++; }
+
+static void feed(EspNowNode& base, uint16_t origin, uint16_t epoch, uint16_t seq, uint8_t attempt, uint32_t now) {
+  uint8_t f[ENL_FRAME_MAX];
+  EnlHeader h = { ENL_MAGIC, ENL_EVENT, origin, epoch, seq, ENL_TTL, attempt, 2 };
+  memcpy(f, &h, sizeof(h));
+  memcpy(f + sizeof(h), "{}", 2);
+  base.onReceive(f, sizeof(h) + 2, now);
+}
+
+static int selftest() {
+  // Lossless, 12 props on a line, range 2: the far end is 6 hops out. Each hop is at most
+  // 7 ms of air, no retry should ever be needed.
+  unsigned worst = checkRun(12, 0.0, 2, 50, 1, 6 * 8);
+  printf("lossless, 12 props, 6 hops: all delivered once and acked, max %u ms\n", worst);
+
+  // 20 % loss per frame and receiver: retries cover it, within the first four backoffs
+  worst = 0;
+  for (unsigned seed = 1; seed <= 5; seed++) {
+    unsigned w = checkRun(12, 0.2, 2, 50, seed, 2500);
+    if (w > worst) worst = w;
+  }
+  printf("20%% loss, 12 props, 5 seeds: all delivered once and acked, max %u ms\n", worst);
+
+  // Base: a retransmission arriving after ENL_SEEN other frames is still not delivered twice
+  EspNowNode base;
+  base.begin(0, 1, ENL_ROLE_BASE, nullptr, countDeliver, nullptr);
+  baseDelivered = 0;
+  feed(base, 7, 3, 1, 0, 0);
+  for (uint16_t s = 1; s <= ENL_SEEN * 2; s++) feed(base, 8, 1, s, 0, s);
+  feed(base, 7, 3, 1, 5, 1000);
+  check(baseDelivered == 1 + ENL_SEEN * 2, "late retransmission delivered twice", "");
+
+  // Out of order within the window: both delivered, each once
+  baseDelivered = 0;
+  feed(base, 7, 3, 5, 0, 1100);
+  feed(base, 7, 3, 3, 0, 1101);
+  feed(base, 7, 3, 3, 1, 1102);
+  feed(base, 7, 3, 5, 2, 1103);
+  check(baseDelivered == 2, "out-of-order seqs", "");
+
+  // Reboot: seq 1 of the new epoch is a new event; a straggler from the old epoch is not
+  baseDelivered = 0;
+  feed(base, 7, 4, 1, 0, 1200);
+  feed(base, 7, 3, 2, 0, 1201);
+  feed(base, 7, 4, 1, 1, 1202);
+  check(baseDelivered == 1, "epoch handling", "");
+
+  // More origins than ENL_ORIGINS: the stalest window makes room, the others keep theirs
+  baseDelivered = 0;
+  for (uint16_t o = 100; o < 100 + ENL_ORIGINS + 4; o++) feed(base, o, 1, 1, 0, 2000 + o);
+  feed(base, 100 + ENL_ORIGINS + 3, 1, 1, 1, 3000);
+  check(baseDelivered == ENL_ORIGINS + 4, "origin table overflow", "");
+
+  printf("%d failure(s)\n", fails);
+  return fails ? 1 : 0;
+}
+
+int main(int argc, char** argv) {
+  if (argc > 1 && !strcmp(argv[1], "selftest")) return selftest();
+  return run(argc, argv);
+}
@@ -0,0 +1,136 @@
+// game_clock.cpp
+// Host-side checks for the 64-bit game clock (GameClock.h) with a settable "now".
+//
+//   wrap       print a bomb countdown that spans the 49.7-day millis() rollover, next to what
+//              the old 32-bit millis() arithmetic gave
+//   selftest   countdowns, disarms and state-entry fades started on both sides of the
+//              rollover: deadline checks fire on the exact ms, remaining time never jumps,
+//              elapsed + remaining = total and the penalty halves the time left. A 32-bit
+//              deadline (start + duration in millis()) is shown to fire early at the rollover
+//
+// Build: g++ -std=c++11 -O2 -I.. game_clock.cpp -o game_clock
+
+#include <cstdio>
+#include <cstring>
+#include <stdint.h>
+
+static uint64_t fakeNowUs = 0;
+static uint64_t fakeClock() { return fakeNowUs; }
+#define GAME_CLOCK_SOURCE fakeClock
+#include "GameClock.h"
+
+static const uint64_t WRAP_US = 4294967296ull * 1000;   // millis() rolls over here (49.7 days)
+
+static uint32_t fakeMillis() { return (uint32_t)(fakeNowUs / 1000); }
+
+static int printWrap() {
+  const uint32_t total = 10000;
+  fakeNowUs = WRAP_US - 4000 * GAME_US_PER_MS;
+  GameUs deadline = gameDeadlineIn(total);
+  uint32_t armedMs = fakeMillis();
+  uint32_t deadline32 = armedMs + total;
+  printf("armed at millis() %u, bomb time %u ms\n", armedMs, total);
+  printf("%12s %8s %8s %8s %6s %6s\n", "millis()", "left", "old left", "32b dl", "fired", "old");
+  for (int i = 0; i <= 12; i++) {
+    uint32_t m = fakeMillis();
+    uint32_t el = m - armedMs;
+    uint32_t oldLeft = total > el ? total - el : 0;
+    printf("%12u %8u %8u %8s %6s %6s\n", m, gameMsLeft(deadline), oldLeft, m >= deadline32 ? "fired" : "-",
+           gameReached(deadline) ? "yes" : "no", el >= total ? "yes" : "no");
+    fakeNowUs += 1000 * GAME_US_PER_MS;
+  }
+  return 0;
+}
+
+static int fails = 0;
+static void check(bool ok, const char* what, uint64_t startUs) {
+  if (ok) return;
+  if (fails++ < 10) printf("FAIL  %s (start %llu us)\n", what, (unsigned long long)startUs);
+}
+
+// One countdown of totalMs from startUs, stepped in stepUs. Returns the number of steps where
+// a 32-bit millis() deadline disagreed with the 64-bit one.
+static unsigned runCountdown(uint64_t startUs, uint32_t totalMs, uint64_t stepUs) {
+  fakeNowUs = startUs;
+  GameUs deadline = gameDeadlineIn(totalMs);
+  uint32_t armedMs = fakeMillis();
+  uint32_t deadline32 = armedMs + totalMs;
+  check(gameMsLeft(deadline) == totalMs, "full time left at arm", startUs);
+  check(gameMsElapsed(deadline, totalMs) == 0, "nothing elapsed at arm", startUs);
+
+  uint32_t lastLeft = totalMs;
+  unsigned early32 = 0;
+  bool fired = false;
+  while (!fired) {
+    fakeNowUs += stepUs;
+    uint32_t left = gameMsLeft(deadline);
+    fired = gameReached(deadline);
+    check(left <= lastLeft, "remaining time went up", startUs);
+    check(lastLeft - left <= (stepUs + GAME_US_PER_MS - 1) / GAME_US_PER_MS, "remaining time jumped", startUs);
+    check(fired == (left == 0), "reached exactly when 0 ms are left", startUs);
+    check(fired == (fakeNowUs >= startUs + gameMsToUs(totalMs)), "fired off the deadline", startUs);
+    check(gameMsElapsed(deadline, totalMs) + left == totalMs, "elapsed + remaining != total", startUs);
+    // The old wrap-safe millis() form agrees, give or take the sub-ms it cannot see
+    uint64_t off = fakeNowUs > deadline ? fakeNowUs - deadline : deadline - fakeNowUs;
+    check(((uint32_t)(fakeMillis() - armedMs) >= totalMs) == fired || off < GAME_US_PER_MS, "old elapsed form", startUs);
+    if ((fakeMillis() >= deadline32) != fired && off >= GAME_US_PER_MS) early32++;
+    lastLeft = left;
+  }
+  return early32;
+}
+
+static int selftest() {
+  const uint32_t times[] = { 10000, 45000, 120000, 3600000 };
+  const uint64_t starts[] = { 0, 123456789ull, WRAP_US - 3600000ull * 1000, WRAP_US - 60000ull * 1000,
+                              WRAP_US - 1, WRAP_US, WRAP_US + 1, 7 * WRAP_US + 999 };
+  unsigned runs = 0, early32 = 0;
+  for (uint32_t t : times) {
+    for (uint64_t s : starts) {
+      early32 += runCountdown(s, t, 997) ? 1 : 0;
+      runs++;
+    }
+  }
+  printf("%u countdowns, %u with a 32-bit deadline wrong at some step\n", runs, early32);
+  check(early32 > 0, "32-bit deadlines should break across the rollover", 0);
+
+  // Penalty: deadline -= half the time left
+  fakeNowUs = WRAP_US - 20000ull * 1000;
+  GameUs deadline = gameDeadlineIn(45000);
+  fakeNowUs += 5000ull * 1000;
+  uint32_t left = gameMsLeft(deadline);
+  deadline -= gameMsToUs(left / 2);
+  check(gameMsLeft(deadline) == left - left / 2, "penalty halves the time left", fakeNowUs);
+  check(gameMsElapsed(deadline, 45000) == 45000 - gameMsLeft(deadline), "elapsed after penalty", fakeNowUs);
+
+  // Disarm deadline and state-entry fade straddling the rollover
+  fakeNowUs = WRAP_US - 500ull * 1000;
+  GameUs entered = gameNowUs();
+  GameUs disarm = gameDeadlineIn(1000);
+  fakeNowUs = WRAP_US + 499999;
+  check(!gameReached(disarm) && gameMsLeft(disarm) == 1, "disarm 1 ms early", fakeNowUs);
+  check(gameMsSince(entered) == 999, "ms since entry across rollover", fakeNowUs);
+  fakeNowUs = WRAP_US + 500000;
+  check(gameReached(disarm) && gameMsLeft(disarm) == 0, "disarm on time", fakeNowUs);
+  check(gameMsSince(entered) == 1000, "ms since entry at 1000", fakeNowUs);
+  check(gameMsSince(entered + 5) == 999 && gameMsSince(fakeNowUs + 1) == 0, "ms since a later timestamp", fakeNowUs);
+
+  // Saturation
+  fakeNowUs = 0;
+  check(gameMsLeft(~(GameUs)0) == 0xFFFFFFFFu, "far deadline saturates", 0);
+  fakeNowUs = ~(GameUs)0;
+  check(gameMsSince(0) == 0xFFFFFFFFu, "long ago saturates", 0);
+
+  // The real host source only moves forward
+  GameUs a = gameClockDefault(), b = gameClockDefault();
+  check(b >= a, "steady_clock went backwards", a);
+
+  printf("%d failure(s)\n", fails);
+  return fails ? 1 : 0;
+}
+
+int main(int argc, char** argv) {
+  if (argc > 1 && !strcmp(argv[1], "wrap")) return printWrap();
+  if (argc > 1 && !strcmp(argv[1], "selftest")) return selftest();
+  fprintf(stderr, "usage: %s wrap | selftest\n", argv[0]);
+  return 2;
+}
@@ -0,0 +1,206 @@
+// http_loopback.cpp
+// Host build of the REST API plumbing (HttpLite.h + JsonLite.h) behind a real socket.
+// Serves a stand-in settings struct with the same field-table mechanism HttpApi.h uses:
+//   GET /api/settings, PATCH /api/settings (Bearer token "secret").
+// Requests are fed to the parser in small pieces, the way WiFiClient delivers them.
+//
+// Build: g++ -std=c++11 -O2 -I.. http_loopback.cpp -o http_loopback
+// Run:   ./http_loopback selftest            scripted requests over 127.0.0.1, prints PASS/FAIL
+//        ./http_loopback serve [port=8081]   then e.g.
+//        curl -X PATCH -H 'Authorization: Bearer secret' -d '{"volume":12}' localhost:8081/api/settings
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <stddef.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include "HttpLite.h"
+
+struct DemoSettings {
+  uint32_t bomb_ms;
+  uint8_t  volume;
+  uint8_t  sudden_death;
+  uint16_t port;
+  uint32_t ip;
+  char     code[8];
+  char     token[16];
+};
+
+static DemoSettings demo = { 40000, 20, 0, 8080, (192u << 24) | (168u << 16) | 100u, "7355608", "secret" };
+
+#define DEMO_FIELD(key, type, flags, member, lo, hi) \
+  { key, type, flags, (uint16_t)offsetof(DemoSettings, member), (uint16_t)sizeof(((DemoSettings*)0)->member), lo, hi }
+
+static const JsonField FIELDS[] = {
+  DEMO_FIELD("bomb_ms",      JF_U32,  0,         bomb_ms,      10000, 3600000),
+  DEMO_FIELD("volume",       JF_U8,   0,         volume,       0, 30),
+  DEMO_FIELD("sudden_death", JF_BOOL, 0,         sudden_death, 0, 1),
+  DEMO_FIELD("port",         JF_U16,  JF_NET,    port,         1, 65535),
+  DEMO_FIELD("ip",           JF_IP,   JF_NET,    ip,           0, 0),
+  DEMO_FIELD("code",         JF_STR,  JF_DIGITS, code,         7, 7),
+  DEMO_FIELD("token",        JF_STR,  JF_SECRET, token,        0, 15),
+};
+static const size_t FIELD_COUNT = sizeof(FIELDS) / sizeof(FIELDS[0]);
+
+static HttpRequest req;
+static JsonOut out;
+static JsonTok toks[64];
+
+static void sinkFd(void* ctx, const char* data, size_t len) {
+  if (send(*(int*)ctx, data, len, MSG_NOSIGNAL) < 0) { /* client went away */ }
+}
+
+static void respond(int fd, uint16_t code) {
+  char head[160];
+  int n = snprintf(head, sizeof(head), "HTTP/1.1 %u %s\r\nContent-Type: application/json\r\nConnection: close\r\n\r\n",
+                   (unsigned)code, httpReason(code));
+  sinkFd(&fd, head, (size_t)n);
+}
+
+static void error(int fd, uint16_t code, const char* err) {
+  respond(fd, code);
+  out.begin(sinkFd, &fd);
+  out.open('{'); out.kvBool("ok", false); out.kvStr("err", err); out.close('}');
+  out.flush();
+}
+
+static void handle(int fd) {
+  req.reset();
+  int8_t r = HP_NEED_MORE;
+  char chunk[7];                                   // odd size: exercise split headers/bodies
+  while (r == HP_NEED_MORE) {
+    ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+    if (n <= 0) return;
+    r = req.feed(chunk, (size_t)n);
+  }
+  if (r == HP_TOO_LARGE) { error(fd, 413, "too_large"); return; }
+  if (r == HP_BAD)       { error(fd, 400, "bad_request"); return; }
+  if (strcmp(req.path, "/api/settings") != 0) { error(fd, 404, "not_found"); return; }
+
+  if (req.method == HM_GET) {
+    respond(fd, 200);
+    out.begin(sinkFd, &fd);
+    out.open('{');
+    jsonFieldsWrite(out, &demo, FIELDS, FIELD_COUNT);
+    out.close('}');
+    out.flush();
+    return;
+  }
+  if (req.method != HM_PATCH && req.method != HM_PUT && req.method != HM_POST) { error(fd, 405, "method"); return; }
+  if (strcmp(req.token, demo.token) != 0) { error(fd, 401, "auth"); return; }
+  int n = jsonTokenize(req.body(), req.bodyLen(), toks, 64);
+  if (n < 1) { error(fd, 400, "bad_json"); return; }
+  const char* bad = nullptr;
+  uint8_t touched = 0;
+  int changed = jsonFieldsApply(req.body(), toks, n, 0, &demo, FIELDS, FIELD_COUNT, &bad, &touched);
+  if (changed < 0) { std::string e = std::string("bad_field:") + bad; error(fd, 400, e.c_str()); return; }
+  respond(fd, 200);
+  out.begin(sinkFd, &fd);
+  out.open('{'); out.kvBool("ok", true); out.kv("changed", (uint32_t)changed);
+  out.kvBool("network_changed", (touched & JF_NET) != 0); out.close('}');
+  out.flush();
+}
+
+static int listenOn(uint16_t port) {
+  int s = socket(AF_INET, SOCK_STREAM, 0);
+  int one = 1;
+  setsockopt(s, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  sockaddr_in a;
+  memset(&a, 0, sizeof(a));
+  a.sin_family = AF_INET;
+  a.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  a.sin_port = htons(port);
+  if (bind(s, (sockaddr*)&a, sizeof(a)) < 0 || listen(s, 4) < 0) { perror("bind"); exit(1); }
+  return s;
+}
+
+// One request over a fresh loopback connection; the server side runs in-process after the
+// client has written (loopback buffers easily hold both directions).
+static std::string roundTrip(int lsock, const std::string& request) {
+  sockaddr_in a;
+  socklen_t al = sizeof(a);
+  getsockname(lsock, (sockaddr*)&a, &al);
+  int c = socket(AF_INET, SOCK_STREAM, 0);
+  if (connect(c, (sockaddr*)&a, al) < 0) { perror("connect"); exit(1); }
+  send(c, request.data(), request.size(), 0);
+  shutdown(c, SHUT_WR);
+  int s = accept(lsock, nullptr, nullptr);
+  handle(s);
+  close(s);
+  std::string resp;
+  char buf[512];
+  ssize_t n;
+  while ((n = recv(c, buf, sizeof(buf), 0)) > 0) resp.append(buf, (size_t)n);
+  close(c);
+  return resp;
+}
+
+static std::string patch(const char* token, const std::string& body) {
+  char head[200];
+  snprintf(head, sizeof(head), "PATCH /api/settings HTTP/1.1\r\nHost: x\r\n%s%s%sContent-Length: %u\r\n\r\n",
+           token ? "Authorization: Bearer " : "", token ? token : "", token ? "\r\n" : "", (unsigned)body.size());
+  return head + body;
+}
+
+// Token as the last header: its value must stop at the line end, not run into the body
+static std::string patchTokenLast(const char* header, const std::string& body) {
+  char head[200];
+  snprintf(head, sizeof(head), "PATCH /api/settings HTTP/1.1\r\nContent-Length: %u\r\n%ssecret\r\n\r\n",
+           (unsigned)body.size(), header);
+  return head + body;
+}
+
+static int selftest() {
+  int ls = listenOn(0);
+  struct Case { const char* name; std::string request; const char* expectStatus; const char* expectBody; };
+  const Case cases[] = {
+    { "get",              "GET /api/settings HTTP/1.1\r\nHost: x\r\n\r\n", " 200 ", "\"code\":\"7355608\"" },
+    { "secret hidden",    "GET /api/settings HTTP/1.1\r\n\r\n",            " 200 ", "\"token_set\":true" },
+    { "patch",            patch("secret", "{\"volume\":12,\"ip\":\"10.0.0.7\"}"), " 200 ", "\"changed\":2,\"network_changed\":true" },
+    { "patch applied",    "GET /api/settings HTTP/1.1\r\n\r\n",            " 200 ", "\"volume\":12" },
+    { "no token",         patch(nullptr, "{\"volume\":1}"),                " 401 ", "auth" },
+    { "token header last", patchTokenLast("X-C4-Token: ", "{\"volume\":13}"), " 200 ", "\"changed\":1" },
+    { "bearer header last", patchTokenLast("Authorization: Bearer ", "{\"volume\":12}"), " 200 ", "\"changed\":1" },
+    { "out of range",     patch("secret", "{\"volume\":31}"),              " 400 ", "bad_field:volume" },
+    { "atomic",           patch("secret", "{\"volume\":5,\"nope\":1}"),    " 400 ", "bad_field:nope" },
+    { "atomic unchanged", "GET /api/settings HTTP/1.1\r\n\r\n",            " 200 ", "\"volume\":12" },
+    { "digits only",      patch("secret", "{\"code\":\"12345a7\"}"),       " 400 ", "bad_field:code" },
+    { "bad ip",           patch("secret", "{\"ip\":\"10.0.0.256\"}"),      " 400 ", "bad_field:ip" },
+    { "bad json",         patch("secret", "{\"volume\":}"),                " 400 ", "bad_json" },
+    { "too large",        patch("secret", std::string(4000, ' ')),         " 413 ", "too_large" },
+    { "bad request",      "HELLO\r\n\r\n",                                 " 400 ", "bad_request" },
+    { "not found",        "GET /nope HTTP/1.1\r\n\r\n",                    " 404 ", "not_found" },
+  };
+  int fails = 0;
+  for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+    std::string resp = roundTrip(ls, cases[i].request);
+    std::string line = resp.substr(0, resp.find("\r\n"));
+    bool ok = line.find(cases[i].expectStatus) != std::string::npos && resp.find(cases[i].expectBody) != std::string::npos;
+    if (!ok) fails++;
+    printf("%s  %-18s %s\n", ok ? "PASS" : "FAIL", cases[i].name, ok ? line.c_str() : resp.c_str());
+  }
+  close(ls);
+  printf("%d failure(s)\n", fails);
+  return fails ? 1 : 0;
+}
+
+int main(int argc, char** argv) {
+  if (argc > 1 && !strcmp(argv[1], "selftest")) return selftest();
+  if (argc > 1 && !strcmp(argv[1], "serve")) {
+    uint16_t port = argc > 2 ? (uint16_t)atoi(argv[2]) : 8081;
+    int ls = listenOn(port);
+    printf("listening on http://127.0.0.1:%u/api/settings (token \"secret\")\n", (unsigned)port);
+    for (;;) {
+      int s = accept(ls, nullptr, nullptr);
+      if (s < 0) continue;
+      handle(s);
+      close(s);
+    }
+  }
+  fprintf(stderr, "usage: %s selftest | serve [port]\n", argv[0]);
+  return 2;
+}
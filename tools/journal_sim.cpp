@@ -0,0 +1,360 @@
+// journal_sim.cpp
+// Host run of the event journal (JournalCore.h) against a stand-in scoreboard over a simulated
+// WebSocket link. The flash is a key/value map that outlives reboots; the link delays, drops
+// and duplicates frames and goes down now and then. The stand-in applies the ack rules of
+// scoreboard_standin.py: per epoch, the next seq in order is delivered, older ones are
+// duplicates, and every event is answered with a cumulative ack of the last one in order.
+// Unlike the Python stand-in it expects seq 1 first, since it never misses the start of an epoch.
+//
+//   run [seconds] [seed]   one random session with every fault on; prints what was
+//                          generated, delivered, resent and the worst delivery delay
+//   selftest               every seq delivered exactly once and in order, with nothing left
+//                          queued, for: a clean link, dropped frames, dropped acks, duplicate
+//                          and stale acks, acks slower than the retransmit timer, disconnects,
+//                          reboots (replay from flash) and all of them at once over many seeds.
+//                          Also: duplicate acks do not hold back a retransmit, a full flash
+//                          drops only the oldest events, and an ack never retires an event the
+//                          scoreboard has not had. (Built with -DJOURNAL_SERVER_ACKS=0 the
+//                          journal is fire-and-forget and the loss cases fail, as they should.)
+//
+// Build: g++ -std=c++11 -O2 -I.. journal_sim.cpp -o journal_sim
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include "JournalCore.h"
+
+static uint32_t rng = 1;
+static uint32_t rnd(uint32_t n) { rng = rng * 1103515245u + 12345u; return n ? (rng >> 8) % n : 0; }
+static bool chance(float p) { return rnd(1000000) < (uint32_t)(p * 1000000); }
+
+static int fails = 0;
+static void check(bool ok, const char* what, const char* detail) {
+  if (ok) return;
+  if (fails++ < 12) printf("FAIL  %s (%s)\n", what, detail);
+}
+
+// ---- flash ----
+
+struct Flash {
+  std::map<std::string, std::vector<uint8_t> > kv;
+};
+
+static uint32_t flashGetU32(void* ctx, const char* key, uint32_t def) {
+  Flash* f = (Flash*)ctx;
+  auto it = f->kv.find(key);
+  if (it == f->kv.end() || it->second.size() != 4) return def;
+  uint32_t v;
+  memcpy(&v, &it->second[0], 4);
+  return v;
+}
+static void flashPutU32(void* ctx, const char* key, uint32_t v) {
+  ((Flash*)ctx)->kv[key].assign((uint8_t*)&v, (uint8_t*)&v + 4);
+}
+static bool flashGetBytes(void* ctx, const char* key, void* buf, size_t len) {
+  Flash* f = (Flash*)ctx;
+  auto it = f->kv.find(key);
+  if (it == f->kv.end() || it->second.size() != len) return false;
+  memcpy(buf, &it->second[0], len);
+  return true;
+}
+static void flashPutBytes(void* ctx, const char* key, const void* buf, size_t len) {
+  ((Flash*)ctx)->kv[key].assign((const uint8_t*)buf, (const uint8_t*)buf + len);
+}
+
+// ---- faults ----
+
+struct Faults {
+  const char* name;
+  float    dropFrame;      // prop -> scoreboard
+  float    dropAck;
+  float    dupAck;         // an ack arrives twice
+  float    staleAck;       // an old ack is replayed later
+  uint32_t ackDelayMs;     // extra delay on every ack (a slow scoreboard)
+  uint32_t downEveryMs;    // mean time between link drops, 0 = never
+  uint32_t downForMs;      // longest outage
+  float    rebootOffline;  // chance per outage that the prop power-cycles
+};
+
+// ---- the session ----
+
+struct Frame { uint32_t at; std::string text; };
+
+struct Sim {
+  Faults   f;
+  Flash    flash;
+  Journal  jr;
+  uint32_t now = 0;
+  bool     up = true;
+  uint32_t downAt = 0;
+  std::deque<Frame> toBoard, toProp;
+  std::vector<std::string> oldAcks;
+
+  // Stand-in scoreboard
+  std::map<uint32_t, uint32_t> nextSeq;           // epoch -> next expected seq
+  std::vector<std::pair<uint32_t, uint32_t> > delivered;
+  std::set<uint64_t> had;
+  uint32_t dupes = 0, gaps = 0;
+
+  // Prop side
+  std::vector<std::pair<uint32_t, uint32_t> > generated;
+  std::map<uint64_t, uint32_t> addedAt;
+  uint32_t maxDelayMs = 0, reboots = 0, sent = 0, retransmits = 0;
+  size_t   retiredUpTo = 0;
+  bool     retiredUnseen = false;
+
+  static void sendFrame(void* ctx, const char* json, size_t len, bool) {
+    Sim* s = (Sim*)ctx;
+    s->sent++;
+    if (!s->up || chance(s->f.dropFrame)) return;
+    s->toBoard.push_back(Frame{ s->now + 5 + rnd(40), std::string(json, len) });
+  }
+
+  void boot() {
+    retransmits += jr.retransmits;
+    JournalStore store = { &flash, flashGetU32, flashPutU32, flashGetBytes, flashPutBytes };
+    jr.begin(store, sendFrame, this);
+  }
+
+  void addEvent() {
+    char body[64];
+    snprintf(body, sizeof(body), "{\"type\":\"c4_event\",\"c4_status\":\"planted\",\"n\":%u}", (unsigned)generated.size());
+    jr.add(body, true);
+    generated.push_back(std::make_pair(jr.epoch, jr.nextSeq - 1));
+    addedAt[journalKey(jr.epoch, jr.nextSeq - 1)] = now;
+  }
+
+  void ackOut(uint32_t epoch, uint32_t seq, uint32_t at) {
+    char a[80];
+    snprintf(a, sizeof(a), "{\"type\":\"ack\",\"epoch\":%u,\"seq\":%u}", (unsigned)epoch, (unsigned)seq);
+    oldAcks.push_back(a);
+    if (chance(f.dropAck)) return;
+    toProp.push_back(Frame{ at, a });
+    if (chance(f.dupAck)) toProp.push_back(Frame{ at + rnd(30), a });
+  }
+
+  // scoreboard_standin.py on_event
+  void onEvent(const std::string& msg) {
+    const char* e = strstr(msg.c_str(), "\"epoch\":");
+    const char* s = strstr(msg.c_str(), "\"seq\":");
+    if (!e || !s) return;
+    uint32_t epoch = strtoul(e + 8, nullptr, 10), seq = strtoul(s + 6, nullptr, 10);
+    uint32_t& next = nextSeq.insert(std::make_pair(epoch, 1u)).first->second;
+    if (seq == next) {
+      next++;
+      delivered.push_back(std::make_pair(epoch, seq));
+      had.insert(journalKey(epoch, seq));
+      uint32_t d = now - addedAt[journalKey(epoch, seq)];
+      if (d > maxDelayMs) maxDelayMs = d;
+    } else if (seq < next) {
+      dupes++;
+    } else {
+      gaps++;
+    }
+    if (next > 1) ackOut(epoch, next - 1, now + 5 + rnd(40) + f.ackDelayMs);
+  }
+
+  void step(uint32_t dtMs) {
+    now += dtMs;
+    while (!toBoard.empty() && toBoard.front().at <= now) { onEvent(toBoard.front().text); toBoard.pop_front(); }
+    std::stable_sort(toProp.begin(), toProp.end(), [](const Frame& a, const Frame& b) { return a.at < b.at; });
+    while (!toProp.empty() && toProp.front().at <= now) {
+      jr.handleAckMessage(toProp.front().text.c_str(), now);
+      toProp.pop_front();
+    }
+    if (!oldAcks.empty() && chance(f.staleAck * dtMs / 100))
+      toProp.push_back(Frame{ now + 5, oldAcks[rnd((uint32_t)oldAcks.size())] });
+    jr.pump(up, !up, now);
+    // An ack must never retire an event the scoreboard has not had
+    for (size_t retired = jr.dropped ? 0 : generated.size() - jr.pending(); retiredUpTo < retired; retiredUpTo++)
+      if (!had.count(journalKey(generated[retiredUpTo].first, generated[retiredUpTo].second))) retiredUnseen = true;
+  }
+
+  // The link goes down; frames in flight are lost. Maybe a power cycle while it is down.
+  void linkDown() {
+    up = false;
+    toBoard.clear();
+    toProp.clear();
+    for (int i = 0; i < 5; i++) step(10);         // the offline checkpoint runs
+    if (chance(f.rebootOffline)) { boot(); reboots++; }
+  }
+
+  // Events every ~eventMs for ms, with outages per the faults
+  void run(uint32_t ms, uint32_t eventMs) {
+    uint32_t end = now + ms;
+    uint32_t nextDown = f.downEveryMs ? now + f.downEveryMs / 2 + rnd(f.downEveryMs) : 0xFFFFFFFFu;
+    while (now < end) {
+      if (up && now >= nextDown) {
+        linkDown();
+        downAt = now + 100 + rnd(f.downForMs);
+      } else if (!up && now >= downAt) {
+        up = true;
+        nextDown = now + f.downEveryMs / 2 + rnd(f.downEveryMs);
+      }
+      if (chance(10.0f / eventMs)) addEvent();
+      step(10);
+    }
+  }
+
+  // Clean link until everything is acked (or a minute passes)
+  void drain() {
+    f.dropFrame = f.dropAck = f.dupAck = f.staleAck = 0;
+    f.ackDelayMs = 0;
+    up = true;
+    for (uint32_t t = 0; t < 60000 && (jr.pending() || !toBoard.empty()); t += 10) step(10);
+  }
+
+  // Every generated (epoch, seq) delivered once, in order, none left queued
+  bool exact(char* why, size_t n) const {
+    if (delivered.size() != generated.size()) {
+      snprintf(why, n, "generated %u, delivered %u", (unsigned)generated.size(), (unsigned)delivered.size());
+      return false;
+    }
+    for (size_t i = 0; i < delivered.size(); i++) {
+      if (delivered[i] != generated[i]) {
+        snprintf(why, n, "#%u: delivered %u/%u, want %u/%u", (unsigned)i, delivered[i].first, delivered[i].second,
+                 generated[i].first, generated[i].second);
+        return false;
+      }
+    }
+    if (jr.pending()) { snprintf(why, n, "%u still queued", (unsigned)jr.pending()); return false; }
+    return true;
+  }
+};
+
+static const Faults CLEAN      = { "clean",       0,    0,    0,    0,    0,    0,     0,    0 };
+static const Faults LOSSY      = { "drop frames", 0.2f, 0,    0,    0,    0,    0,     0,    0 };
+static const Faults ACKLOSS    = { "drop acks",   0,    0.4f, 0,    0,    0,    0,     0,    0 };
+static const Faults DUPACKS    = { "dup+stale",   0,    0,    0.5f, 0.5f, 0,    0,     0,    0 };
+static const Faults SLOWACK    = { "slow acks",   0,    0,    0,    0,    4500, 0,     0,    0 };
+static const Faults FLAPPING   = { "disconnect",  0,    0,    0,    0,    0,    8000,  6000, 0 };
+static const Faults REBOOTS    = { "reboot",      0,    0,    0,    0,    0,    8000,  6000, 0.7f };
+static const Faults EVERYTHING = { "all",         0.1f, 0.2f, 0.3f, 0.3f, 1500, 10000, 8000, 0.4f };
+
+static void session(Sim& s, const Faults& f, uint32_t seed, uint32_t ms, uint32_t eventMs) {
+  rng = seed;
+  s.f = f;
+  s.boot();
+  s.run(ms, eventMs);
+  s.drain();
+  s.retransmits += s.jr.retransmits;
+}
+
+static int runMode(int argc, char** argv) {
+  uint32_t secs = argc > 2 ? (uint32_t)atoi(argv[2]) : 300;
+  uint32_t seed = argc > 3 ? (uint32_t)atoi(argv[3]) : 1;
+  Sim s;
+  session(s, EVERYTHING, seed, secs * 1000, 1500);
+  char why[96] = "";
+  bool ok = s.exact(why, sizeof(why));
+  printf("%u s, faults \"%s\": %u events over %u boot(s), %u delivered, %u frames sent, %u duplicates at the board, "
+         "%u gaps, %u retransmit timeout(s), worst delay %u ms: %s %s\n",
+         secs, EVERYTHING.name, (unsigned)s.generated.size(), s.reboots + 1, (unsigned)s.delivered.size(), s.sent,
+         s.dupes, s.gaps, s.retransmits, s.maxDelayMs, ok ? "exactly once, in order" : "FAILED", why);
+  return ok ? 0 : 1;
+}
+
+static int selftest() {
+  const Faults* all[] = { &CLEAN, &LOSSY, &ACKLOSS, &DUPACKS, &SLOWACK, &FLAPPING, &REBOOTS, &EVERYTHING };
+  for (const Faults* f : all) {
+    uint32_t events = 0, reboots = 0, worst = 0, seeds = f == &EVERYTHING ? 40 : 5;
+    for (uint32_t seed = 1; seed <= seeds; seed++) {
+      Sim s;
+      session(s, *f, seed * 7919, 120000, 1000);
+      char why[96] = "", d[140];
+      bool ok = s.exact(why, sizeof(why));
+      snprintf(d, sizeof(d), "%s seed %u: %s", f->name, (unsigned)seed, why);
+      check(ok, "not exactly once in order", d);
+      check(!s.retiredUnseen, "retired an event the scoreboard never had", d);
+      events += (uint32_t)s.generated.size();
+      reboots += s.reboots;
+      if (s.maxDelayMs > worst) worst = s.maxDelayMs;
+    }
+    printf("%-12s %2u seeds, %5u events, %3u reboots: exactly once, in order, worst delay %u ms\n",
+           f->name, (unsigned)seeds, events, reboots, worst);
+  }
+
+  // Duplicate acks keep coming (later frames arrive past a lost one) while new events keep
+  // going out: the lost one is still resent within the ack timeout.
+  {
+    Sim s;
+    rng = 5;
+    s.f = CLEAN;
+    s.boot();
+    s.addEvent();
+    s.step(10);
+    s.step(100);                                   // 1/1 acked
+    s.f.dropFrame = 1;
+    s.addEvent();                                  // 1/2 lost
+    s.step(10);
+    s.f.dropFrame = 0;
+    uint32_t lostAt = s.now;
+    for (int i = 0; i < 40 && s.delivered.size() < 2; i++) { s.addEvent(); for (int k = 0; k < 20; k++) s.step(10); }
+    char d[64];
+    snprintf(d, sizeof(d), "seq 2 delivered after %u ms", (unsigned)(s.now - lostAt));
+    check(s.delivered.size() >= 2 && s.now - lostAt <= JOURNAL_ACK_TIMEOUT_MS + 500, "dup acks held back the retransmit", d);
+    s.drain();
+    char why[96] = "";
+    check(s.exact(why, sizeof(why)), "dup acks: not exactly once", why);
+    printf("lost frame under a stream of duplicate acks: %s\n", d);
+  }
+
+  // Flash full while offline (everything is checkpointed): only the oldest events are dropped,
+  // the rest arrive in order
+  {
+    Sim s;
+    rng = 9;
+    s.f = CLEAN;
+    s.boot();
+    s.up = false;
+    s.step(10);
+    uint32_t n = JOURNAL_FLASH_SLOTS + JOURNAL_RAM_SLOTS + 10;
+    for (uint32_t i = 0; i < n; i++) { s.addEvent(); s.step(10); }
+    uint32_t dropped = s.jr.dropped;
+    s.up = true;
+    s.nextSeq[s.jr.epoch] = dropped + 1;           // the board learns of the gap out of band
+    s.drain();
+    bool ok = dropped == n - JOURNAL_FLASH_SLOTS && s.delivered.size() == n - dropped &&
+              std::equal(s.delivered.begin(), s.delivered.end(), s.generated.begin() + dropped);
+    char d[64];
+    snprintf(d, sizeof(d), "%u dropped, %u delivered", dropped, (unsigned)s.delivered.size());
+    check(ok, "flash overflow", d);
+  }
+
+  // Reboot with events in flash that were sent but never acked: replayed under the old epoch
+  {
+    Sim s;
+    rng = 3;
+    s.f = CLEAN;
+    s.f.dropAck = 1;
+    s.boot();
+    for (int i = 0; i < 5; i++) { s.addEvent(); s.step(10); }
+    for (int i = 0; i < 10; i++) s.step(10);      // the board has them, the prop does not know
+    s.linkDown();
+    s.boot();
+    s.up = true;
+    s.addEvent();
+    s.drain();
+    char why[96] = "";
+    check(s.exact(why, sizeof(why)) && s.dupes >= 5, "reboot replay", why);
+    printf("reboot with 5 unacked events: replayed as epoch %u, %u duplicate(s) at the board\n",
+           s.generated[0].first, s.dupes);
+  }
+
+  printf("%d failure(s)\n", fails);
+  return fails ? 1 : 0;
+}
+
+int main(int argc, char** argv) {
+  if (argc > 1 && !strcmp(argv[1], "run")) return runMode(argc, argv);
+  if (argc > 1 && !strcmp(argv[1], "selftest")) return selftest();
+  fprintf(stderr, "usage: %s run [seconds] [seed] | selftest\n", argv[0]);
+  return 2;
+}
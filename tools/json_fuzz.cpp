@@ -0,0 +1,208 @@
+// json_fuzz.cpp
+// Mutational fuzzer for the in-place JSON tokenizer (JsonLite.h), the parser every WebSocket
+// command, round_config and PATCH /api/settings body goes through. Inputs are prop protocol
+// messages, then every prefix of them, then random byte flips, inserts, deletes, splices and
+// truncations. Each input sits in a heap buffer of exactly its length (no NUL after it), so
+// the sanitizers catch any read past the end. For every result:
+//   - the count is -1 or 0..maxToks, and the same on a second run
+//   - each token: known type, 0 <= start <= end <= len, -1 <= parent < index
+//   - strings sit between quotes, containers between their brackets, inside their parent
+//   - size = number of tokens naming it as parent; object members are keys with one value
+//   - too few tokens gives -1, never a partial result
+// jsonFind / jsonU32 / jsonEq / jsonTerm then run over the tokens of every accepted input.
+//
+//   run [iterations=1000000] [seed=1]   fuzz, print accepted/rejected counts
+//   selftest                            the seeds parse, then 300000 mutations: 0 failures
+//
+// Build: g++ -std=c++11 -O1 -g -fsanitize=address,undefined -fno-sanitize-recover=all -I.. json_fuzz.cpp -o json_fuzz
+// libFuzzer: clang++ -std=c++11 -g -O1 -DJSON_FUZZ_LIBFUZZER -fsanitize=fuzzer,address,undefined -I.. json_fuzz.cpp -o json_fuzz
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "JsonLite.h"
+
+static const uint16_t FUZZ_MAX_TOKS = 48;
+
+static const char* SEEDS[] = {
+  "{\"type\":\"cmd\",\"id\":7,\"token\":\"s3cret\",\"cmd\":\"arm\",\"code\":\"1234567\"}",
+  "{\"type\":\"cmd\",\"id\":8,\"token\":\"s3cret\",\"cmd\":\"timer\",\"op\":\"rate\",\"value\":150}",
+  "{\"type\":\"round_config\",\"round\":3,\"token\":\"t\",\"start_at\":123456789,\"bomb_ms\":45000,"
+    "\"fixed_code\":\"\",\"sudden_death\":0,\"dud_enabled\":true,\"dud_chance\":5}",
+  "{\"type\":\"ack\",\"epoch\":12,\"seq\":40}",
+  "{\"type\":\"sync_resp\",\"t0\":1,\"t1\":4294967295,\"t2\":-3}",
+  "[{\"a\":1},{\"b\":[1,2,[3,{\"c\":null}]]},\"x\\u00e9\\n\\\"\",false]",
+  "{\"bomb_duration_ms\":40000,\"sound_volume\":25,\"fixed_code_val\":\"7355608\",\"wifi_ssid\":\"a b\"}",
+  "{ \"k\" : [ ] , \"o\" : { } , \"n\" : -0.5e10 }",
+};
+static const size_t SEED_COUNT = sizeof(SEEDS) / sizeof(SEEDS[0]);
+static const char JSON_BYTES[] = "{}[]\":,\\ \t\n0123456789-eE.+tfnulrsabu";
+
+static int fails = 0;
+static void check(bool ok, const char* what, const std::string& in) {
+  if (ok) return;
+  if (fails++ < 12) printf("FAIL  %s (%zu bytes: %.80s)\n", what, in.size(), in.c_str());
+}
+
+static uint32_t rng = 1;
+static uint32_t rnd(uint32_t n) { rng = rng * 1103515245u + 12345u; return (rng >> 8) % n; }
+
+struct FuzzStats { uint64_t inputs, accepted, rejected, tokens; };
+static FuzzStats fs;
+
+// Token invariants for one tokenizer result over js[0..len)
+static void checkTokens(const char* js, size_t len, const JsonTok* t, int n, const std::string& in) {
+  size_t end = 0;                                    // the tokenizer stops at the first NUL
+  while (end < len && js[end]) end++;
+  for (int i = 0; i < n; i++) {
+    const JsonTok& k = t[i];
+    check(k.type >= JSON_OBJECT && k.type <= JSON_PRIMITIVE, "token type", in);
+    check(k.start >= 0 && k.start <= k.end && (size_t)k.end <= end, "start <= end <= len", in);
+    check(k.parent >= -1 && k.parent < i, "parent < index", in);
+    if (k.start < 0 || k.start > k.end || (size_t)k.end > end || k.parent < -1 || k.parent >= i) continue;
+    if (k.type == JSON_STRING) {
+      check(k.start > 0 && js[k.start - 1] == '"' && (size_t)k.end < end && js[k.end] == '"', "string outside quotes", in);
+    } else if (k.type == JSON_OBJECT || k.type == JSON_ARRAY) {
+      char open = k.type == JSON_OBJECT ? '{' : '[', close = k.type == JSON_OBJECT ? '}' : ']';
+      check(k.end - k.start >= 2 && js[k.start] == open && js[k.end - 1] == close, "container brackets", in);
+    } else {
+      check(k.end > k.start, "empty primitive", in);
+    }
+    uint16_t kids = 0;
+    for (int j = i + 1; j < n; j++) if (t[j].parent == i) kids++;
+    check(kids == k.size, "size != children", in);
+    if (k.parent >= 0) {
+      const JsonTok& p = t[k.parent];
+      if (p.type == JSON_OBJECT || p.type == JSON_ARRAY)
+        check(k.start > p.start && k.end < p.end, "token outside its parent", in);
+      if (p.type == JSON_OBJECT) check(k.type == JSON_STRING && k.size == 1, "object member is not a key", in);
+      if (p.type == JSON_STRING) check(k.start > p.end, "value before its key", in);
+    }
+  }
+}
+
+// The accessors the command handlers use, over every object and token
+static void exerciseAccessors(const char* js, size_t len, const JsonTok* t, int n, const std::string& in) {
+  static const char* KEYS[] = { "type", "id", "token", "cmd", "code", "value", "epoch", "seq", "a", "k" };
+  for (int i = 0; i < n; i++) {
+    uint32_t v;
+    jsonU32(js, t[i], v);
+    jsonBool(js, t[i]);
+    jsonEq(js, t[i], "cmd");
+    if (t[i].type == JSON_OBJECT)
+      for (const char* key : KEYS) {
+        check(jsonFind(js, t, n, i, key) < n, "jsonFind past the last token", in);
+      }
+  }
+  // jsonTerm writes at end: on a copy, one token at a time
+  std::vector<char> copy(js, js + len);
+  for (int i = 0; i < n; i++) {
+    if (t[i].type != JSON_STRING && t[i].type != JSON_PRIMITIVE) continue;
+    if ((size_t)t[i].end >= len) continue;         // a primitive at the very end has no byte to overwrite
+    const char* s = jsonTerm(copy.data(), t[i]);
+    (void)strlen(s);
+    memcpy(copy.data(), js, len);
+  }
+}
+
+// One input: exact-size heap copy, tokenize, check
+static int fuzzOne(const uint8_t* data, size_t len) {
+  char* js = (char*)malloc(len ? len : 1);
+  if (len) memcpy(js, data, len);
+  std::string in((const char*)data, len);
+  JsonTok toks[FUZZ_MAX_TOKS], again[FUZZ_MAX_TOKS];
+  int n = jsonTokenize(js, len, toks, FUZZ_MAX_TOKS);
+  fs.inputs++;
+  check(n >= -1 && n <= FUZZ_MAX_TOKS, "token count out of range", in);
+  check(jsonTokenize(js, len, again, FUZZ_MAX_TOKS) == n, "not deterministic", in);
+  if (n > 0) {
+    fs.accepted++;
+    fs.tokens += n;
+    checkTokens(js, len, toks, n, in);
+    bool same = true;
+    for (int i = 0; i < n; i++)
+      same &= toks[i].type == again[i].type && toks[i].start == again[i].start && toks[i].end == again[i].end &&
+              toks[i].size == again[i].size && toks[i].parent == again[i].parent;
+    check(same, "tokens differ between runs", in);
+    check(jsonTokenize(js, len, again, (uint16_t)(n - 1)) == -1, "too few tokens did not fail", in);
+    exerciseAccessors(js, len, toks, n, in);
+  } else {
+    fs.rejected++;
+  }
+  free(js);
+  return 0;
+}
+
+static std::string mutate(std::string s) {
+  uint32_t edits = 1 + rnd(4);
+  for (uint32_t e = 0; e < edits; e++) {
+    uint32_t op = rnd(7);
+    size_t at = s.empty() ? 0 : rnd((uint32_t)s.size());
+    switch (op) {
+      case 0: if (!s.empty()) s[at] = (char)rnd(256); break;                                   // random byte
+      case 1: s.insert(at, 1, JSON_BYTES[rnd(sizeof(JSON_BYTES) - 1)]); break;                  // JSON-ish byte
+      case 2: if (!s.empty()) s.erase(at, 1 + rnd(4)); break;                                   // delete
+      case 3: s.resize(at); break;                                                              // truncate
+      case 4: if (!s.empty()) s.insert(at, s.substr(rnd((uint32_t)s.size()), 1 + rnd(12))); break;  // duplicate a span
+      case 5: { const char* o = SEEDS[rnd(SEED_COUNT)]; size_t ol = strlen(o);                  // splice another seed
+                s = s.substr(0, at) + std::string(o + rnd((uint32_t)ol), o + ol); } break;
+      case 6: if (!s.empty()) s[at] = "{}[]\",:\\"[rnd(8)]; break;                              // structural byte
+    }
+  }
+  return s;
+}
+
+static void fuzz(uint64_t iterations) {
+  std::vector<std::string> pool(SEEDS, SEEDS + SEED_COUNT);
+  for (uint64_t i = 0; i < iterations; i++) {
+    std::string s = mutate(pool[rnd((uint32_t)pool.size())]);
+    fuzzOne((const uint8_t*)s.data(), s.size());
+    if (pool.size() < 512 && s.size() < 400 && rnd(64) == 0) pool.push_back(s);   // keep some mutants to mutate further
+  }
+}
+
+static int run(int argc, char** argv) {
+  uint64_t iterations = argc > 2 ? strtoull(argv[2], nullptr, 10) : 1000000;
+  rng = argc > 3 ? (uint32_t)atoi(argv[3]) : 1;
+  fuzz(iterations);
+  printf("%llu inputs: %llu accepted (%llu tokens), %llu rejected\n", (unsigned long long)fs.inputs,
+         (unsigned long long)fs.accepted, (unsigned long long)fs.tokens, (unsigned long long)fs.rejected);
+  printf("%d failure(s)\n", fails);
+  return fails ? 1 : 0;
+}
+
+static int selftest() {
+  for (size_t i = 0; i < SEED_COUNT; i++) {
+    JsonTok toks[FUZZ_MAX_TOKS];
+    check(jsonTokenize(SEEDS[i], strlen(SEEDS[i]), toks, FUZZ_MAX_TOKS) > 0, "seed rejected", SEEDS[i]);
+  }
+  // Every prefix of every seed (a frame cut short)
+  for (size_t i = 0; i < SEED_COUNT; i++)
+    for (size_t l = 0; l <= strlen(SEEDS[i]); l++) fuzzOne((const uint8_t*)SEEDS[i], l);
+  // Embedded NUL: the tokenizer stops there
+  std::string nul("{\"a\":1}\0{", 9);
+  fuzzOne((const uint8_t*)nul.data(), nul.size());
+  rng = 1;
+  fuzz(300000);
+  printf("%llu inputs: %llu accepted, %llu rejected\n", (unsigned long long)fs.inputs,
+         (unsigned long long)fs.accepted, (unsigned long long)fs.rejected);
+  printf("%d failure(s)\n", fails);
+  return fails ? 1 : 0;
+}
+
+#ifdef JSON_FUZZ_LIBFUZZER
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+  fuzzOne(data, size);
+  if (fails) abort();
+  return 0;
+}
+#else
+int main(int argc, char** argv) {
+  if (argc > 1 && !strcmp(argv[1], "run")) return run(argc, argv);
+  if (argc > 1 && !strcmp(argv[1], "selftest")) return selftest();
+  fprintf(stderr, "usage: %s run [iterations] [seed] | selftest\n", argv[0]);
+  return 2;
+}
+#endif
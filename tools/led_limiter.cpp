@@ -0,0 +1,163 @@
+// led_limiter.cpp
+// Host-side checks and timing for the per-frame LED current limiter (LedLimiter.h).
+//
+//   bench [leds]   time per frame for the channel sum and the whole limiter step (sum, scale,
+//                  current, per-state stats) at 60, 150 and 300 pixels or the given count,
+//                  next to the byte loop and divisions it replaced (powerLedMa + divide)
+//   selftest       the 4-byte sum matches a byte loop for every length and alignment; the
+//                  brightness picked never puts the frame over the room and is within a level
+//                  and 1 % of the exact answer over a grid of frame sums and rooms; LED_MAX_MA
+//                  holds with an unlimited budget; the current reported matches powerLedMa();
+//                  per-state frames, average, peak, demand and dimmed counts add up
+//
+// Build: g++ -std=c++11 -O2 -I.. led_limiter.cpp -o led_limiter
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <stdint.h>
+#include "LedLimiter.h"
+
+static uint32_t rng = 1;
+static uint32_t rnd(uint32_t n) { rng = rng * 1103515245u + 12345u; return (rng >> 8) % n; }
+
+static int fails = 0;
+static void check(bool ok, const char* what, uint32_t a, uint32_t b) {
+  if (ok) return;
+  if (fails++ < 12) printf("FAIL  %s (%u, %u)\n", what, a, b);
+}
+
+static volatile uint32_t sink;   // keeps the timed loops from being optimised away
+
+// ns per call of f over 'frames' frames
+template <typename F>
+static double timeNs(uint32_t frames, F f) {
+  auto t0 = std::chrono::steady_clock::now();
+  for (uint32_t k = 0; k < frames; k++) f(k);
+  auto t1 = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(t1 - t0).count() / frames;
+}
+
+static int bench(int argc, char** argv) {
+  std::vector<uint16_t> counts;
+  if (argc > 2) counts.push_back((uint16_t)atoi(argv[2]));
+  else counts = { 60, 150, 300 };
+  const uint32_t POOL = 32, FRAMES = 400000;
+  printf("%6s %10s %10s %10s %10s\n", "leds", "sum_ns", "frame_ns", "old_ns", "dimmed%");
+  for (uint16_t n : counts) {
+    std::vector<uint8_t> pool((size_t)POOL * n * 3);
+    rng = 5;
+    for (auto& v : pool) v = (uint8_t)rnd(256);
+    LedLimiter lim;
+    lim.begin(n);
+    uint32_t dimmed = 0;
+    double sumNs = timeNs(FRAMES, [&](uint32_t k) {
+      sink += ledChannelSum(&pool[(size_t)(k % POOL) * n * 3], (uint32_t)n * 3);
+    });
+    double frameNs = timeNs(FRAMES, [&](uint32_t k) {
+      uint8_t b = lim.frame(&pool[(size_t)(k % POOL) * n * 3], 255, 200 + (k * 7) % (n * 60), (uint8_t)(k % STATE_COUNT));
+      dimmed += b < 255;
+      sink += b;
+    });
+    // What Power.h did before: byte loop, 64-bit divide for the current, divide for the level
+    double oldNs = timeNs(FRAMES, [&](uint32_t k) {
+      uint32_t room = 200 + (k * 7) % (n * 60) - powerLedIdleMa(n);
+      uint32_t ch = powerLedMa(&pool[(size_t)(k % POOL) * n * 3], n, 255) - powerLedIdleMa(n);
+      uint32_t b = ch <= room ? 255 : room * 256 / ch;
+      sink += b + (uint32_t)((uint64_t)ch * (b + 1) / 256);
+    });
+    printf("%6u %10.1f %10.1f %10.1f %9u%%\n", n, sumNs, frameNs, oldNs, (unsigned)((uint64_t)dimmed * 100 / FRAMES));
+  }
+  printf("ns per frame on this host; the prop shows ~33 frames/s\n");
+  return 0;
+}
+
+static int selftest() {
+  ledRecipInit();
+
+  // Sum: every length up to 1000 bytes at every alignment
+  std::vector<uint8_t> buf(1008);
+  rng = 3;
+  for (auto& v : buf) v = (uint8_t)rnd(256);
+  for (uint32_t off = 0; off < 4; off++) {
+    for (uint32_t len = 0; len <= 1000; len++) {
+      uint32_t ref = 0;
+      for (uint32_t i = 0; i < len; i++) ref += buf[off + i];
+      check(ledChannelSum(&buf[off], len) == ref, "channel sum", off, len);
+    }
+  }
+  std::vector<uint8_t> white(900, 255);
+  check(ledChannelSum(&white[0], 900) == 900u * 255, "channel sum of 300 white pixels", ledChannelSum(&white[0], 900), 900u * 255);
+  printf("channel sum matches the byte loop for 0..1000 bytes at 4 alignments\n");
+
+  // Scale: never over, at most a level and 1 % under the exact level
+  uint32_t cases = 0, exactHits = 0;
+  for (uint32_t sum = 1; sum <= 229500; sum += 1 + sum / 64) {
+    for (uint32_t cap = 0; cap <= 60000; cap += 1 + cap / 32) {
+      uint8_t bright = (uint8_t)(1 + (sum + cap) % 255);
+      uint8_t b = ledScaleFor(sum, bright, cap);
+      uint64_t fit = (uint64_t)cap * 256 / sum;   // largest brightness + 1 that fits
+      uint32_t exact = fit == 0 ? 0 : fit > bright ? bright : (uint32_t)fit - 1;
+      check(b <= bright, "brighter than configured", sum, cap);
+      check(b == 0 || (uint64_t)sum * (b + 1) <= (uint64_t)cap * 256, "over the room", sum, cap);
+      check(b + 1 + (exact + 1) / 100 >= exact, "dimmed a level and 1 % too far", sum, cap);
+      exactHits += b == exact;
+      cases++;
+    }
+  }
+  printf("%u sum/room pairs: none over the room, %u%% on the exact level\n", cases, exactHits * 100 / cases);
+
+  // Ceiling: a white 60-pixel strip with all the budget in the world stays under LED_MAX_MA
+  LedLimiter lim;
+  lim.begin(60);
+  uint8_t b = lim.frame(&white[0], 255, 100000, 0);
+  check(b < 255 && lim.lastMa <= LED_MAX_MA, "LED_MAX_MA ceiling", b, lim.lastMa);
+  check(lim.lastMa + 20 > LED_MAX_MA, "ceiling left too much unused", lim.lastMa, LED_MAX_MA);
+  printf("white strip: %u mA demanded, %u mA shown at brightness %u (LED_MAX_MA %u)\n",
+         (unsigned)powerLedMa(&white[0], 60, 255), (unsigned)lim.lastMa, b, (unsigned)LED_MAX_MA);
+
+  // Current: matches PowerModel.h's reference at the brightness shown, within a mA
+  rng = 11;
+  for (int k = 0; k < 5000; k++) {
+    uint16_t n = (uint16_t)(1 + rnd(300));
+    uint8_t bright = (uint8_t)rnd(256);
+    for (uint32_t i = 0; i < (uint32_t)n * 3; i++) buf[i] = (uint8_t)rnd(256);
+    LedLimiter l;
+    l.begin(n);
+    uint8_t shown = l.frame(&buf[0], bright, 1000000, STATE_COUNT);
+    uint32_t ref = powerLedMa(&buf[0], n, shown);
+    check(l.lastMa <= ref && l.lastMa + 1 >= ref, "current vs powerLedMa", l.lastMa, ref);
+  }
+
+  // Stats: two states, one dimmed
+  lim.begin(60);
+  std::vector<uint8_t> dim(180, 20);
+  for (int i = 0; i < 10; i++) lim.frame(&dim[0], 255, 1000, 1);
+  for (int i = 0; i < 4; i++) lim.frame(&white[0], 255, 1000, 2);
+  for (int i = 0; i < 4; i++) lim.frame(&dim[0], 255, 1000, 2);
+  const LedStateStats& a = lim.st[1];
+  const LedStateStats& c = lim.st[2];
+  uint32_t dimMa = powerLedMa(&dim[0], 60, 255);
+  uint32_t whiteMa = powerLedMa(&white[0], 60, 255);
+  check(a.frames == 10 && a.dimmed == 0 && a.peakMa == dimMa && lim.avgMa(1) == dimMa, "stats of an undimmed state", a.frames, a.peakMa);
+  check(c.frames == 8 && c.dimmed == 4 && c.peakMa <= 1000 && (uint32_t)c.peakDemandMa + 1 >= whiteMa && c.peakDemandMa <= whiteMa,
+        "stats of a dimmed state", c.dimmed, c.peakDemandMa);
+  check(lim.avgMa(2) == (4 * c.peakMa + 4 * dimMa) / 8, "average of a dimmed state", lim.avgMa(2), c.peakMa);
+  check(lim.avgMa(0) == 0 && lim.st[0].frames == 0, "state without frames", lim.avgMa(0), 0);
+  printf("stats: avg %u mA, peak %u mA, demand %u mA, %u of %u frames dimmed\n",
+         (unsigned)lim.avgMa(2), c.peakMa, c.peakDemandMa, c.dimmed, c.frames);
+  lim.resetStats();
+  check(lim.st[2].frames == 0 && lim.st[2].peakMa == 0, "resetStats", lim.st[2].frames, 0);
+
+  printf("%d failure(s)\n", fails);
+  return fails ? 1 : 0;
+}
+
+int main(int argc, char** argv) {
+  if (argc > 1 && !strcmp(argv[1], "bench")) return bench(argc, argv);
+  if (argc > 1 && !strcmp(argv[1], "selftest")) return selftest();
+  fprintf(stderr, "usage: %s bench [leds] | selftest\n", argv[0]);
+  return 2;
+}
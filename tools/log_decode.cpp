@@ -0,0 +1,208 @@
+// log_decode.cpp
+// Turns binary log records (Log.h / LogCodec.h) back into text. The records carry the
+// address of their format string; the strings themselves are looked up in the firmware ELF
+// (Arduino IDE: Sketch > Export Compiled Binary, or the build folder's .elf).
+//
+// Captures:
+//   serial, built with -DLOG_SERIAL_BINARY=1:  any terminal that logs raw bytes to a file
+//   WebSocket: tools/scoreboard_standin.py serve --log-level 4 --log-file prop.bin
+// Bytes that are not part of a frame (console replies, boot ROM text) are passed through.
+//
+// Build: g++ -std=c++11 -O2 -I.. log_decode.cpp -o log_decode
+// Run:   ./log_decode firmware.elf capture.bin [min_level=4]
+//        ./log_decode selftest
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+#include "LogCodec.h"
+
+static bool readFile(const char* path, std::vector<uint8_t>& out) {
+  FILE* f = fopen(path, "rb");
+  if (!f) { perror(path); return false; }
+  uint8_t buf[65536];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0) out.insert(out.end(), buf, buf + n);
+  fclose(f);
+  return true;
+}
+
+template <typename T> static T rd(const std::vector<uint8_t>& b, size_t off) {
+  T v = 0;
+  if (off + sizeof(T) <= b.size()) memcpy(&v, &b[off], sizeof(T));   // ELF32 LE on an LE host
+  return v;
+}
+
+// Format strings live in allocated PROGBITS sections (.flash.rodata on the ESP32-S3)
+struct ElfImage {
+  struct Sec { uint32_t addr, size, off; };
+  std::vector<uint8_t> data;
+  std::vector<Sec> secs;
+
+  bool load(const char* path) {
+    if (!readFile(path, data)) return false;
+    if (data.size() < 52 || memcmp(&data[0], "\x7f" "ELF", 4) != 0 || data[4] != 1 || data[5] != 1) {
+      fprintf(stderr, "%s: not a 32-bit little-endian ELF\n", path);
+      return false;
+    }
+    uint32_t shoff = rd<uint32_t>(data, 32);
+    uint16_t shentsize = rd<uint16_t>(data, 46), shnum = rd<uint16_t>(data, 48);
+    for (uint16_t i = 0; i < shnum; i++) {
+      size_t sh = shoff + (size_t)i * shentsize;
+      uint32_t type = rd<uint32_t>(data, sh + 4), flags = rd<uint32_t>(data, sh + 8);
+      const uint32_t SHT_PROGBITS = 1, SHF_ALLOC = 2;
+      if (type != SHT_PROGBITS || !(flags & SHF_ALLOC)) continue;
+      Sec s = { rd<uint32_t>(data, sh + 12), rd<uint32_t>(data, sh + 20), rd<uint32_t>(data, sh + 16) };
+      if (s.off + (size_t)s.size <= data.size()) secs.push_back(s);
+    }
+    return true;
+  }
+
+  const char* str(uint32_t addr) const {
+    for (size_t i = 0; i < secs.size(); i++) {
+      const Sec& s = secs[i];
+      if (addr < s.addr || addr - s.addr >= s.size) continue;
+      const char* p = (const char*)&data[s.off + (addr - s.addr)];
+      if (memchr(p, 0, s.size - (addr - s.addr))) return p;
+    }
+    return nullptr;
+  }
+};
+
+typedef const char* (*FmtLookup)(void* ctx, uint32_t addr);
+
+// Decodes a byte stream; returns the number of records
+static size_t decodeStream(const uint8_t* in, size_t len, FmtLookup lookup, void* ctx, uint8_t minLevel,
+                           std::string& out) {
+  size_t pos = 0, records = 0;
+  char line[512];
+  while (pos < len) {
+    LogRecord r;
+    uint32_t addr = 0;
+    int n = logFrameRead(in + pos, len - pos, r, addr);
+    if (n == 0) break;                                  // truncated tail
+    if (n < 0) {                                        // not a frame: pass text through
+      uint8_t c = in[pos++];
+      if (c == '\n' || c == '\t' || (c >= 0x20 && c < 0x7F)) out += (char)c;
+      continue;
+    }
+    pos += (size_t)n;
+    records++;
+    if (r.level > minLevel) continue;
+    r.fmt = lookup(ctx, addr);
+    char fallback[48];
+    if (!r.fmt) { snprintf(fallback, sizeof(fallback), "<fmt 0x%08x not in ELF>", (unsigned)addr); r.fmt = fallback; }
+    snprintf(line, sizeof(line), "%c (%lu) ", logLevelChar(r.level), (unsigned long)r.ms);
+    out += line;
+    logFormat(r, line, sizeof(line));
+    out += line;
+    out += '\n';
+  }
+  return records;
+}
+
+static const char* elfLookup(void* ctx, uint32_t addr) { return ((ElfImage*)ctx)->str(addr); }
+
+// --- SELFTEST ---
+// Encodes on the host, frames, mixes in noise, decodes with a pointer table instead of an
+// ELF and compares against printf.
+static std::map<uint32_t, const char*> testFmts;
+static const char* testLookup(void*, uint32_t addr) {
+  auto it = testFmts.find(addr);
+  return it == testFmts.end() ? nullptr : it->second;
+}
+
+struct Case { LogRecord rec; std::string expect; };
+
+template <typename... Args>
+static Case mk(uint8_t level, uint32_t ms, const char* fmt, const std::string& expect, const Args&... args) {
+  Case c;
+  logEncode(c.rec, level, ms, fmt, args...);
+  testFmts[(uint32_t)(uintptr_t)fmt] = fmt;
+  char h[32];
+  snprintf(h, sizeof(h), "%c (%lu) ", logLevelChar(level), (unsigned long)ms);
+  c.expect = h + expect;
+  return c;
+}
+
+static int selftest() {
+  enum Color { RED = 3 };
+  std::vector<Case> cases;
+  cases.push_back(mk(LOG_LEVEL_INFO, 1, "[NET] WebSocket connected (down %u ms, %u attempt(s)%s).",
+                     "[NET] WebSocket connected (down 231 ms, 2 attempt(s), fast path).", 231u, 2u, ", fast path"));
+  cases.push_back(mk(LOG_LEVEL_WARN, 20, "[NET] %s failed after %u ms (%s); retry in %u ms",
+                     "[NET] tcp failed after 3001 ms (timeout); retry in 742 ms", "tcp", 3001u, "timeout", 742u));
+  cases.push_back(mk(LOG_LEVEL_INFO, 300, "[REBOOT] pending… now=%u target=%u remaining=%ld ms",
+                     "[REBOOT] pending… now=4000 target=4500 remaining=-12 ms", 4000u, 4500u, (long)-12));
+  cases.push_back(mk(LOG_LEVEL_ERROR, 4000000000u, "[OTA] Error[%u]: %s", "[OTA] Error[2]: Connect Failed", 2u, "Connect Failed"));
+  cases.push_back(mk(LOG_LEVEL_INFO, 5, "100%% ready, %d%% left, x=%04X c=%c", "100% ready, -5% left, x=00FF c=Z", -5, 255, 'Z'));
+  cases.push_back(mk(LOG_LEVEL_DEBUG, 6, "v=%.2f big=%llu neg=%lld e=%d", "v=3.14 big=18446744073709551615 neg=-42 e=3",
+                     3.14159, 18446744073709551615ULL, -42LL, RED));
+  // %s arguments are cut at LOG_STR_MAX
+  cases.push_back(mk(LOG_LEVEL_INFO, 7, "[%s] %-5s|", "[1234567890123456789012345678901] ab   |",
+                     "12345678901234567890123456789012345678901234567890abc", "ab"));
+  cases.push_back(mk(LOG_LEVEL_INFO, 8, "missing %u and %s", "missing 1 and ?", 1u));
+  cases.push_back(mk(LOG_LEVEL_INFO, 9, "bool=%d null=%s", "bool=1 null=(null)", true, (const char*)nullptr));
+
+  std::vector<uint8_t> stream;
+  const char* noise = "boot: rst:0x1\n";
+  stream.insert(stream.end(), noise, noise + strlen(noise));
+  for (size_t i = 0; i < cases.size(); i++) {
+    uint8_t f[LOG_FRAME_HEAD + LOG_MAX_PAYLOAD];
+    size_t n = logFrameWrite(cases[i].rec, f, sizeof(f));
+    stream.insert(stream.end(), f, f + n);
+    if (i == 3) { stream.push_back(0xC4); stream.push_back('x'); }   // false magic: resync
+  }
+
+  std::string out;
+  size_t records = decodeStream(stream.data(), stream.size(), testLookup, nullptr, LOG_LEVEL_DEBUG, out);
+  std::vector<std::string> lines;
+  size_t start = 0;
+  for (size_t i = 0; i < out.size(); i++) {
+    if (out[i] == '\n') { lines.push_back(out.substr(start, i - start)); start = i + 1; }
+  }
+  int fails = 0;
+  if (records != cases.size()) { printf("FAIL  decoded %u of %u records\n", (unsigned)records, (unsigned)cases.size()); fails++; }
+  for (size_t i = 0; i < cases.size(); i++) {
+    // line 0 is the passed-through noise; "x" from the false magic ends up in front of record 4
+    std::string got = i + 1 < lines.size() ? lines[i + 1] : "";
+    if (i == 4 && got.compare(0, 1, "x") == 0) got.erase(0, 1);
+    bool ok = got == cases[i].expect;
+    if (!ok) fails++;
+    printf("%s  %s\n", ok ? "PASS" : "FAIL", got.c_str());
+    if (!ok) printf("      want %s\n", cases[i].expect.c_str());
+  }
+
+  // Text rendering must match the device's serial output
+  char line[256];
+  snprintf(line, sizeof(line), "%c (%lu) ", 'I', 1UL);
+  LogRecord r = cases[0].rec;
+  r.fmt = testLookup(nullptr, (uint32_t)(uintptr_t)r.fmt);
+  std::string dev = line;
+  logFormat(r, line, sizeof(line));
+  dev += line;
+  if (dev != cases[0].expect) { printf("FAIL  render mismatch\n"); fails++; }
+
+  printf("%d failure(s)\n", fails);
+  return fails ? 1 : 0;
+}
+
+int main(int argc, char** argv) {
+  if (argc > 1 && !strcmp(argv[1], "selftest")) return selftest();
+  if (argc < 3) {
+    fprintf(stderr, "usage: %s firmware.elf capture.bin [min_level=4] | selftest\n", argv[0]);
+    return 2;
+  }
+  ElfImage elf;
+  std::vector<uint8_t> cap;
+  if (!elf.load(argv[1]) || !readFile(argv[2], cap)) return 1;
+  uint8_t minLevel = argc > 3 ? (uint8_t)atoi(argv[3]) : (uint8_t)LOG_LEVEL_DEBUG;
+  std::string out;
+  size_t n = decodeStream(cap.data(), cap.size(), elfLookup, &elf, minLevel, out);
+  fwrite(out.data(), 1, out.size(), stdout);
+  fprintf(stderr, "%u record(s), %u ELF section(s) searched\n", (unsigned)n, (unsigned)elf.secs.size());
+  return 0;
+}
@@ -0,0 +1,360 @@
+// menu_sim.cpp
+// Host simulator for the config menu: the real tree (ConfigMenu.h) and engine (MenuTree.h)
+// on a 20x4 text LCD with the same changed-characters-only writes as Display.h.
+//
+//   tree            print the menu tree with the factory values
+//   keys <keys>     press keys from the root (e.g. "8#8#") and print the LCD after each
+//   selftest        every row reachable with 2/8/#/*, every setting row stores into the right
+//                   Settings member and rejects out-of-range input, toggles, IP and code entry,
+//                   back-navigation, confirm prompts, and the LCD traffic of a long random walk
+//
+// Build: g++ -std=c++11 -O2 -I.. menu_sim.cpp -o menu_sim
+// Run:   ./menu_sim keys "8#2222#"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include "ConfigMenu.h"
+
+static Settings s;
+static int calls[8];
+enum { CALL_SAVE, CALL_EXIT, CALL_VOLUME, CALL_NET, CALL_FORGET, CALL_CLEAR, CALL_TAGS, CALL_PORTAL };
+
+inline void menuSaveExit()     { calls[CALL_SAVE]++; menuNotice(configMenu, "Saving...", "Device will reboot."); }
+inline void menuExit()         { calls[CALL_EXIT]++; }
+inline void menuApplyVolume()  { calls[CALL_VOLUME]++; }
+inline void menuApplyNetwork() { calls[CALL_NET]++; }
+inline void menuForgetWifi()   { calls[CALL_FORGET]++; }
+inline void menuClearTags()    { calls[CALL_CLEAR]++; s.num_rfid_uids = 0; }
+inline void tagListEnter()     { calls[CALL_TAGS]++; }
+inline MenuSound tagListKey(char key, bool& done) { done = (key == '*'); return done ? MS_CLICK : MS_NONE; }
+inline void tagListRender(MenuLines out) { menuLine(out[0], "Registered Cards", true); }
+inline bool tagListPoll()      { return false; }
+inline void portalEnter()      { calls[CALL_PORTAL]++; }
+inline void portalRender(MenuLines out) { menuLine(out[0], "WiFi Portal: ON", true); }
+inline void portalLeave()      { calls[CALL_PORTAL]--; }
+
+static void factory() {
+  memset(&s, 0, sizeof(s));
+  s.bomb_duration_ms = 120000; s.manual_disarm_time_ms = 15000; s.rfid_disarm_time_ms = 5000;
+  s.dud_chance = 5; strcpy(s.fixed_code_val, "7355608");
+  s.sound_enabled = 1; s.sound_volume = 20; s.servo_end_angle = 90;
+  s.easter_eggs_enabled = 1; s.explosion_strobe_enabled = 1;
+  s.ping_interval_s = 30; s.ping_light_enabled = 1; s.rfid_entry_speed_ms = 150;
+  s.net_use_mdns = 1; s.scoreboard_ip = 0xC0A80064; s.master_ip = 0xC0A80032; s.scoreboard_port = 8080;
+  s.num_rfid_uids = 3;
+}
+
+// --- LCD (Display.h lcdPutLine) ---
+static char lcd[MENU_ROWS][MENU_COLS + 1];
+static unsigned long lcdChars = 0, lcdWrites = 0;
+
+static void lcdReset() { memset(lcd, 0, sizeof(lcd)); }
+
+static void draw() {
+  MenuLines f;
+  menuRender(CONFIG_TREE, configMenu, &s, "CONFIG v5.0.3", f);
+  for (uint8_t r = 0; r < MENU_ROWS; r++) {
+    uint8_t first = 0, last = MENU_COLS;
+    while (first < MENU_COLS && lcd[r][first] == f[r][first]) first++;
+    if (first == MENU_COLS) continue;
+    while (last > first && lcd[r][last - 1] == f[r][last - 1]) last--;
+    lcdWrites++;
+    lcdChars += last - first;
+    memcpy(lcd[r], f[r], MENU_COLS);
+  }
+}
+
+static MenuSound press(char k) {
+  MenuSound snd = menuKey(CONFIG_TREE, configMenu, &s, k);
+  if (snd != MS_NONE) draw();
+  return snd;
+}
+
+static void show() {
+  printf("+--------------------+\n");
+  for (uint8_t r = 0; r < MENU_ROWS; r++) printf("|%.20s|\n", lcd[r][0] ? lcd[r] : "                    ");
+  printf("+--------------------+\n");
+}
+
+static void begin() {
+  factory();
+  menuReset(configMenu);
+  lcdReset();
+  draw();
+}
+
+// --- TREE ---
+static void printMenu(uint8_t menu, int depth) {
+  char val[MENU_COLS + 1];
+  static const char* KINDS[] = { "menu", "toggle", "number", "digits", "ip", "action", "screen" };
+  for (uint8_t p = 0; p < menuCount(CONFIG_TREE, menu); p++) {
+    const MenuNode& r = CONFIG_MENU[menuAt(CONFIG_TREE, menu, p)];
+    menuFormatValue(r, &s, val, sizeof(val));
+    printf("%*s%-18s %-7s %s", depth * 2, "", r.label, KINDS[r.kind], val);
+    if (r.kind == MN_NUMBER) printf("  [%lu..%lu]", (unsigned long)r.field.min, (unsigned long)r.field.max);
+    printf("\n");
+    if (r.kind == MN_MENU) printMenu(r.opens, depth + 1);
+  }
+}
+
+static int printTree() {
+  factory();
+  printf("%u rows, %u menus, %u bytes of table\n", (unsigned)CONFIG_MENU_COUNT, (unsigned)CM_COUNT,
+         (unsigned)sizeof(CONFIG_MENU));
+  printMenu(CM_ROOT, 0);
+  return 0;
+}
+
+static int runKeys(const char* keys) {
+  begin();
+  show();
+  for (const char* k = keys; *k; k++) {
+    unsigned long before = lcdChars;
+    MenuSound snd = press(*k);
+    static const char* SOUNDS[] = { "-", "click", "ok", "err" };
+    printf("key '%c'  sound %s  lcd chars %lu\n", *k, SOUNDS[snd], lcdChars - before);
+    show();
+  }
+  return 0;
+}
+
+// --- SELFTEST ---
+static int fails = 0;
+#define CHECK(cond, ...) do { if (!(cond)) { printf("FAIL  "); printf(__VA_ARGS__); printf("\n"); fails++; } } while (0)
+
+// Key presses that select row i from the root (cursor left on it, not opened)
+static std::string pathTo(uint8_t i) {
+  std::string keys;
+  uint8_t menu = CONFIG_MENU[i].parent;
+  uint8_t target = i;
+  for (;;) {
+    std::string step;
+    for (uint8_t p = 0; p < menuCount(CONFIG_TREE, menu); p++) {
+      if (menuAt(CONFIG_TREE, menu, p) == target) break;
+      step += '8';
+    }
+    keys = step + keys;
+    if (menu == CM_ROOT) break;
+    target = menuOpener(CONFIG_TREE, menu);
+    keys = "#" + keys;
+    menu = CONFIG_MENU[target].parent;
+  }
+  return keys;
+}
+
+static void go(const std::string& keys) { for (size_t k = 0; k < keys.size(); k++) press(keys[k]); }
+
+static bool onRow(uint8_t i) {
+  return configMenu.view == MV_LIST && configMenu.menu == CONFIG_MENU[i].parent &&
+         menuAt(CONFIG_TREE, configMenu.menu, configMenu.pos) == i;
+}
+
+static void typeNumber(unsigned long v) {
+  char buf[16];
+  snprintf(buf, sizeof(buf), "%lu", v);
+  for (char* c = buf; *c; c++) press(*c);
+}
+
+// Every setting row, bound by hand to the member it must change
+struct Expect { const char* label; const void* member; uint8_t type; uint32_t lo, hi; };
+
+static int selftest() {
+  const Expect BIND[] = {
+    { "Bomb Time ms",     &s.bomb_duration_ms,      JF_U32,  10000, 3600000 },
+    { "Manual Disarm ms", &s.manual_disarm_time_ms, JF_U32,  1, 600000 },
+    { "RFID Disarm ms",   &s.rfid_disarm_time_ms,   JF_U32,  1, 600000 },
+    { "Sudden Death",     &s.sudden_death_mode,     JF_BOOL, 0, 1 },
+    { "Required",         &s.fixed_code_enabled,    JF_BOOL, 0, 1 },
+    { "Code",             &s.fixed_code_val,        JF_STR,  7, 7 },
+    { "Dud Bomb",         &s.dud_enabled,           JF_BOOL, 0, 1 },
+    { "Chance %",         &s.dud_chance,            JF_U8,   0, 100 },
+    { "Arm Code",         &s.rfid_arming_mode,      JF_BOOL, 0, 1 },
+    { "Typing ms",        &s.rfid_entry_speed_ms,   JF_U16,  0, 5000 },
+    { "Plant Sensor",     &s.plant_sensor_enabled,  JF_BOOL, 0, 1 },
+    { "Sound",            &s.sound_enabled,         JF_BOOL, 0, 1 },
+    { "Volume",           &s.sound_volume,          JF_U8,   0, 30 },
+    { "Ejector",          &s.servo_enabled,         JF_BOOL, 0, 1 },
+    { "Start Angle",      &s.servo_start_angle,     JF_U8,   0, 180 },
+    { "End Angle",        &s.servo_end_angle,       JF_U8,   0, 180 },
+    { "Strobe",           &s.explosion_strobe_enabled, JF_BOOL, 0, 1 },
+    { "Easter Eggs",      &s.easter_eggs_enabled,   JF_BOOL, 0, 1 },
+    { "Ping",             &s.ping_enabled,          JF_BOOL, 0, 1 },
+    { "Interval s",       &s.ping_interval_s,       JF_U16,  5, 3600 },
+    { "Light",            &s.ping_light_enabled,    JF_BOOL, 0, 1 },
+    { "WiFi",             &s.wifi_enabled,          JF_BOOL, 0, 1 },
+    { "Server",           &s.net_use_mdns,          JF_BOOL, 0, 1 },
+    { "Scoreboard IP",    &s.scoreboard_ip,         JF_IP,   0, 0 },
+    { "Port",             &s.scoreboard_port,       JF_U16,  1, 65535 },
+    { "Master IP",        &s.master_ip,             JF_IP,   0, 0 },
+  };
+  const unsigned NB = sizeof(BIND) / sizeof(BIND[0]);
+
+  // 1. Every row can be selected from the root with 2/8/#/*, and the frame is always 4x20
+  unsigned settingRows = 0;
+  for (uint8_t i = 0; i < CONFIG_MENU_COUNT; i++) {
+    begin();
+    go(pathTo(i));
+    CHECK(onRow(i), "row %u '%s' not reachable with %s", i, CONFIG_MENU[i].label, pathTo(i).c_str());
+    for (uint8_t r = 0; r < MENU_ROWS; r++) CHECK(strlen(lcd[r]) == MENU_COLS, "row %u: LCD line %u not 20 wide", i, r);
+    if (CONFIG_MENU[i].kind != MN_MENU && CONFIG_MENU[i].kind != MN_ACTION && CONFIG_MENU[i].kind != MN_SCREEN) settingRows++;
+  }
+  CHECK(settingRows == NB, "%u setting rows, %u expected bindings", settingRows, NB);
+
+  // 2. Each setting row writes exactly its member, in range only
+  for (unsigned b = 0; b < NB; b++) {
+    const Expect& e = BIND[b];
+    uint8_t i = MENU_NONE;
+    for (uint8_t k = 0; k < CONFIG_MENU_COUNT; k++) if (!strcmp(CONFIG_MENU[k].label, e.label)) i = k;
+    if (i == MENU_NONE) { CHECK(false, "no row '%s'", e.label); continue; }
+    const MenuNode& r = CONFIG_MENU[i];
+    CHECK((const uint8_t*)&s + r.field.offset == (const uint8_t*)e.member, "'%s' bound to offset %u", e.label, r.field.offset);
+    CHECK(r.field.type == e.type || (e.type == JF_BOOL && r.kind == MN_TOGGLE), "'%s' type %u", e.label, r.field.type);
+    CHECK(r.field.min == e.lo && r.field.max == e.hi, "'%s' range %lu..%lu", e.label, (unsigned long)r.field.min, (unsigned long)r.field.max);
+
+    Settings before;
+    if (r.kind == MN_TOGGLE) {
+      begin(); go(pathTo(i)); before = s;
+      CHECK(press('#') == MS_OK, "'%s' toggle sound", e.label);
+      CHECK(menuRead(r.field, &s) == !menuRead(r.field, &before), "'%s' did not flip", e.label);
+      Settings flipped = s; menuWrite(r.field, &flipped, menuRead(r.field, &before));
+      CHECK(!memcmp(&flipped, &before, sizeof(s)), "'%s' changed another member", e.label);
+      press('#');
+      CHECK(!memcmp(&s, &before, sizeof(s)), "'%s' second # did not flip back", e.label);
+      CHECK(onRow(i), "'%s' toggle left the list", e.label);
+    } else if (r.kind == MN_NUMBER) {
+      unsigned long vals[3] = { e.lo, e.hi, (e.lo + e.hi) / 2 + 1 };
+      for (int v = 0; v < 3; v++) {
+        begin(); go(pathTo(i)); press('#'); before = s;
+        typeNumber(vals[v]);
+        CHECK(press('#') == MS_OK, "'%s' = %lu refused", e.label, vals[v]);
+        CHECK(menuRead(r.field, &s) == vals[v], "'%s' = %lu stored %lu", e.label, vals[v], (unsigned long)menuRead(r.field, &s));
+        Settings other = s; menuWrite(r.field, &other, menuRead(r.field, &before));
+        CHECK(!memcmp(&other, &before, sizeof(s)), "'%s' changed another member", e.label);
+        CHECK(onRow(i), "'%s' store did not return to the list", e.label);
+      }
+      if (e.lo > 0) {
+        begin(); go(pathTo(i)); press('#'); before = s;
+        typeNumber(e.lo - 1);
+        CHECK(press('#') == MS_ERR && !memcmp(&s, &before, sizeof(s)), "'%s' accepted %lu", e.label, (unsigned long)e.lo - 1);
+        CHECK(configMenu.view == MV_EDIT && !configMenu.input[0], "'%s' bad value did not clear the input", e.label);
+      }
+      begin(); go(pathTo(i)); press('#'); before = s;
+      typeNumber((unsigned long)e.hi + 1);
+      press('#');
+      CHECK(menuRead(r.field, &s) == menuRead(r.field, &before), "'%s' accepted %lu", e.label, (unsigned long)e.hi + 1);
+      typeNumber(e.lo);
+      for (unsigned long v = e.lo; v >= 10; v /= 10) press('*');
+      press('*');
+      CHECK(configMenu.view == MV_EDIT && !configMenu.input[0], "'%s' * did not delete", e.label);
+      press('*');
+      CHECK(onRow(i), "'%s' * did not back out of the edit", e.label);
+    } else if (r.kind == MN_DIGITS) {
+      begin(); go(pathTo(i)); press('#');
+      go("123456");
+      CHECK(press('#') == MS_ERR && !strcmp(s.fixed_code_val, "7355608"), "'%s' took 6 digits", e.label);
+      go("78");
+      CHECK(press('#') == MS_OK && !strcmp(s.fixed_code_val, "1234567"), "'%s' = %s", e.label, s.fixed_code_val);
+    } else if (r.kind == MN_IP) {
+      begin(); go(pathTo(i)); press('#'); before = s;
+      go("10#0#");
+      CHECK(press('2') == MS_CLICK && press('5') == MS_CLICK && press('6') == MS_ERR, "'%s' octet 256 typed", e.label);
+      go("#7");
+      CHECK(!memcmp(&s, &before, sizeof(s)), "'%s' stored before the last #", e.label);
+      CHECK(press('#') == MS_OK, "'%s' final # refused", e.label);
+      CHECK(menuRead(r.field, &s) == 0x0A001907u, "'%s' stored %08lx", e.label, (unsigned long)menuRead(r.field, &s));
+    }
+  }
+
+  // 3. IP entry in detail: 192.168.0.77
+  {
+    uint8_t i = 0;
+    for (uint8_t k = 0; k < CONFIG_MENU_COUNT; k++) if (CONFIG_MENU[k].kind == MN_IP) { i = k; break; }
+    begin(); go(pathTo(i)); press('#');
+    go("192#168#0#77#");
+    CHECK(menuRead(CONFIG_MENU[i].field, &s) == 0xC0A8004Du, "IP 192.168.0.77 stored %08lx", (unsigned long)menuRead(CONFIG_MENU[i].field, &s));
+    begin(); go(pathTo(i)); press('#');
+    go("1#");
+    CHECK(press('#') == MS_ERR, "IP: empty octet accepted");
+    go("*#2#3#4#");
+    CHECK(menuRead(CONFIG_MENU[i].field, &s) == 0x01020304u, "IP: backspace over '.' then 1.2.3.4 stored %08lx",
+          (unsigned long)menuRead(CONFIG_MENU[i].field, &s));
+  }
+
+  // 4. Back from every menu lands on the row that opened it; root '*' does nothing
+  for (uint8_t i = 0; i < CONFIG_MENU_COUNT; i++) {
+    if (CONFIG_MENU[i].kind != MN_MENU) continue;
+    begin(); go(pathTo(i)); press('#'); go("88");
+    CHECK(press('*') == MS_CLICK && onRow(i), "back from '%s'", CONFIG_MENU[i].label);
+  }
+  begin();
+  CHECK(press('*') == MS_NONE && configMenu.menu == CM_ROOT, "root * moved");
+
+  // 5. Confirm prompts run only on '#', plain actions run at once, screens enter/leave
+  for (uint8_t i = 0; i < CONFIG_MENU_COUNT; i++) {
+    const MenuNode& r = CONFIG_MENU[i];
+    if (r.kind == MN_ACTION) {
+      int total = 0, after = 0;
+      for (int c = 0; c < 8; c++) total += calls[c];
+      begin(); go(pathTo(i)); press('#');
+      if (r.flags & MF_CONFIRM) {
+        CHECK(configMenu.view == MV_CONFIRM, "'%s' no confirm", r.label);
+        press('*');
+        for (int c = 0; c < 8; c++) after += calls[c];
+        CHECK(after == total && onRow(i), "'%s' ran on *", r.label);
+        press('#'); press('#');
+        after = 0;
+      }
+      for (int c = 0; c < 8; c++) after += calls[c];
+      CHECK(after == total + 1, "'%s' ran %d times", r.label, after - total);
+    } else if (r.kind == MN_SCREEN) {
+      begin(); go(pathTo(i));
+      int before = calls[CALL_TAGS] + calls[CALL_PORTAL];
+      press('#');
+      CHECK(configMenu.view == MV_SCREEN && calls[CALL_TAGS] + calls[CALL_PORTAL] == before + 1, "'%s' enter", r.label);
+      press('*');
+      CHECK(onRow(i), "'%s' * did not leave the screen", r.label);
+    }
+  }
+  CHECK(calls[CALL_PORTAL] == 0, "portal entered %d more times than left", calls[CALL_PORTAL]);
+  begin();
+  for (uint8_t i = 0; i < CONFIG_MENU_COUNT; i++) if (CONFIG_MENU[i].fn == menuSaveExit) go(pathTo(i));
+  press('#');
+  CHECK(!strncmp(lcd[1] + 5, "Saving...", 9), "Save & Exit notice: '%s'", lcd[1]);
+
+  // 6. LCD traffic: a random walk, compared with clearing and redrawing 80 characters per key
+  begin();
+  srand(1);
+  unsigned long keysDrawn = 0;
+  const char KEYS[] = "2888888#*#0123456789*";
+  lcdChars = 0; lcdWrites = 0;
+  for (int n = 0; n < 200000; n++) {
+    char k = KEYS[rand() % (sizeof(KEYS) - 1)];
+    if (configMenu.menu == CM_ROOT && configMenu.view == MV_LIST && k == '#' &&
+        CONFIG_MENU[menuAt(CONFIG_TREE, CM_ROOT, configMenu.pos)].kind == MN_ACTION) continue;   // stay in the menu
+    if (press(k) != MS_NONE) keysDrawn++;
+    if (configMenu.notice[0]) press('0');
+    if (s.num_rfid_uids == 0) s.num_rfid_uids = 3;
+  }
+  double perKey = keysDrawn ? (double)lcdChars / keysDrawn : 0;
+  printf("random walk: %lu redraws, %.1f LCD chars and %.2f cursor moves per redraw (full redraw: 80 + clear)\n",
+         keysDrawn, perKey, keysDrawn ? (double)lcdWrites / keysDrawn : 0);
+  CHECK(perKey < 40, "%.1f chars per redraw", perKey);
+
+  begin(); go(pathTo(0)); unsigned long c0 = lcdChars; press('8');
+  printf("cursor down one row on the root list: %lu chars\n", lcdChars - c0);
+  CHECK(lcdChars - c0 <= 2, "moving the cursor wrote %lu chars", lcdChars - c0);
+
+  printf("%u rows, %u menus, %u setting bindings checked\n", (unsigned)CONFIG_MENU_COUNT, (unsigned)CM_COUNT, NB);
+  printf("%d failure(s)\n", fails);
+  return fails ? 1 : 0;
+}
+
+int main(int argc, char** argv) {
+  if (argc > 1 && !strcmp(argv[1], "tree")) return printTree();
+  if (argc > 2 && !strcmp(argv[1], "keys")) return runKeys(argv[2]);
+  if (argc > 1 && !strcmp(argv[1], "selftest")) return selftest();
+  fprintf(stderr, "usage: %s tree | keys <keys> | selftest\n", argv[0]);
+  return 2;
+}
@@ -0,0 +1,366 @@
+// ota_patch.cpp
+// Builds and applies OTA patches (OtaPatch.h) on a PC.
+//   make:  greedy matcher. Each position takes the longest of: a run in the base image
+//          (hashed 8-byte anchors, continuing the previous COPY_OLD is free), a run in the last
+//          OTA_PATCH_WINDOW output bytes, or a literal. Without a base image the result is a
+//          plain compressed image.
+//   apply: runs the same OtaPatcher the prop uses, fed in odd-sized pieces.
+// Upload: curl -X POST -H 'Authorization: Bearer <cmd_token>' --data-binary @fw.c4p http://<prop>/api/ota
+// Images: Arduino IDE > Sketch > Export Compiled Binary (the .ino.bin, not the merged one).
+//
+// Build: g++ -std=c++11 -O2 -I.. ota_patch.cpp -o ota_patch
+// Run:   ./ota_patch make  [-k key] old.bin|- new.bin out.c4p
+//        ./ota_patch apply [-k key] old.bin|- patch.c4p out.bin
+//        ./ota_patch selftest [old.bin new.bin]    built-in sample images, or your own pair
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "OtaPatch.h"
+
+typedef std::vector<uint8_t> Bytes;
+
+static bool readFile(const char* path, Bytes& out) {
+  out.clear();
+  if (!strcmp(path, "-")) return true;                  // no base image
+  FILE* f = fopen(path, "rb");
+  if (!f) { perror(path); return false; }
+  uint8_t buf[65536];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0) out.insert(out.end(), buf, buf + n);
+  fclose(f);
+  return true;
+}
+
+static bool writeFile(const char* path, const Bytes& b) {
+  FILE* f = fopen(path, "wb");
+  if (!f) { perror(path); return false; }
+  bool ok = fwrite(b.data(), 1, b.size(), f) == b.size();
+  fclose(f);
+  return ok;
+}
+
+static void sha(const Bytes& b, uint8_t out[32]) {
+  Sha256 s;
+  s.begin();
+  s.update(b.data(), b.size());
+  s.finish(out);
+}
+
+// --- ENCODER ---
+struct Encoder {
+  static const uint32_t MIN_OLD = 8, MIN_OUT = 5, OLD_CANDS = 32, OUT_CHAIN = 64;
+  static const uint32_t HASH_BITS = 18;
+
+  const Bytes& oldB;
+  const Bytes& newB;
+  Bytes out, lit;
+  uint32_t oldPos = 0;
+  std::vector<std::vector<uint32_t> > oldIdx;     // 8-byte anchor hash -> base offsets
+  std::vector<int32_t> outHead, outPrev;           // 4-byte hash chains over the output
+
+  Encoder(const Bytes& o, const Bytes& n) : oldB(o), newB(n) {}
+
+  static uint32_t hash(const uint8_t* p, size_t k) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < k; i++) h = (h ^ p[i]) * 16777619u;
+    return h >> (32 - HASH_BITS);
+  }
+
+  void varint(uint32_t v) {
+    while (v >= 0x80) { out.push_back((uint8_t)(v | 0x80)); v >>= 7; }
+    out.push_back((uint8_t)v);
+  }
+  void tag(uint8_t op, uint32_t len) {
+    if (len < 64) out.push_back((uint8_t)(op | (len << 2)));
+    else { out.push_back(op); varint(len); }
+  }
+  void flushLit() {
+    if (lit.empty()) return;
+    tag(OTA_OP_LIT, (uint32_t)lit.size());
+    out.insert(out.end(), lit.begin(), lit.end());
+    lit.clear();
+  }
+
+  uint32_t matchLen(const uint8_t* a, const uint8_t* b, uint32_t max) const {
+    uint32_t k = 0;
+    while (k < max && a[k] == b[k]) k++;
+    return k;
+  }
+
+  void insertOut(uint32_t p) {
+    if (p + 4 > newB.size()) return;
+    uint32_t h = hash(&newB[p], 4);
+    outPrev[p] = outHead[h];
+    outHead[h] = (int32_t)p;
+  }
+
+  Bytes run(const uint8_t* key, size_t keyLen) {
+    oldIdx.assign(1u << HASH_BITS, std::vector<uint32_t>());
+    for (uint32_t i = 0; i + MIN_OLD <= oldB.size(); i++) {
+      std::vector<uint32_t>& v = oldIdx[hash(&oldB[i], MIN_OLD)];
+      if (v.size() < OLD_CANDS) v.push_back(i);
+    }
+    outHead.assign(1u << HASH_BITS, -1);
+    outPrev.assign(newB.size(), -1);
+
+    OtaPatchHeader h;
+    memset(&h, 0, sizeof(h));
+    h.version = OTA_PATCH_VERSION;
+    h.newSize = (uint32_t)newB.size();
+    h.oldSize = (uint32_t)oldB.size();
+    if (!oldB.empty()) sha(oldB, h.oldSha);
+    sha(newB, h.newSha);
+    out.resize(OTA_PATCH_HEAD);
+    otaPatchWriteHeader(h, key, keyLen, &out[0]);
+
+    uint32_t p = 0, n = (uint32_t)newB.size();
+    while (p < n) {
+      uint32_t rem = n - p;
+      uint32_t bestOld = 0, bestOldSrc = 0, bestOut = 0, bestDist = 0;
+      if (oldPos < oldB.size()) {
+        bestOld = matchLen(&oldB[oldPos], &newB[p], std::min<uint32_t>(rem, (uint32_t)oldB.size() - oldPos));
+        bestOldSrc = oldPos;
+      }
+      if (rem >= MIN_OLD && !oldB.empty()) {
+        const std::vector<uint32_t>& v = oldIdx[hash(&newB[p], MIN_OLD)];
+        for (size_t i = 0; i < v.size(); i++) {
+          uint32_t k = matchLen(&oldB[v[i]], &newB[p], std::min<uint32_t>(rem, (uint32_t)oldB.size() - v[i]));
+          if (k > bestOld + 2) { bestOld = k; bestOldSrc = v[i]; }   // moving the base cursor costs bytes
+        }
+      }
+      if (rem >= 4) {
+        int32_t c = outHead[hash(&newB[p], 4)];
+        for (uint32_t steps = 0; c >= 0 && steps < OUT_CHAIN; steps++, c = outPrev[c]) {
+          uint32_t dist = p - (uint32_t)c;
+          if (dist > OTA_PATCH_WINDOW) break;
+          uint32_t k = matchLen(&newB[c], &newB[p], rem);          // may overlap p: same as the applier
+          if (k > bestOut) { bestOut = k; bestDist = dist; }
+        }
+      }
+
+      uint32_t take = 0;
+      if (bestOld >= MIN_OLD && bestOld >= bestOut) {
+        flushLit();
+        tag(OTA_OP_COPY_OLD, bestOld);
+        int32_t d = (int32_t)(bestOldSrc - oldPos);
+        varint((uint32_t)((d << 1) ^ (d >> 31)));
+        oldPos = bestOldSrc + bestOld;
+        take = bestOld;
+      } else if (bestOut >= MIN_OUT) {
+        flushLit();
+        tag(OTA_OP_COPY_OUT, bestOut);
+        varint(bestDist);
+        take = bestOut;
+        oldPos += bestOut;                         // keep the base cursor roughly aligned
+      } else {
+        lit.push_back(newB[p]);
+        take = 1;
+        oldPos++;
+      }
+      for (uint32_t i = 0; i < take; i++) insertOut(p + i);
+      p += take;
+    }
+    flushLit();
+    out.push_back(OTA_OP_END);
+    return out;
+  }
+};
+
+static Bytes makePatch(const Bytes& oldB, const Bytes& newB, const std::string& key) {
+  Encoder e(oldB, newB);
+  return e.run((const uint8_t*)key.data(), key.size());
+}
+
+// --- APPLY ---
+struct MemImages {
+  const Bytes* oldB;
+  Bytes newB;
+  bool failWrites;
+};
+
+static bool memRead(void* ctx, uint32_t off, uint8_t* buf, size_t n) {
+  MemImages* m = (MemImages*)ctx;
+  if (off + n > m->oldB->size()) return false;
+  memcpy(buf, &(*m->oldB)[off], n);
+  return true;
+}
+static bool memWrite(void* ctx, const uint8_t* buf, size_t n) {
+  MemImages* m = (MemImages*)ctx;
+  if (m->failWrites) return false;
+  m->newB.insert(m->newB.end(), buf, buf + n);
+  return true;
+}
+
+static OtaPatcher patcher;   // 4 KB window: static, like on the prop
+
+// Feeds the patch in pieces of 'piece' bytes (0 = pseudo-random 1..700) with an output
+// budget per call, the way Ota.h does from the HTTP loop. Returns the final result code.
+static int8_t applyPatch(const Bytes& oldB, const Bytes& patch, const std::string& key, Bytes& out,
+                         size_t piece, uint32_t budget, bool checkBase = true) {
+  MemImages m = { &oldB, Bytes(), false };
+  patcher.begin(memRead, memWrite, &m, (const uint8_t*)key.data(), key.size());
+  uint32_t rnd = 12345;
+  size_t pos = 0;
+  int8_t r = OTA_P_MORE;
+  while (pos < patch.size() && r >= 0 && r != OTA_P_DONE) {
+    rnd = rnd * 1103515245u + 12345u;
+    size_t n = piece ? piece : 1 + (rnd >> 16) % 700;
+    if (n > patch.size() - pos) n = patch.size() - pos;
+    size_t used = 0;
+    r = patcher.feed(&patch[pos], n, used, budget);
+    pos += used;
+    if (r == OTA_P_HEADER) {
+      if (patcher.hdr.oldSize != oldB.size() || (checkBase && patcher.hdr.oldSize && !patcher.baseMatches())) return 100;
+      r = OTA_P_MORE;
+    }
+  }
+  out.swap(m.newB);
+  return r;
+}
+
+// --- SELFTEST ---
+static uint32_t lcg = 1;
+static uint32_t rnd() { lcg = lcg * 1664525u + 1013904223u; return lcg >> 8; }
+
+// Code-like sample image: repeated instruction patterns, pointer tables and strings
+static Bytes sampleImage(size_t n) {
+  Bytes b;
+  const char* words[] = { "[NET] ", "WebSocket ", "connected ", "[OTA] ", "Progress ", "%u ms", "\n" };
+  b.push_back(0xE9);
+  while (b.size() < n) {
+    switch (rnd() % 4) {
+      case 0: { uint32_t k = 8 + rnd() % 24; for (uint32_t i = 0; i < k; i++) b.push_back((uint8_t)(0x36 + (rnd() % 5) * 0x10)); } break;
+      case 1: { uint32_t base = 0x3C000000 + (rnd() % 4096) * 4; for (int i = 0; i < 6; i++) { uint32_t v = base + i * 16; b.insert(b.end(), (uint8_t*)&v, (uint8_t*)&v + 4); } } break;
+      case 2: { const char* w = words[rnd() % 7]; b.insert(b.end(), w, w + strlen(w)); } break;
+      default: { uint32_t k = 4 + rnd() % 12; for (uint32_t i = 0; i < k; i++) b.push_back((uint8_t)rnd()); } break;
+    }
+  }
+  b.resize(n);
+  return b;
+}
+
+// A "new build": edits, an insertion that shifts everything after it, a deletion, a moved block
+static Bytes mutate(const Bytes& a) {
+  Bytes b = a;
+  for (int i = 0; i < 40; i++) b[rnd() % b.size()] ^= (uint8_t)(1 + rnd() % 255);
+  Bytes ins = sampleImage(3000);
+  b.insert(b.begin() + b.size() / 3, ins.begin(), ins.end());
+  b.erase(b.begin() + b.size() / 2, b.begin() + b.size() / 2 + 1500);
+  Bytes moved(b.begin() + 1000, b.begin() + 5000);
+  b.insert(b.end() - 2000, moved.begin(), moved.end());
+  return b;
+}
+
+static int fails = 0;
+static void check(bool ok, const char* name, const std::string& detail = "") {
+  if (!ok) fails++;
+  printf("%s  %-26s %s\n", ok ? "PASS" : "FAIL", name, detail.c_str());
+}
+
+static std::string hex(const uint8_t* d, size_t n) {
+  std::string s;
+  char t[3];
+  for (size_t i = 0; i < n; i++) { snprintf(t, sizeof(t), "%02x", d[i]); s += t; }
+  return s;
+}
+
+static std::string ratio(const Bytes& patch, const Bytes& image) {
+  char t[64];
+  snprintf(t, sizeof(t), "%u -> %u bytes (%.1f%%)", (unsigned)image.size(), (unsigned)patch.size(),
+           image.empty() ? 0.0 : 100.0 * patch.size() / image.size());
+  return t;
+}
+
+static int selftest(const char* oldPath, const char* newPath) {
+  // Primitives against published vectors
+  uint8_t d[32];
+  Sha256 s;
+  s.begin(); s.update((const uint8_t*)"abc", 3); s.finish(d);
+  check(hex(d, 32) == "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad", "sha256 abc");
+  std::string million(1000000, 'a');
+  s.begin();
+  for (size_t i = 0; i < million.size(); i += 997) s.update((const uint8_t*)&million[i], std::min<size_t>(997, million.size() - i));
+  s.finish(d);
+  check(hex(d, 32) == "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0", "sha256 1M 'a' (split)");
+  const char* jefe = "what do ya want for nothing?";
+  hmacSha256((const uint8_t*)"Jefe", 4, (const uint8_t*)jefe, strlen(jefe), d);
+  check(hex(d, 32) == "5bdcc146bf60754e6a042426089575c75a003f089d2739839dec58b964ec3843", "hmac-sha256 rfc4231 #2");
+
+  Bytes oldB, newB;
+  if (oldPath) {
+    if (!readFile(oldPath, oldB) || !readFile(newPath, newB)) return 2;
+  } else {
+    oldB = sampleImage(300000);
+    newB = mutate(oldB);
+  }
+  Bytes out;
+
+  Bytes delta = makePatch(oldB, newB, "");
+  check(applyPatch(oldB, delta, "", out, 0, 4096) == OTA_P_DONE && out == newB, "delta, random pieces", ratio(delta, newB));
+  check(applyPatch(oldB, delta, "", out, 1, 64) == OTA_P_DONE && out == newB, "delta, 1-byte pieces");
+
+  Bytes full = makePatch(Bytes(), newB, "");
+  Bytes none;
+  check(applyPatch(none, full, "", out, 0, 4096) == OTA_P_DONE && out == newB, "compressed full image", ratio(full, newB));
+
+  Bytes same = makePatch(oldB, oldB, "");
+  check(applyPatch(oldB, same, "", out, 0, 1 << 20) == OTA_P_DONE && out == oldB, "identical images", ratio(same, oldB));
+
+  // Signatures
+  Bytes signedP = makePatch(oldB, newB, "field-key");
+  check(applyPatch(oldB, signedP, "field-key", out, 0, 4096) == OTA_P_DONE && out == newB, "signed, right key");
+  check(applyPatch(oldB, signedP, "other-key", out, 0, 4096) == OTA_P_AUTH && out.empty(), "signed, wrong key", "nothing written");
+  check(applyPatch(oldB, delta, "field-key", out, 0, 4096) == OTA_P_AUTH, "unsigned, key required");
+  Bytes forged = signedP;
+  forged[8] ^= 1;                                  // newSize
+  check(applyPatch(oldB, forged, "field-key", out, 0, 4096) == OTA_P_AUTH, "signed header altered");
+
+  // Damage
+  Bytes bad = delta;
+  bad[bad.size() - 2] ^= 0x5A;
+  int8_t r = applyPatch(oldB, bad, "", out, 0, 4096);
+  check(r < 0 && r != OTA_P_MAGIC, "corrupted body", otaPatchError(r));
+  Bytes cut(delta.begin(), delta.begin() + delta.size() / 2);
+  check(applyPatch(oldB, cut, "", out, 0, 4096) == OTA_P_MORE, "truncated: never DONE");
+  Bytes wrongBase = oldB;
+  wrongBase[100] ^= 1;
+  check(applyPatch(wrongBase, delta, "", out, 0, 4096) == 100, "wrong base image refused");
+  Bytes raw = newB;
+  check(applyPatch(oldB, raw, "", out, 0, 4096) == OTA_P_MAGIC, "not a patch");
+
+  printf("%d failure(s)\n", fails);
+  return fails ? 1 : 0;
+}
+
+int main(int argc, char** argv) {
+  const char* cmd = argc > 1 ? argv[1] : "";
+  std::string key;
+  int a = 2;
+  if (argc > a + 1 && !strcmp(argv[a], "-k")) { key = argv[a + 1]; a += 2; }
+  int args = argc - a;
+
+  if (!strcmp(cmd, "selftest")) return selftest(args >= 2 ? argv[a] : nullptr, args >= 2 ? argv[a + 1] : nullptr);
+  if (!strcmp(cmd, "make") && args == 3) {
+    Bytes oldB, newB;
+    if (!readFile(argv[a], oldB) || !readFile(argv[a + 1], newB)) return 1;
+    Bytes p = makePatch(oldB, newB, key);
+    if (!writeFile(argv[a + 2], p)) return 1;
+    printf("%s: %s%s\n", argv[a + 2], ratio(p, newB).c_str(), key.empty() ? ", unsigned" : ", signed");
+    return 0;
+  }
+  if (!strcmp(cmd, "apply") && args == 3) {
+    Bytes oldB, patch, out;
+    if (!readFile(argv[a], oldB) || !readFile(argv[a + 1], patch)) return 1;
+    int8_t r = applyPatch(oldB, patch, key, out, 0, 4096);
+    if (r == 100) { fprintf(stderr, "base image does not match the patch\n"); return 1; }
+    if (r != OTA_P_DONE) { fprintf(stderr, "apply failed: %s\n", r < 0 ? otaPatchError(r) : "truncated"); return 1; }
+    if (!writeFile(argv[a + 2], out)) return 1;
+    printf("%s: %u bytes, SHA-256 verified\n", argv[a + 2], (unsigned)out.size());
+    return 0;
+  }
+  fprintf(stderr, "usage: %s make|apply [-k key] old.bin|- <in> <out> | selftest [old.bin new.bin]\n", argv[0]);
+  return 2;
+}
@@ -0,0 +1,303 @@
+// power_budget.cpp
+// Host-side simulation of the power budget (PowerBudget.h) against the LED effects, sounds and
+// shell pop of each game state. Frames are drawn the way Display.h draws them on the 60-pixel
+// strip (status LED + 59); the other loads follow Power.h's estimate.
+//
+//   effects [limit_mA] [rail_mV]   per effect: undimmed peak, limited peak, lowest and mean
+//                                  brightness and how long the shell pop waited
+//                                  (default 1800 mA, rail not measured)
+//   selftest                       every effect stays under the limit at three limits and
+//                                  three rail voltages (or has the LEDs fully dimmed when the
+//                                  other loads alone exceed it); the strobe and solid green
+//                                  get dimmed, the idle pulse only for the ping flash and the
+//                                  armed flash, chase and Star Wars effects never; the pop waits
+//                                  for the blast at a tight limit but never more than
+//                                  POWER_STAGGER_MAX_MS; the rail filter ignores a spike and
+//                                  follows a sag; dimming picks a level that fits and is
+//                                  within a level and 1 % of the brightest that fits
+//
+// Build: g++ -std=c++11 -O2 -I.. power_budget.cpp -o power_budget
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <stdint.h>
+#include "PowerBudget.h"
+#include "LedLimiter.h"
+#include "Countdown.h"
+
+static const uint16_t NUM_LEDS = 60;
+static const uint8_t  BRIGHTNESS = 255;        // NEOPIXEL_BRIGHTNESS (Config.h)
+static const uint32_t STEP_MS = 10;
+static const uint32_t BLAST_MS = 4500;         // PRE_EXPLOSION_BLAST_MS
+static const uint32_t STROBE_MS = 4000;        // PRE_EXPLOSION_STROBE_MS
+static const uint32_t BLAST_AUDIO_MS = 1500;   // POWER_BLAST_AUDIO_MS (Power.h)
+static const uint32_t SERVO_HOLD_MS = 1000;    // SERVO_HOLD_MS (ServoMotion.h)
+
+struct Px { uint8_t r, g, b; };
+static Px frame[NUM_LEDS];
+
+static uint8_t scale8(uint8_t v, uint8_t s) { return (uint8_t)(((uint16_t)v * (1 + s)) >> 8); }
+static void fill(int from, Px c) { for (int i = from; i < NUM_LEDS; i++) frame[i] = c; }
+static void fadeBy(int from, uint8_t by) {
+  for (int i = from; i < NUM_LEDS; i++) {
+    frame[i].r = scale8(frame[i].r, 255 - by); frame[i].g = scale8(frame[i].g, 255 - by); frame[i].b = scale8(frame[i].b, 255 - by);
+  }
+}
+static uint8_t beatsin8(uint32_t bpm, uint8_t lo, uint8_t hi, uint32_t ms) {
+  double s = sin(2.0 * M_PI * bpm * ms / 60000.0);
+  return (uint8_t)(lo + (hi - lo) * (s + 1.0) / 2.0);
+}
+
+// What Power.h's estimate gives for everything but the LEDs
+struct Loads { bool wifiFull, rfid, audio, audioPeak, buzzer; };
+
+enum Effect { FX_ARMED, FX_CHASE, FX_GREEN, FX_IDLE, FX_STARWARS, FX_EXPLOSION, FX_COUNT };
+static const char* FX_NAMES[FX_COUNT] = { "armed_flash", "disarm_chase", "disarmed_green", "idle_pulse_ping", "starwars", "explosion" };
+static const uint32_t FX_LEN_MS[FX_COUNT] = { 45000, 6000, 3000, 12000, 6000, 10000 };
+
+static uint32_t rng = 1;
+static uint32_t rnd(uint32_t n) { rng = rng * 1103515245u + 12345u; return (rng >> 8) % n; }
+
+// Draws the frame at ms into the effect; fills the other loads. BeepCadence drives the armed flash.
+static void drawFrame(Effect fx, uint32_t ms, BeepCadence& beep, Loads& l) {
+  l = { true, true, false, false, false };
+  switch (fx) {
+    case FX_ARMED: {
+      bool on = beep.update(ms, FX_LEN_MS[FX_ARMED]);
+      frame[0] = on ? Px{ 255, 0, 0 } : Px{ 0, 0, 0 };
+      for (int i = 1; i < NUM_LEDS; i++) frame[i] = (on && i % 3 == 0) ? Px{ 255, 0, 0 } : Px{ 0, 0, 0 };
+      l.buzzer = on;
+    } break;
+    case FX_CHASE: {
+      uint8_t pos = (uint8_t)((ms / 50) % NUM_LEDS);
+      frame[0] = Px{ 0, 0, 255 };
+      for (int i = 1; i < NUM_LEDS; i++) {
+        if (abs(i - pos) < 3 || abs(i - (pos + NUM_LEDS)) < 3) frame[i] = Px{ 0, 0, 255 };
+        else { frame[i].r = scale8(frame[i].r, 200); frame[i].g = scale8(frame[i].g, 200); frame[i].b = scale8(frame[i].b, 200); }
+      }
+      l.rfid = false;
+      l.audio = ms < 3000;
+    } break;
+    case FX_GREEN:
+      frame[0] = Px{ 0, 255, 0 };
+      fill(1, Px{ 0, 255, 0 });
+      l.wifiFull = false; l.rfid = false; l.audio = true;
+      break;
+    case FX_IDLE: {
+      frame[0] = Px{ beatsin8(30, 50, 255, ms), beatsin8(30, 40, 200, ms), 0 };
+      uint8_t v = beatsin8(20, 0, 100, ms);
+      fill(1, Px{ v, (uint8_t)(v / 2), 0 });
+      if (ms % 5000 < 200) { fill(0, Px{ 255, 255, 255 }); l.audio = true; }   // homing ping
+      l.wifiFull = false;
+    } break;
+    case FX_STARWARS:
+      frame[0] = (ms / 500) % 2 ? Px{ 0, 255, 0 } : Px{ 255, 0, 0 };
+      if (rnd(10) == 0) frame[1 + rnd(NUM_LEDS - 1)] = rnd(2) ? Px{ 0, 255, 0 } : Px{ 255, 0, 0 };
+      else fadeBy(1, 40);
+      l.wifiFull = false; l.audio = true;
+      break;
+    case FX_EXPLOSION: {
+      uint8_t b = ms >= 2500 ? 255 : (uint8_t)(ms * 255 / 2500);
+      frame[0] = Px{ b, 0, 0 };
+      bool strobe = ms > BLAST_MS && ms < BLAST_MS + STROBE_MS;
+      fill(1, (strobe && (ms / 40) % 2) ? Px{ 255, 255, 255 } : Px{ 0, 0, 0 });
+      l.rfid = false; l.audio = true;
+      l.audioPeak = ms >= BLAST_MS && ms < BLAST_MS + BLAST_AUDIO_MS;
+    } break;
+    default: break;
+  }
+}
+
+static PowerDraw otherLoads(const Loads& l, uint16_t servoMa) {
+  PowerDraw d;
+  memset(&d, 0, sizeof(d));
+  d.ma[PL_CPU] = POWER_MA_CPU_ACTIVE;
+  d.ma[PL_WIFI] = l.wifiFull ? POWER_MA_WIFI_ON : POWER_MA_WIFI_MODEM_SLEEP;
+  d.ma[PL_LCD] = POWER_MA_LCD;
+  d.ma[PL_RFID] = l.rfid ? POWER_MA_RFID_ON : POWER_MA_RFID_SOFT_DOWN;
+  d.ma[PL_AUDIO] = l.audioPeak ? POWER_MA_AUDIO_PEAK : l.audio ? POWER_MA_AUDIO_PLAY : POWER_MA_AUDIO_IDLE;
+  d.ma[PL_SERVO] = servoMa;
+  d.ma[PL_BUZZER] = l.buzzer ? POWER_MA_BUZZER : 0;
+  return d;
+}
+
+struct FxResult {
+  uint32_t rawPeak, peak, limit;
+  uint8_t  minB;
+  uint32_t meanB;
+  uint32_t dimmedSteps, overSteps, fixedOverSteps;
+  int32_t  popWaitMs;       // -1 = no pop in this effect
+};
+
+// One effect at a limit and a rail voltage (0 = not measured), stepped every 10 ms
+static FxResult runEffect(Effect fx, uint32_t baseLimit, uint16_t railMv) {
+  FxResult r = { 0, 0, powerBudgetDerate(baseLimit, railMv), 255, 0, 0, 0, 0, -1 };
+  memset(frame, 0, sizeof(frame));
+  rng = 7;
+  BeepCadence beep;
+  beep.reset(225);
+  LedLimiter limiter;
+  limiter.begin(NUM_LEDS);
+  // Shell ejector as Game.h/ShellEjector.h run it: pop asked for at the blast, extend, hold, retract
+  enum { S_WAIT, S_EXT, S_RET, S_DONE } servo = fx == FX_EXPLOSION ? S_WAIT : S_DONE;
+  uint32_t moveAt = 0, askedAt = 0;
+  bool asked = false;
+  uint64_t sumB = 0;
+  uint32_t steps = 0;
+  for (uint32_t ms = 0; ms < FX_LEN_MS[fx]; ms += STEP_MS) {
+    Loads l;
+    drawFrame(fx, ms, beep, l);
+    uint16_t servoMa = 0;
+    if (servo == S_WAIT && ms >= BLAST_MS) {
+      PowerDraw d = otherLoads(l, 0);
+      if (!asked) { asked = true; askedAt = ms; }
+      if (powerBudgetFits(d, NUM_LEDS, POWER_MA_SERVO_START, r.limit) || ms - askedAt >= POWER_STAGGER_MAX_MS) {
+        servo = S_EXT; moveAt = ms; r.popWaitMs = (int32_t)(ms - askedAt);
+      }
+    } else if (servo == S_EXT && ms - moveAt >= SERVO_HOLD_MS) { servo = S_RET; moveAt = ms; }
+    else if (servo == S_RET && ms - moveAt >= 1000) servo = S_DONE;
+    if (servo == S_EXT || servo == S_RET) servoMa = ms - moveAt < POWER_SERVO_START_MS ? POWER_MA_SERVO_START : POWER_MA_SERVO_ACTIVE;
+
+    PowerDraw d = otherLoads(l, servoMa);
+    uint32_t others = d.total() - d.ma[PL_LEDS];
+    uint32_t rawTotal = others + powerLedMa(&frame[0].r, NUM_LEDS, BRIGHTNESS);
+    uint8_t b = limiter.frame(&frame[0].r, BRIGHTNESS, powerLedShareMa(d, r.limit), STATE_COUNT);
+    uint32_t total = others + limiter.lastMa;
+    if (rawTotal > r.rawPeak) r.rawPeak = rawTotal;
+    if (total > r.peak) r.peak = total;
+    if (b < r.minB) r.minB = b;
+    if (b < BRIGHTNESS) r.dimmedSteps++;
+    if (total > r.limit) {
+      r.overSteps++;
+      if (b == 0 && powerFixedMa(d, NUM_LEDS) > r.limit) r.fixedOverSteps++;
+    }
+    sumB += b;
+    steps++;
+  }
+  r.meanB = steps ? (uint32_t)(sumB / steps) : 0;
+  return r;
+}
+
+static int printEffects(uint32_t limit, uint16_t rail) {
+  printf("limit %u mA, rail %s -> %u mA; strip %u px at brightness %u\n", limit,
+         rail ? "measured" : "not measured", powerBudgetDerate(limit, rail), NUM_LEDS, BRIGHTNESS);
+  printf("%-16s %9s %9s %6s %6s %8s %8s\n", "effect", "raw_peak", "peak", "min_b", "mean_b", "dimmed%", "pop_wait");
+  for (int f = 0; f < FX_COUNT; f++) {
+    FxResult r = runEffect((Effect)f, limit, rail);
+    uint32_t steps = FX_LEN_MS[f] / STEP_MS;
+    char wait[16];
+    if (r.popWaitMs < 0) snprintf(wait, sizeof(wait), "-");
+    else snprintf(wait, sizeof(wait), "%d ms", r.popWaitMs);
+    printf("%-16s %6u mA %6u mA %6u %6u %7u%% %8s%s\n", FX_NAMES[f], r.rawPeak, r.peak, r.minB, r.meanB,
+           r.dimmedSteps * 100 / steps, wait, r.overSteps ? "  OVER" : "");
+  }
+  return 0;
+}
+
+static int fails = 0;
+static void check(bool ok, const char* what, const char* detail) {
+  if (ok) return;
+  if (fails++ < 12) printf("FAIL  %s (%s)\n", what, detail);
+}
+
+static int selftest() {
+  // Peak per effect at each limit / rail voltage
+  const uint32_t limits[] = { 1800, 1500, 1200 };
+  const uint16_t rails[] = { 0, 4700, 4400 };
+  for (uint32_t lim : limits) {
+    for (uint16_t rail : rails) {
+      for (int f = 0; f < FX_COUNT; f++) {
+        FxResult r = runEffect((Effect)f, lim, rail);
+        char d[64];
+        snprintf(d, sizeof(d), "%s at %u mA, rail %u", FX_NAMES[f], lim, rail);
+        check(r.overSteps == r.fixedOverSteps, "over the limit with LEDs still lit", d);
+        if (lim == 1800 && rail == 0) check(r.overSteps == 0, "over the default limit", d);
+      }
+      printf("limit %4u mA, rail %4u mV: every effect within %u mA\n", lim, rail, powerBudgetDerate(lim, rail));
+    }
+  }
+
+  // The budget must actually bite on the big effects, and leave the small ones alone
+  FxResult strobe = runEffect(FX_EXPLOSION, 1800, 0);
+  FxResult green = runEffect(FX_GREEN, 1200, 0);
+  FxResult idle = runEffect(FX_IDLE, 1800, 0);
+  check(strobe.rawPeak > 1800 && strobe.minB < BRIGHTNESS, "strobe needs dimming", "explosion");
+  check(green.rawPeak > 1200 && green.minB < BRIGHTNESS, "solid green needs dimming at 1200 mA", "disarmed_green");
+  check(idle.dimmedSteps > 0 && idle.dimmedSteps <= (FX_LEN_MS[FX_IDLE] / 5000 + 1) * 200 / STEP_MS, "idle pulse dimmed outside the ping flash", "idle");
+  const Effect small[] = { FX_ARMED, FX_CHASE, FX_STARWARS };
+  for (Effect f : small) check(runEffect(f, 1800, 0).dimmedSteps == 0, "small effect dimmed", FX_NAMES[f]);
+  check(strobe.popWaitMs == 0, "pop delayed at the default limit", "explosion");
+  printf("explosion %u -> %u mA at 1800 mA, solid green %u -> %u mA at 1200 mA\n", strobe.rawPeak, strobe.peak, green.rawPeak, green.peak);
+
+  // Stagger: at a tight limit the pop waits for room, never longer than POWER_STAGGER_MAX_MS
+  FxResult tight = runEffect(FX_EXPLOSION, 1150, 0);
+  check(tight.popWaitMs > 0 && tight.popWaitMs <= POWER_STAGGER_MAX_MS, "pop wait at 1150 mA", "explosion");
+  FxResult weak = runEffect(FX_EXPLOSION, 1800, 4400);
+  printf("pop waits %d ms at 1150 mA, %d ms on a 4.4 V rail (limit %u mA)\n", tight.popWaitMs, weak.popWaitMs, weak.limit);
+
+  // Derating: full above OK, LOW_PCT below LOW, monotonic between
+  check(powerBudgetDerate(1800, 0) == 1800 && powerBudgetDerate(1800, 5100) == 1800, "derate at a good rail", "");
+  check(powerBudgetDerate(1800, 4000) == 1800 * POWER_BUDGET_LOW_PCT / 100, "derate at a weak rail", "");
+  uint32_t prev = 0;
+  for (uint16_t mv = 4000; mv <= 5200; mv += 10) {
+    uint32_t v = powerBudgetDerate(1800, mv);
+    check(v >= prev, "derate not monotonic", "");
+    prev = v;
+  }
+
+  // Rail filter: a one-sample dip is ignored, a sag is followed at once, recovery is gradual
+  BatteryFilter bf;
+  bf.reset();
+  for (int i = 0; i < 50; i++) bf.push(5000);
+  bf.push(4200);
+  bf.push(5000);
+  check(bf.floorMv == 5000 && bf.minMv == 5000, "single-sample dip got through", "");
+  bf.push(4500);
+  bf.push(4500);
+  check(bf.floorMv == 4500, "sag not followed within 2 samples", "");
+  for (int i = 0; i < 3; i++) bf.push(5000);
+  check(bf.floorMv < 4600, "floor bounced straight back", "");
+  for (int i = 0; i < 60; i++) bf.push(5000);
+  check(bf.floorMv >= 4950 && bf.mv >= 4950, "floor did not recover", "");
+  printf("rail filter: dip ignored, sag followed, floor %u mV after recovery\n", bf.floorMv);
+
+  // Dimming: the level picked fits and is within a level and 1 % of the brightest that would
+  rng = 99;
+  unsigned frames = 0;
+  LedLimiter limiter;
+  limiter.begin(NUM_LEDS);
+  for (int k = 0; k < 20000; k++) {
+    for (int i = 0; i < NUM_LEDS; i++) frame[i] = Px{ (uint8_t)rnd(256), (uint8_t)rnd(256), (uint8_t)rnd(256) };
+    uint8_t bright = (uint8_t)(1 + rnd(255));
+    uint32_t lim = 300 + rnd(3000);
+    PowerDraw d;
+    memset(&d, 0, sizeof(d));
+    d.ma[PL_CPU] = (uint16_t)rnd(400);
+    uint32_t ch = powerLedMa(&frame[0].r, NUM_LEDS, bright) - powerLedIdleMa(NUM_LEDS);
+    uint8_t b = limiter.frame(&frame[0].r, bright, powerLedShareMa(d, lim), STATE_COUNT);
+    uint32_t fixed = powerFixedMa(d, NUM_LEDS);
+    if (fixed >= lim) { check(b == 0, "LEDs lit with no room", ""); continue; }
+    uint32_t room = lim - fixed;
+    check(b <= bright, "brighter than configured", "");
+    check(ch * ((uint32_t)b + 1) / ((uint32_t)bright + 1) <= room || b == 0, "dimmed frame over the room", "");
+    if (b < bright) {
+      uint32_t best = b + 3 + (b + 1) / 100;   // two levels up, plus 1 %
+      check(best > bright || ch * best / ((uint32_t)bright + 1) > room - 1, "dimmed more than a level and 1 % too far", "");
+    }
+    frames++;
+  }
+  printf("%u random frames dimmed to within a level and 1 %% of the brightest that fits\n", frames);
+
+  printf("%d failure(s)\n", fails);
+  return fails ? 1 : 0;
+}
+
+int main(int argc, char** argv) {
+  if (argc > 1 && !strcmp(argv[1], "effects"))
+    return printEffects(argc > 2 ? (uint32_t)atoi(argv[2]) : POWER_BUDGET_MA, argc > 3 ? (uint16_t)atoi(argv[3]) : 0);
+  if (argc > 1 && !strcmp(argv[1], "selftest")) return selftest();
+  fprintf(stderr, "usage: %s effects [limit_mA] [rail_mV] | selftest\n", argv[0]);
+  return 2;
+}
@@ -0,0 +1,124 @@
+// profiler_host.cpp
+// Host build of the loop() profiler (Profiler.h, C4_PROFILE=1) on its steady_clock fallback:
+// the same probes, bins and p99 the prop reports with "prof", timed in nanoseconds.
+//
+//   bench [iterations=20000]   time a few small workloads under PROF_SCOPE, print the table
+//   selftest                   bin edges, min/avg/max, p99 against hand-counted samples, a span
+//                              across the 32-bit tick wrap, reset, and a real ProfScope around
+//                              a 2 ms wait
+//
+// Build: g++ -std=c++11 -O2 -Wall -Wextra -I.. profiler_host.cpp -o profiler_host
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#define C4_PROFILE 1
+#include "Profiler.h"
+
+static int fails = 0;
+static void check(bool ok, const char* what, const char* detail) {
+  if (ok) return;
+  if (fails++ < 12) printf("FAIL  %s (%s)\n", what, detail);
+}
+
+static uint32_t rng = 1;
+static uint32_t rnd(uint32_t n) { rng = rng * 1103515245u + 12345u; return (rng >> 8) % n; }
+
+static void printTable() {
+  printf("%-10s %8s %8s %8s %8s %8s\n", "probe", "count", "min_us", "avg_us", "p99_us", "max_us");
+  for (uint8_t i = 0; i < PROF_COUNT; i++) {
+    const ProfStat& s = profStats[i];
+    uint32_t avg = s.count ? (uint32_t)(s.sumUs / s.count) : 0;
+    printf("%-10s %8u %8u %8u %8u %8u\n", PROF_NAMES[i], (unsigned)s.count, (unsigned)s.minUs,
+           (unsigned)avg, (unsigned)profP99(s), (unsigned)s.maxUs);
+  }
+}
+
+static void spinUs(uint32_t us) {
+  std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now() + std::chrono::microseconds(us);
+  while (std::chrono::steady_clock::now() < end) {}
+}
+
+static volatile uint32_t sink;
+
+static int bench(int argc, char** argv) {
+  int iterations = argc > 2 ? atoi(argv[2]) : 20000;
+  static uint8_t frame[300 * 3];
+  profReset();
+  for (int i = 0; i < iterations; i++) {
+    { PROF_SCOPE(PROF_LEDS); memset(frame, (int)rnd(256), sizeof(frame)); sink = frame[rnd(sizeof(frame))]; }
+    { PROF_SCOPE(PROF_KEYPAD); uint32_t h = 0; for (int k = 0; k < 64; k++) h = h * 31 + rnd(10); sink = h; }
+    if (i % 1000 == 0) { PROF_SCOPE(PROF_NETWORK); spinUs(200); }
+  }
+  printTable();
+  return 0;
+}
+
+static void recordUs(ProfProbe p, uint32_t us, uint32_t n) {
+  for (uint32_t i = 0; i < n; i++) profRecord(p, us * profTicksPerUs());
+}
+
+static int selftest() {
+  char d[96];
+  check(profTicksPerUs() == 1000, "host ticks are not ns", "");
+
+  // Bins: 0 = <1 us, k = [2^(k-1), 2^k), the last one open-ended
+  static const uint32_t US[]  = { 0, 1, 2, 3, 4, 7, 8, 1000, (1u << 18) - 1, 1u << 18, 0xFFFFFFFFu };
+  static const uint8_t  BIN[] = { 0, 1, 2, 2, 3, 3, 4, 10,   18,             19,      19 };
+  for (size_t i = 0; i < sizeof(US) / sizeof(US[0]); i++) {
+    snprintf(d, sizeof(d), "%u us -> bin %u, want %u", (unsigned)US[i], (unsigned)profBinFor(US[i]), (unsigned)BIN[i]);
+    check(profBinFor(US[i]) == BIN[i], "bin edge", d);
+  }
+
+  // min/avg/max, and p99 = upper edge of the bin holding the 99th percentile, clamped to max
+  profReset();
+  check(profP99(profStats[PROF_DISPLAY]) == 0, "p99 of no samples", "");
+  recordUs(PROF_DISPLAY, 5, 99);
+  recordUs(PROF_DISPLAY, 100000, 1);
+  const ProfStat& s = profStats[PROF_DISPLAY];
+  snprintf(d, sizeof(d), "n %u min %u max %u sum %llu p99 %u", (unsigned)s.count, (unsigned)s.minUs,
+           (unsigned)s.maxUs, (unsigned long long)s.sumUs, (unsigned)profP99(s));
+  check(s.count == 100 && s.minUs == 5 && s.maxUs == 100000 && s.sumUs == 99 * 5 + 100000, "min/max/sum", d);
+  check(profP99(s) == 8, "p99 with one outlier in 100", d);
+
+  profReset();
+  recordUs(PROF_RFID, 5, 980);
+  recordUs(PROF_RFID, 3000, 20);
+  snprintf(d, sizeof(d), "p99 %u", (unsigned)profP99(profStats[PROF_RFID]));
+  check(profP99(profStats[PROF_RFID]) == 3000, "p99 in the slow bin, clamped to max", d);
+  check(profStats[PROF_DISPLAY].count == 0, "reset left samples", "");
+
+  // ProfScope subtracts in uint32_t: a span across the tick wrap is still its length
+  profReset();
+  uint32_t start = 0xFFFFFFF0u, end = start + 2500000u;
+  profRecord(PROF_WS_LOOP, end - start);
+  snprintf(d, sizeof(d), "recorded %u us", (unsigned)profStats[PROF_WS_LOOP].maxUs);
+  check(profStats[PROF_WS_LOOP].maxUs == 2500, "span across the tick wrap", d);
+
+  // The real clock: two scopes in one block, one around a 2 ms wait
+  profReset();
+  uint32_t t1 = profTicks(), t2 = profTicks();
+  check((uint32_t)(t2 - t1) < 1000000000u, "steady_clock ticks went backwards", "");
+  {
+    PROF_SCOPE(PROF_GAMEPLAY);
+    PROF_SCOPE(PROF_NETWORK);
+    spinUs(2000);
+  }
+  const ProfStat& g = profStats[PROF_GAMEPLAY];
+  const ProfStat& n = profStats[PROF_NETWORK];
+  snprintf(d, sizeof(d), "gameplay %u us, network %u us", (unsigned)g.maxUs, (unsigned)n.maxUs);
+  check(g.count == 1 && n.count == 1, "scope not recorded once", d);
+  check(n.minUs >= 2000 && n.minUs < 500000, "2 ms wait", d);
+  check(g.minUs >= n.minUs, "outer scope shorter than inner", d);
+
+  printf("%d failure(s)\n", fails);
+  return fails ? 1 : 0;
+}
+
+int main(int argc, char** argv) {
+  if (argc > 1 && !strcmp(argv[1], "bench")) return bench(argc, argv);
+  if (argc > 1 && !strcmp(argv[1], "selftest")) return selftest();
+  fprintf(stderr, "usage: %s bench [iterations] | selftest\n", argv[0]);
+  return 2;
+}
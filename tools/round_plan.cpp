@@ -0,0 +1,212 @@
+// round_plan.cpp
+// Host checks of the remote round logic (RoundPlan.h) with injected clocks: the prop's
+// millis() and the ClockSync offset (board = prop + offset) are chosen per case, including
+// both sides of the 32-bit wrap.
+//
+//   selftest   roundBoardToLocal maps a board instant back to the prop's exactly for every
+//              offset and clock; start_at/start_in are accepted up to ROUND_MAX_LEAD_MS ahead
+//              and ROUND_MAX_LATE_MS behind and refused one ms past either; start_at without
+//              a clock offset is refused; a resent config for the staged round is a duplicate,
+//              older or equal ids are stale and a new connection starts ids over; every round
+//              value is checked against its SETTINGS_FIELDS range; a round's values are never
+//              what saveSettings() would store, an edit made during the round survives it,
+//              and ending the round brings the referee's values back
+//
+// Build: g++ -std=c++11 -O2 -I.. round_plan.cpp -o round_plan
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdint.h>
+#include "RoundPlan.h"
+
+static int fails = 0;
+static void check(bool ok, const char* what, const char* detail) {
+  if (ok) return;
+  if (fails++ < 12) printf("FAIL  %s (%s)\n", what, detail);
+}
+
+static JsonTok toks[48];
+
+// roundParse on a message; err is nullptr when staged
+static const char* parse(const char* msgIn, bool hasOffset, int32_t off, uint32_t rtt, uint32_t now,
+                         RoundConfig& rc, int32_t& lead) {
+  static char msg[256];
+  snprintf(msg, sizeof(msg), "%s", msgIn);
+  int n = jsonTokenize(msg, strlen(msg), toks, 48);
+  memset(&rc, 0, sizeof(rc));
+  lead = 0;
+  if (n < 1) return "bad_json";
+  return roundParse(msg, toks, n, hasOffset, off, rtt, now, rc, lead);
+}
+
+static const int32_t OFFSETS[] = { 0, 1, -1, 123456789, -123456789, 2000000000, -2000000000, INT32_MAX, INT32_MIN };
+static const uint32_t NOWS[] = { 0, 1000, 2000000000u, 0xFFFFFFFFu - 1500, 0xFFFFFFFFu };
+
+static void startWindows() {
+  unsigned cases = 0;
+  for (int32_t off : OFFSETS) {
+    for (uint32_t now : NOWS) {
+      char d[96];
+      // Board -> local, exact for any lead
+      const int32_t leads[] = { -5000, -1, 0, 1, 777, 600000 };
+      for (int32_t lead : leads) {
+        uint32_t board = now + (uint32_t)off + (uint32_t)lead;
+        snprintf(d, sizeof(d), "off %d now %u lead %d", off, now, lead);
+        check(roundBoardToLocal(board, off) == now + (uint32_t)lead, "roundBoardToLocal", d);
+      }
+      // The window edges through roundParse
+      struct { int32_t lead; bool ok; } edges[] = {
+        { -(int32_t)ROUND_MAX_LATE_MS - 1, false }, { -(int32_t)ROUND_MAX_LATE_MS, true }, { 0, true },
+        { (int32_t)ROUND_MAX_LEAD_MS, true }, { (int32_t)ROUND_MAX_LEAD_MS + 1, false },
+      };
+      for (auto& e : edges) {
+        char msg[128];
+        snprintf(msg, sizeof(msg), "{\"type\":\"round_config\",\"round\":1,\"start_at\":%u}",
+                 (unsigned)(now + (uint32_t)off + (uint32_t)e.lead));
+        RoundConfig rc;
+        int32_t lead;
+        const char* err = parse(msg, true, off, 40, now, rc, lead);
+        snprintf(d, sizeof(d), "off %d now %u lead %d: %s", off, now, e.lead, err ? err : "staged");
+        check(e.ok ? err == nullptr && lead == e.lead && rc.startLocalMs == now + (uint32_t)e.lead
+                   : err && !strcmp(err, "bad_start"), "start window", d);
+        cases++;
+      }
+      // The same board instant seen with a stale offset: off by the error, no more
+      RoundConfig rc;
+      int32_t lead;
+      char msg[128];
+      snprintf(msg, sizeof(msg), "{\"type\":\"round_config\",\"round\":1,\"start_at\":%u}", (unsigned)(now + (uint32_t)off + 5000));
+      parse(msg, true, (int32_t)((uint32_t)off + 30), 40, now, rc, lead);
+      snprintf(d, sizeof(d), "off %d now %u", off, now);
+      check(lead == 4970, "offset error shifts the start by the error", d);
+    }
+  }
+  printf("%u start-window cases over %u offsets and %u clocks: edges exact\n", cases,
+         (unsigned)(sizeof(OFFSETS) / sizeof(OFFSETS[0])), (unsigned)(sizeof(NOWS) / sizeof(NOWS[0])));
+
+  // start_in: relative, minus half the round trip; needs no offset
+  RoundConfig rc;
+  int32_t lead;
+  const char* err = parse("{\"round\":1,\"start_in\":1000}", false, 0, 200, 0xFFFFFF00u, rc, lead);
+  check(!err && lead == 900 && rc.startLocalMs == 0xFFFFFF00u + 900, "start_in", err ? err : "");
+  err = parse("{\"round\":1,\"start_in\":700000}", false, 0, 0, 5, rc, lead);
+  check(err && !strcmp(err, "bad_start"), "start_in past the lead limit", err ? err : "staged");
+  err = parse("{\"round\":1,\"start_at\":5000}", false, 0, 0, 0, rc, lead);
+  check(err && !strcmp(err, "no_clock_sync"), "start_at without clock sync", err ? err : "staged");
+  err = parse("{\"round\":1,\"bomb_ms\":40000}", true, 0, 0, 0, rc, lead);
+  check(err && !strcmp(err, "no_start"), "no start", err ? err : "staged");
+}
+
+static void roundIds() {
+  RoundConfig staged;
+  memset(&staged, 0, sizeof(staged));
+  uint32_t lastId = 0;
+  check(roundIdCheck(1, lastId, staged) == RID_NEW, "first id", "1");
+  staged.id = 5; staged.pending = true; lastId = 5;
+  check(roundIdCheck(5, lastId, staged) == RID_DUPLICATE, "resent staged config", "5");
+  check(roundIdCheck(4, lastId, staged) == RID_STALE, "older id while staged", "4");
+  check(roundIdCheck(6, lastId, staged) == RID_NEW, "newer id replaces staged", "6");
+  staged.pending = false;                        // started or cancelled
+  check(roundIdCheck(5, lastId, staged) == RID_STALE, "id of a started round", "5");
+  check(roundIdCheck(3, lastId, staged) == RID_STALE, "older id", "3");
+  lastId = 0;                                    // reconnected: a restarted board counts from 1
+  check(roundIdCheck(1, lastId, staged) == RID_NEW, "id after reconnect", "1");
+  printf("round ids: duplicate, stale and new as expected\n");
+}
+
+static void ranges() {
+  struct { const char* field; bool ok; const char* err; } cases[] = {
+    { "\"bomb_ms\":9999", false, "bad_bomb_ms" },         { "\"bomb_ms\":10000", true, nullptr },
+    { "\"bomb_ms\":3600000", true, nullptr },             { "\"bomb_ms\":3600001", false, "bad_bomb_ms" },
+    { "\"manual_disarm_ms\":0", false, "bad_manual_disarm_ms" }, { "\"manual_disarm_ms\":1", true, nullptr },
+    { "\"manual_disarm_ms\":600000", true, nullptr },     { "\"manual_disarm_ms\":600001", false, "bad_manual_disarm_ms" },
+    { "\"rfid_disarm_ms\":0", false, "bad_rfid_disarm_ms" }, { "\"rfid_disarm_ms\":4000000000", false, "bad_rfid_disarm_ms" },
+    { "\"rfid_disarm_ms\":5000", true, nullptr },
+    { "\"dud_chance\":0", true, nullptr },                { "\"dud_chance\":100", true, nullptr },
+    { "\"dud_chance\":101", false, "bad_dud_chance" },    { "\"dud_chance\":-1", false, "bad_dud_chance" },
+    { "\"sudden_death\":true", true, nullptr },           { "\"sudden_death\":2", false, "bad_sudden_death" },
+    { "\"dud_enabled\":0", true, nullptr },               { "\"dud_enabled\":\"yes\"", false, "bad_dud_enabled" },
+    { "\"fixed_code\":\"7355608\"", true, nullptr },      { "\"fixed_code\":\"\"", true, nullptr },
+    { "\"fixed_code\":\"123\"", false, "bad_fixed_code" }, { "\"fixed_code\":\"12a4567\"", false, "bad_fixed_code" },
+    { "\"fixed_code\":1234567", false, "bad_fixed_code" },
+  };
+  for (auto& c : cases) {
+    char msg[160];
+    snprintf(msg, sizeof(msg), "{\"round\":1,\"start_in\":100,%s}", c.field);
+    RoundConfig rc;
+    int32_t lead;
+    const char* err = parse(msg, false, 0, 0, 0, rc, lead);
+    check(c.ok ? err == nullptr : err && !strcmp(err, c.err), "value range", c.field);
+  }
+  // Each range is the SETTINGS_FIELDS row's
+  for (const RoundKey& rk : ROUND_KEYS) check(settingsField(rk.setting) != nullptr, "round key without a settings row", rk.setting);
+
+  RoundConfig rc;
+  int32_t lead;
+  parse("{\"start_in\":100,\"bomb_ms\":20000,\"dud_chance\":0,\"fixed_code\":\"1234567\"}", false, 0, 0, 0, rc, lead);
+  check(rc.fields == (RF_BOMB | RF_DUD_CHANCE | RF_CODE | RF_CODE_ON) && rc.vals.bomb_duration_ms == 20000 &&
+        rc.vals.dud_chance == 0 && rc.vals.fixed_code_enabled == 1 && !strcmp(rc.vals.fixed_code_val, "1234567"),
+        "staged values", "");
+  parse("{\"start_in\":100,\"fixed_code\":\"\"}", false, 0, 0, 0, rc, lead);
+  check(rc.fields == RF_CODE_ON && rc.vals.fixed_code_enabled == 0, "any code", "");
+  printf("%u value cases: ranges match SETTINGS_FIELDS\n", (unsigned)(sizeof(cases) / sizeof(cases[0])));
+}
+
+static void overlay() {
+  Settings live, base, applied;
+  memset(&live, 0, sizeof(live));
+  live.bomb_duration_ms = 45000;
+  live.manual_disarm_time_ms = 10000;
+  live.dud_chance = 5;
+  live.fixed_code_enabled = 0;
+  strcpy(live.fixed_code_val, "7355608");
+  live.sound_volume = 20;
+  Settings referee = live;
+
+  RoundConfig rc;
+  int32_t lead;
+  parse("{\"start_in\":100,\"bomb_ms\":20000,\"dud_chance\":0,\"fixed_code\":\"1234567\"}", false, 0, 0, 0, rc, lead);
+  roundOverlayBegin(live, base, applied, rc);
+  check(live.bomb_duration_ms == 20000 && live.dud_chance == 0 && live.fixed_code_enabled == 1 &&
+        !strcmp(live.fixed_code_val, "1234567") && live.manual_disarm_time_ms == 10000, "round values in effect", "");
+
+  // Saving mid-round (any save path): the referee's values, not the round's
+  Settings out = live;
+  roundOverlaySaveView(out, base, applied, rc.fields);
+  check(!memcmp(&out, &referee, sizeof(out)), "saved the round's values", "");
+
+  // An edit during the round: a round member and another one; both are saved and both stay
+  live.dud_chance = 30;
+  live.sound_volume = 12;
+  out = live;
+  roundOverlaySaveView(out, base, applied, rc.fields);
+  check(out.dud_chance == 30 && out.sound_volume == 12 && out.bomb_duration_ms == 45000, "edit during the round saved", "");
+
+  roundOverlayEnd(live, base, applied, rc.fields);
+  check(live.bomb_duration_ms == 45000 && live.fixed_code_enabled == 0 && !strcmp(live.fixed_code_val, "7355608") &&
+        live.dud_chance == 30 && live.sound_volume == 12 && live.manual_disarm_time_ms == 10000,
+        "round end: referee's values back, edits kept", "");
+
+  // "Any code" round over a referee's fixed code: the code is untouched, only required is off
+  live.fixed_code_enabled = 1;
+  parse("{\"start_in\":100,\"fixed_code\":\"\"}", false, 0, 0, 0, rc, lead);
+  roundOverlayBegin(live, base, applied, rc);
+  check(live.fixed_code_enabled == 0 && !strcmp(live.fixed_code_val, "7355608"), "any-code round", "");
+  roundOverlayEnd(live, base, applied, rc.fields);
+  check(live.fixed_code_enabled == 1, "any-code round end", "");
+  printf("overlay: round values never saved, edits kept, referee's back at the end\n");
+}
+
+int main(int argc, char** argv) {
+  if (argc > 1 && !strcmp(argv[1], "selftest")) {
+    startWindows();
+    roundIds();
+    ranges();
+    overlay();
+    printf("%d failure(s)\n", fails);
+    return fails ? 1 : 0;
+  }
+  fprintf(stderr, "usage: %s selftest\n", argv[0]);
+  return 2;
+}
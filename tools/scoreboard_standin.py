@@ -0,0 +1,529 @@
+#!/usr/bin/env python3
+"""
+scoreboard_standin.py
+Local stand-in for the scoreboard, plus a load generator. Python 3.7+, stdlib only.
+
+  serve    WebSocket server that speaks the prop protocol:
+             - logs "state", "c4_event", "tick", "loop_report", "metric", ... messages
+             - accepts batched frames ([{...},{...}])
+             - acks journaled c4_events cumulatively: {"type":"ack","epoch":E,"seq":S}
+             - answers {"type":"sync_req"} with sync_resp and WS pings with pongs
+           Fault injection: dropped events, delayed replies, periodic connection kills,
+           half-open sockets and refused handshakes. After each fault it prints how
+           long the prop took to reconnect.
+           Round orchestration: --round-at pushes a round_config with a common start_at
+           to every connected prop and reports how far apart they actually started.
+           --clock-offset skews this server's clock to exercise the offset mapping.
+           --log-level subscribes to the prop's binary log stream; --log-file saves the
+           frames for tools/log_decode.cpp.
+
+  loadgen  Many virtual props hammering a server (this one or the real scoreboard)
+           with state/c4_event traffic; reports throughput and ack latency.
+
+Examples:
+  ./scoreboard_standin.py serve --port 8080
+  ./scoreboard_standin.py serve --drop 0.2 --delay 150
+  ./scoreboard_standin.py serve --kill-every 60 --refuse-for 20
+  ./scoreboard_standin.py serve --half-open-every 90 --half-open-for 30
+  ./scoreboard_standin.py serve --token s3cret --round-at 30 --clock-offset 123456789
+  ./scoreboard_standin.py serve --log-level 4 --log-file prop.bin
+  ./scoreboard_standin.py loadgen --host 127.0.0.1 --props 50 --rate 5 --duration 30
+"""
+
+import argparse
+import asyncio
+import base64
+import hashlib
+import json
+import os
+import random
+import struct
+import time
+
+WS_GUID = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
+OP_CONT, OP_TEXT, OP_BIN, OP_CLOSE, OP_PING, OP_PONG = 0x0, 0x1, 0x2, 0x8, 0x9, 0xA
+
+
+def now_ms():
+    return int(time.monotonic() * 1000)
+
+
+def log(tag, msg):
+    print("%s [%s] %s" % (time.strftime("%H:%M:%S"), tag, msg), flush=True)
+
+
+# ---------------------------------------------------------------------------
+# Minimal RFC 6455 framing
+# ---------------------------------------------------------------------------
+async def read_frame(reader):
+    """Returns (opcode, payload) for one complete message (continuations joined)."""
+    data = b""
+    first_op = None
+    while True:
+        b0, b1 = await reader.readexactly(2)
+        fin, op = b0 & 0x80, b0 & 0x0F
+        masked, n = b1 & 0x80, b1 & 0x7F
+        if n == 126:
+            n = struct.unpack("!H", await reader.readexactly(2))[0]
+        elif n == 127:
+            n = struct.unpack("!Q", await reader.readexactly(8))[0]
+        key = await reader.readexactly(4) if masked else None
+        payload = await reader.readexactly(n)
+        if key:
+            payload = bytes(c ^ key[i % 4] for i, c in enumerate(payload))
+        if op >= 0x8:                       # control frames are never fragmented
+            return op, payload
+        if first_op is None:
+            first_op = op
+        data += payload
+        if fin:
+            return first_op, data
+
+
+def make_frame(op, payload, mask):
+    head = bytearray([0x80 | op])
+    n = len(payload)
+    mbit = 0x80 if mask else 0
+    if n < 126:
+        head.append(mbit | n)
+    elif n < 65536:
+        head.append(mbit | 126)
+        head += struct.pack("!H", n)
+    else:
+        head.append(mbit | 127)
+        head += struct.pack("!Q", n)
+    if mask:
+        key = os.urandom(4)
+        head += key
+        payload = bytes(c ^ key[i % 4] for i, c in enumerate(payload))
+    return bytes(head) + payload
+
+
+def accept_key(key):
+    return base64.b64encode(hashlib.sha1((key + WS_GUID).encode()).digest()).decode()
+
+
+async def read_http_head(reader):
+    raw = await reader.readuntil(b"\r\n\r\n")
+    lines = raw.decode(errors="replace").split("\r\n")
+    headers = {}
+    for line in lines[1:]:
+        if ":" in line:
+            k, v = line.split(":", 1)
+            headers[k.strip().lower()] = v.strip()
+    return lines[0], headers
+
+
+# ---------------------------------------------------------------------------
+# Server
+# ---------------------------------------------------------------------------
+class Stats:
+    def __init__(self):
+        self.frames = 0
+        self.msgs = 0
+        self.bytes = 0
+        self.events = 0
+        self.dupes = 0
+        self.dropped = 0
+        self.acks = 0
+        self.connects = 0
+        self.refused = 0
+        self.by_type = {}
+
+
+class Server:
+    def __init__(self, args):
+        self.args = args
+        self.stats = Stats()
+        self.conns = set()
+        self.refuse_until = 0.0
+        self.half_open_until = 0.0
+        self.fault_at = {}          # peer ip -> monotonic time a fault cut it off
+        self.next_seq = {}          # (ip, epoch) -> next expected seq
+        self.mesh_seen = set()      # (from, epoch, seq) forwarded by a mesh base station
+        self.ticks = {}             # ip -> reconstructed countdown
+        self.round_id = 0
+        self.round_starts = {}      # ip -> board time the prop reported starting
+
+    def board_ms(self):
+        # Scoreboard clock as the props see it (optionally skewed)
+        return (now_ms() + self.args.clock_offset) & 0xFFFFFFFF
+
+    # --- connection ---
+    async def handle(self, reader, writer):
+        ip = writer.get_extra_info("peername")[0]
+        try:
+            request, headers = await read_http_head(reader)
+        except (asyncio.IncompleteReadError, asyncio.LimitOverrunError, ConnectionError):
+            writer.close()
+            return
+        if time.monotonic() < self.refuse_until:
+            self.stats.refused += 1
+            log("FAULT", "refusing handshake from %s" % ip)
+            writer.write(b"HTTP/1.1 503 Service Unavailable\r\nContent-Length: 0\r\n\r\n")
+            await writer.drain()
+            writer.close()
+            return
+        key = headers.get("sec-websocket-key")
+        if not key:
+            writer.write(b"HTTP/1.1 400 Bad Request\r\nContent-Length: 0\r\n\r\n")
+            writer.close()
+            return
+        resp = ("HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+                "Sec-WebSocket-Accept: %s\r\n" % accept_key(key))
+        if "sec-websocket-protocol" in headers:
+            resp += "Sec-WebSocket-Protocol: %s\r\n" % headers["sec-websocket-protocol"].split(",")[0].strip()
+        writer.write((resp + "\r\n").encode())
+        await writer.drain()
+
+        self.stats.connects += 1
+        cut = self.fault_at.pop(ip, None)
+        if cut is not None:
+            log("RECOVERY", "%s reconnected %.2f s after the fault" % (ip, time.monotonic() - cut))
+        log("CONN", "%s connected (%s)" % (ip, request))
+        self.conns.add(writer)
+        if self.args.log_level:
+            await self.send_json(writer, {"type": "log_stream", "level": self.args.log_level})
+        try:
+            while True:
+                if time.monotonic() < self.half_open_until:
+                    # Half-open: peer's frames pile up unread, nothing is answered, socket stays up
+                    await asyncio.sleep(self.half_open_until - time.monotonic())
+                    self.fault_at[ip] = time.monotonic()
+                    log("FAULT", "half-open window over, aborting %s" % ip)
+                    writer.transport.abort()
+                    return
+                op, payload = await read_frame(reader)
+                self.stats.frames += 1
+                self.stats.bytes += len(payload)
+                if op == OP_CLOSE:
+                    writer.write(make_frame(OP_CLOSE, payload[:2], False))
+                    break
+                if op == OP_PING:
+                    await self.reply(writer, make_frame(OP_PONG, payload, False))
+                elif op == OP_TEXT:
+                    await self.on_text(ip, writer, payload.decode(errors="replace"))
+                elif op == OP_BIN:
+                    if self.args.log_file:
+                        with open(self.args.log_file, "ab") as f:
+                            f.write(payload)
+                    else:
+                        log("RX", "%s binary frame (%d bytes)" % (ip, len(payload)))
+        except (asyncio.IncompleteReadError, ConnectionError):
+            pass
+        finally:
+            self.conns.discard(writer)
+            log("CONN", "%s disconnected" % ip)
+            try:
+                writer.close()
+            except Exception:
+                pass
+
+    async def reply(self, writer, frame):
+        if self.args.delay:
+            await asyncio.sleep(self.args.delay / 1000.0)
+        if writer.is_closing():
+            return
+        writer.write(frame)
+        await writer.drain()
+
+    async def send_json(self, writer, obj):
+        await self.reply(writer, make_frame(OP_TEXT, json.dumps(obj, separators=(",", ":")).encode(), False))
+
+    # --- protocol ---
+    async def on_text(self, ip, writer, text):
+        t_rx = now_ms()
+        try:
+            doc = json.loads(text)
+        except ValueError:
+            log("RX", "%s non-JSON: %r" % (ip, text[:80]))
+            return
+        for msg in (doc if isinstance(doc, list) else [doc]):
+            if isinstance(msg, dict):
+                self.stats.msgs += 1
+                await self.on_message(ip, writer, msg, t_rx)
+
+    async def on_message(self, ip, writer, msg, t_rx):
+        kind = msg.get("type") or msg.get("eventType") or "?"
+        self.stats.by_type[kind] = self.stats.by_type.get(kind, 0) + 1
+
+        if kind == "c4_event":
+            await self.on_event(ip, writer, msg)
+        elif kind == "state":
+            log("STATE", "%s -> %s" % (ip, msg.get("value")))
+        elif kind == "sync_req":
+            await self.send_json(writer, {"type": "sync_resp", "t0": msg.get("t0", 0),
+                                          "t1": (t_rx + self.args.clock_offset) & 0xFFFFFFFF,
+                                          "t2": self.board_ms()})
+        elif kind == "tick":
+            self.on_tick(ip, msg)
+        elif kind == "round_ack":
+            self.on_round_ack(ip, msg, t_rx)
+        elif kind == "cmd_result":
+            log("CMD", "%s %s" % (ip, json.dumps(msg)))
+        elif kind == "mesh":
+            self.on_mesh(ip, msg)
+        elif kind in ("loop_report", "metric", "prof", "ws_stats"):
+            log(kind.upper(), "%s %s" % (ip, json.dumps(msg)[:160]))
+        else:
+            log("RX", "%s %s" % (ip, json.dumps(msg)[:160]))
+
+    async def on_event(self, ip, writer, msg):
+        status = msg.get("c4_status")
+        if "epoch" not in msg or "seq" not in msg:
+            self.stats.events += 1
+            log("EVENT", "%s %s (unjournaled) %s" % (ip, status, msg))
+            return
+        epoch, seq = int(msg["epoch"]), int(msg["seq"])
+        k = (ip, epoch)
+        if k not in self.next_seq:
+            self.next_seq[k] = seq          # first sight of this epoch: earlier seqs were acked elsewhere
+        elif self.args.drop and random.random() < self.args.drop:
+            self.stats.dropped += 1
+            log("FAULT", "dropped %s epoch=%d seq=%d" % (status, epoch, seq))
+            return
+        expected = self.next_seq[k]
+        if seq == expected:
+            self.next_seq[k] = seq + 1
+            self.stats.events += 1
+            log("EVENT", "%s %s epoch=%d seq=%d %s" % (ip, status, epoch, seq,
+                                                       {x: msg[x] for x in msg if x.endswith("_ms")}))
+        elif seq < expected:
+            self.stats.dupes += 1
+            log("EVENT", "%s duplicate epoch=%d seq=%d (replay)" % (ip, epoch, seq))
+        else:
+            log("EVENT", "%s gap: got seq=%d, want %d" % (ip, seq, expected))
+        if not self.args.no_ack and self.next_seq[k] > 1:
+            self.stats.acks += 1
+            await self.send_json(writer, {"type": "ack", "epoch": epoch, "seq": self.next_seq[k] - 1})
+
+    def on_mesh(self, ip, msg):
+        # Mesh events arrive in any order (many origins, retries); seq restarts every epoch
+        k = (msg.get("from"), msg.get("epoch"), msg.get("seq"))
+        if k in self.mesh_seen:
+            self.stats.dupes += 1
+            log("MESH", "%s duplicate from=%s epoch=%s seq=%s" % ((ip,) + k))
+            return
+        self.mesh_seen.add(k)
+        self.stats.events += 1
+        log("MESH", "%s from=%s epoch=%s seq=%s %s" % ((ip,) + k + (json.dumps(msg.get("msg"))[:120],)))
+
+    def on_tick(self, ip, msg):
+        t = self.ticks.setdefault(ip, {"rem": None, "ts": None, "n": 0, "gaps": 0, "rate": 100})
+        n = msg.get("n", 0)
+        if t["n"] and n != t["n"] + 1:
+            t["gaps"] += 1
+            t["rem"] = None
+        t["n"] = n
+        if "rem" in msg:
+            t["rem"], t["ts"], t["rate"] = msg["rem"], msg["ts"], msg.get("rate", 100)
+        elif t["rem"] is not None:
+            elapsed = ((msg["ts"] - t["ts"]) & 0xFFFFFFFF) * t["rate"] // 100
+            t["rem"] = max(0, t["rem"] - elapsed - msg.get("d", 0))
+            t["ts"] = msg["ts"]
+        if "rem" in msg or msg.get("d"):
+            log("TICK", "%s n=%d remaining=%s ms rate=%d%% rtt=%s off=%s" % (ip, n, t["rem"], t["rate"], msg.get("rtt"), msg.get("off")))
+
+    def on_round_ack(self, ip, msg, t_rx):
+        log("ROUND", "%s %s" % (ip, json.dumps(msg)))
+        if msg.get("phase") != "started" or msg.get("round") != self.round_id:
+            return
+        # Ack left the prop right at its start instant (+late_ms); back it out by ~rtt/2
+        self.round_starts[ip] = t_rx - self.args.rtt_guess / 2.0 - msg.get("late_ms", 0)
+        if len(self.round_starts) > 1:
+            t = sorted(self.round_starts.values())
+            log("ROUND", "round %d: %d prop(s) started, spread %.0f ms" % (
+                self.round_id, len(t), t[-1] - t[0]))
+
+    async def push_round(self):
+        a = self.args
+        await asyncio.sleep(a.round_at)
+        self.round_id += 1
+        self.round_starts = {}
+        cfg = {"type": "round_config", "round": self.round_id, "token": a.token,
+               "start_at": (self.board_ms() + a.round_lead) & 0xFFFFFFFF, "bomb_ms": a.round_bomb}
+        log("ROUND", "pushing round %d to %d prop(s), start in %d ms" % (self.round_id, len(self.conns), a.round_lead))
+        for w in list(self.conns):
+            await self.send_json(w, cfg)
+
+    # --- fault schedule + stats ---
+    async def faults(self):
+        a = self.args
+        start = time.monotonic()
+        next_kill = start + a.kill_every if a.kill_every else None
+        next_half = start + a.half_open_every if a.half_open_every else None
+        while True:
+            await asyncio.sleep(0.25)
+            t = time.monotonic()
+            if next_kill and t >= next_kill:
+                next_kill = t + a.kill_every
+                log("FAULT", "killing %d connection(s)%s" % (
+                    len(self.conns), ", refusing for %ds" % a.refuse_for if a.refuse_for else ""))
+                for w in list(self.conns):
+                    self.fault_at[w.get_extra_info("peername")[0]] = t
+                    w.transport.abort()
+                if a.refuse_for:
+                    self.refuse_until = t + a.refuse_for
+            if next_half and t >= next_half:
+                next_half = t + a.half_open_every
+                self.half_open_until = t + a.half_open_for
+                log("FAULT", "half-open for %ds" % a.half_open_for)
+
+    async def report(self):
+        last = (0, 0, 0)
+        while True:
+            await asyncio.sleep(self.args.stats_every)
+            s = self.stats
+            d = (s.frames - last[0], s.msgs - last[1], s.bytes - last[2])
+            last = (s.frames, s.msgs, s.bytes)
+            per = float(self.args.stats_every)
+            log("STATS", "conns=%d frames/s=%.1f msgs/s=%.1f B/s=%.0f events=%d dupes=%d dropped=%d acks=%d "
+                "connects=%d refused=%d types=%s" % (
+                    len(self.conns), d[0] / per, d[1] / per, d[2] / per, s.events, s.dupes, s.dropped,
+                    s.acks, s.connects, s.refused, s.by_type))
+
+
+async def serve(args):
+    srv = Server(args)
+    server = await asyncio.start_server(srv.handle, args.bind, args.port)
+    log("SERVE", "listening on ws://%s:%d/ (drop=%.2f delay=%dms ack=%s)" % (
+        args.bind, args.port, args.drop, args.delay, "off" if args.no_ack else "on"))
+    asyncio.ensure_future(srv.faults())
+    asyncio.ensure_future(srv.report())
+    if args.round_at:
+        asyncio.ensure_future(srv.push_round())
+    async with server:
+        await server.serve_forever()
+
+
+# ---------------------------------------------------------------------------
+# Load generator
+# ---------------------------------------------------------------------------
+STATES = ["PROP_IDLE", "ARMING", "ARMED", "DISARMING_KEYPAD", "DISARMED", "STANDBY"]
+
+
+class LoadStats:
+    def __init__(self):
+        self.sent = 0
+        self.bytes = 0
+        self.acked = 0
+        self.errors = 0
+        self.latency = []
+
+
+async def virtual_prop(idx, args, ls, deadline):
+    epoch = random.randint(1, 1 << 30)
+    seq = 0
+    sent_at = {}
+    try:
+        reader, writer = await asyncio.open_connection(args.host, args.port)
+        key = base64.b64encode(os.urandom(16)).decode()
+        writer.write(("GET %s HTTP/1.1\r\nHost: %s:%d\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+                      "Sec-WebSocket-Key: %s\r\nSec-WebSocket-Version: 13\r\n\r\n"
+                      % (args.path, args.host, args.port, key)).encode())
+        status, headers = await read_http_head(reader)
+        if " 101 " not in status or headers.get("sec-websocket-accept") != accept_key(key):
+            raise ConnectionError("handshake failed: %s" % status)
+    except (OSError, asyncio.IncompleteReadError, ConnectionError) as e:
+        ls.errors += 1
+        log("LOAD", "prop %d: %s" % (idx, e))
+        return
+
+    async def rx():
+        try:
+            while True:
+                op, payload = await read_frame(reader)
+                if op != OP_TEXT:
+                    continue
+                msg = json.loads(payload.decode())
+                if isinstance(msg, dict) and msg.get("type") == "ack" and msg.get("epoch") == epoch:
+                    t = now_ms()
+                    for s in [s for s in sent_at if s <= msg["seq"]]:
+                        ls.latency.append(t - sent_at.pop(s))
+                        ls.acked += 1
+        except (asyncio.IncompleteReadError, ConnectionError, ValueError):
+            pass
+
+    rx_task = asyncio.ensure_future(rx())
+    period = 1.0 / args.rate
+    try:
+        while time.monotonic() < deadline:
+            seq += 1
+            batch = [
+                {"type": "state", "value": STATES[seq % len(STATES)]},
+                {"epoch": epoch, "seq": seq, "eventType": "c4_event", "c4_status": "bombPlanted",
+                 "bomb_duration_ms": 40000},
+            ]
+            body = json.dumps(batch if args.batch else batch[1], separators=(",", ":")).encode()
+            if not args.batch:
+                writer.write(make_frame(OP_TEXT, json.dumps(batch[0]).encode(), True))
+                ls.sent += 1
+            writer.write(make_frame(OP_TEXT, body, True))
+            sent_at[seq] = now_ms()
+            ls.sent += len(batch) if args.batch else 1
+            ls.bytes += len(body)
+            await writer.drain()
+            await asyncio.sleep(period * random.uniform(0.8, 1.2))
+    except ConnectionError:
+        ls.errors += 1
+    await asyncio.sleep(1.0)                # let trailing acks arrive
+    rx_task.cancel()
+    writer.close()
+
+
+async def loadgen(args):
+    ls = LoadStats()
+    t0 = time.monotonic()
+    deadline = t0 + args.duration
+    await asyncio.gather(*[virtual_prop(i, args, ls, deadline) for i in range(args.props)])
+    dt = time.monotonic() - t0
+    lat = sorted(ls.latency)
+    pct = lambda p: lat[min(len(lat) - 1, int(len(lat) * p))] if lat else 0
+    log("LOAD", "props=%d duration=%.1fs msgs=%d (%.0f msgs/s, %.0f B/s) acked=%d errors=%d" % (
+        args.props, dt, ls.sent, ls.sent / dt, ls.bytes / dt, ls.acked, ls.errors))
+    log("LOAD", "ack latency ms: p50=%d p90=%d p99=%d max=%d" % (pct(0.5), pct(0.9), pct(0.99), lat[-1] if lat else 0))
+
+
+def main():
+    ap = argparse.ArgumentParser(description="C4 prop scoreboard stand-in + load generator")
+    sub = ap.add_subparsers(dest="cmd")
+    sub.required = True
+
+    s = sub.add_parser("serve", help="run the stand-in scoreboard")
+    s.add_argument("--bind", default="0.0.0.0")
+    s.add_argument("--port", type=int, default=8080)
+    s.add_argument("--drop", type=float, default=0.0, help="probability of dropping a journaled c4_event")
+    s.add_argument("--delay", type=int, default=0, help="ms to delay every reply (ack, pong, sync_resp)")
+    s.add_argument("--no-ack", action="store_true", help="behave like a legacy scoreboard (never ack)")
+    s.add_argument("--kill-every", type=int, default=0, help="abort all connections every N s")
+    s.add_argument("--refuse-for", type=int, default=0, help="after a kill, refuse handshakes for N s")
+    s.add_argument("--half-open-every", type=int, default=0, help="go silent (no reads/replies) every N s")
+    s.add_argument("--half-open-for", type=int, default=20, help="length of the half-open window in s")
+    s.add_argument("--stats-every", type=int, default=10)
+    s.add_argument("--token", default="", help="prop cmd_token (for round_config)")
+    s.add_argument("--round-at", type=int, default=0, help="push a round_config N s after startup")
+    s.add_argument("--round-lead", type=int, default=5000, help="ms between the push and start_at")
+    s.add_argument("--round-bomb", type=int, default=40000, help="bomb_ms in the pushed round")
+    s.add_argument("--clock-offset", type=int, default=0, help="skew the server clock by this many ms")
+    s.add_argument("--log-level", type=int, default=0, help="subscribe to prop logs (1 error .. 4 debug)")
+    s.add_argument("--log-file", default="", help="append binary log frames here (decode with log_decode)")
+    s.add_argument("--rtt-guess", type=int, default=10, help="ms; used to back out ack flight time")
+
+    g = sub.add_parser("loadgen", help="simulate many props against a server")
+    g.add_argument("--host", default="127.0.0.1")
+    g.add_argument("--port", type=int, default=8080)
+    g.add_argument("--path", default="/")
+    g.add_argument("--props", type=int, default=24)
+    g.add_argument("--rate", type=float, default=2.0, help="events per second per prop")
+    g.add_argument("--duration", type=float, default=20.0)
+    g.add_argument("--batch", action="store_true", help="send state+event as one batched frame")
+
+    args = ap.parse_args()
+    try:
+        asyncio.get_event_loop().run_until_complete(serve(args) if args.cmd == "serve" else loadgen(args))
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == "__main__":
+    main()
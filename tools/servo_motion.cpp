@@ -0,0 +1,194 @@
+// servo_motion.cpp
+// Host-side checks of the shell ejector's motion planner (ServoMotion.h): the pulse widths
+// the esp_timer writes, one per SERVO_UPDATE_MS.
+//
+//   trace [pop|double|home] [step|trapezoid|scurve] [start_deg] [end_deg]
+//                  the pulse trajectory of a sequence: ms, step, angle, pulse width
+//                  (default pop, scurve, 0 -> 90°)
+//   selftest       for every profile, sequence and a set of angle pairs: pulses stay between
+//                  the start and end pulse, every move reaches its target and holds it for
+//                  the step's hold, speed and acceleration stay within SERVO_SPEED_DEG_S and
+//                  SERVO_ACCEL_DEG_S2, the S-curve starts and ends each ramp with no
+//                  acceleration, the trajectory is the same at any tick rate or jitter, a
+//                  restart mid-move carries on from where the arm is, the sequence ends at
+//                  totalUs() and SP_STEP gives the old jump-hold-jump
+//
+// Build: g++ -std=c++11 -O2 -I.. servo_motion.cpp -o servo_motion
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdint.h>
+#include "ServoMotion.h"
+
+struct Seq { const char* name; const MotionStep* steps; uint8_t count; };
+static const Seq SEQS[] = {
+  { "pop",    SERVO_SEQ_POP,        sizeof(SERVO_SEQ_POP) / sizeof(SERVO_SEQ_POP[0]) },
+  { "double", SERVO_SEQ_DOUBLE_POP, sizeof(SERVO_SEQ_DOUBLE_POP) / sizeof(SERVO_SEQ_DOUBLE_POP[0]) },
+  { "home",   SERVO_SEQ_HOME,       sizeof(SERVO_SEQ_HOME) / sizeof(SERVO_SEQ_HOME[0]) },
+};
+static const char* PROFILE_NAMES[] = { "step", "trapezoid", "scurve" };
+
+static int fails = 0;
+static void check(bool ok, const char* what, const char* detail) {
+  if (ok) return;
+  if (fails++ < 12) printf("FAIL  %s (%s)\n", what, detail);
+}
+
+static int trace(int argc, char** argv) {
+  const Seq* seq = &SEQS[0];
+  uint8_t prof = SP_SCURVE;
+  for (const Seq& s : SEQS) if (argc > 2 && !strcmp(argv[2], s.name)) seq = &s;
+  for (uint8_t p = 0; p < 3; p++) if (argc > 3 && !strcmp(argv[3], PROFILE_NAMES[p])) prof = p;
+  float start = argc > 4 ? (float)atof(argv[4]) : 0;
+  float end = argc > 5 ? (float)atof(argv[5]) : 90;
+  ServoPlanner pl;
+  pl.begin(seq->steps, seq->count, start, end, start, prof);
+  printf("%s, %s, %.0f -> %.0f deg, %u ms, tick %u ms\n", seq->name, PROFILE_NAMES[prof], start, end,
+         (unsigned)(pl.totalUs(start) / 1000), (unsigned)SERVO_UPDATE_MS);
+  printf("%6s %4s %7s %6s\n", "ms", "step", "deg", "us");
+  for (uint32_t ms = 0; !pl.done; ms += SERVO_UPDATE_MS) {
+    float a = pl.at(ms * 1000);
+    printf("%6u %4u %7.2f %6u\n", ms, pl.step, a, servoPulseUs(a));
+  }
+  return 0;
+}
+
+// One sequence sampled every 1 ms
+static void checkSequence(const Seq& s, uint8_t prof, float start, float end) {
+  char d[96];
+  snprintf(d, sizeof(d), "%s %s %.0f->%.0f", s.name, PROFILE_NAMES[prof], start, end);
+  ServoPlanner pl;
+  pl.begin(s.steps, s.count, start, end, start, prof);
+  uint32_t total = pl.totalUs(start);
+  float lo = start < end ? start : end, hi = start < end ? end : start;
+  const float dt = 0.001f;
+  float prev = start, prevV = 0, prevA = 0, maxV = 0, maxA = 0;
+  uint8_t lastStep = 0;
+  uint32_t stepStartMs = 0;
+  bool holdOk = true, targetOk = true, rampEdgesOk = true;
+  uint32_t ms = 0;
+  for (; ms * 1000 <= total + 1000; ms++) {
+    float a = pl.at(ms * 1000);
+    if (pl.step != lastStep) {   // the previous step must have ended on its target
+      targetOk &= fabsf(prev - pl.target(lastStep)) < 0.01f;
+      lastStep = pl.step;
+      stepStartMs = ms;
+    }
+    check(a >= lo - 0.01f && a <= hi + 0.01f, "angle outside the start..end range", d);
+    // inside the hold (after the move): exactly on target
+    if (!pl.done && (ms - stepStartMs) * 1000 >= pl.move.us + 1000 && fabsf(a - pl.target(pl.step)) > 0.001f) holdOk = false;
+    float v = (a - prev) / dt;
+    float acc = (v - prevV) / dt;
+    if (prof != SP_STEP && ms > 0) {
+      if (fabsf(v) > maxV) maxV = fabsf(v);
+      if (ms > 1 && fabsf(acc) > maxA) maxA = fabsf(acc);
+      // S-curve: the acceleration fades in and out (jerk at most pi * accel / ta, plus float noise), no steps
+      float jerk = pl.move.ta > 0 ? 3.1416f * SERVO_ACCEL_DEG_S2 / pl.move.ta : 0;
+      if (prof == SP_SCURVE && ms > 2 && fabsf(acc - prevA) > jerk * dt * 1.5f + SERVO_ACCEL_DEG_S2 * 0.05f) rampEdgesOk = false;
+    }
+    prevA = acc;
+    prevV = v;
+    prev = a;
+  }
+  check(pl.done, "sequence not done after totalUs", d);
+  check(fabsf(pl.angle - pl.target(s.count - 1)) < 0.001f, "did not end on the last target", d);
+  check(targetOk, "a move ended off its target", d);
+  check(holdOk, "drifted during a hold", d);
+  if (prof != SP_STEP) {
+    check(maxV <= SERVO_SPEED_DEG_S * 1.01f, "over SERVO_SPEED_DEG_S", d);
+    check(maxA <= SERVO_ACCEL_DEG_S2 * 1.05f, "over SERVO_ACCEL_DEG_S2", d);
+  }
+  check(rampEdgesOk, "S-curve acceleration jumps", d);
+
+  // done flips exactly at totalUs
+  ServoPlanner q;
+  q.begin(s.steps, s.count, start, end, start, prof);
+  q.at(total - 1);
+  check(!q.done, "done before totalUs", d);
+  q.at(total);
+  check(q.done, "not done at totalUs", d);
+
+  // Same trajectory at the 20 ms tick, at 1 ms and with jittery ticks: compare at shared times
+  ServoPlanner fine, tick, jit;
+  fine.begin(s.steps, s.count, start, end, start, prof);
+  tick.begin(s.steps, s.count, start, end, start, prof);
+  jit.begin(s.steps, s.count, start, end, start, prof);
+  uint32_t r = 17;
+  bool same = true;
+  for (uint32_t t = 0, nextJit = 0; t <= total; t += 1000) {
+    float f = fine.at(t);
+    while (nextJit < t) { jit.at(nextJit); r = r * 1103515245u + 12345u; nextJit += 5000 + (r >> 8) % 40000; }
+    if (t % (SERVO_UPDATE_MS * 1000) == 0) {
+      if (fabsf(tick.at(t) - f) > 1e-4f || fabsf(jit.at(t) - f) > 1e-4f) same = false;
+    }
+  }
+  check(same, "trajectory depends on the tick rate", d);
+}
+
+static int selftest() {
+  const float pairs[][2] = { { 0, 90 }, { 90, 0 }, { 10, 170 }, { 45, 50 }, { 30, 30 } };
+  unsigned runs = 0;
+  for (const Seq& s : SEQS)
+    for (uint8_t p = 0; p < 3; p++)
+      for (const auto& pr : pairs) { checkSequence(s, p, pr[0], pr[1]); runs++; }
+  printf("%u sequence/profile/angle runs: on target, in range, within speed and acceleration\n", runs);
+
+  // Move times for the default 90° pop
+  for (uint8_t p = 0; p < 3; p++) {
+    MotionMove m;
+    m.plan(0, 90, p, SERVO_SPEED_DEG_S, SERVO_ACCEL_DEG_S2);
+    printf("90 deg %-9s: %3u ms", PROFILE_NAMES[p], (unsigned)(m.us / 1000));
+    if (p == SP_STEP) printf(" (the servo's own speed)");
+    printf("\n");
+  }
+
+  // SP_STEP: the old behaviour, end pulse at once, start pulse after the hold
+  ServoPlanner st;
+  st.begin(SERVO_SEQ_POP, 2, 0, 90, 0, SP_STEP);
+  check(servoPulseUs(st.at(0)) == servoPulseUs(90), "step: end pulse at once", "");
+  check(servoPulseUs(st.at(SERVO_HOLD_MS * 1000 - 1)) == servoPulseUs(90), "step: held", "");
+  check(servoPulseUs(st.at(SERVO_HOLD_MS * 1000)) == servoPulseUs(0), "step: start pulse after the hold", "");
+
+  // Profiled moves start gently: the first tick moves no further than the acceleration allows
+  ServoPlanner sc, tr;
+  sc.begin(SERVO_SEQ_POP, 2, 0, 90, 0, SP_SCURVE);
+  tr.begin(SERVO_SEQ_POP, 2, 0, 90, 0, SP_TRAPEZOID);
+  float sc1 = sc.at(SERVO_UPDATE_MS * 1000), tr1 = tr.at(SERVO_UPDATE_MS * 1000);
+  float tick = SERVO_UPDATE_MS / 1000.0f;
+  check(sc1 < tr1 && tr1 <= 0.5f * SERVO_ACCEL_DEG_S2 * tick * tick + 0.01f, "first tick moves too far", "");
+  printf("first %u ms: scurve %.2f deg, trapezoid %.2f deg, step 90 deg\n", (unsigned)SERVO_UPDATE_MS, sc1, tr1);
+
+  // Double pop visits 100 %, 40 %, 100 %, 0 % in order
+  ServoPlanner dp;
+  dp.begin(SERVO_SEQ_DOUBLE_POP, 4, 0, 90, 0, SERVO_PROFILE);
+  const float want[] = { 90, 36, 90, 0 };
+  uint8_t seen = 0;
+  for (uint32_t t = 0; !dp.done; t += SERVO_UPDATE_MS * 1000) {
+    float a = dp.at(t);
+    if (seen < 4 && fabsf(a - want[seen]) < 0.01f) seen++;
+  }
+  check(seen == 4, "double pop did not visit 100/40/100/0 %", "");
+
+  // Restart halfway through the first move: continues from the arm's angle, no jump
+  ServoPlanner rs;
+  rs.begin(SERVO_SEQ_POP, 2, 0, 90, 0, SP_SCURVE);
+  float mid = rs.at(rs.move.us / 2);
+  rs.begin(SERVO_SEQ_POP, 2, 0, 90, rs.angle, SP_SCURVE);
+  check(fabsf(rs.at(0) - mid) < 0.001f && fabsf(rs.at(SERVO_UPDATE_MS * 1000) - mid) < 5.0f, "restart jumped", "");
+
+  // Pulse mapping: ESP32Servo's write() range
+  check(servoPulseUs(0) == SERVO_MIN_US && servoPulseUs(180) == SERVO_MAX_US && servoPulseUs(-5) == SERVO_MIN_US &&
+        servoPulseUs(200) == SERVO_MAX_US, "pulse mapping", "");
+
+  printf("%d failure(s)\n", fails);
+  return fails ? 1 : 0;
+}
+
+int main(int argc, char** argv) {
+  if (argc > 1 && !strcmp(argv[1], "trace")) return trace(argc, argv);
+  if (argc > 1 && !strcmp(argv[1], "selftest")) return selftest();
+  fprintf(stderr, "usage: %s trace [pop|double|home] [step|trapezoid|scurve] [start_deg] [end_deg] | selftest\n", argv[0]);
+  return 2;
+}
@@ -0,0 +1,434 @@
+// state_trace.cpp
+// Host-side checks for the game state table (StateTable.h).
+//
+//   table               print every (state, event) -> state edge
+//   selftest            replay every state x input x guard combination through a transcription
+//                       of the pre-table handlers (direct setState() calls) and through the
+//                       event/table path, and compare the state traces
+//   check <log.txt>     verify "[STATE] A -> B on ev" lines from a device log (serial text or
+//                       tools/log_decode output, built with -DC4_LOG_LEVEL=4) against the table
+//
+// Build: g++ -std=c++11 -O2 -I.. state_trace.cpp -o state_trace
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "StateTable.h"
+
+// --- MODEL ---
+// Inputs as loop() sees them; guards the handlers evaluate are folded into Ctx
+enum Input {
+  IN_BOOT_AWAIT, IN_BOOT_CONFIG, IN_BOOT_TOLKIEN,
+  IN_ARM_UP, IN_ARM_DOWN, IN_DIGIT, IN_STAR, IN_HASH, IN_BTN_DOWN, IN_BTN_UP,
+  IN_CARD_ADMIN, IN_CARD_DISARM, IN_CARD_ARM, IN_BOMB_CLOCK, IN_FADE, IN_DISARM_HELD,
+  IN_TRACK_DET, IN_TRACK_DUD, IN_TRACK_JUGS, IN_WS_RESET, IN_WS_ARM, IN_ROUND,
+  IN_CFG_EXIT, IN_TOLKIEN_END, IN_COUNT
+};
+static const char* INPUT_NAMES[IN_COUNT] = {
+  "boot_await", "boot_config", "boot_tolkien", "arm_up", "arm_down", "digit", "star", "hash",
+  "btn_down", "btn_up", "card_admin", "card_disarm", "card_arm", "bomb_clock", "fade",
+  "disarm_held", "track_det", "track_dud", "track_jugs", "ws_reset", "ws_arm", "round",
+  "cfg_exit", "tolkien_end",
+};
+
+// Which branch of processArmingCode() the entered code takes (easter eggs already resolved)
+enum Code { C_OK, C_WRONG_FIXED, C_SHORT, C_JOKE, C_STARWARS, C_MASTER, C_JUGS, C_SERVO, C_COUNT };
+// DISARMING_KEYPAD buffer after a digit
+enum Disarm { D_PARTIAL, D_MATCH, D_WRONG_FULL, D_COUNT };
+
+struct Ctx {
+  bool planted, sdSetting, sdActive, dud, doubleTap;
+  uint8_t code, disarm;
+};
+
+struct Sim {
+  uint8_t state;
+  bool sdActive, autoTyping;
+  std::string trace;
+  void push(uint8_t from, uint8_t to) {
+    trace += stateName(from); trace += "->"; trace += stateName(to); trace += ' ';
+  }
+};
+
+// --- BEFORE: handlers calling setState() directly (transcribed from State.h 6.7.0 / Game.h 6.5.2) ---
+struct OldGame {
+  Sim s; Ctx c;
+
+  void resetSpecialModes() { s.sdActive = false; s.autoTyping = false; }
+  void setState(uint8_t n) {
+    if (s.state == n) return;
+    uint8_t o = s.state;
+    s.push(o, n);
+    s.state = n;
+    if (!(o == PROP_IDLE && n == ARMING)) s.autoTyping = false;
+    if (n == STANDBY || n == PROP_IDLE || n == AWAIT_ARM_TOGGLE) resetSpecialModes();
+    if (n == PRE_EXPLOSION && c.dud) { setState(PROP_DUD); return; }
+    if (n == EASTER_EGG) setState(ARMED);
+  }
+
+  void processArmingCode() {
+    switch (c.code) {
+      case C_STARWARS:    setState(STARWARS_PRE_GAME); break;
+      case C_JOKE:        setState(PROP_IDLE); break;
+      case C_JUGS:        setState(EASTER_EGG_2); break;
+      case C_SERVO:       break;
+      case C_MASTER:      setState(EASTER_EGG); break;
+      case C_WRONG_FIXED: setState(PROP_IDLE); break;
+      case C_OK:          setState(ARMED); break;
+      default:            setState(PROP_IDLE); break;
+    }
+  }
+
+  void keypad(Input in) {
+    if (s.state == STARWARS_PRE_GAME) {
+      if (in == IN_HASH) { if (!c.planted) return; setState(ARMED); return; }
+      if (in == IN_STAR) { resetSpecialModes(); setState(PROP_IDLE); return; }
+      return;
+    }
+    if (s.state == PROP_IDLE) setState(ARMING);
+    if (s.state == ARMED) setState(DISARMING_KEYPAD);
+    if (in == IN_DIGIT) {
+      if (s.state == DISARMING_KEYPAD) {
+        if (c.disarm == D_MATCH) setState(DISARMED);
+        else if (c.disarm == D_WRONG_FULL) setState(ARMED);
+      }
+    } else if (in == IN_STAR) {
+      if (c.doubleTap) {
+        if (s.state == ARMING) setState(PROP_IDLE);
+        if (s.state == DISARMING_KEYPAD) setState(ARMED);
+      }
+    } else if (in == IN_HASH) {
+      if (s.state == ARMING) {
+        if (!c.planted) { setState(PROP_IDLE); return; }
+        processArmingCode();
+      }
+    }
+  }
+
+  void button(Input in) {
+    if (s.state == ARMED || s.state == DISARMING_KEYPAD) {
+      if (in == IN_BTN_DOWN) setState(DISARMING_MANUAL);
+    }
+    if (s.state == DISARMING_MANUAL && in == IN_BTN_UP) setState(ARMED);
+  }
+
+  void rfid(Input in) {
+    if (in == IN_CARD_ADMIN) { resetSpecialModes(); setState(STANDBY); return; }
+    if (in == IN_CARD_DISARM && (s.state == ARMED || s.state == DISARMING_KEYPAD)) setState(DISARMING_RFID);
+  }
+
+  void armSwitch(Input in) {
+    if (c.sdSetting) {
+      if (in == IN_ARM_UP) {
+        if (s.state == STANDBY || s.state == PROP_IDLE) {
+          if (!c.planted) return;
+          s.sdActive = true;
+          setState(ARMED);
+        }
+      } else if (in == IN_ARM_DOWN) {
+        if (s.state == ARMED && s.sdActive) setState(DISARMED);
+        if ((s.state == EXPLODED || s.state == DISARMED) && s.sdActive) setState(STANDBY);
+      }
+      return;
+    }
+    if (in == IN_ARM_UP) {
+      if (s.state == DISARMED || s.state == EXPLODED || s.state == PROP_IDLE ||
+          s.state == AWAIT_ARM_TOGGLE || s.state == PROP_DUD) { resetSpecialModes(); setState(STANDBY); }
+    } else if (in == IN_ARM_DOWN) {
+      if (s.state == STANDBY) setState(PROP_IDLE);
+    }
+  }
+
+  void serviceGameplay(Input in) {
+    bool key = in == IN_DIGIT || in == IN_STAR || in == IN_HASH;
+    switch (s.state) {
+      case STARWARS_PRE_GAME: case PROP_IDLE: case ARMING:
+        if (key) keypad(in);
+        rfid(in);
+        break;
+      case DISARMING_KEYPAD: case ARMED:
+        if (key) keypad(in);
+        button(in);
+        rfid(in);
+        break;
+      case DISARMING_MANUAL:
+        button(in);
+        if (in == IN_DISARM_HELD) setState(DISARMED);
+        break;
+      case DISARMING_RFID:
+        if (in == IN_DISARM_HELD) setState(DISARMED);
+        break;
+      default: break;
+    }
+  }
+
+  void step(Input in) {
+    switch (in) {
+      case IN_BOOT_CONFIG: s.push(s.state, CONFIG_MODE); s.state = CONFIG_MODE; return;
+      case IN_BOOT_AWAIT: setState(AWAIT_ARM_TOGGLE); return;
+      case IN_BOOT_TOLKIEN: setState(TOLKIEN_GAME); return;
+      case IN_TRACK_DET: if (s.state != EXPLODED) setState(EXPLODED); return;
+      case IN_TRACK_DUD: if (s.state != EXPLODED) setState(STANDBY); return;
+      case IN_TRACK_JUGS: if (s.state == EASTER_EGG_2) setState(ARMED); return;
+      case IN_WS_RESET: if (s.state == CONFIG_MODE) return; resetSpecialModes(); setState(STANDBY); return;
+      case IN_WS_ARM: if (s.state != PROP_IDLE && s.state != ARMING) return; setState(ARMED); return;
+      case IN_ROUND:
+        if (s.state == STANDBY || s.state == AWAIT_ARM_TOGGLE || s.state == PROP_IDLE ||
+            s.state == DISARMED || s.state == EXPLODED || s.state == PROP_DUD) setState(PROP_IDLE);
+        return;
+      default: break;
+    }
+    if (s.state == TOLKIEN_GAME) { if (in == IN_TOLKIEN_END) setState(STANDBY); return; }
+    if (s.state == CONFIG_MODE) { if (in == IN_CFG_EXIT) setState(STANDBY); return; }
+    armSwitch(in);
+    if (s.state >= ARMED && s.state < DISARMED && in == IN_BOMB_CLOCK) setState(PRE_EXPLOSION);
+    if (s.state == PRE_EXPLOSION && in == IN_FADE) setState(EXPLODED);
+    serviceGameplay(in);
+  }
+};
+
+// --- AFTER: handlers raising events, table picks the state (State.h 7.0.0 / Game.h 6.6.0) ---
+struct NewGame {
+  Sim s; Ctx c;
+
+  void resetSpecialModes() { s.sdActive = false; s.autoTyping = false; }
+  bool accepts(uint8_t ev) { return stateEdgeFor(s.state, ev) != STATE_NO_EDGE; }
+  StateEvent enter(uint8_t n) {
+    if (n == PRE_EXPLOSION && c.dud) return EV_DUD;
+    if (n == EASTER_EGG) return EV_EGG_DONE;
+    return EV_NONE;
+  }
+  bool fire(uint8_t ev) {
+    bool changed = false;
+    while (ev != EV_NONE) {
+      uint8_t e = stateEdgeFor(s.state, ev);
+      if (e == STATE_NO_EDGE) return changed;
+      const StateEdge& edge = STATE_EDGES[e];
+      if (s.state == edge.to) return changed;
+      s.push(s.state, edge.to);
+      s.state = edge.to;
+      changed = true;
+      if (edge.flags & EF_SILENT) return changed;
+      if (!(edge.flags & EF_KEEP_AUTOTYPE)) s.autoTyping = false;
+      if (stateHas(edge.to, SF_RESET_MODES)) resetSpecialModes();
+      ev = enter(edge.to);
+    }
+    return changed;
+  }
+
+  void processArmingCode() {
+    switch (c.code) {
+      case C_STARWARS:    fire(EV_CODE_STARWARS); break;
+      case C_JOKE:        fire(EV_CODE_BAD); break;
+      case C_JUGS:        fire(EV_CODE_JUGS); break;
+      case C_SERVO:       break;
+      case C_MASTER:      fire(EV_CODE_MASTER); break;
+      case C_WRONG_FIXED: fire(EV_CODE_BAD); break;
+      case C_OK:          fire(EV_CODE_OK); break;
+      default:            fire(EV_CODE_BAD); break;
+    }
+  }
+
+  void keypad(Input in) {
+    if (s.state == STARWARS_PRE_GAME) {
+      if (in == IN_HASH) { if (!c.planted) return; fire(EV_CODE_OK); return; }
+      if (in == IN_STAR) { resetSpecialModes(); fire(EV_CANCEL); return; }
+      return;
+    }
+    fire(EV_KEY);
+    if (in == IN_DIGIT) {
+      if (s.state == DISARMING_KEYPAD) {
+        if (c.disarm == D_MATCH) fire(EV_CODE_OK);
+        else if (c.disarm == D_WRONG_FULL) fire(EV_CODE_BAD);
+      }
+    } else if (in == IN_STAR) {
+      if (c.doubleTap) fire(EV_CANCEL);
+    } else if (in == IN_HASH) {
+      if (s.state == ARMING) {
+        if (!c.planted) { fire(EV_CODE_BAD); return; }
+        processArmingCode();
+      }
+    }
+  }
+
+  void button(Input in) {
+    if (in == IN_BTN_DOWN) fire(EV_BUTTON_DOWN);
+    if (in == IN_BTN_UP && accepts(EV_BUTTON_UP)) fire(EV_BUTTON_UP);
+  }
+
+  void rfid(Input in) {
+    if (in == IN_CARD_ADMIN) { resetSpecialModes(); fire(EV_RESET); return; }
+    if (in == IN_CARD_DISARM) fire(EV_CARD_DISARM);
+  }
+
+  void armSwitch(Input in) {
+    if (c.sdSetting) {
+      if (in == IN_ARM_UP) {
+        if (accepts(EV_SD_ARM_ON)) {
+          if (!c.planted) return;
+          s.sdActive = true;
+          fire(EV_SD_ARM_ON);
+        }
+      } else if (in == IN_ARM_DOWN && s.sdActive) {
+        if (fire(EV_SD_ARM_OFF) && s.state == DISARMED) fire(EV_SD_ARM_OFF);
+      }
+      return;
+    }
+    if (in == IN_ARM_UP) {
+      if (accepts(EV_ARM_ON)) { resetSpecialModes(); fire(EV_ARM_ON); }
+    } else if (in == IN_ARM_DOWN) {
+      if (accepts(EV_ARM_OFF)) fire(EV_ARM_OFF);
+    }
+  }
+
+  enum Tick { T_NONE, T_IDLE, T_ARMED, T_MANUAL, T_RFID, T_PRE };
+  void serviceGameplay(Input in) {
+    static const uint8_t TICK[STATE_COUNT] = {
+      T_NONE, T_NONE, T_IDLE, T_IDLE, T_ARMED, T_ARMED, T_MANUAL, T_RFID, T_NONE,
+      T_PRE, T_NONE, T_NONE, T_NONE, T_NONE, T_IDLE, T_NONE, T_NONE,
+    };
+    bool key = in == IN_DIGIT || in == IN_STAR || in == IN_HASH;
+    switch (TICK[s.state]) {
+      case T_IDLE:   if (key) keypad(in); rfid(in); break;
+      case T_ARMED:  if (key) keypad(in); button(in); rfid(in); break;
+      case T_MANUAL: button(in); if (in == IN_DISARM_HELD) fire(EV_DISARM_DONE); break;
+      case T_RFID:   if (in == IN_DISARM_HELD) fire(EV_DISARM_DONE); break;
+      default: break;
+    }
+  }
+
+  void step(Input in) {
+    switch (in) {
+      case IN_BOOT_CONFIG: fire(EV_BOOT_CONFIG); return;
+      case IN_BOOT_AWAIT: fire(EV_BOOT_AWAIT); return;
+      case IN_BOOT_TOLKIEN: fire(EV_BOOT_TOLKIEN); return;
+      case IN_TRACK_DET: if (s.state != EXPLODED) fire(EV_TRACK_DETONATION); return;
+      case IN_TRACK_DUD: if (s.state != EXPLODED) fire(EV_TRACK_DUD); return;
+      case IN_TRACK_JUGS: if (accepts(EV_TRACK_JUGS)) fire(EV_TRACK_JUGS); return;
+      case IN_WS_RESET: if (s.state == CONFIG_MODE) return; resetSpecialModes(); fire(EV_RESET); return;
+      case IN_WS_ARM: if (!accepts(EV_REMOTE_ARM)) return; fire(EV_REMOTE_ARM); return;
+      case IN_ROUND: if (accepts(EV_ROUND_START)) fire(EV_ROUND_START); return;
+      default: break;
+    }
+    if (s.state == TOLKIEN_GAME) { if (in == IN_TOLKIEN_END) fire(EV_RESET); return; }
+    if (s.state == CONFIG_MODE) { if (in == IN_CFG_EXIT) fire(EV_RESET); return; }
+    armSwitch(in);
+    if (stateHas(s.state, SF_BOMB_CLOCK) && in == IN_BOMB_CLOCK) fire(EV_TIMEOUT);
+    if (s.state == PRE_EXPLOSION && in == IN_FADE) fire(EV_TIMEOUT);
+    serviceGameplay(in);
+  }
+};
+
+// --- COMMANDS ---
+static int printTable() {
+  for (uint8_t st = 0; st < STATE_COUNT; st++) {
+    for (uint8_t ev = EV_NONE + 1; ev < EV_COUNT; ev++) {
+      uint8_t e = stateEdgeFor(st, ev);
+      if (e == STATE_NO_EDGE || STATE_EDGES[e].to == st) continue;
+      printf("%-18s %-17s -> %s%s\n", stateName(st), stateEventName(ev), stateName(STATE_EDGES[e].to),
+             STATE_EDGES[e].from == STATE_ANY ? "  (any)" : "");
+    }
+  }
+  return 0;
+}
+
+static int selftest() {
+  unsigned cases = 0, moved = 0, fails = 0;
+  for (uint8_t st = 0; st < STATE_COUNT; st++) {
+    for (int in = 0; in < IN_COUNT; in++) {
+      // boot inputs only happen from the initial STANDBY
+      if (in <= IN_BOOT_TOLKIEN && st != STANDBY) continue;
+      for (unsigned bits = 0; bits < 32; bits++) {
+        for (uint8_t code = 0; code < C_COUNT; code++) {
+          for (uint8_t disarm = 0; disarm < D_COUNT; disarm++) {
+            Ctx c = { !!(bits & 1), !!(bits & 2), !!(bits & 4), !!(bits & 8), !!(bits & 16), code, disarm };
+            OldGame o; o.c = c; o.s.state = st; o.s.sdActive = c.sdActive; o.s.autoTyping = true;
+            NewGame n; n.c = c; n.s.state = st; n.s.sdActive = c.sdActive; n.s.autoTyping = true;
+            o.step((Input)in);
+            n.step((Input)in);
+            cases++;
+            if (!o.s.trace.empty()) moved++;
+            bool same = o.s.trace == n.s.trace && o.s.state == n.s.state &&
+                        o.s.sdActive == n.s.sdActive && o.s.autoTyping == n.s.autoTyping;
+            if (same) continue;
+            if (fails++ < 20) {
+              printf("FAIL  %s + %s (bits=%02x code=%u disarm=%u)\n", stateName(st), INPUT_NAMES[in], bits, code, disarm);
+              printf("      before: %s sd=%d auto=%d\n", o.s.trace.c_str(), o.s.sdActive, o.s.autoTyping);
+              printf("      after:  %s sd=%d auto=%d\n", n.s.trace.c_str(), n.s.sdActive, n.s.autoTyping);
+            }
+          }
+        }
+      }
+    }
+  }
+
+  // A few end-to-end traces, printed for eyeballing
+  struct Script { const char* name; Ctx c; std::vector<Input> in; };
+  Ctx plain = { true, false, false, false, false, C_OK, D_PARTIAL };
+  Ctx dud = plain; dud.dud = true;
+  Ctx egg = plain; egg.code = C_MASTER;
+  Ctx sd = plain; sd.sdSetting = true;
+  Script scripts[] = {
+    { "arm+defuse", plain, { IN_ARM_DOWN, IN_DIGIT, IN_HASH, IN_BTN_DOWN, IN_DISARM_HELD, IN_ARM_UP } },
+    { "dud",        dud,   { IN_ARM_DOWN, IN_HASH, IN_BOMB_CLOCK, IN_TRACK_DUD } },
+    { "master",     egg,   { IN_ARM_DOWN, IN_HASH, IN_CARD_DISARM, IN_DISARM_HELD } },
+    { "sudden",     sd,    { IN_ARM_UP, IN_ARM_DOWN } },
+  };
+  for (size_t i = 0; i < sizeof(scripts) / sizeof(scripts[0]); i++) {
+    OldGame o; o.c = scripts[i].c; o.s.state = STANDBY; o.s.sdActive = false; o.s.autoTyping = false;
+    NewGame n; n.c = scripts[i].c; n.s.state = STANDBY; n.s.sdActive = false; n.s.autoTyping = false;
+    for (size_t k = 0; k < scripts[i].in.size(); k++) { o.step(scripts[i].in[k]); n.step(scripts[i].in[k]); }
+    bool ok = o.s.trace == n.s.trace;
+    if (!ok) fails++;
+    printf("%s  %-11s %s\n", ok ? "PASS" : "FAIL", scripts[i].name, n.s.trace.c_str());
+  }
+
+  printf("%u combinations, %u with a transition, %u failure(s)\n", cases, moved, fails);
+  return fails ? 1 : 0;
+}
+
+static int stateByName(const std::string& name) {
+  for (uint8_t s = 0; s < STATE_COUNT; s++) if (name == stateName(s)) return s;
+  return -1;
+}
+static int eventByName(const std::string& name) {
+  for (uint8_t e = 0; e < EV_COUNT; e++) if (name == stateEventName(e)) return e;
+  return -1;
+}
+
+static int checkLog(const char* path) {
+  FILE* f = fopen(path, "r");
+  if (!f) { perror(path); return 2; }
+  char line[512];
+  unsigned lineNo = 0, seen = 0, bad = 0, gaps = 0;
+  int last = -1;
+  while (fgets(line, sizeof(line), f)) {
+    lineNo++;
+    const char* p = strstr(line, "[STATE] ");
+    if (!p || strstr(p, "refused")) continue;
+    char from[32], to[32], ev[32];
+    if (sscanf(p, "[STATE] %31s -> %31s on %31s", from, to, ev) != 3) continue;
+    seen++;
+    int fs = stateByName(from), ts = stateByName(to), e = eventByName(ev);
+    uint8_t idx = (fs < 0 || e < 0) ? STATE_NO_EDGE : stateEdgeFor(fs, e);
+    if (ts < 0 || idx == STATE_NO_EDGE || STATE_EDGES[idx].to != ts) {
+      printf("%u: not in table: %s -> %s on %s\n", lineNo, from, to, ev);
+      bad++;
+    }
+    // EF_SILENT edges and dropped log records leave gaps; report, don't fail
+    if (last >= 0 && fs >= 0 && fs != last) { printf("%u: gap: last state %s, next starts at %s\n", lineNo, stateName(last), from); gaps++; }
+    last = ts;
+  }
+  fclose(f);
+  printf("%u transition(s), %u not in table, %u gap(s)\n", seen, bad, gaps);
+  return bad ? 1 : 0;
+}
+
+int main(int argc, char** argv) {
+  if (argc > 1 && !strcmp(argv[1], "table")) return printTable();
+  if (argc > 1 && !strcmp(argv[1], "selftest")) return selftest();
+  if (argc > 2 && !strcmp(argv[1], "check")) return checkLog(argv[2]);
+  fprintf(stderr, "usage: %s table | selftest | check <log.txt>\n", argv[0]);
+  return 2;
+}